@@ -0,0 +1,50 @@
+// Copyright (c) 2025 Elias Bachaalany
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+/// @file bench_common.hpp
+/// @brief Minimal timing helpers shared by the micro-benchmarks
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+
+namespace bench
+{
+
+using Clock = std::chrono::steady_clock;
+
+/// Prevent the optimizer from discarding a computed value
+template <typename T>
+inline void do_not_optimize(const T& value)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    asm volatile("" : : "g"(&value) : "memory");
+#else
+    static volatile const void* sink;
+    sink = &value;
+#endif
+}
+
+/// Run fn() `iterations` times and print throughput and per-op latency
+template <typename Fn>
+inline double run(const std::string& name, uint64_t iterations, Fn&& fn)
+{
+    // Warm-up pass (1% of the iterations, at least one)
+    for (uint64_t i = 0; i < iterations / 100 + 1; ++i)
+        fn();
+
+    auto start = Clock::now();
+    for (uint64_t i = 0; i < iterations; ++i)
+        fn();
+    auto elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+
+    double ops_per_sec = elapsed > 0 ? static_cast<double>(iterations) / elapsed : 0.0;
+    double ns_per_op = iterations > 0 ? elapsed * 1e9 / static_cast<double>(iterations) : 0.0;
+    std::printf("%-48s %12.0f ops/s %10.1f ns/op\n", name.c_str(), ops_per_sec, ns_per_op);
+    return ops_per_sec;
+}
+
+} // namespace bench
@@ -0,0 +1,96 @@
+// Copyright (c) 2025 Elias Bachaalany
+// SPDX-License-Identifier: MIT
+
+// Compares ways of obtaining the last few events of a 50k-event session:
+// decoding the whole session.getMessages payload (get_messages), decoding only
+// the tail after a known id (get_messages_since fallback), and serving the tail
+// from the event history ring (get_messages_since fast path).
+
+#include "bench_common.hpp"
+
+#include <copilot/session.hpp>
+#include <cstdio>
+#include <string>
+
+using namespace copilot;
+
+namespace
+{
+
+constexpr int kEvents = 50'000;
+constexpr int kTail = 10;
+
+json make_event_json(int i)
+{
+    std::string id = "evt-" + std::to_string(i);
+    if (i % 2 == 0)
+        return {
+            {"type", "assistant.message"},
+            {"id", id},
+            {"timestamp", "2025-06-01T00:00:00Z"},
+            {"data", {{"messageId", "msg-" + std::to_string(i)}, {"content", std::string(200, 'a')}}}
+        };
+    return {
+        {"type", "tool.execution_complete"},
+        {"id", id},
+        {"timestamp", "2025-06-01T00:00:00Z"},
+        {"data",
+         {{"toolCallId", "call-" + std::to_string(i)},
+          {"success", true},
+          {"result", {{"content", std::string(200, 'r')}}}}}
+    };
+}
+
+} // namespace
+
+int main()
+{
+    json events = json::array();
+    for (int i = 0; i < kEvents; ++i)
+        events.push_back(make_event_json(i));
+    const std::string known_id = "evt-" + std::to_string(kEvents - kTail - 1);
+    std::printf("payload: %d events, %zu bytes\n", kEvents, events.dump().size());
+
+    bench::run(
+        "get_messages/decode_all",
+        5,
+        [&]
+        {
+            std::vector<SessionEvent> all;
+            for (const auto& j : events)
+                all.push_back(parse_session_event(j));
+            bench::do_not_optimize(all);
+        }
+    );
+
+    bench::run(
+        "get_messages_since/decode_tail",
+        200,
+        [&]
+        {
+            auto tail = parse_session_events_after(events, known_id);
+            bench::do_not_optimize(tail);
+        }
+    );
+
+    auto session = std::make_shared<Session>("bench-session", nullptr);
+    EventHistoryOptions options;
+    options.max_events = kEvents;
+    session->enable_history(options);
+    for (const auto& j : events)
+        session->dispatch_event(parse_session_event(j));
+
+    bench::run(
+        "get_messages_since/history_ring",
+        200,
+        [&]
+        {
+            auto tail = session->get_messages_since(known_id).get();
+            bench::do_not_optimize(tail);
+        }
+    );
+
+    auto stats = session->history_stats();
+    std::printf("  history: %zu events, ~%zu bytes\n", stats.events, stats.bytes);
+    return 0;
+}
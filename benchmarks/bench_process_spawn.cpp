@@ -0,0 +1,80 @@
+// Copyright (c) 2025 Elias Bachaalany
+// SPDX-License-Identifier: MIT
+
+// Measures Process::spawn + wait latency for a trivial child (`true`) with
+// fork + execve versus posix_spawn, while the parent holds progressively more
+// resident memory. fork has to copy the parent's page tables, so its cost grows
+// with RSS; posix_spawn does not.
+//
+// Usage: bench_process_spawn [rss_mb ...]   (default: 0 256 1024)
+
+#include "bench_common.hpp"
+
+#include <copilot/process.hpp>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace copilot;
+
+#ifndef _WIN32
+
+namespace
+{
+
+constexpr uint64_t kSpawns = 200;
+
+void spawn_true(SpawnMethod method)
+{
+    ProcessOptions opts;
+    opts.redirect_stdin = false;
+    opts.redirect_stdout = false;
+    opts.spawn_method = method;
+
+    Process proc;
+    proc.spawn("true", {}, opts);
+    proc.wait();
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    std::vector<size_t> sizes_mb;
+    for (int i = 1; i < argc; ++i)
+        sizes_mb.push_back(std::strtoull(argv[i], nullptr, 10));
+    if (sizes_mb.empty())
+        sizes_mb = {0, 256, 1024};
+
+    // Grow a ballast allocation and touch every page so it is really resident
+    std::vector<std::unique_ptr<char[]>> ballast;
+    size_t resident_mb = 0;
+    for (size_t target_mb : sizes_mb)
+    {
+        for (; resident_mb < target_mb; ++resident_mb)
+        {
+            ballast.emplace_back(new char[1024 * 1024]);
+            std::memset(ballast.back().get(), 1, 1024 * 1024);
+        }
+
+        std::string rss = "rss+" + std::to_string(target_mb) + "MB";
+        bench::run("spawn/fork/" + rss, kSpawns, [] { spawn_true(SpawnMethod::Fork); });
+        bench::run(
+            "spawn/posix_spawn/" + rss, kSpawns, [] { spawn_true(SpawnMethod::PosixSpawn); }
+        );
+    }
+    return 0;
+}
+
+#else
+
+int main()
+{
+    std::printf("bench_process_spawn: POSIX only (Windows always uses CreateProcess)\n");
+    return 0;
+}
+
+#endif
@@ -0,0 +1,66 @@
+// Copyright (c) 2025 Elias Bachaalany
+// SPDX-License-Identifier: MIT
+
+// Measures Session::dispatch_event throughput (events/sec) for a streaming
+// delta event with 1, 10 and 100 subscribers, and with 100 type-filtered
+// subscribers of which only one wants deltas.
+
+#include "bench_common.hpp"
+
+#include <copilot/session.hpp>
+#include <vector>
+
+using namespace copilot;
+
+int main()
+{
+    SessionEvent event;
+    event.id = "evt-1";
+    event.timestamp = "2025-01-01T00:00:00Z";
+    event.type = SessionEventType::AssistantMessageDelta;
+    event.type_string = "assistant.message_delta";
+    event.data = AssistantMessageDeltaData{"msg-1", "token", std::nullopt, std::nullopt};
+
+    for (int subscribers : {1, 10, 100})
+    {
+        auto session = std::make_shared<Session>("bench-session", nullptr);
+
+        // Handlers capture some state so that copying them would not be free
+        std::vector<Subscription> subs;
+        uint64_t total = 0;
+        std::string captured(64, 'x');
+        for (int i = 0; i < subscribers; ++i)
+            subs.push_back(session->on([&total, captured](const SessionEvent& evt)
+                                       { total += evt.id.size() + captured.size(); }));
+
+        uint64_t iterations = 10'000'000 / static_cast<uint64_t>(subscribers);
+        bench::run(
+            "dispatch_event/" + std::to_string(subscribers) + "_subscribers",
+            iterations,
+            [&] { session->dispatch_event(event); }
+        );
+        bench::do_not_optimize(total);
+    }
+
+    {
+        auto session = std::make_shared<Session>("bench-session", nullptr);
+
+        std::vector<Subscription> subs;
+        uint64_t total = 0;
+        for (int i = 0; i < 99; ++i)
+            subs.push_back(session->on<AssistantMessageData>([&total](const AssistantMessageData&)
+                                                             { total++; }));
+        subs.push_back(session->on<AssistantMessageDeltaData>(
+            [&total](const AssistantMessageDeltaData& delta) { total += delta.delta_content.size(); }
+        ));
+
+        bench::run(
+            "dispatch_event/100_filtered_subscribers",
+            10'000'000,
+            [&] { session->dispatch_event(event); }
+        );
+        bench::do_not_optimize(total);
+    }
+
+    return 0;
+}
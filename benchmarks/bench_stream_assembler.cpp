@@ -0,0 +1,118 @@
+// Copyright (c) 2025 Elias Bachaalany
+// SPDX-License-Identifier: MIT
+
+// Measures the per-delta cost of StreamAssembler (direct and through
+// Session::dispatch_event) against naive std::string concatenation, and checks
+// that assembler memory stays flat across many completed messages.
+
+#include "bench_common.hpp"
+
+#include <copilot/session.hpp>
+#include <copilot/stream_assembler.hpp>
+#include <cstdio>
+#include <string>
+
+using namespace copilot;
+
+namespace
+{
+
+constexpr uint64_t kDeltasPerMessage = 2000;
+constexpr uint64_t kIterations = 4'000'000;
+
+SessionEvent make_delta(const std::string& message_id, const std::string& text)
+{
+    SessionEvent event;
+    event.id = "evt";
+    event.timestamp = "2025-01-01T00:00:00Z";
+    event.type = SessionEventType::AssistantMessageDelta;
+    event.type_string = "assistant.message_delta";
+    event.data = AssistantMessageDeltaData{message_id, text, std::nullopt, std::nullopt};
+    return event;
+}
+
+SessionEvent make_message(const std::string& message_id)
+{
+    SessionEvent event;
+    event.id = "evt";
+    event.timestamp = "2025-01-01T00:00:00Z";
+    event.type = SessionEventType::AssistantMessage;
+    event.type_string = "assistant.message";
+    AssistantMessageData data;
+    data.message_id = message_id;
+    event.data = data;
+    return event;
+}
+
+} // namespace
+
+int main()
+{
+    const std::string token = "token_42";
+
+    {
+        std::string text;
+        uint64_t n = 0;
+        bench::run(
+            "string_concat/per_delta",
+            kIterations,
+            [&]
+            {
+                text += token;
+                if (++n % kDeltasPerMessage == 0)
+                    text = std::string();
+            }
+        );
+        bench::do_not_optimize(text);
+    }
+
+    {
+        StreamAssembler assembler;
+        const std::string message_id = "msg-1";
+        uint64_t n = 0;
+        bench::run(
+            "assembler_append/per_delta",
+            kIterations,
+            [&]
+            {
+                assembler.append(message_id, token);
+                if (++n % kDeltasPerMessage == 0)
+                    assembler.complete(message_id);
+            }
+        );
+        auto stats = assembler.stats();
+        std::printf(
+            "  messages=%llu allocated_blocks=%zu allocated_bytes=%zu\n",
+            static_cast<unsigned long long>(stats.messages_completed),
+            stats.allocated_blocks,
+            stats.allocated_bytes
+        );
+    }
+
+    {
+        auto session = std::make_shared<Session>("bench-session", nullptr);
+        auto assembler = session->stream_assembler();
+        auto delta = make_delta("msg-1", token);
+        auto done = make_message("msg-1");
+        uint64_t n = 0;
+        bench::run(
+            "session_assembler/per_delta",
+            kIterations,
+            [&]
+            {
+                session->dispatch_event(delta);
+                if (++n % kDeltasPerMessage == 0)
+                    session->dispatch_event(done);
+            }
+        );
+        auto stats = assembler->stats();
+        std::printf(
+            "  messages=%llu allocated_blocks=%zu allocated_bytes=%zu\n",
+            static_cast<unsigned long long>(stats.messages_completed),
+            stats.allocated_blocks,
+            stats.allocated_bytes
+        );
+    }
+
+    return 0;
+}
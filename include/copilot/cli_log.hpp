@@ -0,0 +1,113 @@
+// Copyright (c) 2025 Elias Bachaalany
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+/// @file cli_log.hpp
+/// @brief Bounded capture of the CLI server's stderr
+
+#include <atomic>
+#include <copilot/process.hpp>
+#include <copilot/thread_options.hpp>
+#include <copilot/types.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+namespace copilot
+{
+
+/// Counters describing a CliLog
+struct CliLogStats
+{
+    uint64_t lines = 0;     ///< Lines received
+    uint64_t bytes = 0;     ///< Bytes received
+    uint64_t evicted = 0;   ///< Lines pushed out of the ring by newer ones
+    uint64_t truncated = 0; ///< Lines cut at CliLog::kMaxLineLength
+    uint64_t errors = 0;
+    uint64_t warnings = 0;
+    uint64_t infos = 0;
+    uint64_t debugs = 0;
+    uint64_t unleveled = 0; ///< Lines without a recognizable severity
+};
+
+/// Ring of the most recent log lines, with per-severity counters
+///
+/// Raw output is fed in arbitrary chunks and split into lines; each complete
+/// line is classified, counted and stored, evicting the oldest line once
+/// `capacity` is reached, then passed to the optional sink. The sink runs with
+/// no lock held, so it may call lines() and stats(). Thread-safe.
+class CliLog
+{
+  public:
+    /// Longer lines are truncated (the rest up to the newline is dropped)
+    static constexpr std::size_t kMaxLineLength = 16 * 1024;
+
+    explicit CliLog(std::size_t capacity = 1000, CliLogHandler sink = nullptr);
+
+    /// Append raw output; complete lines are processed immediately
+    void feed(const char* data, std::size_t size);
+
+    /// Process a trailing line that has no newline (e.g. at EOF)
+    void flush();
+
+    /// The stored lines, oldest first
+    std::vector<CliLogLine> lines() const;
+
+    /// Snapshot of the counters
+    CliLogStats stats() const;
+
+    /// Guess the severity of a log line from its first few words
+    /// (e.g. "[ERROR] ...", "2025-06-01T10:00:00Z warn: ...")
+    /// @return LogLevel::None if no level keyword is found
+    static LogLevel parse_level(std::string_view line);
+
+  private:
+    void emit_locked(std::string text, std::vector<CliLogLine>& to_sink);
+    void run_sink(const std::vector<CliLogLine>& lines) const;
+
+    const std::size_t capacity_;
+    const CliLogHandler sink_;
+
+    mutable std::mutex mutex_;
+    std::deque<CliLogLine> lines_;
+    std::string partial_;
+    bool discarding_ = false; // inside an over-long line
+    CliLogStats stats_;
+};
+
+/// Reads a pipe on a background thread into a CliLog until EOF or destruction
+///
+/// Keeps the writer from ever blocking on a full pipe buffer.
+class PipeDrain
+{
+  public:
+    /// @param pipe Must outlive the drain
+    /// @param on_thread_start Called first on the drain thread (ThreadRole::LogDrain)
+    PipeDrain(
+        ReadPipe& pipe, std::shared_ptr<CliLog> log, ThreadStartHook on_thread_start = nullptr
+    );
+
+    /// Stops reading (within ~100 ms if the pipe stays open) and joins the thread
+    ~PipeDrain();
+
+    PipeDrain(const PipeDrain&) = delete;
+    PipeDrain& operator=(const PipeDrain&) = delete;
+
+  private:
+    void run();
+
+    ReadPipe& pipe_;
+    std::shared_ptr<CliLog> log_;
+    ThreadStartHook on_thread_start_;
+    std::atomic<bool> stop_{false};
+    std::thread thread_;
+};
+
+} // namespace copilot
@@ -6,14 +6,21 @@
 /// @file client.hpp
 /// @brief CopilotClient for managing connections to the Copilot CLI server
 
+#include <array>
 #include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <copilot/cli_log.hpp>
 #include <copilot/events.hpp>
 #include <copilot/jsonrpc.hpp>
+#include <copilot/metrics_registry.hpp>
 #include <copilot/process.hpp>
+#include <copilot/rpc_metrics.hpp>
 #include <copilot/transport.hpp>
 #include <copilot/transport_stdio.hpp>
 #include <copilot/transport_tcp.hpp>
 #include <copilot/types.hpp>
+#include <deque>
 #include <functional>
 #include <future>
 #include <map>
@@ -21,7 +28,9 @@
 #include <mutex>
 #include <optional>
 #include <regex>
+#include <shared_mutex>
 #include <string>
+#include <thread>
 #include <vector>
 
 namespace copilot
@@ -46,6 +55,57 @@ json build_session_create_request(const SessionConfig& config);
 /// @return JSON object ready to send to server
 json build_session_resume_request(const std::string& session_id, const ResumeSessionConfig& config);
 
+// =============================================================================
+// Resource Usage
+// =============================================================================
+
+/// CLI server figures combined with SDK-side load (see Client::get_resource_usage())
+struct ClientResourceUsage
+{
+    /// The spawned CLI server; std::nullopt when using cli_url or not started
+    std::optional<ResourceUsage> cli;
+    int cli_pid = 0;
+
+    size_t sessions = 0;         ///< Open sessions
+    size_t pending_requests = 0; ///< JSON-RPC requests awaiting a response
+    uint64_t cli_restarts = 0;   ///< See restart_stats()
+    uint64_t cli_log_bytes = 0;  ///< stderr bytes received from the CLI server
+};
+
+// =============================================================================
+// Rolling Replace
+// =============================================================================
+
+/// How one session moved to the new CLI server (see Client::rolling_replace())
+struct SessionHandoff
+{
+    std::string session_id;
+
+    /// From the pause of new turns until this session's running turn (if any) ended
+    std::chrono::microseconds drain_time{0};
+
+    /// Round trip of its session.resume on the new server
+    std::chrono::microseconds resume_time{0};
+
+    /// From the pause of new turns until the session was attached to the new server
+    std::chrono::microseconds handoff_latency{0};
+};
+
+/// Outcome of Client::rolling_replace()
+struct RollingReplaceResult
+{
+    /// Spawn to protocol check of the new server, while the old one kept serving
+    std::chrono::microseconds startup_time{0};
+
+    /// How long new turns (send / send_and_wait) were held back
+    std::chrono::microseconds pause_time{0};
+
+    std::vector<SessionHandoff> sessions;
+
+    /// Exit code of the retired server
+    std::optional<int> old_exit_code;
+};
+
 // =============================================================================
 // CopilotClient - Main client class
 // =============================================================================
@@ -106,6 +166,72 @@ class Client
     /// Get the current connection state
     ConnectionState state() const;
 
+    /// Exit code of the CLI server process spawned by this client
+    ///
+    /// The exit is observed as it happens (see Process::on_exit); requests still
+    /// in flight at that moment fail immediately with ConnectionClosed instead of
+    /// waiting for their timeouts.
+    /// @return The exit code, or std::nullopt while it runs (or if none was spawned)
+    std::optional<int> cli_exit_code() const;
+
+    /// Counters describing automatic CLI restarts (see ClientOptions::auto_restart)
+    RestartStats restart_stats() const;
+
+    /// Replace the CLI server without taking sessions offline (e.g. to upgrade it)
+    ///
+    /// Spawns a second server from the launch settings of `options` (cli_path,
+    /// cli_args, cwd, port, use_stdio, log_level, environment, github_token,
+    /// use_logged_in_user, node_startup, threads.cli_process) while the current
+    /// one keeps serving. Then new turns are paused, running turns are left to
+    /// finish on the old server, every session is resumed on the new one and
+    /// requests switch over; Session objects stay valid throughout. The old
+    /// server is then shut down. On failure the new server is discarded and the
+    /// client keeps using the old one.
+    /// @param options Launch settings for the new server (cli_url is not allowed)
+    /// @param drain_timeout Longest wait for running turns to finish
+    /// @return Future with per-session hand-off timings
+    /// @throws std::invalid_argument if options are inconsistent or use cli_url
+    /// @throws std::runtime_error if the client is not connected to a server it
+    ///         spawned, the new server fails to start, a turn does not finish in
+    ///         time or a session cannot be resumed
+    std::future<RollingReplaceResult> rolling_replace(
+        ClientOptions options, std::chrono::milliseconds drain_timeout = std::chrono::seconds(30)
+    );
+
+    /// Timing of the most recent CLI server start (or restart), including the
+    /// spawn-to-ready time that ClientOptions::node_startup aims to cut
+    StartupStats startup_stats() const;
+
+    /// CPU, memory, context switches and I/O of the CLI server plus SDK-side load
+    ///
+    /// Samples on each call (see Process::resource_usage()); cheap enough to poll
+    /// for placement or autoscaling decisions across many clients. Does not wait
+    /// for start(), stop() or a restart in progress.
+    ClientResourceUsage get_resource_usage() const;
+
+    /// Per-method JSON-RPC request counts, errors, bytes and latency histograms
+    ///
+    /// `callbacks` and `callback_details` time the answers to the server's
+    /// tool.call, permission.request, userInput.request and hooks.invoke requests,
+    /// split into decode, queue wait, handler and write, per method and per tool
+    /// name, permission kind or hook type.
+    ///
+    /// Totals span CLI restarts and rolling_replace(). Empty (and `enabled` false)
+    /// unless the library was built with COPILOT_ENABLE_RPC_METRICS.
+    RpcMetricsSnapshot get_rpc_metrics() const
+    {
+        return rpc_metrics_ ? rpc_metrics_->snapshot() : RpcMetricsSnapshot{};
+    }
+
+    /// Recent stderr output of the CLI server, with per-severity counters
+    ///
+    /// stderr is read continuously on a background thread, so the CLI never blocks
+    /// on a full pipe. The log spans CLI restarts.
+    const CliLog& cli_log() const
+    {
+        return *cli_log_;
+    }
+
     // =========================================================================
     // Session Management
     // =========================================================================
@@ -183,17 +309,91 @@ class Client
     std::shared_ptr<Session> get_session(const std::string& session_id);
 
     /// Get the JSON-RPC client (internal use)
+    /// Replaced when the CLI server is restarted; the previous client is kept alive
+    /// (stopped) until the next restart, so a pointer in use stays valid.
     JsonRpcClient* rpc_client()
     {
-        return rpc_.get();
+        return rpc_view_.load(std::memory_order_acquire);
+    }
+
+    /// The JSON-RPC client for sending a request (internal use)
+    ///
+    /// None is published while stopped, while the supervisor restarts the CLI
+    /// server, or after it gave up on a crash loop.
+    /// @throws JsonRpcError (ConnectionClosed) if there is no connection
+    JsonRpcClient& connected_rpc();
+
+    /// Held (shared) by Session while sending session.send (internal use);
+    /// rolling_replace() holds it exclusively to pause new turns
+    std::shared_lock<std::shared_mutex> send_gate()
+    {
+        return std::shared_lock<std::shared_mutex>(send_gate_);
     }
 
   private:
+    /// How the CLI server is launched, derived from the launch fields of options_
+    struct CliLaunch
+    {
+        SpawnSpec spec;
+        bool node_accelerated = false;
+        std::optional<std::string> compile_cache_dir;
+    };
+
+    /// Resolve the CLI command and build its argv/environment from options_
+    CliLaunch prepare_cli_launch();
+
     /// Start the CLI server process
     void start_cli_server();
 
     /// Connect to the server (stdio or TCP)
-    void connect_to_server();
+    /// @param publish Make the new connection the one rpc_client() returns
+    void connect_to_server(bool publish = true);
+
+    /// Called on the process exit watcher when the CLI server exits
+    /// @param generation cli_generation_ when the process was spawned
+    void handle_cli_exit(uint64_t generation, int exit_code);
+
+    /// Start / stop the thread that restarts the CLI server (auto_restart)
+    void start_supervisor();
+    void stop_supervisor();
+
+    /// Supervisor thread body
+    void supervise();
+
+    /// Respawn the CLI server, reconnect and resume sessions
+    /// @param exit_time When the previous process exited (for downtime stats)
+    /// @return true on success
+    bool restart_cli_server(std::chrono::steady_clock::time_point exit_time);
+
+    /// Stop the RPC client, reap the process and park both in retired_ (mutex_ held)
+    void retire_connection();
+
+    /// Resume every open session on the current connection, concurrently
+    void reattach_sessions();
+
+    /// Hook that names and places SDK threads per options_.threads
+    ThreadStartHook thread_start_hook();
+
+    /// Attach the options_.event_journal_dir journal, if one is configured and opens
+    void attach_event_journal(Session& session);
+
+    /// Collector registered with options_.metrics
+    void collect_metrics(MetricsWriter& writer) const;
+
+    /// Make `process` the one get_resource_usage() samples (null: none).
+    /// Cleared before the current process is destroyed or replaced.
+    void publish_cli_process(Process* process);
+
+    /// Record spawn-to-ready once the spawned CLI passed the protocol check
+    void record_cli_ready();
+
+    /// Validate options and fill in defaults (constructor and rolling_replace())
+    static void normalize_options(ClientOptions& options);
+
+    /// rolling_replace() body (mutex_ and session_registry_mutex_ held)
+    RollingReplaceResult replace_cli_server(
+        const ClientOptions& launch, std::chrono::milliseconds drain_timeout
+    );
 
     /// Verify protocol version matches
     void verify_protocol_version();
@@ -231,12 +431,71 @@ class Client
 
     // Components
     std::unique_ptr<Process> process_;
+    std::unique_ptr<PipeDrain> stderr_drain_; // reads process_'s stderr; reset before it
+    std::shared_ptr<CliLog> cli_log_;
     std::unique_ptr<ITransport> transport_;
-    std::unique_ptr<JsonRpcClient> rpc_;
+    std::shared_ptr<JsonRpcClient> rpc_;
+
+    std::atomic<JsonRpcClient*> rpc_view_{nullptr};
+
+    // CLI exit (guards rpc_ against the exit watcher; process_.reset() joins it)
+    mutable std::mutex cli_exit_mutex_;
+    std::optional<int> cli_exit_code_;
+    uint64_t cli_generation_ = 0; // exits of replaced processes are ignored
 
-    // Sessions
+    // Auto-restart supervisor
+    struct RetiredConnection
+    {
+        std::unique_ptr<Process> process;
+        std::shared_ptr<JsonRpcClient> rpc; // destroyed first (uses the pipes)
+    };
+    std::thread supervisor_thread_;
+    std::mutex supervisor_mutex_;
+    std::condition_variable supervisor_cv_;
+    bool supervisor_stop_ = false;
+    bool restart_requested_ = false;
+    std::chrono::steady_clock::time_point exit_time_;
+    std::deque<std::chrono::steady_clock::time_point> restart_times_;
+    RetiredConnection retired_;
+    mutable std::mutex restart_stats_mutex_;
+    RestartStats restart_stats_;
+
+    // Shared by every connection so totals survive reconnects
+#if COPILOT_ENABLE_RPC_METRICS
+    std::shared_ptr<RpcMetrics> rpc_metrics_ = std::make_shared<RpcMetrics>();
+#else
+    std::shared_ptr<RpcMetrics> rpc_metrics_;
+#endif
+    std::shared_ptr<TransportCounters> transport_counters_ =
+        std::make_shared<TransportCounters>();
+
+    // Reported through options_.metrics
+    std::array<std::atomic<uint64_t>, kSessionEventTypeCount> event_counts_{};
+    int metrics_collector_ = -1;
+
+    // process_ as seen by get_resource_usage(), which must not take mutex_
+    // (held across start, stop and restarts)
+    mutable std::mutex usage_mutex_;
+    Process* usage_process_ = nullptr;
+
+    // CLI startup timing
+    std::optional<CliLaunch> cli_launch_; // mutex_ held; reset when launch options change
+    std::chrono::steady_clock::time_point spawn_started_;
+    mutable std::mutex startup_stats_mutex_;
+    StartupStats startup_stats_;
+
+    // Sessions (writers hold mutex_ and sessions_mutex_; readers either, so
+    // event dispatch does not wait for connection management)
+    mutable std::mutex sessions_mutex_;
     std::map<std::string, std::shared_ptr<Session>> sessions_;
 
+    // Rolling replace: creation/removal of sessions and new turns wait for it
+    std::shared_mutex session_registry_mutex_; // taken before mutex_
+    std::shared_mutex send_gate_;
+
+    /// session.resume request that re-attaches each session after a restart
+    std::map<std::string, json> session_attach_requests_;
+
     // Models cache
     mutable std::mutex models_cache_mutex_;
     std::optional<std::vector<ModelInfo>> models_cache_;
@@ -9,15 +9,25 @@
 /// This header includes all public API headers for convenience.
 /// You can also include individual headers for finer-grained control.
 
+#include <copilot/cli_log.hpp>
 #include <copilot/client.hpp>
+#include <copilot/event_journal.hpp>
+#include <copilot/event_stream.hpp>
 #include <copilot/events.hpp>
 #include <copilot/jsonrpc.hpp>
+#include <copilot/metrics_registry.hpp>
+#include <copilot/node_startup.hpp>
 #include <copilot/process.hpp>
+#include <copilot/rpc_metrics.hpp>
 #include <copilot/session.hpp>
+#include <copilot/stream_assembler.hpp>
+#include <copilot/thread_options.hpp>
 #include <copilot/tool_builder.hpp>
+#include <copilot/trace.hpp>
 #include <copilot/transport.hpp>
 #include <copilot/transport_stdio.hpp>
 #include <copilot/transport_tcp.hpp>
+#include <copilot/turn_profiler.hpp>
 #include <copilot/types.hpp>
 
 namespace copilot
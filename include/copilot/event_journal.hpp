@@ -0,0 +1,189 @@
+// Copyright (c) 2025 Elias Bachaalany
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+/// @file event_journal.hpp
+/// @brief Local append-only event log for fast cold resume
+
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <copilot/events.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace copilot
+{
+
+/// Configuration for an EventJournal
+struct EventJournalOptions
+{
+    /// Start a new segment file once the current one would exceed this size
+    std::size_t segment_bytes = 8 * 1024 * 1024;
+
+    /// How long after the first unsynced append the background flusher fsyncs
+    /// (0 = as soon as possible, one fsync covering every append made while the
+    /// last one ran)
+    ///
+    /// Appends only write into the stdio buffer; flushing and fsync happen on a
+    /// single flusher thread shared by every journal in the process, which only
+    /// visits journals with unsynced records. Events appended since the last sync
+    /// can be lost if the machine crashes; a process crash loses at most the stdio
+    /// buffer.
+    std::chrono::milliseconds sync_interval{1000};
+
+    /// Also journal ephemeral events (e.g. streaming deltas), which the server
+    /// does not persist either
+    bool include_ephemeral = false;
+};
+
+/// Counters describing an EventJournal
+struct EventJournalStats
+{
+    std::size_t events = 0;        ///< Records in the journal
+    std::size_t segments = 0;      ///< Segment files
+    uint64_t bytes_written = 0;    ///< Bytes appended by this instance
+    uint64_t syncs = 0;            ///< fsync calls made by this instance
+    uint64_t write_errors = 0;     ///< Appends that failed
+    uint64_t recovered_bytes = 0;  ///< Torn tail bytes discarded when opening
+};
+
+/// Append-only, segmented event log for one session
+///
+/// Each dispatched event is stored in its wire form as a compact MessagePack
+/// record, preceded by a small header carrying the event type, id and a
+/// checksum. Opening a journal scans the record headers only, building an index
+/// by event id and by type; events are decoded lazily when read. On POSIX,
+/// segments are read through read-only memory maps.
+///
+/// Example usage:
+/// @code
+/// // After a restart, rebuild the conversation without JSON-RPC:
+/// auto journal = EventJournal::open("journals/" + session_id);
+/// for (const auto& event : journal->read_all())
+///     render(event);
+/// @endcode
+class EventJournal : public std::enable_shared_from_this<EventJournal>
+{
+  public:
+    /// Open the journal in `directory`, creating it if needed
+    ///
+    /// A torn record at the end of the last segment (e.g. after a crash) is
+    /// truncated away.
+    /// @throws std::runtime_error if the directory or a segment cannot be opened
+    static std::shared_ptr<EventJournal> open(
+        const std::string& directory, EventJournalOptions options = {}
+    );
+
+    /// Syncs and closes the active segment
+    ~EventJournal();
+
+    // Non-copyable, non-movable (shared between the session and readers)
+    EventJournal(const EventJournal&) = delete;
+    EventJournal& operator=(const EventJournal&) = delete;
+
+    // =========================================================================
+    // Writing
+    // =========================================================================
+
+    /// Append an event in its wire (JSON) form
+    ///
+    /// Only a buffered write; never waits for the disk to sync.
+    /// @return false if the event was skipped (ephemeral and not included)
+    /// @throws std::runtime_error if the write fails
+    bool append(const json& event_json);
+
+    /// Flush buffered records and fsync them, waiting until done
+    void sync();
+
+    /// Have the flusher sync now, without waiting for it
+    void request_sync();
+
+    // =========================================================================
+    // Reading
+    // =========================================================================
+
+    /// Number of records
+    std::size_t size() const;
+
+    /// Whether an event with this id is in the journal
+    bool contains(const std::string& event_id) const;
+
+    /// Decode the record at `index` (0 = oldest)
+    std::optional<SessionEvent> read(std::size_t index) const;
+
+    /// Decode the event with the given id
+    std::optional<SessionEvent> find(const std::string& event_id) const;
+
+    /// Decode every record, oldest first
+    std::vector<SessionEvent> read_all() const;
+
+    /// Decode the records after `event_id` (all records if it is unknown)
+    std::vector<SessionEvent> read_since(const std::string& event_id) const;
+
+    /// Decode only the records whose type is in `types`
+    std::vector<SessionEvent> read_types(SessionEventTypeMask types) const;
+
+    /// Record indices of one event type, oldest first (nothing is decoded)
+    std::vector<std::size_t> indices_of_type(SessionEventType type) const;
+
+    /// Directory holding the segment files
+    const std::string& directory() const
+    {
+        return directory_;
+    }
+
+    /// Snapshot of the journal's counters
+    EventJournalStats stats() const;
+
+  private:
+    struct RecordRef
+    {
+        uint32_t segment;  // index into segments_
+        uint64_t offset;   // of the MessagePack payload within the segment file
+        uint32_t size;     // payload bytes
+        SessionEventType type;
+    };
+
+    struct Segment;
+    class Flusher;
+
+    EventJournal(std::string directory, EventJournalOptions options);
+
+    void load_segments();
+    void index_segment(uint32_t segment_index, bool is_last);
+    void open_new_segment();
+    void sync_locked(std::unique_lock<std::mutex>& lock);
+    void schedule_sync(std::chrono::milliseconds delay);
+    void flush_scheduled();
+    std::optional<SessionEvent> decode_locked(const RecordRef& ref) const;
+
+    const std::string directory_;
+    const EventJournalOptions options_;
+
+    mutable std::mutex mutex_;
+    std::vector<std::unique_ptr<Segment>> segments_;
+    std::vector<RecordRef> records_;
+    std::unordered_map<std::string, std::size_t> by_id_;
+    std::array<std::vector<std::size_t>, kSessionEventTypeCount> by_type_;
+
+    std::FILE* active_ = nullptr; // append handle for segments_.back()
+    uint64_t active_size_ = 0;
+    bool dirty_ = false;          // appended since the last sync
+    std::vector<int> unsynced_fds_; // duplicates of rolled-over segments, synced next
+    EventJournalStats stats_;
+
+    std::condition_variable flush_cv_;
+    bool syncing_ = false;   // an fsync is running without the lock
+    bool scheduled_ = false; // queued on the shared flusher since the last sync
+};
+
+} // namespace copilot
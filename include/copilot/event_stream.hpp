@@ -0,0 +1,182 @@
+// Copyright (c) 2025 Elias Bachaalany
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+/// @file event_stream.hpp
+/// @brief Pull-based, bounded session event queue
+
+#include <chrono>
+#include <condition_variable>
+#include <copilot/events.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <vector>
+
+namespace copilot
+{
+
+/// What an EventStream does with a new event when it is full
+enum class StreamOverflowPolicy
+{
+    /// Wait for the consumer to make room (back-pressures the read thread)
+    Block,
+    /// Discard the oldest queued event
+    DropOldest,
+    /// Merge streaming deltas into the newest queued delta of the same message;
+    /// other events wait for room as with Block
+    CoalesceDeltas
+};
+
+/// Configuration for an EventStream
+struct EventStreamOptions
+{
+    /// Maximum number of queued events (at least 1)
+    std::size_t capacity = 1024;
+
+    /// Behavior when the stream is full
+    StreamOverflowPolicy overflow = StreamOverflowPolicy::Block;
+
+    /// Queue depth at which streaming deltas start being coalesced (0 = only
+    /// when full under CoalesceDeltas). Once the consumer falls this far behind,
+    /// a delta for the same message as the newest queued delta is merged into it
+    /// instead of taking a new slot.
+    std::size_t coalesce_threshold = 0;
+};
+
+/// Counters describing an EventStream's traffic
+struct EventStreamStats
+{
+    uint64_t pushed_events = 0;    ///< Events accepted (including merged ones)
+    uint64_t popped_events = 0;    ///< Events handed to the consumer
+    uint64_t dropped_events = 0;   ///< Events discarded (DropOldest or closed)
+    uint64_t coalesced_deltas = 0; ///< Deltas merged into an already queued delta
+    std::size_t max_depth = 0;     ///< Highest queue depth observed
+};
+
+/// Bounded ring buffer of session events for pull-based consumers
+///
+/// The session's dispatch path pushes events; consumer threads drain them with
+/// try_pop(), pop() or pop_n(). No user code runs on the read thread. The ring
+/// holds `capacity` SessionEvent slots, default-constructed up front. push()
+/// copies the event before taking the lock and only moves it into its slot under
+/// it (a coalesced delta is appended to the queued one instead); pops move events
+/// out. pop_n() drains a whole batch under a single lock acquisition.
+///
+/// Example usage:
+/// @code
+/// auto stream = session->open_stream(1024, StreamOverflowPolicy::CoalesceDeltas);
+/// std::vector<SessionEvent> batch;
+/// while (stream->pop_n(batch, 64, std::chrono::milliseconds(100)) > 0 || !stream->is_closed())
+/// {
+///     for (const auto& evt : batch)
+///         handle(evt);
+///     batch.clear();
+/// }
+/// @endcode
+class EventStream
+{
+  public:
+    /// Create a stream
+    /// @param capacity Maximum number of queued events (at least 1)
+    /// @param policy Behavior when the stream is full
+    explicit EventStream(
+        std::size_t capacity, StreamOverflowPolicy policy = StreamOverflowPolicy::Block
+    );
+
+    /// Create a stream from options
+    explicit EventStream(const EventStreamOptions& options);
+    ~EventStream();
+
+    // Non-copyable, non-movable (consumers hold it by shared_ptr)
+    EventStream(const EventStream&) = delete;
+    EventStream& operator=(const EventStream&) = delete;
+
+    // =========================================================================
+    // Consumer API
+    // =========================================================================
+
+    /// Pop the oldest event without waiting
+    /// @return Event, or nullopt if the stream is empty
+    std::optional<SessionEvent> try_pop();
+
+    /// Pop the oldest event, waiting up to `timeout` for one to arrive
+    /// @return Event, or nullopt on timeout or when the stream is closed and empty
+    std::optional<SessionEvent> pop(std::chrono::milliseconds timeout);
+
+    /// Move up to `max_events` queued events into `out` (appended)
+    /// @param timeout How long to wait if the stream is empty (0 = don't wait)
+    /// @return Number of events appended
+    std::size_t pop_n(
+        std::vector<SessionEvent>& out,
+        std::size_t max_events,
+        std::chrono::milliseconds timeout = std::chrono::milliseconds{0}
+    );
+
+    /// Close the stream: wakes waiting consumers and producers, drops further events.
+    /// Already queued events can still be popped.
+    void close();
+
+    /// Check if the stream has been closed
+    bool is_closed() const;
+
+    /// Number of queued events
+    std::size_t size() const;
+
+    /// Maximum number of queued events
+    std::size_t capacity() const
+    {
+        return capacity_;
+    }
+
+    /// Overflow policy
+    StreamOverflowPolicy policy() const
+    {
+        return policy_;
+    }
+
+    /// Number of events discarded by DropOldest or because the stream was closed
+    uint64_t dropped_events() const;
+
+    /// Number of deltas merged into an already queued delta
+    uint64_t coalesced_deltas() const;
+
+    /// Snapshot of the stream's counters
+    EventStreamStats stats() const;
+
+    // =========================================================================
+    // Producer API (called by Session)
+    // =========================================================================
+
+    /// Queue an event, applying the overflow policy if the stream is full
+    /// @return false if the event was discarded because the stream is closed
+    bool push(const SessionEvent& event);
+
+    /// Set a callback run once when the stream is closed or destroyed
+    /// (Session uses it to drop the stream's event subscription)
+    void set_on_close(std::function<void()> on_close);
+
+  private:
+    SessionEvent pop_front_locked();
+    void run_on_close();
+
+    const std::size_t capacity_;
+    const StreamOverflowPolicy policy_;
+    const std::size_t coalesce_threshold_; // 0 = never coalesce
+
+    mutable std::mutex mutex_;
+    std::condition_variable not_empty_;
+    std::condition_variable not_full_;
+    std::vector<SessionEvent> ring_;
+    std::size_t head_ = 0;  // index of the oldest event
+    std::size_t count_ = 0; // number of queued events
+    bool closed_ = false;
+    EventStreamStats stats_;
+
+    std::function<void()> on_close_;
+};
+
+} // namespace copilot
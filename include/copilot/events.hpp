@@ -4,10 +4,14 @@
 #pragma once
 
 #include <chrono>
+#include <copilot/trace.hpp>
 #include <copilot/types.hpp>
+#include <cstddef>
+#include <cstdint>
 #include <map>
 #include <optional>
 #include <string>
+#include <type_traits>
 #include <variant>
 #include <vector>
 
@@ -1044,6 +1048,61 @@ using SessionEventData = std::variant<
     json // Unknown event fallback
     >;
 
+/// Number of SessionEventType values, including Unknown
+inline constexpr std::size_t kSessionEventTypeCount =
+    static_cast<std::size_t>(SessionEventType::Unknown) + 1;
+
+static_assert(
+    std::variant_size_v<SessionEventData> == kSessionEventTypeCount,
+    "SessionEventData alternatives must line up with SessionEventType values"
+);
+
+/// Bit set of SessionEventType values (bit N = SessionEventType with value N)
+using SessionEventTypeMask = uint64_t;
+
+static_assert(kSessionEventTypeCount <= 64, "SessionEventTypeMask is too narrow");
+
+/// Mask bit for a single event type
+constexpr SessionEventTypeMask session_event_type_bit(SessionEventType type)
+{
+    return SessionEventTypeMask{1} << static_cast<unsigned>(type);
+}
+
+/// Mask with every event type set
+inline constexpr SessionEventTypeMask kAllSessionEventTypes =
+    (kSessionEventTypeCount == 64) ? ~SessionEventTypeMask{0}
+                                   : (SessionEventTypeMask{1} << kSessionEventTypeCount) - 1;
+
+namespace detail
+{
+
+template <typename T, typename Variant>
+struct variant_index;
+
+template <typename T, typename... Ts>
+struct variant_index<T, std::variant<Ts...>>
+{
+    static constexpr std::size_t find()
+    {
+        constexpr bool matches[] = {std::is_same_v<T, Ts>...};
+        for (std::size_t i = 0; i < sizeof...(Ts); ++i)
+            if (matches[i])
+                return i;
+        return sizeof...(Ts);
+    }
+
+    static constexpr std::size_t value = find();
+};
+
+} // namespace detail
+
+/// SessionEventType carried by an event data type
+/// (e.g. session_event_type_v<AssistantMessageDeltaData> == AssistantMessageDelta)
+template <typename T>
+inline constexpr SessionEventType session_event_type_v = static_cast<SessionEventType>(
+    detail::variant_index<T, SessionEventData>::value
+);
+
 /// Base session event with common fields and typed data
 struct SessionEvent
 {
@@ -1077,24 +1136,10 @@ struct SessionEvent
     }
 };
 
-/// Parse session event from JSON
-inline SessionEvent parse_session_event(const json& j)
+/// Map a wire event type string (e.g. "assistant.message") to its enum value
+/// @return SessionEventType::Unknown for unrecognized types
+inline SessionEventType parse_session_event_type(const std::string& type_string)
 {
-    SessionEvent event;
-
-    // Parse common fields
-    event.id = j.at("id").get<std::string>();
-    event.timestamp = j.at("timestamp").get<std::string>();
-    if (j.contains("parentId") && !j.at("parentId").is_null())
-        event.parent_id = j.at("parentId").get<std::string>();
-    if (j.contains("ephemeral"))
-        event.ephemeral = j.at("ephemeral").get<bool>();
-
-    // Parse type and data
-    event.type_string = j.at("type").get<std::string>();
-    const auto& data_json = j.at("data");
-
-    // Map type string to enum and parse data
     static const std::map<std::string, SessionEventType> type_map = {
         {"session.start", SessionEventType::SessionStart},
         {"session.resume", SessionEventType::SessionResume},
@@ -1139,11 +1184,117 @@ inline SessionEvent parse_session_event(const json& j)
         {"skill.invoked", SessionEventType::SkillInvoked},
     };
 
-    auto it = type_map.find(event.type_string);
-    if (it != type_map.end())
+    auto it = type_map.find(type_string);
+    return it != type_map.end() ? it->second : SessionEventType::Unknown;
+}
+
+/// Wire name of an event type ("unknown" for SessionEventType::Unknown)
+inline const char* session_event_type_name(SessionEventType type)
+{
+    switch (type)
     {
-        event.type = it->second;
+    case SessionEventType::SessionStart:
+        return "session.start";
+    case SessionEventType::SessionResume:
+        return "session.resume";
+    case SessionEventType::SessionError:
+        return "session.error";
+    case SessionEventType::SessionIdle:
+        return "session.idle";
+    case SessionEventType::SessionInfo:
+        return "session.info";
+    case SessionEventType::SessionModelChange:
+        return "session.model_change";
+    case SessionEventType::SessionHandoff:
+        return "session.handoff";
+    case SessionEventType::SessionTruncation:
+        return "session.truncation";
+    case SessionEventType::UserMessage:
+        return "user.message";
+    case SessionEventType::PendingMessagesModified:
+        return "pending_messages.modified";
+    case SessionEventType::AssistantTurnStart:
+        return "assistant.turn_start";
+    case SessionEventType::AssistantIntent:
+        return "assistant.intent";
+    case SessionEventType::AssistantReasoning:
+        return "assistant.reasoning";
+    case SessionEventType::AssistantReasoningDelta:
+        return "assistant.reasoning_delta";
+    case SessionEventType::AssistantMessage:
+        return "assistant.message";
+    case SessionEventType::AssistantMessageDelta:
+        return "assistant.message_delta";
+    case SessionEventType::AssistantTurnEnd:
+        return "assistant.turn_end";
+    case SessionEventType::AssistantUsage:
+        return "assistant.usage";
+    case SessionEventType::Abort:
+        return "abort";
+    case SessionEventType::ToolUserRequested:
+        return "tool.user_requested";
+    case SessionEventType::ToolExecutionStart:
+        return "tool.execution_start";
+    case SessionEventType::ToolExecutionPartialResult:
+        return "tool.execution_partial_result";
+    case SessionEventType::ToolExecutionComplete:
+        return "tool.execution_complete";
+    case SessionEventType::ToolExecutionProgress:
+        return "tool.execution_progress";
+    case SessionEventType::SessionCompactionStart:
+        return "session.compaction_start";
+    case SessionEventType::SessionCompactionComplete:
+        return "session.compaction_complete";
+    case SessionEventType::SessionUsageInfo:
+        return "session.usage_info";
+    case SessionEventType::CustomAgentStarted:
+        return "subagent.started";
+    case SessionEventType::CustomAgentCompleted:
+        return "subagent.completed";
+    case SessionEventType::CustomAgentFailed:
+        return "subagent.failed";
+    case SessionEventType::CustomAgentSelected:
+        return "subagent.selected";
+    case SessionEventType::HookStart:
+        return "hook.start";
+    case SessionEventType::HookEnd:
+        return "hook.end";
+    case SessionEventType::SystemMessage:
+        return "system.message";
+    case SessionEventType::SessionSnapshotRewind:
+        return "session.snapshot_rewind";
+    case SessionEventType::SessionShutdown:
+        return "session.shutdown";
+    case SessionEventType::SkillInvoked:
+        return "skill.invoked";
+    case SessionEventType::Unknown:
+        break;
+    }
+    return "unknown";
+}
 
+/// Parse session event from JSON
+inline SessionEvent parse_session_event(const json& j)
+{
+    COPILOT_TRACE_SCOPE("events", "parse_session_event");
+    SessionEvent event;
+
+    // Parse common fields
+    event.id = j.at("id").get<std::string>();
+    event.timestamp = j.at("timestamp").get<std::string>();
+    if (j.contains("parentId") && !j.at("parentId").is_null())
+        event.parent_id = j.at("parentId").get<std::string>();
+    if (j.contains("ephemeral"))
+        event.ephemeral = j.at("ephemeral").get<bool>();
+
+    // Parse type and data
+    event.type_string = j.at("type").get<std::string>();
+    const auto& data_json = j.at("data");
+
+    // Map type string to enum and parse data
+    event.type = parse_session_event_type(event.type_string);
+    if (event.type != SessionEventType::Unknown)
+    {
         // Parse data based on type
         switch (event.type)
         {
@@ -1273,6 +1424,80 @@ inline SessionEvent parse_session_event(const json& j)
     return event;
 }
 
+/// Parse the events of a session.getMessages response that follow `event_id`
+///
+/// Scans the array backwards for `event_id` by its "id" field and only decodes the
+/// events after it, so fetching a short tail of a long history costs little more
+/// than the tail itself. If `event_id` is empty or not found, all events are parsed.
+/// @param events JSON array of events
+/// @param event_id ID of the last event the caller already has
+inline std::vector<SessionEvent> parse_session_events_after(
+    const json& events, const std::string& event_id
+)
+{
+    std::vector<SessionEvent> result;
+    if (!events.is_array())
+        return result;
+
+    std::size_t begin = 0;
+    if (!event_id.empty())
+    {
+        for (std::size_t i = events.size(); i-- > 0;)
+        {
+            const auto& j = events[i];
+            auto id = j.find("id");
+            if (id != j.end() && id->is_string() && id->get_ref<const std::string&>() == event_id)
+            {
+                begin = i + 1;
+                break;
+            }
+        }
+    }
+
+    result.reserve(events.size() - begin);
+    for (std::size_t i = begin; i < events.size(); ++i)
+        result.push_back(parse_session_event(events[i]));
+    return result;
+}
+
+/// Merge a streaming delta into the previous delta of the same message
+///
+/// Applies to assistant.message_delta (same message_id) and
+/// assistant.reasoning_delta (same reasoning_id). On success `into` carries the
+/// concatenated delta_content and the id/timestamp of `next`.
+/// @return true if `next` was merged into `into`
+inline bool coalesce_delta_event(SessionEvent& into, const SessionEvent& next)
+{
+    if (into.type != next.type)
+        return false;
+
+    if (auto* dst = std::get_if<AssistantMessageDeltaData>(&into.data))
+    {
+        const auto* src = next.try_as<AssistantMessageDeltaData>();
+        if (!src || src->message_id != dst->message_id ||
+            src->parent_tool_call_id != dst->parent_tool_call_id)
+            return false;
+        dst->delta_content += src->delta_content;
+        if (src->total_response_size_bytes)
+            dst->total_response_size_bytes = src->total_response_size_bytes;
+    }
+    else if (auto* dst = std::get_if<AssistantReasoningDeltaData>(&into.data))
+    {
+        const auto* src = next.try_as<AssistantReasoningDeltaData>();
+        if (!src || src->reasoning_id != dst->reasoning_id)
+            return false;
+        dst->delta_content += src->delta_content;
+    }
+    else
+    {
+        return false;
+    }
+
+    into.id = next.id;
+    into.timestamp = next.timestamp;
+    return true;
+}
+
 /// ADL hook for json
 inline void from_json(const json& j, SessionEvent& event)
 {
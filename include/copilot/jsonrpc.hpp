@@ -7,6 +7,9 @@
 #include <atomic>
 #include <chrono>
 #include <condition_variable>
+#include <copilot/rpc_metrics.hpp>
+#include <copilot/thread_options.hpp>
+#include <copilot/trace.hpp>
 #include <copilot/transport.hpp>
 #include <copilot/types.hpp>
 #include <functional>
@@ -194,11 +197,23 @@ struct JsonRpcResponse
 // Pending Request Tracking
 // =============================================================================
 
+/// Completion callback for JsonRpcClient::invoke_async
+///
+/// `error` is null on success; otherwise it holds the JsonRpcError and `result` is null.
+using ResponseCallback = std::function<void(const json& result, std::exception_ptr error)>;
+
 /// Holds state for a pending request awaiting response
 struct PendingRequest
 {
     std::promise<json> promise;
+    ResponseCallback callback; ///< When set, completes the request instead of `promise`
     std::chrono::steady_clock::time_point deadline;
+    bool local = false; ///< watch_deadline() entry: nothing was sent
+#if COPILOT_ENABLE_RPC_METRICS
+    std::string method; ///< Empty for watch_deadline() entries
+    /// When the request was fully written (steady_clock ticks, 0 until then)
+    std::atomic<std::chrono::steady_clock::rep> sent_at{0};
+#endif
 
     PendingRequest(std::chrono::milliseconds timeout = std::chrono::milliseconds{0})
         : deadline(
@@ -207,6 +222,42 @@ struct PendingRequest
           )
     {
     }
+
+    /// Complete with a result (throws std::future_error if already completed)
+    void resolve(json result)
+    {
+        if (!callback)
+        {
+            promise.set_value(std::move(result));
+            return;
+        }
+        try
+        {
+            callback(result, nullptr);
+        }
+        catch (...)
+        {
+            // Callback exceptions must not escape into the read loop
+        }
+    }
+
+    /// Complete with an error (throws std::future_error if already completed)
+    void reject(std::exception_ptr error)
+    {
+        if (!callback)
+        {
+            promise.set_exception(std::move(error));
+            return;
+        }
+        try
+        {
+            callback(nullptr, std::move(error));
+        }
+        catch (...)
+        {
+            // Callback exceptions must not escape into the read loop
+        }
+    }
 };
 
 // =============================================================================
@@ -221,6 +272,22 @@ using NotificationHandler =
 using RequestHandler =
     std::function<json(const std::string& method, const json& params)>;
 
+/// Messages and message-body bytes through a JsonRpcClient, in both directions
+///
+/// Always counted (relaxed atomic increments). One instance can be shared by
+/// successive clients to keep running totals.
+struct TransportCounters
+{
+    std::atomic<uint64_t> bytes_sent{0};
+    std::atomic<uint64_t> bytes_received{0};
+    std::atomic<uint64_t> messages_sent{0};
+    std::atomic<uint64_t> messages_received{0};
+};
+
+/// Finer metrics key for an incoming request, e.g. the tool of a tool call
+/// (empty for none; see RpcMetricsSnapshot::callback_details)
+using RequestDetail = std::function<std::string(const std::string& method, const json& params)>;
+
 /// JSON-RPC 2.0 client with bidirectional communication
 ///
 /// Features:
@@ -229,7 +296,7 @@ using RequestHandler =
 /// - Handle incoming notifications via callback
 /// - Handle incoming requests (server-to-client calls) via callback
 /// - Background read loop with automatic dispatch
-class JsonRpcClient
+class JsonRpcClient : public std::enable_shared_from_this<JsonRpcClient>
 {
   public:
     /// Construct client with transport and message framer
@@ -256,8 +323,23 @@ class JsonRpcClient
         if (running_.exchange(true))
             return; // Already running
 
-        read_thread_ = std::thread([this] { read_loop(); });
-        timeout_thread_ = std::thread([this] { timeout_loop(); });
+        read_thread_ = std::thread(
+            [this]
+            {
+                if (thread_start_hook_)
+                    thread_start_hook_(ThreadRole::RpcReader);
+                COPILOT_TRACE_THREAD_NAME(thread_role_name(ThreadRole::RpcReader));
+                read_loop();
+            }
+        );
+        timeout_thread_ = std::thread(
+            [this]
+            {
+                if (thread_start_hook_)
+                    thread_start_hook_(ThreadRole::RpcTimer);
+                timeout_loop();
+            }
+        );
     }
 
     /// Stop the client and close connection
@@ -282,12 +364,58 @@ class JsonRpcClient
         fail_all_pending(JsonRpcErrorCode::ConnectionClosed, "Connection closed");
     }
 
+    /// Fail every in-flight request with ConnectionClosed, without stopping
+    ///
+    /// For when the peer is known to be gone before the transport notices, e.g.
+    /// the server process exited.
+    void abort_pending(const std::string& reason)
+    {
+        fail_all_pending(JsonRpcErrorCode::ConnectionClosed, reason);
+    }
+
     /// Check if client is running
     bool is_running() const
     {
         return running_;
     }
 
+    /// Use `metrics` to collect this client's metrics (call before start())
+    ///
+    /// Sharing one collector between successive clients keeps running totals.
+    void set_metrics(std::shared_ptr<RpcMetrics> metrics)
+    {
+        metrics_ = std::move(metrics);
+    }
+
+    /// Collector of per-method counters and latencies
+    ///
+    /// Only filled when built with COPILOT_ENABLE_RPC_METRICS; otherwise nullptr
+    /// unless set_metrics() was called.
+    const std::shared_ptr<RpcMetrics>& metrics() const
+    {
+        return metrics_;
+    }
+
+    /// Number of requests awaiting a response (watch_deadline() entries are not
+    /// requests and are not counted)
+    size_t pending_request_count() const
+    {
+        std::lock_guard<std::mutex> lock(pending_mutex_);
+        return count_requests_locked();
+    }
+
+    /// Wait until no request awaits a response
+    /// @return false if `deadline` passed first
+    bool wait_for_drain(std::chrono::steady_clock::time_point deadline)
+    {
+        std::unique_lock<std::mutex> lock(pending_mutex_);
+        ++drain_waiters_;
+        bool drained =
+            drain_cv_.wait_until(lock, deadline, [this] { return count_requests_locked() == 0; });
+        --drain_waiters_;
+        return drained;
+    }
+
     /// Set handler for incoming notifications
     void set_notification_handler(NotificationHandler handler)
     {
@@ -302,6 +430,30 @@ class JsonRpcClient
         request_handler_ = std::move(handler);
     }
 
+    /// Count this client's traffic into `counters` (call before start())
+    void set_transport_counters(std::shared_ptr<TransportCounters> counters)
+    {
+        transport_counters_ = std::move(counters);
+    }
+
+    const std::shared_ptr<TransportCounters>& transport_counters() const
+    {
+        return transport_counters_;
+    }
+
+    /// Break down the metrics of incoming requests by `detail` (call before start())
+    void set_request_detail(RequestDetail detail)
+    {
+        request_detail_ = std::move(detail);
+    }
+
+    /// Run `hook` first thing on the reader and timeout threads (e.g. to name
+    /// them or pin them to CPUs). Must be set before start().
+    void set_thread_start_hook(ThreadStartHook hook)
+    {
+        thread_start_hook_ = std::move(hook);
+    }
+
     /// Send a request and await response
     /// @param method The method name
     /// @param params The parameters (can be object or array)
@@ -317,29 +469,81 @@ class JsonRpcClient
 
         auto pending = std::make_shared<PendingRequest>(timeout);
         auto future = pending->promise.get_future();
+        send_request(id, pending, method, params);
+        return future;
+    }
 
-        {
-            std::lock_guard<std::mutex> lock(pending_mutex_);
-            pending_requests_[id] = pending;
-        }
-        pending_cv_.notify_all();
+    /// Send a request and deliver the response to a callback
+    ///
+    /// No future or thread is involved: the callback runs on the read thread when the
+    /// response arrives, or on the timeout thread if the request times out.
+    /// @param method The method name
+    /// @param params The parameters (can be object or array)
+    /// @param callback Called exactly once with the result or the error
+    /// @param timeout Request timeout (0 = no timeout)
+    /// @return Request ID (can be passed to cancel())
+    int64_t invoke_async(
+        const std::string& method,
+        const json& params,
+        ResponseCallback callback,
+        std::chrono::milliseconds timeout = std::chrono::milliseconds{30000}
+    )
+    {
+        auto id = next_id_++;
 
-        // Build and send request
-        JsonRpcRequest request{method, params, JsonRpcId{id}};
+        auto pending = std::make_shared<PendingRequest>(timeout);
+        pending->callback = std::move(callback);
+        send_request(id, pending, method, params);
+        return id;
+    }
 
-        try
-        {
-            send_message(request.to_json());
-        }
-        catch (...)
+    /// Register a local deadline that is tracked like a pending request
+    ///
+    /// Nothing is sent. The callback fires with a JsonRpcErrorCode::Timeout error once
+    /// the timeout elapses, or with ConnectionClosed if the client stops first, unless
+    /// the deadline is cancelled before then. Lets callers put their own timeouts on
+    /// the existing timeout thread instead of running a timer thread of their own.
+    /// @param timeout Time until the deadline (must be positive)
+    /// @param callback Called at most once with the error
+    /// @return Deadline ID to pass to cancel()
+    int64_t watch_deadline(std::chrono::milliseconds timeout, ResponseCallback callback)
+    {
+        auto id = next_id_++;
+
+        auto pending = std::make_shared<PendingRequest>(timeout);
+        pending->callback = std::move(callback);
+        pending->local = true;
+
+        bool registered = false;
         {
-            // Remove pending request on send failure
+            // Checked under the lock so stop() either sees the entry or we see !running_
             std::lock_guard<std::mutex> lock(pending_mutex_);
-            pending_requests_.erase(id);
-            throw;
+            if (running_)
+            {
+                pending_requests_[id] = pending;
+                registered = true;
+            }
         }
 
-        return future;
+        if (registered)
+            pending_cv_.notify_all();
+        else
+            pending->reject(
+                std::make_exception_ptr(
+                    JsonRpcError(JsonRpcErrorCode::ConnectionClosed, "Connection closed")
+                )
+            );
+        return id;
+    }
+
+    /// Forget a pending request or deadline without completing it
+    /// @return true if it was still pending
+    bool cancel(int64_t id)
+    {
+        std::lock_guard<std::mutex> lock(pending_mutex_);
+        bool erased = pending_requests_.erase(id) > 0;
+        notify_drain_locked();
+        return erased;
     }
 
     /// Send a request and wait for response synchronously
@@ -406,27 +610,65 @@ class JsonRpcClient
 
         auto pending = std::make_shared<PendingRequest>(timeout);
         auto future = pending->promise.get_future();
+        send_request(id, pending, method, params);
+        return {id, std::move(future)};
+    }
 
+    /// Register `pending` under `id`, then serialize and write the request
+    void send_request(
+        int64_t id,
+        const std::shared_ptr<PendingRequest>& pending,
+        const std::string& method,
+        const json& params
+    )
+    {
+#if COPILOT_ENABLE_RPC_METRICS
+        pending->method = method;
+#endif
         {
+            // Once the read loop is gone nothing would ever answer or time it out
             std::lock_guard<std::mutex> lock(pending_mutex_);
+            if (!running_)
+                throw JsonRpcError(JsonRpcErrorCode::ConnectionClosed, "Connection closed");
             pending_requests_[id] = pending;
         }
         pending_cv_.notify_all();
 
-        JsonRpcRequest request{method, params, JsonRpcId{id}};
-
         try
         {
-            send_message(request.to_json());
+#if COPILOT_ENABLE_RPC_METRICS
+            auto send_start = std::chrono::steady_clock::now();
+            size_t bytes = send_message(JsonRpcRequest{method, params, JsonRpcId{id}}.to_json());
+            auto sent = std::chrono::steady_clock::now();
+            pending->sent_at.store(sent.time_since_epoch().count(), std::memory_order_release);
+            metrics_->record_sent(
+                method,
+                bytes,
+                std::chrono::duration_cast<std::chrono::microseconds>(sent - send_start)
+            );
+#else
+            send_message(JsonRpcRequest{method, params, JsonRpcId{id}}.to_json());
+#endif
         }
         catch (...)
         {
+            // Remove pending request on send failure
             std::lock_guard<std::mutex> lock(pending_mutex_);
             pending_requests_.erase(id);
+            notify_drain_locked();
             throw;
         }
+    }
 
-        return {id, std::move(future)};
+    /// Count a request that completes without a response
+    void record_failure(
+        [[maybe_unused]] const PendingRequest& pending, [[maybe_unused]] JsonRpcErrorCode code
+    )
+    {
+#if COPILOT_ENABLE_RPC_METRICS
+        if (!pending.method.empty())
+            metrics_->record_failure(pending.method, code);
+#endif
     }
 
     void timeout_loop()
@@ -455,6 +697,8 @@ class JsonRpcClient
                         ++it;
                     }
                 }
+                if (!expired.empty())
+                    notify_drain_locked();
 
                 if (expired.empty())
                 {
@@ -480,9 +724,10 @@ class JsonRpcClient
 
             for (auto& pending : expired)
             {
+                record_failure(*pending, JsonRpcErrorCode::Timeout);
                 try
                 {
-                    pending->promise.set_exception(
+                    pending->reject(
                         std::make_exception_ptr(
                             JsonRpcError(JsonRpcErrorCode::Timeout, "Request timed out")
                         )
@@ -506,10 +751,12 @@ class JsonRpcClient
                 return;
             pending = it->second;
             pending_requests_.erase(it);
+            notify_drain_locked();
         }
+        record_failure(*pending, code);
         try
         {
-            pending->promise.set_exception(std::make_exception_ptr(JsonRpcError(code, message)));
+            pending->reject(std::make_exception_ptr(JsonRpcError(code, message)));
         }
         catch (...)
         {
@@ -517,10 +764,18 @@ class JsonRpcClient
         }
     }
 
-    void send_message(const json& message)
+    /// @return Size of the serialized message
+    size_t send_message(const json& message)
     {
-        std::lock_guard<std::mutex> lock(write_mutex_);
-        framer_.write_message(message.dump());
+        COPILOT_TRACE_SCOPE_ARG("rpc", "send_message", trace_label(message));
+        std::string payload = message.dump();
+        {
+            std::lock_guard<std::mutex> lock(write_mutex_);
+            framer_.write_message(payload);
+        }
+        transport_counters_->bytes_sent.fetch_add(payload.size(), std::memory_order_relaxed);
+        transport_counters_->messages_sent.fetch_add(1, std::memory_order_relaxed);
+        return payload.size();
     }
 
     void read_loop()
@@ -530,8 +785,17 @@ class JsonRpcClient
             try
             {
                 auto message_str = framer_.read_message();
-                auto message = json::parse(message_str);
-                dispatch_message(message);
+                transport_counters_->bytes_received.fetch_add(
+                    message_str.size(), std::memory_order_relaxed
+                );
+                transport_counters_->messages_received.fetch_add(1, std::memory_order_relaxed);
+                std::chrono::steady_clock::time_point received;
+#if COPILOT_ENABLE_RPC_METRICS
+                received = std::chrono::steady_clock::now();
+#endif
+                COPILOT_TRACE_SCOPE("rpc", "read_loop");
+                auto message = parse_message(message_str);
+                dispatch_message(message, message_str.size(), received);
             }
             catch (const ConnectionClosedError&)
             {
@@ -554,14 +818,37 @@ class JsonRpcClient
         }
     }
 
-    void dispatch_message(const json& message)
+    static json parse_message(const std::string& text)
+    {
+        COPILOT_TRACE_SCOPE("rpc", "json_parse");
+        return json::parse(text);
+    }
+
+    /// Method of a request or notification, "response" otherwise
+    [[maybe_unused]] static std::string_view trace_label(const json& message)
+    {
+        if (message.is_object())
+        {
+            auto it = message.find("method");
+            if (it != message.end() && it->is_string())
+                return it->get_ref<const std::string&>();
+        }
+        return "response";
+    }
+
+    void dispatch_message(
+        const json& message,
+        [[maybe_unused]] size_t bytes,
+        [[maybe_unused]] std::chrono::steady_clock::time_point received
+    )
     {
+        COPILOT_TRACE_SCOPE_ARG("rpc", "dispatch_message", trace_label(message));
         // Check if it's a response (has id and result/error, no method)
         if (message.contains("id") && !message.at("id").is_null() &&
             (message.contains("result") || message.contains("error")) &&
             !message.contains("method"))
         {
-            handle_response(message);
+            handle_response(message, bytes);
             return;
         }
 
@@ -569,18 +856,24 @@ class JsonRpcClient
         if (message.contains("method"))
         {
             auto request = JsonRpcRequest::from_json(message);
+#if COPILOT_ENABLE_RPC_METRICS
+            metrics_->record_incoming(request.method, bytes);
+#endif
             if (request.is_notification())
                 handle_notification(request);
             else
-                handle_request(request);
+                handle_request(request, received);
             return;
         }
 
         // Unknown message format - ignore
     }
 
-    void handle_response(const json& message)
+    void handle_response(const json& message, [[maybe_unused]] size_t bytes)
     {
+#if COPILOT_ENABLE_RPC_METRICS
+        auto received = std::chrono::steady_clock::now();
+#endif
         auto response = JsonRpcResponse::from_json(message);
 
         // Find pending request by ID
@@ -603,13 +896,35 @@ class JsonRpcClient
                 return; // Unknown request ID
             pending = it->second;
             pending_requests_.erase(it);
+            notify_drain_locked();
+        }
+
+#if COPILOT_ENABLE_RPC_METRICS
+        if (!pending->method.empty())
+        {
+            // A response can overtake the writer recording sent_at; count that as 0
+            auto sent_ticks = pending->sent_at.load(std::memory_order_acquire);
+            auto sent = sent_ticks ? std::chrono::steady_clock::time_point(
+                                         std::chrono::steady_clock::duration(sent_ticks)
+                                     )
+                                   : received;
+            std::optional<JsonRpcErrorCode> error;
+            if (response.is_error())
+                error = static_cast<JsonRpcErrorCode>(response.error->code);
+            metrics_->record_response(
+                pending->method,
+                bytes,
+                std::chrono::duration_cast<std::chrono::microseconds>(received - sent),
+                error
+            );
         }
+#endif
 
         // Resolve or reject the promise
         if (response.is_error())
         {
             auto& err = *response.error;
-            pending->promise.set_exception(
+            pending->reject(
                 std::make_exception_ptr(
                     JsonRpcError(static_cast<JsonRpcErrorCode>(err.code), err.message, err.data)
                 )
@@ -617,7 +932,7 @@ class JsonRpcClient
         }
         else
         {
-            pending->promise.set_value(response.result.value_or(nullptr));
+            pending->resolve(response.result.value_or(nullptr));
         }
     }
 
@@ -642,8 +957,15 @@ class JsonRpcClient
         }
     }
 
-    void handle_request(const JsonRpcRequest& request)
+    /// @param received When the request's frame was read (metrics only)
+    void handle_request(
+        const JsonRpcRequest& request,
+        [[maybe_unused]] std::chrono::steady_clock::time_point received
+    )
     {
+#if COPILOT_ENABLE_RPC_METRICS
+        auto decoded = std::chrono::steady_clock::now();
+#endif
         RequestHandler handler;
         {
             std::lock_guard<std::mutex> lock(handlers_mutex_);
@@ -661,21 +983,77 @@ class JsonRpcClient
             return;
         }
 
+#if COPILOT_ENABLE_RPC_METRICS
+        auto handler_started = std::chrono::steady_clock::now();
+        auto handler_finished = handler_started;
+#endif
+        [[maybe_unused]] bool failed = true;
         try
         {
             auto result = handler(request.method, request.params);
+#if COPILOT_ENABLE_RPC_METRICS
+            handler_finished = std::chrono::steady_clock::now();
+#endif
+            failed = false;
             send_response(*request.id, result);
         }
         catch (const JsonRpcError& e)
         {
+#if COPILOT_ENABLE_RPC_METRICS
+            handler_finished = std::chrono::steady_clock::now();
+#endif
             send_error_response(*request.id, static_cast<int>(e.code()), e.what(), e.data());
         }
         catch (const std::exception& e)
         {
+#if COPILOT_ENABLE_RPC_METRICS
+            handler_finished = std::chrono::steady_clock::now();
+#endif
             send_error_response(
                 *request.id, static_cast<int>(JsonRpcErrorCode::InternalError), e.what()
             );
         }
+
+#if COPILOT_ENABLE_RPC_METRICS
+        auto written = std::chrono::steady_clock::now();
+        auto us = [](auto duration)
+        { return std::chrono::duration_cast<std::chrono::microseconds>(duration); };
+        CallbackTiming timing;
+        timing.decode = us(decoded - received);
+        timing.queue_wait = us(handler_started - decoded);
+        timing.handler = us(handler_finished - handler_started);
+        timing.write = us(written - handler_finished);
+
+        std::string detail;
+        if (request_detail_)
+        {
+            try
+            {
+                detail = request_detail_(request.method, request.params);
+            }
+            catch (...)
+            {
+                // Keep the per-method numbers
+            }
+        }
+        metrics_->record_callback(request.method, detail, timing, failed);
+#endif
+    }
+
+    size_t count_requests_locked() const
+    {
+        return static_cast<size_t>(std::count_if(
+            pending_requests_.begin(),
+            pending_requests_.end(),
+            [](const auto& entry) { return !entry.second->local; }
+        ));
+    }
+
+    /// Wake wait_for_drain() callers (only when there are any)
+    void notify_drain_locked()
+    {
+        if (drain_waiters_ > 0)
+            drain_cv_.notify_all();
     }
 
     void fail_all_pending(JsonRpcErrorCode code, const std::string& message)
@@ -687,12 +1065,14 @@ class JsonRpcClient
             for (auto& [id, pending] : pending_requests_)
                 to_fail.push_back(pending);
             pending_requests_.clear();
+            notify_drain_locked();
         }
         for (auto& pending : to_fail)
         {
+            record_failure(*pending, code);
             try
             {
-                pending->promise.set_exception(
+                pending->reject(
                     std::make_exception_ptr(JsonRpcError(code, message))
                 );
             }
@@ -710,11 +1090,22 @@ class JsonRpcClient
 
     std::thread read_thread_;
     std::thread timeout_thread_;
+    ThreadStartHook thread_start_hook_;
     std::mutex write_mutex_;
 
-    std::mutex pending_mutex_;
+    mutable std::mutex pending_mutex_;
     std::condition_variable pending_cv_;
     std::map<int64_t, std::shared_ptr<PendingRequest>> pending_requests_;
+    std::condition_variable drain_cv_; // signalled as requests complete, see wait_for_drain()
+    int drain_waiters_ = 0;
+
+#if COPILOT_ENABLE_RPC_METRICS
+    std::shared_ptr<RpcMetrics> metrics_ = std::make_shared<RpcMetrics>();
+#else
+    std::shared_ptr<RpcMetrics> metrics_; // nothing is recorded
+#endif
+    RequestDetail request_detail_;
+    std::shared_ptr<TransportCounters> transport_counters_ = std::make_shared<TransportCounters>();
 
     std::mutex handlers_mutex_;
     NotificationHandler notification_handler_;
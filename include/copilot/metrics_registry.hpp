@@ -0,0 +1,315 @@
+// Copyright (c) 2025 Elias Bachaalany
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+/// @file metrics_registry.hpp
+/// @brief Counters, gauges and histograms rendered as Prometheus text, with an
+/// optional localhost HTTP endpoint
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <copilot/rpc_metrics.hpp>
+#include <copilot/transport_tcp.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace copilot
+{
+
+/// Label names and values of one series, e.g. {{"method", "session.send"}}
+using MetricLabels = std::vector<std::pair<std::string, std::string>>;
+
+enum class MetricType
+{
+    Counter,
+    Gauge,
+    Histogram,
+};
+
+// =============================================================================
+// Metric instruments - lock-free updates
+// =============================================================================
+
+/// Monotonic counter
+class MetricCounter
+{
+  public:
+    void inc(uint64_t amount = 1)
+    {
+        value_.fetch_add(amount, std::memory_order_relaxed);
+    }
+
+    uint64_t value() const
+    {
+        return value_.load(std::memory_order_relaxed);
+    }
+
+  private:
+    std::atomic<uint64_t> value_{0};
+};
+
+/// Value that can go up and down
+class MetricGauge
+{
+  public:
+    void set(double value)
+    {
+        value_.store(value, std::memory_order_relaxed);
+    }
+
+    void add(double amount)
+    {
+        value_.fetch_add(amount, std::memory_order_relaxed);
+    }
+
+    double value() const
+    {
+        return value_.load(std::memory_order_relaxed);
+    }
+
+  private:
+    std::atomic<double> value_{0};
+};
+
+/// Bucket counts of a histogram (non-cumulative; the last bucket is +Inf)
+struct HistogramData
+{
+    std::vector<double> bounds;   ///< Upper bounds, ascending
+    std::vector<uint64_t> counts; ///< bounds.size() + 1 entries
+    uint64_t count = 0;
+    double sum = 0;
+};
+
+/// Histogram with fixed bucket bounds (seconds, by Prometheus convention)
+class MetricHistogram
+{
+  public:
+    /// @throws std::invalid_argument if `bounds` is not strictly ascending
+    explicit MetricHistogram(std::vector<double> bounds);
+
+    void observe(double value)
+    {
+        size_t index =
+            std::lower_bound(bounds_.begin(), bounds_.end(), value) - bounds_.begin();
+        counts_[index].fetch_add(1, std::memory_order_relaxed);
+        count_.fetch_add(1, std::memory_order_relaxed);
+        sum_.fetch_add(value, std::memory_order_relaxed);
+    }
+
+    /// Record a duration in seconds
+    void observe(std::chrono::microseconds duration)
+    {
+        observe(static_cast<double>(duration.count()) / 1e6);
+    }
+
+    /// Copy of the counts; concurrent observations may be partly included
+    HistogramData data() const;
+
+  private:
+    const std::vector<double> bounds_;
+    std::unique_ptr<std::atomic<uint64_t>[]> counts_;
+    std::atomic<uint64_t> count_{0};
+    std::atomic<double> sum_{0};
+};
+
+// =============================================================================
+// MetricsWriter - Samples of one scrape
+// =============================================================================
+
+/// Collects the samples of one scrape and renders them as Prometheus text
+///
+/// Samples with the same name and labels are added together, so several
+/// Clients can report into one registry.
+class MetricsWriter
+{
+  public:
+    /// @throws std::invalid_argument for an invalid name, or a name already
+    /// used with another type
+    void counter(
+        const std::string& name,
+        const std::string& help,
+        double value,
+        const MetricLabels& labels = {}
+    );
+    void gauge(
+        const std::string& name,
+        const std::string& help,
+        double value,
+        const MetricLabels& labels = {}
+    );
+    void histogram(
+        const std::string& name,
+        const std::string& help,
+        const HistogramData& data,
+        const MetricLabels& labels = {}
+    );
+
+    /// Histogram of a LatencyHistogram, converted to seconds with `bounds`
+    void histogram(
+        const std::string& name,
+        const std::string& help,
+        const LatencyHistogram& latencies,
+        const MetricLabels& labels = {},
+        const std::vector<double>& bounds = default_latency_bounds()
+    );
+
+    /// Text exposition format 0.0.4
+    std::string prometheus_text() const;
+
+    /// Latency buckets from 0.5ms to 60s
+    static const std::vector<double>& default_latency_bounds();
+
+  private:
+    struct Family
+    {
+        MetricType type;
+        std::string help;
+        std::map<MetricLabels, HistogramData> samples; // counters/gauges use sum
+    };
+
+    Family& family(const std::string& name, const std::string& help, MetricType type);
+
+    std::map<std::string, Family> families_;
+};
+
+// =============================================================================
+// MetricsRegistry
+// =============================================================================
+
+/// Named metrics and collectors, rendered together as Prometheus text
+///
+/// Instruments returned by counter(), gauge() and histogram() live as long as
+/// the registry; keep the reference and update it lock-free. Collectors are
+/// called at scrape time for values that already exist elsewhere (Client
+/// registers one when ClientOptions::metrics is set).
+///
+/// Example usage:
+/// @code
+/// auto registry = std::make_shared<MetricsRegistry>();
+/// ClientOptions options;
+/// options.metrics = registry;
+/// Client client(options);
+/// MetricsServer server(registry, {.port = 9464});
+/// @endcode
+class MetricsRegistry
+{
+  public:
+    using Collector = std::function<void(MetricsWriter& writer)>;
+
+    /// Get or create a counter
+    /// @throws std::invalid_argument for an invalid name, or a name already
+    /// used with another type
+    MetricCounter& counter(
+        const std::string& name, const std::string& help, const MetricLabels& labels = {}
+    );
+
+    /// Get or create a gauge
+    MetricGauge& gauge(
+        const std::string& name, const std::string& help, const MetricLabels& labels = {}
+    );
+
+    /// Get or create a histogram (bounds apply on creation)
+    MetricHistogram& histogram(
+        const std::string& name,
+        const std::string& help,
+        const MetricLabels& labels = {},
+        const std::vector<double>& bounds = MetricsWriter::default_latency_bounds()
+    );
+
+    /// Call `collector` on every scrape until remove_collector()
+    /// @return Id for remove_collector()
+    int add_collector(Collector collector);
+
+    /// Returns once no scrape is running the collector any more
+    void remove_collector(int id);
+
+    /// Write every instrument and run the collectors
+    void collect(MetricsWriter& writer) const;
+
+    /// collect() rendered in the Prometheus text format
+    std::string render_prometheus() const;
+
+  private:
+    struct Family
+    {
+        MetricType type;
+        std::string help;
+        std::map<MetricLabels, std::unique_ptr<MetricCounter>> counters;
+        std::map<MetricLabels, std::unique_ptr<MetricGauge>> gauges;
+        std::map<MetricLabels, std::unique_ptr<MetricHistogram>> histograms;
+    };
+
+    Family& family(const std::string& name, const std::string& help, MetricType type);
+
+    mutable std::mutex mutex_;
+    std::map<std::string, Family> families_;
+
+    // Held while collectors run, so remove_collector() can wait them out
+    mutable std::mutex collectors_mutex_;
+    std::vector<std::pair<int, Collector>> collectors_;
+    int next_collector_id_ = 0;
+};
+
+// =============================================================================
+// MetricsServer - Minimal HTTP endpoint
+// =============================================================================
+
+/// Serves a MetricsRegistry over HTTP for Prometheus to scrape
+///
+/// Answers GET on `path` with the registry's text and 404 otherwise, one
+/// connection at a time on a background thread. Meant for localhost scraping,
+/// not as a general web server.
+class MetricsServer
+{
+  public:
+    struct Options
+    {
+        std::string host = "127.0.0.1";
+        int port = 0; ///< 0 picks a free port (see port())
+        std::string path = "/metrics";
+    };
+
+    /// Bind and start serving
+    /// @throws TransportError if the address cannot be bound
+    explicit MetricsServer(std::shared_ptr<const MetricsRegistry> registry);
+    MetricsServer(std::shared_ptr<const MetricsRegistry> registry, Options options);
+    ~MetricsServer();
+
+    MetricsServer(const MetricsServer&) = delete;
+    MetricsServer& operator=(const MetricsServer&) = delete;
+
+    /// Port being listened on
+    int port() const
+    {
+        return port_;
+    }
+
+    /// e.g. "http://127.0.0.1:9464/metrics"
+    std::string url() const;
+
+    /// Stop serving and close the socket (also done by the destructor)
+    void stop();
+
+  private:
+    void serve();
+    void answer(TcpTransport::Socket socket);
+
+    std::shared_ptr<const MetricsRegistry> registry_;
+    Options options_;
+    TcpTransport::Socket listen_socket_ = TcpTransport::kInvalidSocket;
+    int port_ = 0;
+    std::atomic<bool> running_{false};
+    std::thread thread_;
+};
+
+} // namespace copilot
@@ -0,0 +1,39 @@
+// Copyright (c) 2025 Elias Bachaalany
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+/// @file node_startup.hpp
+/// @brief Cold-start acceleration for a CLI run through Node.js
+
+#include <copilot/types.hpp>
+#include <optional>
+#include <string>
+
+namespace copilot
+{
+
+/// Like find_node(), but the PATH search runs once per process
+///
+/// The remembered path is checked with a single stat on each call and searched
+/// for again if it no longer exists.
+std::optional<std::string> find_node_cached();
+
+/// Version of the CLI whose entry script is `script`
+/// @return The "version" of the nearest package.json above the script, else a
+///         key derived from the script's size and modification time
+std::string node_cli_version(const std::string& script);
+
+/// Create the compile cache directory for the CLI version of `script`
+///
+/// The directory is `<cache_root>/<version>`, created readable by the current
+/// user only. Its modification time is refreshed on every use, and the least
+/// recently used version directories beyond options.max_cached_versions are
+/// removed once unused for a day (another client may still be running them).
+/// @return The directory, or empty if it could not be created or the cache root
+///         belongs to another user
+std::string prepare_node_compile_cache(
+    const NodeStartupOptions& options, const std::string& script
+);
+
+} // namespace copilot
@@ -10,6 +10,11 @@
 /// @file process.hpp
 /// @brief Cross-platform process management for Copilot CLI
 
+#include <chrono>
+#include <copilot/thread_options.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
 #include <map>
 #include <memory>
 #include <optional>
@@ -23,6 +28,7 @@ namespace copilot
 // Forward declarations for platform-specific types
 struct ProcessHandle;
 struct PipeHandle;
+struct SpawnBlock;
 
 // =============================================================================
 // Error Types
@@ -53,6 +59,9 @@ class ReadPipe
     ReadPipe& operator=(ReadPipe&&) noexcept;
 
     /// Read up to size bytes into buffer
+    ///
+    /// Bytes already buffered by read_line()/read_until() are returned first. Small
+    /// reads refill the internal buffer; large reads go straight to the pipe.
     /// @return Number of bytes read, 0 on EOF
     /// @throws ProcessError on read failure
     size_t read(char* buffer, size_t size);
@@ -61,11 +70,36 @@ class ReadPipe
     /// @return Line including newline, or partial line on EOF
     std::string read_line(size_t max_size = 4096);
 
+    /// Read up to and including `delim` (or max_size bytes, or EOF)
+    ///
+    /// Served from an internal buffer refilled one pipe read at a time, so a line
+    /// costs one syscall per buffer fill instead of one per byte.
+    /// @return The bytes read, ending with `delim` unless max_size or EOF came first
+    /// @throws ProcessError on read failure
+    std::string read_until(char delim, size_t max_size = 4096);
+
+    /// Return what is buffered, or what one pipe read yields if data is ready now
+    /// @return Up to max_size bytes; empty if nothing is available (never blocks)
+    /// @throws ProcessError on read failure
+    std::string read_available(size_t max_size = 65536);
+
     /// Check if data is available without blocking
     /// @param timeout_ms Timeout in milliseconds (0 = non-blocking check)
-    /// @return true if data is available
+    /// @return true if data is available (buffered or in the pipe)
     bool has_data(int timeout_ms = 0);
 
+    /// Bytes read from the pipe but not yet consumed
+    size_t buffered() const
+    {
+        return buffer_end_ - buffer_begin_;
+    }
+
+    /// Number of read syscalls (ReadFile on Windows) made on this pipe
+    uint64_t read_syscalls() const
+    {
+        return read_syscalls_;
+    }
+
     /// Close the pipe
     void close();
 
@@ -74,7 +108,28 @@ class ReadPipe
 
   private:
     friend class Process;
+
+    /// Internal buffer size for line reads and small reads
+    static constexpr size_t kBufferSize = 16 * 1024;
+
+    /// One read syscall (platform-specific)
+    size_t read_raw(char* buffer, size_t size);
+
+    /// Wait until the pipe itself is readable (platform-specific)
+    bool wait_readable(int timeout_ms);
+
+    /// Refill the (empty) buffer with one read_raw()
+    /// @return false on EOF
+    bool fill_buffer();
+
+    /// Move up to size buffered bytes into out
+    size_t take_buffered(char* out, size_t size);
+
     std::unique_ptr<PipeHandle> handle_;
+    std::unique_ptr<char[]> buffer_;
+    size_t buffer_begin_ = 0;
+    size_t buffer_end_ = 0;
+    uint64_t read_syscalls_ = 0;
 };
 
 // =============================================================================
@@ -120,6 +175,19 @@ class WritePipe
 // ProcessOptions - Configuration for process spawning
 // =============================================================================
 
+/// How a subprocess is launched on POSIX (ignored on Windows)
+enum class SpawnMethod
+{
+    /// posix_spawn with file actions for the redirections. On Linux and macOS
+    /// the child shares the parent's address space until exec, so spawn cost does
+    /// not grow with the parent's RSS. Falls back to Fork when a working
+    /// directory is requested and the C library cannot chdir in posix_spawn.
+    PosixSpawn,
+
+    /// fork + execve; copies the parent's page tables
+    Fork,
+};
+
 /// Options for spawning a subprocess
 struct ProcessOptions
 {
@@ -143,12 +211,112 @@ struct ProcessOptions
 
     /// On Windows: whether to create the process in a new console window
     bool create_no_window = true;
+
+    /// On POSIX: launch mechanism
+    SpawnMethod spawn_method = SpawnMethod::PosixSpawn;
+
+    /// CPU affinity (Linux, Windows) and scheduler policy (POSIX) for the child.
+    /// On Linux the affinity is inherited from a mask briefly set on the spawning
+    /// thread; Batch and Idle need the Fork method, which is then used instead.
+    /// Spawn fails with ProcessError if either cannot be applied.
+    ThreadConfig scheduling;
+
+    /// Run first thing on the exit watcher thread started by Process::on_exit()
+    ThreadStartHook on_thread_start;
+};
+
+// =============================================================================
+// SpawnSpec - Prebuilt command line and environment for repeated spawns
+// =============================================================================
+
+/// Executable, arguments and environment laid out once for any number of spawns
+///
+/// Construction resolves the executable against the child's PATH, snapshots the
+/// inherited environment merged with options.environment, and builds the exact
+/// argv/envp arrays (command line and environment block on Windows) handed to
+/// the OS. Spawning from a spec then does no string or environment work at all;
+/// on POSIX the child runs only async-signal-safe calls between fork and exec.
+///
+/// The snapshot is frozen: later changes to the parent's environment are not
+/// seen. Copies share the same immutable block and are cheap.
+class SpawnSpec
+{
+  public:
+    /// @param executable Path to executable (can be relative or absolute)
+    /// @param args Command line arguments (not including executable)
+    /// @param options Process configuration, kept for every spawn
+    SpawnSpec(
+        const std::string& executable,
+        const std::vector<std::string>& args,
+        const ProcessOptions& options = {}
+    );
+    ~SpawnSpec();
+
+    SpawnSpec(const SpawnSpec&) = default;
+    SpawnSpec& operator=(const SpawnSpec&) = default;
+    SpawnSpec(SpawnSpec&&) noexcept = default;
+    SpawnSpec& operator=(SpawnSpec&&) noexcept = default;
+
+    /// Executable as given to the constructor
+    const std::string& executable() const;
+
+    /// Executable that will be run, after the PATH search
+    const std::string& resolved_path() const;
+
+    /// Arguments, not including the executable
+    const std::vector<std::string>& args() const;
+
+    /// Environment of the child as "KEY=value" entries
+    const std::vector<std::string>& environment() const;
+
+    /// Options the spec was built with
+    const ProcessOptions& options() const;
+
+  private:
+    friend class Process;
+    std::shared_ptr<const SpawnBlock> block_;
+};
+
+// =============================================================================
+// ResourceUsage - CPU, memory and I/O accounting of a subprocess
+// =============================================================================
+
+/// Resource figures of a subprocess (see Process::resource_usage())
+///
+/// Fields a platform cannot report stay 0.
+struct ResourceUsage
+{
+    std::chrono::microseconds user_cpu{0};
+    std::chrono::microseconds system_cpu{0};
+
+    uint64_t rss_bytes = 0;      ///< Current resident set (0 once exited)
+    uint64_t peak_rss_bytes = 0; ///< Resident set high-water mark
+
+    uint64_t voluntary_context_switches = 0;   ///< Blocked waiting (POSIX)
+    uint64_t involuntary_context_switches = 0; ///< Preempted (POSIX)
+
+    uint64_t read_bytes = 0;  ///< Read from storage (Windows: all I/O incl. pipes)
+    uint64_t write_bytes = 0; ///< Written to storage (Windows: all I/O incl. pipes)
+
+    /// The process has exited; these are its final figures
+    bool exited = false;
+
+    std::chrono::steady_clock::time_point sampled_at;
+
+    /// Total CPU time
+    std::chrono::microseconds cpu() const
+    {
+        return user_cpu + system_cpu;
+    }
 };
 
 // =============================================================================
 // Process - Cross-platform subprocess management
 // =============================================================================
 
+/// Callback invoked when a subprocess exits, with its exit code
+using ExitCallback = std::function<void(int exit_code)>;
+
 /// Cross-platform subprocess management
 ///
 /// Example usage:
@@ -185,6 +353,10 @@ class Process
         const ProcessOptions& options = {}
     );
 
+    /// Spawn a new process from a prebuilt spec (see SpawnSpec)
+    /// @throws ProcessError if spawn fails
+    void spawn(const SpawnSpec& spec);
+
     /// Get stdin pipe (only valid if redirect_stdin was true)
     /// @throws ProcessError if stdin was not redirected
     WritePipe& stdin_pipe();
@@ -218,6 +390,35 @@ class Process
     /// @return Process ID, or 0 if not spawned
     int pid() const;
 
+    /// Linux process file descriptor (pidfd_open) for the spawned child
+    ///
+    /// Becomes readable (POLLIN) when the process exits, so it can be registered
+    /// with epoll/poll/select alongside other descriptors. Owned by the Process;
+    /// do not close it.
+    /// @return The descriptor, or -1 if not spawned or unsupported (non-Linux,
+    ///         kernel older than 5.3)
+    int pidfd() const;
+
+    /// Sample the CPU, memory, context-switch and I/O figures of the process
+    ///
+    /// Cheap enough to poll: on Linux it reads /proc/<pid>/{stat,status,io}, on
+    /// Windows it queries the process handle. Once wait()/try_wait() has reaped
+    /// the process, the final figures from wait4() are returned. Other POSIX
+    /// systems only report those final figures.
+    /// @throws ProcessError if the process was not spawned
+    ResourceUsage resource_usage() const;
+
+    /// Invoke `callback` with the exit code once the process exits
+    ///
+    /// The exit is observed by a watcher thread (blocked on the pidfd on Linux,
+    /// waitid(WNOWAIT) on other POSIX systems, the process handle on Windows);
+    /// the callback runs on that thread. The process is not reaped, so wait() and
+    /// try_wait() keep working. If wait() reaps the process first, the callback
+    /// still runs, with wait()'s exit code or -1.
+    /// @param callback Receives the exit code (128 + signal if killed by a signal)
+    /// @throws ProcessError if the process was not spawned or a callback is already set
+    void on_exit(ExitCallback callback);
+
   private:
     std::unique_ptr<ProcessHandle> handle_;
     std::unique_ptr<WritePipe> stdin_;
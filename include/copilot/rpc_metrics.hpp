@@ -0,0 +1,640 @@
+// Copyright (c) 2025 Elias Bachaalany
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+/// @file rpc_metrics.hpp
+/// @brief Per-method JSON-RPC counters and latency histograms, including the
+/// time taken to answer requests from the server
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+/// JsonRpcClient records metrics only when this is non-zero (CMake option
+/// COPILOT_ENABLE_RPC_METRICS). When 0 the request path takes no timestamps and
+/// touches no counters; snapshots are empty.
+#ifndef COPILOT_ENABLE_RPC_METRICS
+#define COPILOT_ENABLE_RPC_METRICS 0
+#endif
+
+namespace copilot
+{
+
+enum class JsonRpcErrorCode : int; // jsonrpc.hpp
+
+// =============================================================================
+// LatencyHistogram - Log-linear histogram of durations
+// =============================================================================
+
+/// Fixed-size latency histogram in microseconds, in the style of HdrHistogram
+///
+/// Values below 32us get a bucket each. Above that, every power of two is split
+/// into 16 buckets, so a value is known to within 1/16 (6.25%). Values of about
+/// 38 hours and more share the last bucket. Recording never allocates.
+/// Not synchronized; see AtomicLatencyHistogram for recording from several threads.
+class LatencyHistogram
+{
+  public:
+    static constexpr int kSubBucketBits = 4;                    ///< 16 buckets per power of two
+    static constexpr int kLinearBits = kSubBucketBits + 1;      ///< Exact below 2^5
+    static constexpr int kMaxBits = 37;                         ///< Last bucket from 2^36
+    static constexpr size_t kLinearBuckets = size_t(1) << kLinearBits;
+    static constexpr size_t kSubBuckets = size_t(1) << kSubBucketBits;
+    static constexpr size_t kBucketCount = kLinearBuckets + (kMaxBits - kLinearBits) * kSubBuckets;
+
+    /// Bucket holding `us` microseconds
+    static size_t bucket_index(uint64_t us)
+    {
+        if (us < kLinearBuckets)
+            return static_cast<size_t>(us);
+        int bits = std::bit_width(us);
+        if (bits > kMaxBits)
+            return kBucketCount - 1;
+        int shift = bits - kLinearBits;
+        uint64_t top = us >> shift; // kSubBuckets .. 2 * kSubBuckets - 1
+        return kLinearBuckets + (shift - 1) * kSubBuckets + (top - kSubBuckets);
+    }
+
+    /// Smallest value (microseconds) that lands in bucket `index`
+    static uint64_t bucket_lower_bound(size_t index)
+    {
+        if (index < kLinearBuckets)
+            return index;
+        size_t shift = (index - kLinearBuckets) / kSubBuckets + 1;
+        uint64_t top = (index - kLinearBuckets) % kSubBuckets + kSubBuckets;
+        return top << shift;
+    }
+
+    /// Largest value (microseconds) that lands in bucket `index`
+    static uint64_t bucket_upper_bound(size_t index)
+    {
+        if (index + 1 >= kBucketCount)
+            return std::numeric_limits<uint64_t>::max();
+        return bucket_lower_bound(index + 1) - 1;
+    }
+
+    void record(std::chrono::microseconds value)
+    {
+        uint64_t us = value.count() > 0 ? static_cast<uint64_t>(value.count()) : 0;
+        counts_[bucket_index(us)]++;
+        count_++;
+        sum_ += us;
+        min_ = std::min(min_, us);
+        max_ = std::max(max_, us);
+    }
+
+    void merge(const LatencyHistogram& other)
+    {
+        for (size_t i = 0; i < kBucketCount; ++i)
+            counts_[i] += other.counts_[i];
+        count_ += other.count_;
+        sum_ += other.sum_;
+        min_ = std::min(min_, other.min_);
+        max_ = std::max(max_, other.max_);
+    }
+
+    uint64_t count() const
+    {
+        return count_;
+    }
+
+    std::chrono::microseconds total() const
+    {
+        return std::chrono::microseconds(sum_);
+    }
+
+    std::chrono::microseconds min() const
+    {
+        return std::chrono::microseconds(count_ ? min_ : 0);
+    }
+
+    std::chrono::microseconds max() const
+    {
+        return std::chrono::microseconds(max_);
+    }
+
+    std::chrono::microseconds mean() const
+    {
+        return std::chrono::microseconds(count_ ? sum_ / count_ : 0);
+    }
+
+    /// Value at or below which `percent` of the recorded values fall
+    ///
+    /// Reported as the upper bound of the bucket reached, capped at max().
+    /// @param percent 0 to 100
+    /// @return 0 if nothing was recorded
+    std::chrono::microseconds percentile(double percent) const
+    {
+        if (count_ == 0)
+            return std::chrono::microseconds(0);
+        double clamped = std::clamp(percent, 0.0, 100.0);
+        auto rank = static_cast<uint64_t>(clamped / 100.0 * static_cast<double>(count_) + 0.5);
+        rank = std::clamp<uint64_t>(rank, 1, count_);
+
+        uint64_t seen = 0;
+        for (size_t i = 0; i < kBucketCount; ++i)
+        {
+            seen += counts_[i];
+            if (seen >= rank)
+                return std::chrono::microseconds(std::min(bucket_upper_bound(i), max_));
+        }
+        return max();
+    }
+
+    /// Count per bucket (see bucket_lower_bound()/bucket_upper_bound())
+    const std::array<uint64_t, kBucketCount>& buckets() const
+    {
+        return counts_;
+    }
+
+  private:
+    friend class AtomicLatencyHistogram;
+
+    std::array<uint64_t, kBucketCount> counts_{};
+    uint64_t count_ = 0;
+    uint64_t sum_ = 0;
+    uint64_t min_ = std::numeric_limits<uint64_t>::max();
+    uint64_t max_ = 0;
+};
+
+// =============================================================================
+// AtomicLatencyHistogram - LatencyHistogram recorded without a lock
+// =============================================================================
+
+/// LatencyHistogram whose record() may run on several threads at once
+///
+/// Every field is a relaxed atomic; only min and max need a compare-exchange,
+/// and only while they move. load() copies the buckets into a LatencyHistogram.
+/// A copy taken while values are being recorded may miss some of them.
+class AtomicLatencyHistogram
+{
+  public:
+    void record(std::chrono::microseconds value)
+    {
+        uint64_t us = value.count() > 0 ? static_cast<uint64_t>(value.count()) : 0;
+        counts_[LatencyHistogram::bucket_index(us)].fetch_add(1, std::memory_order_relaxed);
+        sum_.fetch_add(us, std::memory_order_relaxed);
+
+        uint64_t min = min_.load(std::memory_order_relaxed);
+        while (us < min && !min_.compare_exchange_weak(min, us, std::memory_order_relaxed))
+        {
+        }
+        uint64_t max = max_.load(std::memory_order_relaxed);
+        while (us > max && !max_.compare_exchange_weak(max, us, std::memory_order_relaxed))
+        {
+        }
+    }
+
+    LatencyHistogram load() const
+    {
+        LatencyHistogram histogram;
+        for (size_t i = 0; i < LatencyHistogram::kBucketCount; ++i)
+        {
+            histogram.counts_[i] = counts_[i].load(std::memory_order_relaxed);
+            histogram.count_ += histogram.counts_[i]; // consistent with the buckets
+        }
+        histogram.sum_ = sum_.load(std::memory_order_relaxed);
+        histogram.min_ = min_.load(std::memory_order_relaxed);
+        histogram.max_ = max_.load(std::memory_order_relaxed);
+        return histogram;
+    }
+
+    void clear()
+    {
+        for (auto& count : counts_)
+            count.store(0, std::memory_order_relaxed);
+        sum_.store(0, std::memory_order_relaxed);
+        min_.store(std::numeric_limits<uint64_t>::max(), std::memory_order_relaxed);
+        max_.store(0, std::memory_order_relaxed);
+    }
+
+  private:
+    std::array<std::atomic<uint64_t>, LatencyHistogram::kBucketCount> counts_{};
+    std::atomic<uint64_t> sum_{0};
+    std::atomic<uint64_t> min_{std::numeric_limits<uint64_t>::max()};
+    std::atomic<uint64_t> max_{0};
+};
+
+// =============================================================================
+// RpcMethodStats / RpcMetricsSnapshot
+// =============================================================================
+
+/// Counters and timings of one JSON-RPC method
+struct RpcMethodStats
+{
+    uint64_t requests = 0;  ///< Requests sent
+    uint64_t responses = 0; ///< Successful responses
+    uint64_t incoming = 0;  ///< Notifications and requests received from the server
+
+    /// Failed requests by code: error responses, plus Timeout and
+    /// ConnectionClosed for requests that never got a response
+    std::map<JsonRpcErrorCode, uint64_t> errors;
+
+    uint64_t bytes_out = 0; ///< Serialized requests
+    uint64_t bytes_in = 0;  ///< Responses and incoming messages
+
+    /// Serializing and writing a request
+    LatencyHistogram send_time;
+
+    /// From the request being written until its response (or error response)
+    /// was read; timeouts and closed connections are not included
+    LatencyHistogram wait_time;
+
+    uint64_t error_count() const
+    {
+        uint64_t total = 0;
+        for (const auto& [code, count] : errors)
+            total += count;
+        return total;
+    }
+
+    void merge(const RpcMethodStats& other)
+    {
+        requests += other.requests;
+        responses += other.responses;
+        incoming += other.incoming;
+        for (const auto& [code, count] : other.errors)
+            errors[code] += count;
+        bytes_out += other.bytes_out;
+        bytes_in += other.bytes_in;
+        send_time.merge(other.send_time);
+        wait_time.merge(other.wait_time);
+    }
+};
+
+/// Stages of answering one request from the server
+///
+/// Requests are handled on the read thread, so queue_wait only grows when the
+/// handler cannot start right away (e.g. while another thread swaps handlers).
+struct CallbackTiming
+{
+    std::chrono::microseconds decode{0};     ///< Frame read until parsed
+    std::chrono::microseconds queue_wait{0}; ///< Parsed until the handler started
+    std::chrono::microseconds handler{0};    ///< Running the handler
+    std::chrono::microseconds write{0};      ///< Encoding and writing the response
+
+    std::chrono::microseconds total() const
+    {
+        return decode + queue_wait + handler + write;
+    }
+};
+
+/// Timings of the requests from the server with one method (or method and detail)
+struct CallbackStats
+{
+    uint64_t count = 0;
+    uint64_t errors = 0; ///< Answered with an error response
+
+    LatencyHistogram decode;
+    LatencyHistogram queue_wait;
+    LatencyHistogram handler;
+    LatencyHistogram write;
+    LatencyHistogram total; ///< Frame read until the response was written
+
+    void record(const CallbackTiming& timing, bool failed)
+    {
+        count++;
+        if (failed)
+            errors++;
+        decode.record(timing.decode);
+        queue_wait.record(timing.queue_wait);
+        handler.record(timing.handler);
+        write.record(timing.write);
+        total.record(timing.total());
+    }
+
+    void merge(const CallbackStats& other)
+    {
+        count += other.count;
+        errors += other.errors;
+        decode.merge(other.decode);
+        queue_wait.merge(other.queue_wait);
+        handler.merge(other.handler);
+        write.merge(other.write);
+        total.merge(other.total);
+    }
+};
+
+/// Point-in-time copy of RpcMetrics
+struct RpcMetricsSnapshot
+{
+    /// Whether the library was built with COPILOT_ENABLE_RPC_METRICS
+    bool enabled = COPILOT_ENABLE_RPC_METRICS != 0;
+
+    std::map<std::string, RpcMethodStats> methods;
+
+    /// Requests from the server that this side answered, by method
+    std::map<std::string, CallbackStats> callbacks;
+
+    /// The same requests by method and detail (tool name, hook type or
+    /// permission kind); only requests with a detail are listed
+    std::map<std::pair<std::string, std::string>, CallbackStats> callback_details;
+
+    std::chrono::steady_clock::time_point taken_at;
+
+    /// All methods combined
+    RpcMethodStats total() const
+    {
+        RpcMethodStats sum;
+        for (const auto& [method, stats] : methods)
+            sum.merge(stats);
+        return sum;
+    }
+};
+
+// =============================================================================
+// RpcMetrics - Thread-safe collector
+// =============================================================================
+
+/// Per-method metrics recorded by JsonRpcClient
+///
+/// Recording runs on the read thread for every message, so it takes no lock:
+/// each method (and each callback method and detail) gets a slot of relaxed
+/// atomic counters and AtomicLatencyHistograms, found through an insert-only hash
+/// table. Only the first message of a new method, and error codes, take a lock.
+/// One collector can be shared by successive connections (Client does this, so
+/// totals span CLI restarts).
+class RpcMetrics
+{
+  public:
+    void record_sent(const std::string& method, size_t bytes, std::chrono::microseconds send_time)
+    {
+        auto& slot = methods_.at(method);
+        slot.requests.fetch_add(1, std::memory_order_relaxed);
+        slot.bytes_out.fetch_add(bytes, std::memory_order_relaxed);
+        slot.send_time.record(send_time);
+    }
+
+    /// A response arrived; `error` is set for error responses
+    void record_response(
+        const std::string& method,
+        size_t bytes,
+        std::chrono::microseconds wait_time,
+        std::optional<JsonRpcErrorCode> error
+    )
+    {
+        auto& slot = methods_.at(method);
+        slot.bytes_in.fetch_add(bytes, std::memory_order_relaxed);
+        slot.wait_time.record(wait_time);
+        if (error)
+            slot.add_error(*error);
+        else
+            slot.responses.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    /// A request failed without a response (timeout, connection closed)
+    void record_failure(const std::string& method, JsonRpcErrorCode code)
+    {
+        methods_.at(method).add_error(code);
+    }
+
+    /// A notification or request from the server
+    void record_incoming(const std::string& method, size_t bytes)
+    {
+        auto& slot = methods_.at(method);
+        slot.incoming.fetch_add(1, std::memory_order_relaxed);
+        slot.bytes_in.fetch_add(bytes, std::memory_order_relaxed);
+    }
+
+    /// A request from the server was answered
+    /// @param detail Finer key such as a tool name (empty for none)
+    void record_callback(
+        const std::string& method,
+        const std::string& detail,
+        const CallbackTiming& timing,
+        bool failed
+    )
+    {
+        callbacks_.at(method).record(timing, failed);
+        if (!detail.empty())
+            callback_details_.at(method + kDetailSeparator + detail).record(timing, failed);
+    }
+
+    /// Copy of every counter; slots with nothing recorded (e.g. after reset()) are left out
+    RpcMetricsSnapshot snapshot() const
+    {
+        RpcMetricsSnapshot snapshot;
+        methods_.for_each(
+            [&](const MethodSlot& slot)
+            {
+                auto stats = slot.load();
+                if (stats.requests || stats.responses || stats.incoming || !stats.errors.empty())
+                    snapshot.methods.emplace(slot.key, std::move(stats));
+            }
+        );
+        callbacks_.for_each(
+            [&](const CallbackSlot& slot)
+            {
+                auto stats = slot.load();
+                if (stats.count)
+                    snapshot.callbacks.emplace(slot.key, std::move(stats));
+            }
+        );
+        callback_details_.for_each(
+            [&](const CallbackSlot& slot)
+            {
+                auto stats = slot.load();
+                auto separator = slot.key.find(kDetailSeparator);
+                if (stats.count == 0 || separator == std::string::npos)
+                    return;
+                auto key = std::make_pair(
+                    slot.key.substr(0, separator), slot.key.substr(separator + 1)
+                );
+                snapshot.callback_details.emplace(std::move(key), std::move(stats));
+            }
+        );
+        snapshot.taken_at = std::chrono::steady_clock::now();
+        return snapshot;
+    }
+
+    void reset()
+    {
+        methods_.for_each([](MethodSlot& slot) { slot.clear(); });
+        callbacks_.for_each([](CallbackSlot& slot) { slot.clear(); });
+        callback_details_.for_each([](CallbackSlot& slot) { slot.clear(); });
+    }
+
+  private:
+    static constexpr char kDetailSeparator = '\0';
+
+    struct MethodSlot
+    {
+        explicit MethodSlot(std::string slot_key) : key(std::move(slot_key)) {}
+
+        void add_error(JsonRpcErrorCode code)
+        {
+            std::lock_guard<std::mutex> lock(errors_mutex);
+            errors[code]++;
+        }
+
+        RpcMethodStats load() const
+        {
+            RpcMethodStats stats;
+            stats.requests = requests.load(std::memory_order_relaxed);
+            stats.responses = responses.load(std::memory_order_relaxed);
+            stats.incoming = incoming.load(std::memory_order_relaxed);
+            stats.bytes_out = bytes_out.load(std::memory_order_relaxed);
+            stats.bytes_in = bytes_in.load(std::memory_order_relaxed);
+            stats.send_time = send_time.load();
+            stats.wait_time = wait_time.load();
+            std::lock_guard<std::mutex> lock(errors_mutex);
+            stats.errors = errors;
+            return stats;
+        }
+
+        void clear()
+        {
+            for (auto* counter : {&requests, &responses, &incoming, &bytes_out, &bytes_in})
+                counter->store(0, std::memory_order_relaxed);
+            send_time.clear();
+            wait_time.clear();
+            std::lock_guard<std::mutex> lock(errors_mutex);
+            errors.clear();
+        }
+
+        const std::string key;
+        std::atomic<uint64_t> requests{0};
+        std::atomic<uint64_t> responses{0};
+        std::atomic<uint64_t> incoming{0};
+        std::atomic<uint64_t> bytes_out{0};
+        std::atomic<uint64_t> bytes_in{0};
+        AtomicLatencyHistogram send_time;
+        AtomicLatencyHistogram wait_time;
+        mutable std::mutex errors_mutex; // failures are rare
+        std::map<JsonRpcErrorCode, uint64_t> errors;
+    };
+
+    struct CallbackSlot
+    {
+        explicit CallbackSlot(std::string slot_key) : key(std::move(slot_key)) {}
+
+        void record(const CallbackTiming& timing, bool failed)
+        {
+            count.fetch_add(1, std::memory_order_relaxed);
+            if (failed)
+                errors.fetch_add(1, std::memory_order_relaxed);
+            decode.record(timing.decode);
+            queue_wait.record(timing.queue_wait);
+            handler.record(timing.handler);
+            write.record(timing.write);
+            total.record(timing.total());
+        }
+
+        CallbackStats load() const
+        {
+            CallbackStats stats;
+            stats.count = count.load(std::memory_order_relaxed);
+            stats.errors = errors.load(std::memory_order_relaxed);
+            stats.decode = decode.load();
+            stats.queue_wait = queue_wait.load();
+            stats.handler = handler.load();
+            stats.write = write.load();
+            stats.total = total.load();
+            return stats;
+        }
+
+        void clear()
+        {
+            count.store(0, std::memory_order_relaxed);
+            errors.store(0, std::memory_order_relaxed);
+            for (auto* histogram : {&decode, &queue_wait, &handler, &write, &total})
+                histogram->clear();
+        }
+
+        const std::string key; // method, or method, kDetailSeparator and detail
+        std::atomic<uint64_t> count{0};
+        std::atomic<uint64_t> errors{0};
+        AtomicLatencyHistogram decode;
+        AtomicLatencyHistogram queue_wait;
+        AtomicLatencyHistogram handler;
+        AtomicLatencyHistogram write;
+        AtomicLatencyHistogram total;
+    };
+
+    /// Insert-only open-addressing table of slots by key
+    ///
+    /// Finding a known key is lock-free (hash, probe, compare). A new key takes
+    /// the mutex once to add its slot; slots are never removed or moved. Keys
+    /// beyond kCapacity go to an overflow map that is searched under the mutex.
+    template <typename Slot>
+    class SlotTable
+    {
+      public:
+        static constexpr size_t kCapacity = 256;
+
+        Slot& at(std::string_view key)
+        {
+            size_t hash = std::hash<std::string_view>{}(key);
+            for (size_t probe = 0; probe < kCapacity; ++probe)
+            {
+                Slot* slot = table_[(hash + probe) % kCapacity].load(std::memory_order_acquire);
+                if (!slot)
+                    break;
+                if (slot->key == key)
+                    return *slot;
+            }
+            return insert(key, hash);
+        }
+
+        template <typename Visit>
+        void for_each(Visit&& visit) const
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            for (const auto& slot : slots_)
+                visit(*slot);
+        }
+
+      private:
+        Slot& insert(std::string_view key, size_t hash)
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            // Probe again: another thread may have added the key meanwhile
+            for (size_t probe = 0; probe < kCapacity; ++probe)
+            {
+                auto& entry = table_[(hash + probe) % kCapacity];
+                Slot* slot = entry.load(std::memory_order_relaxed);
+                if (slot && slot->key == key)
+                    return *slot;
+                if (!slot)
+                {
+                    slots_.push_back(std::make_unique<Slot>(std::string(key)));
+                    entry.store(slots_.back().get(), std::memory_order_release);
+                    return *slots_.back();
+                }
+            }
+
+            auto it = overflow_.find(key);
+            if (it != overflow_.end())
+                return *it->second;
+            slots_.push_back(std::make_unique<Slot>(std::string(key)));
+            overflow_.emplace(slots_.back()->key, slots_.back().get());
+            return *slots_.back();
+        }
+
+        std::array<std::atomic<Slot*>, kCapacity> table_{};
+        mutable std::mutex mutex_;
+        std::vector<std::unique_ptr<Slot>> slots_; // every slot, in insertion order
+        std::map<std::string, Slot*, std::less<>> overflow_;
+    };
+
+    SlotTable<MethodSlot> methods_;
+    SlotTable<CallbackSlot> callbacks_;
+    SlotTable<CallbackSlot> callback_details_;
+};
+
+} // namespace copilot
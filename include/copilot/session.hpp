@@ -6,23 +6,86 @@
 /// @file session.hpp
 /// @brief CopilotSession for managing conversation sessions
 
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <copilot/event_stream.hpp>
+#include <copilot/event_journal.hpp>
 #include <copilot/events.hpp>
 #include <copilot/jsonrpc.hpp>
+#include <copilot/stream_assembler.hpp>
 #include <copilot/types.hpp>
+#include <cstdint>
+#include <deque>
+#include <exception>
 #include <functional>
 #include <future>
 #include <map>
 #include <memory>
 #include <mutex>
 #include <string>
+#include <type_traits>
 #include <vector>
 
+#if defined(__cpp_impl_coroutine) && __has_include(<coroutine>)
+#include <coroutine>
+#define COPILOT_HAS_COROUTINES 1
+#else
+#define COPILOT_HAS_COROUTINES 0
+#endif
+
 namespace copilot
 {
 
 // Forward declaration
 class Client;
 
+namespace detail
+{
+
+/// Atomically replaceable std::shared_ptr.
+///
+/// Uses std::atomic<std::shared_ptr<T>> where the standard library provides it and
+/// falls back to the std::atomic_load/std::atomic_store free functions otherwise.
+template <typename T>
+class AtomicSharedPtr
+{
+  public:
+    AtomicSharedPtr() = default;
+    explicit AtomicSharedPtr(std::shared_ptr<T> value) : ptr_(std::move(value)) {}
+
+    AtomicSharedPtr(const AtomicSharedPtr&) = delete;
+    AtomicSharedPtr& operator=(const AtomicSharedPtr&) = delete;
+
+    std::shared_ptr<T> load() const
+    {
+#if defined(__cpp_lib_atomic_shared_ptr)
+        return ptr_.load(std::memory_order_acquire);
+#else
+        return std::atomic_load_explicit(&ptr_, std::memory_order_acquire);
+#endif
+    }
+
+    void store(std::shared_ptr<T> value)
+    {
+#if defined(__cpp_lib_atomic_shared_ptr)
+        ptr_.store(std::move(value), std::memory_order_release);
+#else
+        std::atomic_store_explicit(&ptr_, std::move(value), std::memory_order_release);
+#endif
+    }
+
+  private:
+#if defined(__cpp_lib_atomic_shared_ptr)
+    std::atomic<std::shared_ptr<T>> ptr_;
+#else
+    std::shared_ptr<T> ptr_;
+#endif
+};
+
+} // namespace detail
+
 // =============================================================================
 // Subscription - RAII subscription handle
 // =============================================================================
@@ -73,6 +136,113 @@ class Subscription
     std::function<void()> unsubscribe_;
 };
 
+// =============================================================================
+// Timing observers
+// =============================================================================
+
+/// Server-to-client callbacks answered by a Session's handlers
+enum class SessionCallbackKind
+{
+    Tool,       ///< tool.call
+    Permission, ///< permission.request
+    UserInput,  ///< userInput.request
+    Hook,       ///< hooks.invoke
+};
+
+/// Receives the timing of a session's turns and callbacks (see TurnProfiler)
+///
+/// All members are optional. They run on SDK threads and must not block.
+struct SessionTimingObserver
+{
+    /// send() or send_and_wait() started a turn
+    std::function<void(std::chrono::steady_clock::time_point sent_at)> on_turn_sent;
+
+    /// The turn will not end with session.idle or session.error: sending it
+    /// failed, or the client stopped, the CLI exited or the session was destroyed
+    std::function<void(const std::string& error)> on_turn_failed;
+
+    /// A callback handler returned or threw
+    /// @param name Tool name, permission kind, hook type, or "userInput"
+    std::function<void(
+        SessionCallbackKind kind, const std::string& name, std::chrono::microseconds elapsed
+    )>
+        on_callback;
+};
+
+// =============================================================================
+// Turn completion
+// =============================================================================
+
+/// Completion callback for a turn
+///
+/// Called once with the last assistant.message of the turn (nullopt if there was
+/// none) when the session becomes idle, or with an error (session.error, timeout,
+/// or RPC failure). Runs on the thread that completed the turn - usually the
+/// client's read thread - so it must not block.
+using TurnCallback =
+    std::function<void(std::optional<SessionEvent> message, std::exception_ptr error)>;
+
+#if COPILOT_HAS_COROUTINES
+/// Awaitable adapter for callback-style turns
+///
+/// The turn starts when the awaitable is constructed; `co_await` yields its final
+/// assistant message or rethrows its error. The awaiting coroutine is resumed on
+/// the thread that completed the turn.
+///
+/// Example usage:
+/// @code
+/// auto reply = co_await session->async_send_and_wait({.prompt = "Hello!"});
+/// @endcode
+class TurnAwaitable
+{
+  public:
+    /// @param start Starts the turn and arranges for the callback to be called once
+    explicit TurnAwaitable(const std::function<void(TurnCallback)>& start);
+
+    bool await_ready() const noexcept;
+    bool await_suspend(std::coroutine_handle<> waiter);
+    std::optional<SessionEvent> await_resume();
+
+  private:
+    struct State
+    {
+        std::mutex mutex;
+        bool done = false;
+        std::optional<SessionEvent> message;
+        std::exception_ptr error;
+        std::coroutine_handle<> waiter;
+    };
+
+    std::shared_ptr<State> state_;
+};
+#endif
+
+// =============================================================================
+// Event history
+// =============================================================================
+
+/// Bounds for a session's in-memory event history ring (0 = unbounded on that axis)
+struct EventHistoryOptions
+{
+    /// Maximum number of retained events
+    std::size_t max_events = 1000;
+
+    /// Maximum estimated memory held by retained events
+    std::size_t max_bytes = 0;
+
+    /// Also retain ephemeral events (e.g. streaming deltas)
+    bool include_ephemeral = true;
+};
+
+/// Memory accounting for a session's event history ring
+struct EventHistoryStats
+{
+    std::size_t events = 0;       ///< Events currently retained
+    std::size_t bytes = 0;        ///< Estimated memory held by retained events
+    uint64_t appended_events = 0; ///< Events recorded since history was enabled
+    uint64_t evicted_events = 0;  ///< Events dropped to stay within bounds
+};
+
 // =============================================================================
 // Session - Copilot conversation session
 // =============================================================================
@@ -151,7 +321,21 @@ class Session : public std::enable_shared_from_this<Session>
     /// @return Future that resolves to list of session events
     std::future<std::vector<SessionEvent>> get_messages();
 
+    /// Get the persisted events that follow a known event
+    ///
+    /// Served from the event history ring (see enable_history()) without any RPC
+    /// when the ring still holds `event_id`; the returned future is then already
+    /// ready. Otherwise falls back to session.getMessages and decodes only the
+    /// events after `event_id` (all events if it is unknown). Ephemeral events are
+    /// never included, matching get_messages().
+    /// @param event_id ID of the last event the caller already has
+    /// @return Future that resolves to the events after `event_id`
+    std::future<std::vector<SessionEvent>> get_messages_since(const std::string& event_id);
+
     /// Send a message and wait until the session becomes idle.
+    ///
+    /// The turn is resolved directly from dispatch_event on session.idle or
+    /// session.error; no helper thread or per-call subscription is involved.
     /// @param options Message options including prompt and attachments
     /// @param timeout Maximum time to wait (default: 60 seconds)
     /// @return Future that resolves to the final assistant message, or nullopt if none
@@ -160,6 +344,34 @@ class Session : public std::enable_shared_from_this<Session>
         MessageOptions options,
         std::chrono::seconds timeout = std::chrono::seconds(60));
 
+    /// Send a message and report the turn's outcome to a callback
+    /// @param options Message options including prompt and attachments
+    /// @param callback Called once with the final assistant message or an error
+    /// @param timeout Maximum time to wait (0 = no timeout)
+    void send_and_wait(
+        MessageOptions options,
+        TurnCallback callback,
+        std::chrono::milliseconds timeout = std::chrono::seconds(60)
+    );
+
+#if COPILOT_HAS_COROUTINES
+    /// Send a message and `co_await` the turn's final assistant message
+    /// @param options Message options including prompt and attachments
+    /// @param timeout Maximum time to wait (0 = no timeout)
+    TurnAwaitable async_send_and_wait(
+        MessageOptions options, std::chrono::milliseconds timeout = std::chrono::seconds(60)
+    );
+#endif
+
+    /// Report the outcome of the current turn without sending anything
+    ///
+    /// Resolves on the next session.idle or session.error, e.g. after send().
+    /// @param callback Called once with the turn's last assistant message or an error
+    /// @param timeout Maximum time to wait (0 = no timeout)
+    void wait_for_idle(
+        TurnCallback callback, std::chrono::milliseconds timeout = std::chrono::milliseconds{0}
+    );
+
     // =========================================================================
     // Event Handling
     // =========================================================================
@@ -169,9 +381,190 @@ class Session : public std::enable_shared_from_this<Session>
     /// @return Subscription handle (unsubscribes on destruction)
     Subscription on(EventHandler handler);
 
+    /// Subscribe to session events, first replaying retained history
+    ///
+    /// Replays the events recorded after `replay_from_event_id` (every retained
+    /// event if the ID is empty), then delivers live events. No event is missed or
+    /// delivered twice between replay and live delivery. Replay runs on the
+    /// calling thread without blocking dispatch; live events arriving meanwhile
+    /// are held back until it ends. If the ID is no longer retained nothing is
+    /// replayed (history_since() tells such a gap apart beforehand).
+    /// @param handler Function to call for each event
+    /// @param replay_from_event_id Last event the caller has already seen
+    /// @return Subscription handle (unsubscribes on destruction)
+    Subscription on(EventHandler handler, const std::string& replay_from_event_id);
+
+    /// Subscribe to a set of event types only
+    /// @param types Event types the handler is interested in
+    /// @param handler Function to call for each matching event
+    /// @return Subscription handle (unsubscribes on destruction)
+    Subscription on(const std::vector<SessionEventType>& types, EventHandler handler);
+
+    /// Subscribe to a single typed event
+    ///
+    /// The handler may take either `const T&` or `(const SessionEvent&, const T&)`
+    /// and is only invoked for events whose data is a T.
+    ///
+    /// @code
+    /// auto sub = session->on<AssistantMessageDeltaData>(
+    ///     [](const AssistantMessageDeltaData& delta) { std::cout << delta.delta_content; });
+    /// @endcode
+    template <typename T, typename Handler>
+    Subscription on(Handler handler)
+    {
+        constexpr SessionEventType type = session_event_type_v<T>;
+        static_assert(type != SessionEventType::Unknown, "T must be a session event data type");
+        static_assert(
+            std::is_invocable_v<Handler&, const T&> ||
+                std::is_invocable_v<Handler&, const SessionEvent&, const T&>,
+            "Handler must be callable with (const T&) or (const SessionEvent&, const T&)"
+        );
+
+        return subscribe(
+            session_event_type_bit(type),
+            [handler = std::move(handler)](const SessionEvent& event) mutable
+            {
+                const T* data = event.try_as<T>();
+                if (!data)
+                    return;
+                if constexpr (std::is_invocable_v<Handler&, const SessionEvent&, const T&>)
+                    handler(event, *data);
+                else
+                    handler(*data);
+            }
+        );
+    }
+
+    /// Check whether any subscriber is interested in an event type
+    bool has_subscribers(SessionEventType type) const;
+
+    /// Mask of event types that have at least one subscriber
+    ///
+    /// Events whose type is not in the mask would be delivered to nobody, so
+    /// their payloads do not need to be decoded.
+    SessionEventTypeMask subscribed_event_types() const;
+
+    /// Mask of event types this session needs decoded
+    ///
+    /// Subscribers' types plus internal consumers (pending send_and_wait turns,
+    /// the history ring). Kept up to date as subscriptions change and read by
+    /// Client to skip decoding events nobody wants.
+    SessionEventTypeMask wanted_event_types() const;
+
+    /// Check whether events of `type` need to be decoded
+    bool wants_event_type(SessionEventType type) const;
+
+    /// Number of events skipped without decoding (see skip_event())
+    uint64_t skipped_events() const;
+
+    /// Open a pull-based event stream
+    ///
+    /// Every event dispatched to this session is queued on the returned stream
+    /// until a consumer pops it. The stream stays subscribed until it is closed
+    /// or the last reference to it is released.
+    /// @param capacity Maximum number of queued events
+    /// @param overflow_policy Behavior when the stream is full
+    /// @return Stream to pop events from
+    std::shared_ptr<EventStream> open_stream(
+        std::size_t capacity,
+        StreamOverflowPolicy overflow_policy = StreamOverflowPolicy::Block
+    );
+
+    /// Open a pull-based event stream with full options (e.g. delta coalescing
+    /// once the consumer falls `coalesce_threshold` events behind)
+    std::shared_ptr<EventStream> open_stream(const EventStreamOptions& options);
+
+    /// Close all streams opened on this session (called by Client on shutdown,
+    /// so a full Block-policy stream cannot stall the read thread)
+    void close_streams();
+
+    /// Fail every pending send_and_wait() / wait_for_idle() turn with `error`
+    ///
+    /// Called by Client on stop(), force_stop() and CLI exit, and by destroy() and
+    /// the destructor, since no session.idle or session.error will arrive then.
+    void fail_turns(std::exception_ptr error);
+
+    /// Get this session's streaming message assembler
+    ///
+    /// Created and subscribed to assistant.message_delta / assistant.message on
+    /// first call; later calls return the same instance. Deltas received before
+    /// the first call are not included.
+    std::shared_ptr<StreamAssembler> stream_assembler();
+
+    /// Start recording dispatched events into a bounded history ring
+    ///
+    /// Calling again changes the bounds, evicting the oldest events as needed.
+    void enable_history(const EventHistoryOptions& options = {});
+
+    /// Stop recording and release the history ring
+    void disable_history();
+
+    /// Snapshot of the retained events, oldest first
+    std::vector<SessionEvent> history() const;
+
+    /// Retained events recorded after `event_id`
+    /// @return nullopt if `event_id` is not (or no longer) in the ring
+    std::optional<std::vector<SessionEvent>> history_since(const std::string& event_id) const;
+
+    /// Memory accounting for the history ring
+    EventHistoryStats history_stats() const;
+
+    /// Persist dispatched events to a local journal (nullptr detaches)
+    ///
+    /// Events are journaled from dispatch_event(event, raw_event); the journal is
+    /// synced whenever the session becomes idle.
+    void attach_journal(std::shared_ptr<EventJournal> journal);
+
+    /// The attached event journal, or nullptr
+    std::shared_ptr<EventJournal> journal() const;
+
     /// Dispatch an event to all subscribers (called by Client)
+    ///
+    /// Reads an immutable snapshot of the subscriber table, so dispatch neither locks
+    /// nor allocates (unless history is enabled), and only handlers subscribed to
+    /// the event's type are called.
+    /// Handlers added or removed while an event is being dispatched take effect
+    /// from the next event. Pending send_and_wait() / wait_for_idle() turns are
+    /// resolved here on session.idle and session.error.
     void dispatch_event(const SessionEvent& event);
 
+    /// Dispatch an event, appending its wire form to the attached journal first
+    /// @param event Parsed event
+    /// @param raw_event The event's JSON as received
+    void dispatch_event(const SessionEvent& event, const json& raw_event);
+
+    /// Account for an event that is not decoded because its type is not wanted
+    /// (called by Client); it is still written to the attached journal
+    /// @param raw_event The event's JSON as received
+    /// @param type Event type read from the JSON
+    void skip_event(const json& raw_event, SessionEventType type);
+
+    /// End the running turn on session.idle or session.error (called by Client
+    /// for every event, decoded or not)
+    void track_turn_state(SessionEventType type);
+
+    /// Whether a turn started by send() or send_and_wait() has not ended yet
+    bool turn_running() const;
+
+    /// Wait until no turn is running (used by Client::rolling_replace())
+    /// @return false if a turn was still running at `deadline`
+    bool wait_turn_ended(std::chrono::steady_clock::time_point deadline);
+
+    // =========================================================================
+    // Timing
+    // =========================================================================
+
+    /// Observe turn starts and the time spent in this session's callback handlers
+    /// @return Subscription handle (stops observing on destruction)
+    Subscription observe_timing(SessionTimingObserver observer);
+
+    /// Report a callback handler that ran from `started` until now (called by Client)
+    void record_callback_time(
+        SessionCallbackKind kind,
+        const std::string& name,
+        std::chrono::steady_clock::time_point started
+    );
+
     // =========================================================================
     // Tool Management
     // =========================================================================
@@ -233,15 +626,117 @@ class Session : public std::enable_shared_from_this<Session>
     std::future<void> destroy();
 
   private:
+    /// Register a handler for the event types in `types` (publishes a new table)
+    Subscription subscribe(SessionEventTypeMask types, EventHandler handler);
+
     std::string session_id_;
     Client* client_;
     std::optional<std::string> workspace_path_;
 
-    // Event handlers
+    // Event handlers (copy-on-write: writers serialize on handlers_mutex_ and publish
+    // a new immutable table; dispatch_event only loads the current snapshot)
+    struct HandlerEntry
+    {
+        int id;
+        SessionEventTypeMask types;
+        std::shared_ptr<const EventHandler> handler;
+    };
+    using HandlerList = std::vector<HandlerEntry>;
+
+    struct HandlerTable
+    {
+        HandlerList entries;                                     // registration order
+        std::array<HandlerList, kSessionEventTypeCount> by_type; // dispatch index
+        SessionEventTypeMask types = 0;                          // union of entry types
+
+        static std::shared_ptr<const HandlerTable> build(HandlerList entries);
+    };
+
     mutable std::mutex handlers_mutex_;
-    std::vector<std::pair<int, EventHandler>> event_handlers_;
+    detail::AtomicSharedPtr<const HandlerTable> event_handlers_;
     int next_handler_id_ = 0;
 
+    // Event history ring (guarded by history_mutex_; the flag keeps dispatch
+    // lock-free while history is disabled)
+    struct HistoryEntry
+    {
+        SessionEvent event;
+        std::size_t bytes; // estimated footprint
+    };
+
+    void append_history_locked(const SessionEvent& event);
+    void trim_history_locked();
+
+    mutable std::mutex history_mutex_;
+    std::atomic<bool> history_enabled_{false};
+    EventHistoryOptions history_options_;
+    std::deque<HistoryEntry> history_;
+    std::size_t history_bytes_ = 0;
+    uint64_t history_appended_ = 0;
+    uint64_t history_evicted_ = 0;
+
+    // Local event journal (optional)
+    void journal_event(const json& raw_event, SessionEventType type);
+
+    detail::AtomicSharedPtr<EventJournal> journal_;
+
+    // Event types that need decoding (see wanted_event_types())
+    void refresh_event_mask();
+
+    std::mutex event_mask_mutex_;
+    std::atomic<SessionEventTypeMask> event_mask_{0};
+    std::atomic<uint64_t> skipped_events_{0};
+
+    // Turns waiting for session.idle / session.error
+    struct PendingTurn
+    {
+        TurnCallback callback;
+        std::optional<SessionEvent> last_message; // guarded by turns_mutex_
+        std::atomic<bool> settled{false};
+        std::atomic<int64_t> deadline_id{0}; // JsonRpcClient::watch_deadline ID
+        std::weak_ptr<JsonRpcClient> deadline_rpc; // set before deadline_id; ids are per connection
+    };
+
+    std::shared_ptr<PendingTurn> start_turn(
+        TurnCallback callback, std::chrono::milliseconds timeout
+    );
+    void finish_turn(
+        const std::shared_ptr<PendingTurn>& turn,
+        std::optional<SessionEvent> message,
+        std::exception_ptr error
+    );
+    void track_turns(const SessionEvent& event);
+
+    std::mutex turns_mutex_;
+    std::vector<std::shared_ptr<PendingTurn>> turns_;
+    std::atomic<std::size_t> active_turns_{0};
+
+    // Whether the server is running a turn, whoever waits for it
+    void set_turn_running(bool running);
+
+    mutable std::mutex turn_state_mutex_;
+    std::condition_variable turn_state_cv_;
+    bool turn_running_ = false;
+
+    // Timing observers (copy-on-write like the event handlers)
+    void notify_turn_sent();
+    void notify_turn_failed(std::exception_ptr error);
+
+    using TimingObservers =
+        std::vector<std::pair<int, std::shared_ptr<const SessionTimingObserver>>>;
+    std::mutex timing_mutex_;
+    detail::AtomicSharedPtr<const TimingObservers> timing_observers_;
+    int next_timing_id_ = 0;
+
+    // Pull-based streams (weak: a stream lives as long as its consumer holds it)
+    std::mutex streams_mutex_;
+    std::vector<std::weak_ptr<EventStream>> streams_;
+
+    // Streaming message assembler (created on first use)
+    std::mutex assembler_mutex_;
+    std::shared_ptr<StreamAssembler> assembler_;
+    Subscription assembler_subscription_;
+
     // Tools
     mutable std::mutex tools_mutex_;
     std::map<std::string, Tool> tools_;
@@ -0,0 +1,183 @@
+// Copyright (c) 2025 Elias Bachaalany
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+/// @file stream_assembler.hpp
+/// @brief Reassembly of streaming assistant message deltas
+
+#include <atomic>
+#include <copilot/events.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace copilot
+{
+
+/// Counters describing a StreamAssembler
+struct StreamAssemblerStats
+{
+    uint64_t deltas_appended = 0;    ///< assistant.message_delta events consumed
+    uint64_t bytes_appended = 0;     ///< Total delta_content bytes
+    uint64_t messages_completed = 0; ///< Messages released by assistant.message
+    uint64_t messages_abandoned = 0; ///< Messages released by complete_all()
+    std::size_t in_flight_messages = 0;
+    std::size_t allocated_blocks = 0; ///< Live blocks (in use, pooled, or held by a Text)
+    std::size_t pooled_blocks = 0;    ///< Free blocks kept for reuse
+    std::size_t allocated_bytes = 0;  ///< allocated_blocks * block_size
+};
+
+/// Collects AssistantMessageDeltaData::delta_content per message_id
+///
+/// Text is kept in a chunked rope of fixed-size blocks, so appending a delta is
+/// a memcpy into the current block and never moves earlier text. Readers get
+/// zero-copy std::string_view chunks via snapshot() or read_new(). When the
+/// final assistant.message for a message arrives its blocks are released into a
+/// bounded free pool. Messages that never get one (aborted turns, session.error)
+/// are released when the turn ends, keeping memory flat over long sessions.
+///
+/// Example usage:
+/// @code
+/// auto assembler = session->stream_assembler();
+/// // ... on a UI thread:
+/// for (auto chunk : assembler->read_new(message_id).chunks())
+///     render(chunk);
+/// @endcode
+class StreamAssembler
+{
+  private:
+    // Counts itself in `live`, which outlives the assembler while a Text holds
+    // the block
+    struct Block
+    {
+        Block(std::size_t capacity, std::shared_ptr<std::atomic<std::size_t>> counter)
+            : data(new char[capacity]), live(std::move(counter))
+        {
+            live->fetch_add(1, std::memory_order_relaxed);
+        }
+
+        ~Block()
+        {
+            live->fetch_sub(1, std::memory_order_relaxed);
+        }
+
+        std::unique_ptr<char[]> data;
+        std::shared_ptr<std::atomic<std::size_t>> live;
+    };
+
+  public:
+    /// Configuration for a StreamAssembler
+    struct Options
+    {
+        /// Size of each rope block in bytes
+        std::size_t block_size = 4096;
+
+        /// Maximum number of free blocks kept for reuse
+        std::size_t max_pooled_blocks = 64;
+    };
+
+    /// Zero-copy view of assembled text
+    ///
+    /// Holds references to the underlying blocks, so the views stay valid for the
+    /// lifetime of this object even after the message completes.
+    class Text
+    {
+      public:
+        /// Contiguous pieces of the text, in order
+        const std::vector<std::string_view>& chunks() const
+        {
+            return chunks_;
+        }
+
+        /// Total number of bytes
+        std::size_t size() const
+        {
+            return size_;
+        }
+
+        bool empty() const
+        {
+            return size_ == 0;
+        }
+
+        /// Copy the text into a single string
+        std::string str() const;
+
+      private:
+        friend class StreamAssembler;
+        std::vector<std::string_view> chunks_;
+        std::vector<std::shared_ptr<const Block>> blocks_;
+        std::size_t size_ = 0;
+    };
+
+    StreamAssembler();
+    explicit StreamAssembler(Options options);
+
+    // Non-copyable, non-movable (shared between the session and readers)
+    StreamAssembler(const StreamAssembler&) = delete;
+    StreamAssembler& operator=(const StreamAssembler&) = delete;
+
+    /// Feed a session event: deltas are appended, assistant.message releases the
+    /// message's buffers, session.idle, session.error and abort release every
+    /// message still in flight, other events are ignored
+    void on_event(const SessionEvent& event);
+
+    /// Append text to an in-flight message
+    void append(const std::string& message_id, std::string_view delta);
+
+    /// Release an in-flight message's buffers
+    void complete(const std::string& message_id);
+
+    /// Release every in-flight message's buffers (the turn ended without their
+    /// final assistant.message)
+    void complete_all();
+
+    /// Everything received so far for a message (empty if unknown or completed)
+    Text snapshot(const std::string& message_id) const;
+
+    /// Text received since the previous read_new() call for this message
+    Text read_new(const std::string& message_id);
+
+    /// Number of bytes received so far for a message
+    std::size_t size(const std::string& message_id) const;
+
+    /// IDs of messages that are still streaming
+    std::vector<std::string> in_flight_messages() const;
+
+    /// Snapshot of the assembler's counters
+    StreamAssemblerStats stats() const;
+
+  private:
+    struct Message
+    {
+        std::vector<std::shared_ptr<Block>> blocks;
+        std::size_t size = 0;
+        std::size_t read_offset = 0;
+    };
+
+    Text make_text(const Message& message, std::size_t from, std::size_t to) const;
+    std::shared_ptr<Block> acquire_block();
+    void release_blocks(Message& message);
+
+    const Options options_;
+
+    mutable std::mutex mutex_;
+    std::unordered_map<std::string, Message> messages_;
+    std::string last_id_;             // deltas arrive in runs for one message,
+    Message* last_message_ = nullptr; // so skip the hash lookup for repeats
+    std::vector<std::shared_ptr<Block>> pool_;
+    std::shared_ptr<std::atomic<std::size_t>> live_blocks_ =
+        std::make_shared<std::atomic<std::size_t>>(0);
+    uint64_t deltas_appended_ = 0;
+    uint64_t bytes_appended_ = 0;
+    uint64_t messages_completed_ = 0;
+    uint64_t messages_abandoned_ = 0;
+};
+
+} // namespace copilot
@@ -0,0 +1,90 @@
+// Copyright (c) 2025 Elias Bachaalany
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+/// @file thread_options.hpp
+/// @brief Names, CPU affinity and scheduling policy for SDK threads and the CLI
+
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace copilot
+{
+
+/// Background threads started by the SDK
+enum class ThreadRole
+{
+    RpcReader,   ///< JSON-RPC read loop
+    RpcTimer,    ///< JSON-RPC request timeouts
+    LogDrain,    ///< CLI stderr reader
+    ExitWatcher, ///< Waits for the CLI process to exit
+    Supervisor,  ///< Restarts the CLI (auto_restart)
+};
+
+/// Thread name used for a role (at most 15 characters, the Linux limit)
+const char* thread_role_name(ThreadRole role);
+
+/// Scheduler policy for a thread or process
+enum class SchedulingPolicy
+{
+    Inherit,    ///< Leave unchanged
+    Other,      ///< SCHED_OTHER (default time-sharing)
+    Batch,      ///< SCHED_BATCH (Linux)
+    Idle,       ///< SCHED_IDLE (Linux)
+    Fifo,       ///< SCHED_FIFO (real-time; usually needs privileges)
+    RoundRobin, ///< SCHED_RR (real-time; usually needs privileges)
+};
+
+/// CPU placement and scheduling for one thread or process
+struct ThreadConfig
+{
+    /// CPUs to run on (empty = inherit). Linux and Windows (CPUs 0-63).
+    std::vector<int> cpus;
+
+    /// Scheduler policy (POSIX)
+    SchedulingPolicy policy = SchedulingPolicy::Inherit;
+
+    /// Static priority for Fifo/RoundRobin (ignored for the other policies)
+    int priority = 0;
+
+    /// Whether anything is to be changed
+    bool empty() const
+    {
+        return cpus.empty() && policy == SchedulingPolicy::Inherit;
+    }
+};
+
+/// Thread settings for a Client (see ClientOptions::threads)
+struct ThreadOptions
+{
+    /// Name SDK threads after their role, so they show up in profilers and debuggers
+    bool name_threads = true;
+
+    /// Per-role placement; roles not listed are left unchanged
+    std::map<ThreadRole, ThreadConfig> roles;
+
+    /// Placement of the spawned CLI server process
+    ThreadConfig cli_process;
+};
+
+/// Called at the start of each SDK background thread, on that thread
+using ThreadStartHook = std::function<void(ThreadRole role)>;
+
+/// Name the calling thread (truncated to 15 characters on Linux)
+/// @return false if the platform call failed or is unsupported
+bool set_current_thread_name(const std::string& name);
+
+/// Apply CPU affinity and scheduling policy to the calling thread
+///
+/// Best effort: every setting is attempted even if an earlier one fails.
+/// @return false if any setting could not be applied
+bool apply_thread_config(const ThreadConfig& config);
+
+/// Name the calling thread after `role` and apply that role's settings
+/// @return false if any setting could not be applied
+bool configure_current_thread(const ThreadOptions& options, ThreadRole role);
+
+} // namespace copilot
@@ -0,0 +1,466 @@
+// Copyright (c) 2025 Elias Bachaalany
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+/// @file trace.hpp
+/// @brief Span tracing of SDK internals, exported as Chrome trace JSON
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <nlohmann/json.hpp>
+#include <ostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/// The COPILOT_TRACE_* macros record spans only when this is non-zero (CMake
+/// option COPILOT_ENABLE_TRACING). When 0 they expand to nothing; Tracer itself
+/// stays available but sees no SDK spans.
+#ifndef COPILOT_ENABLE_TRACING
+#define COPILOT_ENABLE_TRACING 0
+#endif
+
+namespace copilot
+{
+
+// =============================================================================
+// TraceEvent / TraceOptions / TraceStats
+// =============================================================================
+
+/// One completed span
+struct TraceEvent
+{
+    static constexpr size_t kMaxArgSize = 47;
+
+    const char* category; ///< String literal
+    const char* name;     ///< String literal
+    int64_t start_ns;     ///< Since Tracer::start()
+    int64_t duration_ns;
+    char arg[kMaxArgSize + 1]; ///< Optional detail (method, tool name), truncated
+};
+
+struct TraceOptions
+{
+    /// Spans kept per thread; later spans are counted in TraceStats::dropped
+    size_t max_events_per_thread = 1 << 16;
+};
+
+struct TraceStats
+{
+    uint64_t events = 0;  ///< Spans recorded since start()
+    uint64_t dropped = 0; ///< Spans lost to max_events_per_thread
+    size_t threads = 0;   ///< Threads that recorded spans
+};
+
+// =============================================================================
+// Tracer - Process-wide span collector
+// =============================================================================
+
+/// Collects spans from every thread into per-thread buffers
+///
+/// Each thread appends to its own chunked buffer without locking: an event is
+/// written, then published with a release store of the chunk's size, so
+/// exporting can run while threads keep recording. The registry mutex is taken
+/// only when a thread records its first span and when a new start() makes it
+/// drop its old buffer.
+///
+/// The output loads in chrome://tracing and in the Perfetto UI
+/// (https://ui.perfetto.dev), which reads Chrome JSON traces.
+///
+/// Example usage:
+/// @code
+/// Tracer::instance().start();
+/// // ... run sessions ...
+/// Tracer::instance().stop();
+/// Tracer::instance().write_chrome_json_file("copilot-trace.json");
+/// @endcode
+class Tracer
+{
+  public:
+    static Tracer& instance()
+    {
+        static Tracer tracer;
+        return tracer;
+    }
+
+    /// Whether spans are being recorded (one relaxed load; checked by every span)
+    static bool enabled()
+    {
+        return enabled_.load(std::memory_order_relaxed);
+    }
+
+    /// Discard previous spans and start recording
+    void start(TraceOptions options = {})
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        max_events_.store(options.max_events_per_thread, std::memory_order_relaxed);
+        epoch_ticks_.store(
+            std::chrono::steady_clock::now().time_since_epoch().count(), std::memory_order_relaxed
+        );
+        generation_.fetch_add(1, std::memory_order_release);
+
+        // Threads that exited keep nothing worth exporting any more
+        buffers_.erase(
+            std::remove_if(
+                buffers_.begin(),
+                buffers_.end(),
+                [](const std::shared_ptr<ThreadBuffer>& buffer) { return buffer->exited.load(); }
+            ),
+            buffers_.end()
+        );
+        enabled_.store(true, std::memory_order_release);
+    }
+
+    /// Stop recording; recorded spans stay available for export
+    void stop()
+    {
+        enabled_.store(false, std::memory_order_release);
+    }
+
+    /// Name the calling thread in exported traces
+    void set_thread_name(std::string name)
+    {
+        auto& local = local_state();
+        if (!local.buffer)
+        {
+            local.name = std::move(name); // Applied if the thread ever records
+            return;
+        }
+        std::lock_guard<std::mutex> lock(mutex_);
+        local.buffer->name = std::move(name);
+    }
+
+    /// Record a span that ran on the calling thread (used by TraceScope)
+    void record(
+        const char* category,
+        const char* name,
+        std::chrono::steady_clock::time_point start,
+        std::chrono::steady_clock::time_point end,
+        std::string_view arg = {}
+    )
+    {
+        auto& buffer = local_buffer();
+        uint64_t generation = generation_.load(std::memory_order_acquire);
+        if (buffer.generation != generation)
+            reset_buffer(buffer, generation);
+
+        // Published by start() before the generation
+        auto epoch = std::chrono::steady_clock::time_point(
+            std::chrono::steady_clock::duration(epoch_ticks_.load(std::memory_order_relaxed))
+        );
+        if (start < epoch)
+            return; // Began before the current start()
+
+        if (buffer.count >= max_events_.load(std::memory_order_relaxed))
+        {
+            buffer.dropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        if (!buffer.tail || buffer.tail_size == Chunk::kSize)
+            append_chunk(buffer);
+
+        TraceEvent& event = buffer.tail->events[buffer.tail_size];
+        event.category = category;
+        event.name = name;
+        event.start_ns =
+            std::chrono::duration_cast<std::chrono::nanoseconds>(start - epoch).count();
+        event.duration_ns =
+            std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+        size_t arg_size = std::min(arg.size(), TraceEvent::kMaxArgSize);
+        std::memcpy(event.arg, arg.data(), arg_size);
+        event.arg[arg_size] = '\0';
+
+        buffer.tail->size.store(++buffer.tail_size, std::memory_order_release);
+        buffer.count++;
+    }
+
+    TraceStats stats() const
+    {
+        TraceStats stats;
+        std::lock_guard<std::mutex> lock(mutex_);
+        uint64_t generation = generation_.load(std::memory_order_acquire);
+        for (const auto& buffer : buffers_)
+        {
+            if (buffer->generation != generation)
+                continue;
+            size_t events = 0;
+            for_each_event(*buffer, [&](const TraceEvent&) { ++events; });
+            stats.events += events;
+            stats.dropped += buffer->dropped.load(std::memory_order_relaxed);
+            if (events > 0)
+                stats.threads++;
+        }
+        return stats;
+    }
+
+    /// Write the recorded spans in the Chrome trace event format
+    void write_chrome_json(std::ostream& out) const
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        uint64_t generation = generation_.load(std::memory_order_acquire);
+        uint64_t dropped = 0;
+
+        out << R"({"displayTimeUnit":"ms","traceEvents":[)";
+        out << R"({"ph":"M","name":"process_name","pid":1,"tid":0,)"
+            << R"("args":{"name":"copilot-sdk"}})";
+        for (const auto& buffer : buffers_)
+        {
+            if (buffer->generation != generation)
+                continue;
+            dropped += buffer->dropped.load(std::memory_order_relaxed);
+
+            out << R"(,{"ph":"M","name":"thread_name","pid":1,"tid":)" << buffer->tid
+                << R"(,"args":{"name":)" << json_string(buffer->name) << "}}";
+            for_each_event(
+                *buffer,
+                [&](const TraceEvent& event)
+                {
+                    out << R"(,{"ph":"X","pid":1,"tid":)" << buffer->tid << R"(,"cat":")"
+                        << event.category << R"(","name":")" << event.name << R"(","ts":)"
+                        << micros(event.start_ns) << R"(,"dur":)" << micros(event.duration_ns);
+                    if (event.arg[0] != '\0')
+                    {
+                        out << R"(,"args":{"detail":)" << json_string(event.arg) << "}";
+                    }
+                    out << "}";
+                }
+            );
+        }
+        out << R"(],"otherData":{"dropped_events":)" << dropped << "}}";
+    }
+
+    std::string chrome_json() const
+    {
+        std::ostringstream out;
+        write_chrome_json(out);
+        return out.str();
+    }
+
+    /// @throws std::runtime_error if the file cannot be written
+    void write_chrome_json_file(const std::string& path) const
+    {
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        if (!out)
+            throw std::runtime_error("Cannot open trace file: " + path);
+        write_chrome_json(out);
+        if (!out)
+            throw std::runtime_error("Failed to write trace file: " + path);
+    }
+
+  private:
+    struct Chunk
+    {
+        static constexpr size_t kSize = 512;
+        std::array<TraceEvent, kSize> events;
+        std::atomic<size_t> size{0};
+        std::atomic<Chunk*> next{nullptr};
+    };
+
+    struct ThreadBuffer
+    {
+        // Read by exporters under the registry mutex
+        std::atomic<Chunk*> head{nullptr};
+        std::atomic<uint64_t> dropped{0};
+        std::atomic<bool> exited{false};
+        uint64_t generation = 0; // changed under the registry mutex
+        uint64_t tid = 0;
+        std::string name;
+
+        // Owned by the recording thread; freed only under the registry mutex
+        std::vector<std::unique_ptr<Chunk>> chunks;
+        Chunk* tail = nullptr;
+        size_t tail_size = 0;
+        size_t count = 0;
+    };
+
+    Tracer() = default;
+
+    struct LocalState
+    {
+        std::shared_ptr<ThreadBuffer> buffer; // Registered on the first span
+        std::string name;
+
+        ~LocalState()
+        {
+            if (buffer)
+                buffer->exited.store(true);
+        }
+    };
+
+    static LocalState& local_state()
+    {
+        thread_local LocalState state;
+        return state;
+    }
+
+    ThreadBuffer& local_buffer()
+    {
+        auto& local = local_state();
+        if (!local.buffer)
+        {
+            auto buffer = std::make_shared<ThreadBuffer>();
+            std::lock_guard<std::mutex> lock(mutex_);
+            buffer->tid = ++next_tid_;
+            buffer->name = local.name.empty() ? "thread-" + std::to_string(buffer->tid)
+                                              : std::move(local.name);
+            buffer->generation = generation_.load(std::memory_order_relaxed);
+            buffers_.push_back(buffer);
+            local.buffer = std::move(buffer);
+        }
+        return *local.buffer;
+    }
+
+    void reset_buffer(ThreadBuffer& buffer, uint64_t generation)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        buffer.head.store(nullptr, std::memory_order_relaxed);
+        buffer.chunks.clear();
+        buffer.tail = nullptr;
+        buffer.tail_size = 0;
+        buffer.count = 0;
+        buffer.dropped.store(0, std::memory_order_relaxed);
+        buffer.generation = generation;
+    }
+
+    static void append_chunk(ThreadBuffer& buffer)
+    {
+        buffer.chunks.push_back(std::make_unique<Chunk>());
+        Chunk* chunk = buffer.chunks.back().get();
+        if (buffer.tail)
+            buffer.tail->next.store(chunk, std::memory_order_release);
+        else
+            buffer.head.store(chunk, std::memory_order_release);
+        buffer.tail = chunk;
+        buffer.tail_size = 0;
+    }
+
+    template <typename Fn>
+    static void for_each_event(const ThreadBuffer& buffer, Fn&& fn)
+    {
+        for (Chunk* chunk = buffer.head.load(std::memory_order_acquire); chunk;
+             chunk = chunk->next.load(std::memory_order_acquire))
+        {
+            size_t size = chunk->size.load(std::memory_order_acquire);
+            for (size_t i = 0; i < size; ++i)
+                fn(chunk->events[i]);
+        }
+    }
+
+    static std::string json_string(const std::string& text)
+    {
+        return nlohmann::json(text).dump(-1, ' ', false, nlohmann::json::error_handler_t::replace);
+    }
+
+    static double micros(int64_t ns)
+    {
+        return static_cast<double>(ns) / 1000.0;
+    }
+
+    static inline std::atomic<bool> enabled_{false};
+
+    mutable std::mutex mutex_;
+    std::vector<std::shared_ptr<ThreadBuffer>> buffers_;
+    std::atomic<uint64_t> generation_{0};
+    std::atomic<int64_t> epoch_ticks_{0};
+    std::atomic<size_t> max_events_{TraceOptions{}.max_events_per_thread};
+    uint64_t next_tid_ = 0;
+};
+
+// =============================================================================
+// TraceScope - RAII span
+// =============================================================================
+
+/// Records a span from construction to destruction while tracing is enabled
+class TraceScope
+{
+  public:
+    TraceScope(const char* category, const char* name) : category_(category), name_(name)
+    {
+        if (Tracer::enabled())
+        {
+            active_ = true;
+            start_ = std::chrono::steady_clock::now();
+        }
+    }
+
+    ~TraceScope()
+    {
+        if (active_)
+        {
+            Tracer::instance().record(
+                category_,
+                name_,
+                start_,
+                std::chrono::steady_clock::now(),
+                std::string_view(arg_.data(), arg_size_)
+            );
+        }
+    }
+
+    TraceScope(const TraceScope&) = delete;
+    TraceScope& operator=(const TraceScope&) = delete;
+
+    /// Whether this span will be recorded
+    bool active() const
+    {
+        return active_;
+    }
+
+    /// Attach a detail shown in the trace viewer (truncated)
+    void set_arg(std::string_view arg)
+    {
+        arg_size_ = std::min(arg.size(), TraceEvent::kMaxArgSize);
+        std::memcpy(arg_.data(), arg.data(), arg_size_);
+    }
+
+  private:
+    const char* category_;
+    const char* name_;
+    bool active_ = false;
+    std::chrono::steady_clock::time_point start_;
+    std::array<char, TraceEvent::kMaxArgSize> arg_;
+    size_t arg_size_ = 0;
+};
+
+} // namespace copilot
+
+// =============================================================================
+// Instrumentation macros
+// =============================================================================
+
+#define COPILOT_TRACE_CONCAT_INNER(a, b) a##b
+#define COPILOT_TRACE_CONCAT(a, b) COPILOT_TRACE_CONCAT_INNER(a, b)
+#define COPILOT_TRACE_VAR COPILOT_TRACE_CONCAT(copilot_trace_scope_, __LINE__)
+
+#if COPILOT_ENABLE_TRACING
+
+/// Trace the rest of the enclosing scope; both arguments must be string literals
+#define COPILOT_TRACE_SCOPE(category, name) ::copilot::TraceScope COPILOT_TRACE_VAR(category, name)
+
+/// Like COPILOT_TRACE_SCOPE, with a detail that is evaluated only while tracing
+#define COPILOT_TRACE_SCOPE_ARG(category, name, arg)                                               \
+    ::copilot::TraceScope COPILOT_TRACE_VAR(category, name);                                       \
+    if (COPILOT_TRACE_VAR.active())                                                                \
+    COPILOT_TRACE_VAR.set_arg(arg)
+
+/// Name the calling thread in traces
+#define COPILOT_TRACE_THREAD_NAME(name) ::copilot::Tracer::instance().set_thread_name(name)
+
+#else
+
+#define COPILOT_TRACE_SCOPE(category, name) static_cast<void>(0)
+#define COPILOT_TRACE_SCOPE_ARG(category, name, arg) static_cast<void>(0)
+#define COPILOT_TRACE_THREAD_NAME(name) static_cast<void>(0)
+
+#endif
@@ -0,0 +1,167 @@
+// Copyright (c) 2025 Elias Bachaalany
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+/// @file turn_profiler.hpp
+/// @brief Per-turn latency breakdown of sessions
+
+#include <chrono>
+#include <copilot/rpc_metrics.hpp>
+#include <copilot/session.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace copilot
+{
+
+// =============================================================================
+// TurnRecord / TurnProfileSummary
+// =============================================================================
+
+/// One callback handler run during a turn
+struct TurnCallbackTiming
+{
+    SessionCallbackKind kind;
+    std::string name;                 ///< Tool name, permission kind, hook type, or "userInput"
+    std::chrono::microseconds offset; ///< From the send until the handler returned
+    std::chrono::microseconds elapsed;
+};
+
+/// Timeline of one turn, from send() until session.idle or session.error
+///
+/// A send() while a turn is still running (e.g. a queued follow-up) joins
+/// that turn rather than starting another.
+struct TurnRecord
+{
+    std::string session_id;
+    std::optional<std::string> turn_id; ///< From the first assistant.turn_start
+    std::chrono::steady_clock::time_point sent_at;
+
+    std::optional<std::chrono::microseconds> time_to_turn_start;
+    std::optional<std::chrono::microseconds> time_to_first_delta;
+    std::chrono::microseconds duration{0}; ///< Until session.idle or session.error
+
+    uint64_t delta_count = 0;
+    uint64_t delta_bytes = 0;                    ///< Sum of delta_content sizes
+    std::chrono::microseconds streaming_time{0}; ///< First delta until last delta
+
+    /// Handlers in the order they returned
+    std::vector<TurnCallbackTiming> callbacks;
+
+    // Sums of the turn's assistant.usage events
+    uint64_t model_calls = 0;
+    double input_tokens = 0;
+    double output_tokens = 0;
+    double cache_read_tokens = 0;
+    std::chrono::microseconds api_time{0}; ///< Sum of assistant.usage durations
+
+    bool failed = false; ///< Ended with session.error, or was never sent or completed
+    std::optional<std::string> error_message;
+
+    /// Total time spent in handlers of one kind
+    std::chrono::microseconds callback_time(SessionCallbackKind kind) const;
+
+    /// Number of handler runs of one kind
+    size_t callback_count(SessionCallbackKind kind) const;
+
+    /// Delta bytes over streaming_time (0 with fewer than two deltas)
+    double delta_bytes_per_second() const;
+
+    /// Output tokens over api_time, or over streaming_time when the server
+    /// reported no durations (0 if neither is known)
+    double output_tokens_per_second() const;
+};
+
+/// Distributions across every turn a TurnProfiler has closed
+///
+/// Callback histograms hold one value per handler run; the others one per turn.
+struct TurnProfileSummary
+{
+    uint64_t turns = 0;
+    uint64_t failed_turns = 0;
+
+    LatencyHistogram time_to_turn_start;
+    LatencyHistogram time_to_first_delta;
+    LatencyHistogram turn_duration;
+    LatencyHistogram streaming_time;
+
+    LatencyHistogram tool_time;
+    LatencyHistogram permission_time;
+    LatencyHistogram user_input_time;
+    LatencyHistogram hook_time;
+
+    /// Handler runs per tool name
+    std::map<std::string, LatencyHistogram> tools;
+
+    double input_tokens = 0;
+    double output_tokens = 0;
+    double cache_read_tokens = 0;
+};
+
+// =============================================================================
+// TurnProfiler
+// =============================================================================
+
+/// Builds a TurnRecord for every turn of the sessions it is attached to
+///
+/// Follows each session's events (assistant.turn_start, assistant.message_delta,
+/// assistant.usage, session.idle, session.error) and the time Client spends in
+/// the session's tool, permission, user input and hook handlers. One profiler
+/// can follow many sessions; summary() aggregates all of them.
+///
+/// Example usage:
+/// @code
+/// TurnProfiler profiler;
+/// profiler.attach(session);
+/// session->send_and_wait(message, ...);
+/// auto p95 = profiler.summary().time_to_first_delta.percentile(95);
+/// @endcode
+class TurnProfiler
+{
+  public:
+    struct Options
+    {
+        /// Closed turns kept by records(); the oldest are dropped first
+        size_t max_records = 1024;
+
+        /// Called with each closed turn, on the thread that delivered
+        /// session.idle or session.error
+        std::function<void(const TurnRecord&)> on_turn;
+    };
+
+    TurnProfiler();
+    explicit TurnProfiler(Options options);
+    ~TurnProfiler();
+
+    TurnProfiler(const TurnProfiler&) = delete;
+    TurnProfiler& operator=(const TurnProfiler&) = delete;
+
+    /// Start profiling a session's turns (no-op if already attached)
+    void attach(const std::shared_ptr<Session>& session);
+
+    /// Stop profiling a session; its open turn is discarded
+    void detach(const std::string& session_id);
+
+    /// Closed turns, oldest first
+    std::vector<TurnRecord> records() const;
+
+    /// Aggregates of every turn closed since construction or reset()
+    TurnProfileSummary summary() const;
+
+    /// Drop records and aggregates (open turns keep running)
+    void reset();
+
+  private:
+    struct State;
+    std::shared_ptr<State> state_;
+};
+
+} // namespace copilot
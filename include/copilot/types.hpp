@@ -3,7 +3,10 @@
 
 #pragma once
 
+#include <algorithm>
 #include <chrono>
+#include <copilot/thread_options.hpp>
+#include <cstdint>
 #include <cstdlib>
 #include <functional>
 #include <map>
@@ -25,6 +28,7 @@ namespace copilot
 using json = nlohmann::json;
 
 // Forward declarations
+class MetricsRegistry;
 class Session;
 struct SessionEvent;
 
@@ -1074,6 +1078,99 @@ inline void to_json(json& j, const MessageOptions& o)
 // Client Options
 // =============================================================================
 
+/// How the client restarts a CLI server process that exits unexpectedly
+///
+/// Restarts back off exponentially: the n-th restart within `crash_loop_window`
+/// waits initial_backoff * multiplier^(n-1), capped at max_backoff. A CLI that
+/// stays up longer than the window starts again from initial_backoff.
+struct RestartPolicy
+{
+    std::chrono::milliseconds initial_backoff{100};
+    std::chrono::milliseconds max_backoff{10000};
+    double multiplier = 2.0;
+
+    /// Give up (state becomes Error) after this many restarts within the window
+    int max_restarts = 5;
+    std::chrono::milliseconds crash_loop_window{60000};
+
+    /// Delay before the `attempt`-th restart within the window (1-based)
+    std::chrono::milliseconds backoff_for(int attempt) const
+    {
+        double delay = static_cast<double>(initial_backoff.count());
+        for (int i = 1; i < attempt && delay < static_cast<double>(max_backoff.count()); ++i)
+            delay *= multiplier;
+        auto ms = static_cast<std::chrono::milliseconds::rep>(delay);
+        return std::min(std::chrono::milliseconds(ms), max_backoff);
+    }
+};
+
+/// Opt-in cold-start tuning for a CLI run through Node.js (cli_path is a .js file)
+///
+/// The node executable found on PATH is reused across starts, NODE_COMPILE_CACHE
+/// points at a directory per CLI version so code V8 compiled for one start is
+/// reused by the next (Node 22.1+; older versions ignore it), and `v8_flags` are
+/// passed ahead of the script. Client::startup_stats() shows the effect.
+struct NodeStartupOptions
+{
+    bool enabled = false;
+
+    /// Root of the compile caches (empty = a per-user location:
+    /// $XDG_CACHE_HOME, ~/.cache or %LOCALAPPDATA%, then copilot-sdk-cpp/node-compile-cache).
+    /// A NODE_COMPILE_CACHE set in the environment takes precedence.
+    std::string cache_root;
+
+    /// Compile caches kept under cache_root; the least recently used are removed
+    std::size_t max_cached_versions = 3;
+
+    /// Node/V8 options placed before the script. A larger young generation
+    /// saves scavenges while the CLI loads its modules.
+    std::vector<std::string> v8_flags = {"--max-semi-space-size=32"};
+};
+
+/// Timing of the most recent CLI server start (see Client::startup_stats())
+struct StartupStats
+{
+    uint64_t starts = 0; ///< CLI servers spawned, including restarts
+
+    std::chrono::microseconds resolve_time{0};   ///< Locating node, building argv/environment
+    std::chrono::microseconds spawn_time{0};     ///< Process::spawn()
+    std::chrono::microseconds spawn_to_ready{0}; ///< Spawn until the protocol check passed
+
+    /// The argv/environment block built by an earlier start was reused
+    /// (restarts reuse it until rolling_replace() changes the launch options)
+    bool launch_reused = false;
+
+    bool node_accelerated = false;                ///< NodeStartupOptions were applied
+    std::optional<std::string> compile_cache_dir; ///< NODE_COMPILE_CACHE given to the CLI
+};
+
+/// Counters describing CLI server restarts (see ClientOptions::auto_restart)
+struct RestartStats
+{
+    uint64_t restarts = 0;             ///< Successful restarts
+    uint64_t failed_attempts = 0;      ///< Respawns that failed to connect
+    uint64_t sessions_reattached = 0;  ///< Sessions resumed after a restart
+    uint64_t reattach_failures = 0;    ///< Sessions whose resume failed
+    bool crash_loop = false;           ///< Gave up after too many restarts
+    std::optional<int> last_exit_code; ///< Exit code of the last unexpected exit
+
+    /// Time from the exit to sessions being re-attached
+    std::chrono::milliseconds last_downtime{0};
+    std::chrono::milliseconds max_downtime{0};
+    std::chrono::milliseconds total_downtime{0};
+};
+
+/// One line the CLI server wrote to stderr
+struct CliLogLine
+{
+    std::chrono::system_clock::time_point time; ///< When the line was read
+    LogLevel level = LogLevel::None;            ///< Parsed severity (None if unrecognized)
+    std::string text;                           ///< Without the trailing newline
+};
+
+/// Receives CLI stderr lines as they are read (on the drain thread)
+using CliLogHandler = std::function<void(const CliLogLine&)>;
+
 /// Options for creating a CopilotClient
 struct ClientOptions
 {
@@ -1085,15 +1182,45 @@ struct ClientOptions
     std::optional<std::string> cli_url;
     LogLevel log_level = LogLevel::Info;
     bool auto_start = true;
+
+    /// Respawn a CLI server spawned by this client if it exits while connected,
+    /// then resume every open session (tools and handlers stay registered)
     bool auto_restart = true;
+    RestartPolicy restart_policy;
+
     std::optional<std::map<std::string, std::string>> environment;
 
+    /// Cold-start tuning when cli_path is a Node.js script
+    NodeStartupOptions node_startup;
+
     /// GitHub token for authentication. Cannot be used with cli_url.
     std::optional<std::string> github_token;
 
     /// Whether to use logged-in user for auth. Defaults to true when github_token is empty.
     /// Cannot be used with cli_url.
     std::optional<bool> use_logged_in_user;
+
+    /// Recent CLI stderr lines kept in memory (see Client::cli_log()). stderr is
+    /// always drained, so a verbose CLI never blocks on a full pipe.
+    std::size_t cli_log_capacity = 1000;
+
+    /// Optional sink for every CLI stderr line
+    CliLogHandler on_cli_log;
+
+    /// Thread names, CPU affinity and scheduling of SDK background threads and
+    /// of the spawned CLI server
+    ThreadOptions threads;
+
+    /// Opt-in local event journal. Events of each created or resumed session are
+    /// appended under `<event_journal_dir>/<session_id>` (see EventJournal), so a
+    /// conversation can be read back after a restart without JSON-RPC. A session
+    /// whose journal cannot be opened runs without one (Session::journal() is null).
+    std::optional<std::string> event_journal_dir;
+
+    /// Registry the Client reports into (see MetricsRegistry): JSON-RPC latency,
+    /// in-flight requests, transport bytes, events by type, open sessions, tool
+    /// call latency, CLI restarts and CLI memory. Read at construction.
+    std::shared_ptr<MetricsRegistry> metrics;
 };
 
 // =============================================================================
@@ -0,0 +1,215 @@
+// Copyright (c) 2025 Elias Bachaalany
+// SPDX-License-Identifier: MIT
+
+#include <algorithm>
+#include <cctype>
+#include <copilot/cli_log.hpp>
+#include <cstring>
+
+namespace copilot
+{
+
+// =============================================================================
+// CliLog
+// =============================================================================
+
+CliLog::CliLog(std::size_t capacity, CliLogHandler sink)
+    : capacity_(capacity), sink_(std::move(sink))
+{
+}
+
+void CliLog::feed(const char* data, std::size_t size)
+{
+    std::vector<CliLogLine> to_sink;
+    std::unique_lock<std::mutex> lock(mutex_);
+    stats_.bytes += size;
+
+    const char* end = data + size;
+    while (data < end)
+    {
+        const char* newline = static_cast<const char*>(std::memchr(data, '\n', end - data));
+        const char* stop = newline ? newline : end;
+
+        if (!discarding_)
+        {
+            std::size_t room = kMaxLineLength - partial_.size();
+            std::size_t take = std::min<std::size_t>(room, stop - data);
+            partial_.append(data, take);
+            if (take < static_cast<std::size_t>(stop - data))
+            {
+                discarding_ = true;
+                stats_.truncated++;
+            }
+        }
+
+        if (!newline)
+            break;
+
+        if (!partial_.empty() && partial_.back() == '\r')
+            partial_.pop_back();
+        emit_locked(std::move(partial_), to_sink);
+        partial_.clear();
+        discarding_ = false;
+        data = newline + 1;
+    }
+
+    lock.unlock();
+    run_sink(to_sink);
+}
+
+void CliLog::flush()
+{
+    std::vector<CliLogLine> to_sink;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (partial_.empty())
+            return;
+        emit_locked(std::move(partial_), to_sink);
+        partial_.clear();
+        discarding_ = false;
+    }
+    run_sink(to_sink);
+}
+
+void CliLog::run_sink(const std::vector<CliLogLine>& lines) const
+{
+    for (const auto& line : lines)
+    {
+        try
+        {
+            sink_(line);
+        }
+        catch (...)
+        {
+            // A throwing sink must not stop the drain
+        }
+    }
+}
+
+void CliLog::emit_locked(std::string text, std::vector<CliLogLine>& to_sink)
+{
+    CliLogLine line;
+    line.time = std::chrono::system_clock::now();
+    line.level = parse_level(text);
+    line.text = std::move(text);
+
+    stats_.lines++;
+    switch (line.level)
+    {
+    case LogLevel::Error:
+        stats_.errors++;
+        break;
+    case LogLevel::Warning:
+        stats_.warnings++;
+        break;
+    case LogLevel::Info:
+        stats_.infos++;
+        break;
+    case LogLevel::Debug:
+        stats_.debugs++;
+        break;
+    default:
+        stats_.unleveled++;
+        break;
+    }
+
+    if (sink_)
+        to_sink.push_back(line);
+
+    if (capacity_ == 0)
+        return;
+    if (lines_.size() == capacity_)
+    {
+        lines_.pop_front();
+        stats_.evicted++;
+    }
+    lines_.push_back(std::move(line));
+}
+
+std::vector<CliLogLine> CliLog::lines() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return {lines_.begin(), lines_.end()};
+}
+
+CliLogStats CliLog::stats() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stats_;
+}
+
+LogLevel CliLog::parse_level(std::string_view line)
+{
+    // Look at the first few alphabetic words only: timestamps and brackets are
+    // skipped, and message text further along cannot be mistaken for a level
+    constexpr int kWordsToCheck = 4;
+    std::string word;
+    int words = 0;
+    std::size_t i = 0;
+    while (i < line.size() && words < kWordsToCheck)
+    {
+        while (i < line.size() && !std::isalpha(static_cast<unsigned char>(line[i])))
+            ++i;
+        word.clear();
+        for (; i < line.size() && std::isalpha(static_cast<unsigned char>(line[i])); ++i)
+            word.push_back(static_cast<char>(std::tolower(static_cast<unsigned char>(line[i]))));
+        if (word.empty())
+            break;
+        ++words;
+
+        if (word == "error" || word == "err" || word == "fatal" || word == "critical")
+            return LogLevel::Error;
+        if (word == "warn" || word == "warning")
+            return LogLevel::Warning;
+        if (word == "info")
+            return LogLevel::Info;
+        if (word == "debug" || word == "trace" || word == "verbose")
+            return LogLevel::Debug;
+    }
+    return LogLevel::None;
+}
+
+// =============================================================================
+// PipeDrain
+// =============================================================================
+
+PipeDrain::PipeDrain(ReadPipe& pipe, std::shared_ptr<CliLog> log, ThreadStartHook on_thread_start)
+    : pipe_(pipe), log_(std::move(log)), on_thread_start_(std::move(on_thread_start)),
+      thread_([this] { run(); })
+{
+}
+
+PipeDrain::~PipeDrain()
+{
+    stop_ = true;
+    if (thread_.joinable())
+        thread_.join();
+}
+
+void PipeDrain::run()
+{
+    if (on_thread_start_)
+        on_thread_start_(ThreadRole::LogDrain);
+
+    char buffer[8192];
+    try
+    {
+        while (!stop_)
+        {
+            // Bounded wait so destruction is noticed even if the pipe stays open
+            if (!pipe_.has_data(100))
+                continue;
+            std::size_t n = pipe_.read(buffer, sizeof(buffer));
+            if (n == 0)
+                break; // EOF
+            log_->feed(buffer, n);
+        }
+    }
+    catch (const ProcessError&)
+    {
+        // Pipe closed or failed: nothing more to drain
+    }
+    log_->flush();
+}
+
+} // namespace copilot
@@ -3,7 +3,11 @@
 
 #include <chrono>
 #include <copilot/client.hpp>
+#include <copilot/node_startup.hpp>
 #include <copilot/session.hpp>
+#include <copilot/trace.hpp>
+#include <cstdlib>
+#include <filesystem>
 #include <regex>
 #include <thread>
 
@@ -198,37 +202,54 @@ json build_session_resume_request(const std::string& session_id, const ResumeSes
 // Constructor / Destructor
 // =============================================================================
 
-Client::Client(ClientOptions options) : options_(std::move(options))
+Client::Client(ClientOptions options)
+    : options_(std::move(options)),
+      cli_log_(std::make_shared<CliLog>(options_.cli_log_capacity, options_.on_cli_log))
+{
+    normalize_options(options_);
+
+    // Parse CLI URL if provided
+    if (options_.cli_url.has_value())
+        parse_cli_url(*options_.cli_url);
+
+    if (options_.metrics)
+    {
+        metrics_collector_ = options_.metrics->add_collector(
+            [this](MetricsWriter& writer) { collect_metrics(writer); }
+        );
+    }
+}
+
+Client::~Client()
+{
+    // First, so no scrape reaches into a Client being torn down
+    if (options_.metrics)
+        options_.metrics->remove_collector(metrics_collector_);
+    force_stop();
+}
+
+void Client::normalize_options(ClientOptions& options)
 {
     // Validate mutually exclusive options
-    if (options_.cli_url.has_value() && (options_.use_stdio || options_.cli_path.has_value()))
+    if (options.cli_url.has_value() && (options.use_stdio || options.cli_path.has_value()))
         throw std::invalid_argument("cli_url is mutually exclusive with use_stdio and cli_path");
 
     // Validate auth options with external server
-    if (options_.cli_url.has_value())
+    if (options.cli_url.has_value())
     {
-        if (options_.github_token.has_value())
+        if (options.github_token.has_value())
             throw std::invalid_argument(
                 "github_token cannot be used with cli_url "
                 "(external server manages its own auth)");
-        if (options_.use_logged_in_user.has_value())
+        if (options.use_logged_in_user.has_value())
             throw std::invalid_argument(
                 "use_logged_in_user cannot be used with cli_url "
                 "(external server manages its own auth)");
     }
 
     // Smart default for use_logged_in_user (only when managing our own server)
-    if (!options_.cli_url.has_value() && !options_.use_logged_in_user.has_value())
-        options_.use_logged_in_user = !options_.github_token.has_value();
-
-    // Parse CLI URL if provided
-    if (options_.cli_url.has_value())
-        parse_cli_url(*options_.cli_url);
-}
-
-Client::~Client()
-{
-    force_stop();
+    if (!options.cli_url.has_value() && !options.use_logged_in_user.has_value())
+        options.use_logged_in_user = !options.github_token.has_value();
 }
 
 // =============================================================================
@@ -312,8 +333,13 @@ std::future<void> Client::start()
 
                 // Verify protocol version
                 verify_protocol_version();
+                if (process_)
+                    record_cli_ready();
 
                 state_ = ConnectionState::Connected;
+
+                if (process_ && options_.auto_restart)
+                    start_supervisor();
             }
             catch (...)
             {
@@ -330,9 +356,21 @@ std::future<std::vector<StopError>> Client::stop()
         std::launch::async,
         [this]() -> std::vector<StopError>
         {
+            // Before taking mutex_: a restart in progress holds it
+            stop_supervisor();
+
             std::lock_guard<std::mutex> lock(mutex_);
             std::vector<StopError> errors;
 
+            // Release consumers and any read-thread push blocked on a full stream,
+            // and turns that will never see session.idle
+            auto stopped = std::make_exception_ptr(std::runtime_error("Client stopped"));
+            for (auto& [id, session] : sessions_)
+            {
+                session->close_streams();
+                session->fail_turns(stopped);
+            }
+
             // Destroy all sessions
             for (auto& [id, session] : sessions_)
             {
@@ -349,7 +387,11 @@ std::future<std::vector<StopError>> Client::stop()
                     errors.push_back(StopError{"Unknown error destroying session " + id});
                 }
             }
-            sessions_.clear();
+            {
+                std::lock_guard<std::mutex> sessions_lock(sessions_mutex_);
+                sessions_.clear();
+            }
+            session_attach_requests_.clear();
 
             // Clear models cache
             {
@@ -362,15 +404,20 @@ std::future<std::vector<StopError>> Client::stop()
             {
                 process_->terminate();
                 process_->wait();
+                stderr_drain_.reset();
+                publish_cli_process(nullptr);
                 process_.reset();
             }
 
             // Now stop RPC client - read thread will unblock since pipes are closed
+            rpc_view_.store(nullptr, std::memory_order_release);
             if (rpc_)
             {
                 rpc_->stop();
                 rpc_.reset();
             }
+            retired_.rpc.reset();
+            retired_.process.reset();
 
             // Close transport
             if (transport_)
@@ -387,9 +434,21 @@ std::future<std::vector<StopError>> Client::stop()
 
 void Client::force_stop()
 {
+    stop_supervisor();
+
     std::lock_guard<std::mutex> lock(mutex_);
 
-    sessions_.clear();
+    auto stopped = std::make_exception_ptr(std::runtime_error("Client stopped"));
+    for (auto& [id, session] : sessions_)
+    {
+        session->close_streams();
+        session->fail_turns(stopped);
+    }
+    {
+        std::lock_guard<std::mutex> sessions_lock(sessions_mutex_);
+        sessions_.clear();
+    }
+    session_attach_requests_.clear();
 
     // Clear models cache
     {
@@ -402,15 +461,20 @@ void Client::force_stop()
     {
         process_->kill();
         process_->wait();
+        stderr_drain_.reset();
+        publish_cli_process(nullptr);
         process_.reset();
     }
 
     // Now stop RPC client - read thread will unblock since pipes are closed
+    rpc_view_.store(nullptr, std::memory_order_release);
     if (rpc_)
     {
         rpc_->stop();
         rpc_.reset();
     }
+    retired_.rpc.reset();
+    retired_.process.reset();
 
     if (transport_)
     {
@@ -437,10 +501,14 @@ Client::resolve_cli_command(const std::string& cli_path, const std::vector<std::
     // Check if it's a Node.js script
     if (is_node_script(cli_path))
     {
-        auto node_path = find_node();
+        const NodeStartupOptions& startup = options_.node_startup;
+        auto node_path = startup.enabled ? find_node_cached() : find_node();
         if (!node_path.has_value())
             throw std::runtime_error("Node.js not found in PATH but required for .js CLI");
-        std::vector<std::string> full_args = {cli_path};
+        std::vector<std::string> full_args;
+        if (startup.enabled)
+            full_args = startup.v8_flags;
+        full_args.push_back(cli_path);
         full_args.insert(full_args.end(), args.begin(), args.end());
         return {*node_path, full_args};
     }
@@ -459,7 +527,7 @@ Client::resolve_cli_command(const std::string& cli_path, const std::vector<std::
     return {cli_path, args};
 }
 
-void Client::start_cli_server()
+Client::CliLaunch Client::prepare_cli_launch()
 {
     std::string cli_path = options_.cli_path.value_or("copilot");
 
@@ -507,9 +575,79 @@ void Client::start_cli_server()
     if (options_.github_token.has_value())
         proc_opts.environment["COPILOT_SDK_AUTH_TOKEN"] = *options_.github_token;
 
+    proc_opts.scheduling = options_.threads.cli_process;
+    proc_opts.on_thread_start = thread_start_hook();
+
+    // Node cold-start acceleration; an explicit NODE_COMPILE_CACHE wins
+    bool node_accelerated = options_.node_startup.enabled && is_node_script(cli_path);
+    std::optional<std::string> compile_cache_dir;
+    if (node_accelerated)
+    {
+        const char* inherited = std::getenv("NODE_COMPILE_CACHE");
+        auto it = proc_opts.environment.find("NODE_COMPILE_CACHE");
+        if (it != proc_opts.environment.end())
+        {
+            compile_cache_dir = it->second;
+        }
+        else if (inherited && proc_opts.inherit_environment)
+        {
+            compile_cache_dir = inherited;
+        }
+        else
+        {
+            std::string dir = prepare_node_compile_cache(options_.node_startup, cli_path);
+            if (!dir.empty())
+            {
+                proc_opts.environment["NODE_COMPILE_CACHE"] = dir;
+                compile_cache_dir = dir;
+            }
+        }
+    }
+
+    return CliLaunch{
+        SpawnSpec(executable, full_args, proc_opts), node_accelerated, compile_cache_dir
+    };
+}
+
+void Client::start_cli_server()
+{
+    // Argument, PATH and environment work is done once; restarts reuse the block
+    auto resolve_start = std::chrono::steady_clock::now();
+    bool launch_reused = cli_launch_.has_value();
+    if (!launch_reused)
+        cli_launch_ = prepare_cli_launch();
+    auto resolve_time = std::chrono::steady_clock::now() - resolve_start;
+
     // Spawn process
+    uint64_t generation = 0;
+    {
+        std::lock_guard<std::mutex> exit_lock(cli_exit_mutex_);
+        cli_exit_code_.reset();
+        generation = ++cli_generation_;
+    }
+    stderr_drain_.reset();
+    publish_cli_process(nullptr);
     process_ = std::make_unique<Process>();
-    process_->spawn(executable, full_args, proc_opts);
+    spawn_started_ = std::chrono::steady_clock::now();
+    process_->spawn(cli_launch_->spec);
+    publish_cli_process(process_.get());
+    {
+        using std::chrono::duration_cast;
+        using std::chrono::microseconds;
+        std::lock_guard<std::mutex> stats_lock(startup_stats_mutex_);
+        startup_stats_.starts++;
+        startup_stats_.resolve_time = duration_cast<microseconds>(resolve_time);
+        startup_stats_.spawn_time =
+            duration_cast<microseconds>(std::chrono::steady_clock::now() - spawn_started_);
+        startup_stats_.spawn_to_ready = microseconds(0);
+        startup_stats_.launch_reused = launch_reused;
+        startup_stats_.node_accelerated = cli_launch_->node_accelerated;
+        startup_stats_.compile_cache_dir = cli_launch_->compile_cache_dir;
+    }
+    process_->on_exit([this, generation](int exit_code)
+                      { handle_cli_exit(generation, exit_code); });
+    stderr_drain_ =
+        std::make_unique<PipeDrain>(process_->stderr_pipe(), cli_log_, thread_start_hook());
 
     // If not using stdio, wait for port announcement
     if (!options_.use_stdio)
@@ -543,7 +681,665 @@ void Client::start_cli_server()
     }
 }
 
-void Client::connect_to_server()
+void Client::handle_cli_exit(uint64_t generation, int exit_code)
+{
+    // Runs on the exit watcher; mutex_ may be held by stop() waiting for this thread
+    std::string reason = "CLI process exited with code " + std::to_string(exit_code);
+    std::shared_ptr<JsonRpcClient> rpc;
+    {
+        std::lock_guard<std::mutex> exit_lock(cli_exit_mutex_);
+        if (generation != cli_generation_)
+            return; // a process replaced by rolling_replace()
+        cli_exit_code_ = exit_code;
+        rpc = rpc_;
+    }
+
+    // Callbacks run inline and may call back into the client (e.g. cli_exit_code())
+    if (rpc)
+        rpc->abort_pending(reason);
+
+    // The dead process will not report session.idle for the turns it was running
+    std::vector<std::shared_ptr<Session>> sessions;
+    {
+        std::lock_guard<std::mutex> sessions_lock(sessions_mutex_);
+        for (auto& [id, session] : sessions_)
+            sessions.push_back(session);
+    }
+    auto exited = std::make_exception_ptr(std::runtime_error(reason));
+    for (auto& session : sessions)
+        session->fail_turns(exited);
+
+    // An exit while connected is unexpected (stop() shuts the supervisor down first)
+    if (!options_.auto_restart || state_ != ConnectionState::Connected)
+        return;
+
+    {
+        std::lock_guard<std::mutex> stats_lock(restart_stats_mutex_);
+        restart_stats_.last_exit_code = exit_code;
+    }
+    {
+        std::lock_guard<std::mutex> supervisor_lock(supervisor_mutex_);
+        if (supervisor_stop_ || !supervisor_thread_.joinable())
+            return;
+        restart_requested_ = true;
+        exit_time_ = std::chrono::steady_clock::now();
+    }
+    supervisor_cv_.notify_all();
+}
+
+std::optional<int> Client::cli_exit_code() const
+{
+    std::lock_guard<std::mutex> exit_lock(cli_exit_mutex_);
+    return cli_exit_code_;
+}
+
+RestartStats Client::restart_stats() const
+{
+    std::lock_guard<std::mutex> stats_lock(restart_stats_mutex_);
+    return restart_stats_;
+}
+
+StartupStats Client::startup_stats() const
+{
+    std::lock_guard<std::mutex> stats_lock(startup_stats_mutex_);
+    return startup_stats_;
+}
+
+void Client::record_cli_ready()
+{
+    auto elapsed = std::chrono::steady_clock::now() - spawn_started_;
+    std::lock_guard<std::mutex> stats_lock(startup_stats_mutex_);
+    startup_stats_.spawn_to_ready = std::chrono::duration_cast<std::chrono::microseconds>(elapsed);
+}
+
+ClientResourceUsage Client::get_resource_usage() const
+{
+    ClientResourceUsage usage;
+    usage.cli_restarts = restart_stats().restarts;
+    usage.cli_log_bytes = cli_log_->stats().bytes;
+    {
+        std::lock_guard<std::mutex> lock(sessions_mutex_);
+        usage.sessions = sessions_.size();
+    }
+    // Kept alive for a generation after a restart, like the pointer Sessions use
+    if (auto* rpc = rpc_view_.load(std::memory_order_acquire))
+        usage.pending_requests = rpc->pending_request_count();
+
+    std::lock_guard<std::mutex> lock(usage_mutex_);
+    if (usage_process_)
+    {
+        usage.cli = usage_process_->resource_usage();
+        usage.cli_pid = usage_process_->pid();
+    }
+    return usage;
+}
+
+void Client::publish_cli_process(Process* process)
+{
+    std::lock_guard<std::mutex> lock(usage_mutex_);
+    usage_process_ = process;
+}
+
+void Client::collect_metrics(MetricsWriter& writer) const
+{
+    auto usage = get_resource_usage();
+    writer.gauge("copilot_sessions_active", "Open sessions", static_cast<double>(usage.sessions));
+    writer.gauge(
+        "copilot_rpc_requests_in_flight",
+        "JSON-RPC requests awaiting a response",
+        static_cast<double>(usage.pending_requests)
+    );
+    writer.counter(
+        "copilot_cli_restarts_total",
+        "Automatic restarts of the CLI server",
+        static_cast<double>(usage.cli_restarts)
+    );
+    if (usage.cli)
+    {
+        writer.gauge(
+            "copilot_cli_resident_memory_bytes",
+            "Resident set size of the CLI server",
+            static_cast<double>(usage.cli->rss_bytes)
+        );
+        writer.counter(
+            "copilot_cli_cpu_seconds_total",
+            "CPU time used by the CLI server",
+            static_cast<double>(usage.cli->cpu().count()) / 1e6
+        );
+    }
+
+    bool tcp = options_.cli_url.has_value() || !options_.use_stdio;
+    MetricLabels transport = {{"transport", tcp ? "tcp" : "stdio"}};
+    writer.counter(
+        "copilot_transport_sent_bytes_total",
+        "JSON-RPC message bytes written to the CLI server",
+        static_cast<double>(transport_counters_->bytes_sent.load(std::memory_order_relaxed)),
+        transport
+    );
+    writer.counter(
+        "copilot_transport_received_bytes_total",
+        "JSON-RPC message bytes read from the CLI server",
+        static_cast<double>(transport_counters_->bytes_received.load(std::memory_order_relaxed)),
+        transport
+    );
+
+    for (size_t i = 0; i < event_counts_.size(); ++i)
+    {
+        uint64_t count = event_counts_[i].load(std::memory_order_relaxed);
+        if (count == 0)
+            continue;
+        writer.counter(
+            "copilot_session_events_total",
+            "Session events received",
+            static_cast<double>(count),
+            {{"type", session_event_type_name(static_cast<SessionEventType>(i))}}
+        );
+    }
+
+    // Latencies come from the RPC metrics (COPILOT_ENABLE_RPC_METRICS)
+    auto rpc = get_rpc_metrics();
+    for (const auto& [method, stats] : rpc.methods)
+    {
+        if (stats.requests == 0)
+            continue; // Only received from the server
+        MetricLabels labels = {{"method", method}};
+        writer.counter(
+            "copilot_rpc_requests_total",
+            "JSON-RPC requests sent",
+            static_cast<double>(stats.requests),
+            labels
+        );
+        writer.counter(
+            "copilot_rpc_errors_total",
+            "JSON-RPC requests that failed (error response, timeout, connection lost)",
+            static_cast<double>(stats.error_count()),
+            labels
+        );
+        writer.histogram(
+            "copilot_rpc_request_duration_seconds",
+            "Time from a JSON-RPC request being written until its response was read",
+            stats.wait_time,
+            labels
+        );
+    }
+    for (const auto& [key, stats] : rpc.callback_details)
+    {
+        if (key.first != "tool.call")
+            continue;
+        MetricLabels labels = {{"tool", key.second}};
+        writer.histogram(
+            "copilot_tool_call_duration_seconds",
+            "Time to answer a tool call, from request read to response written",
+            stats.total,
+            labels
+        );
+        writer.counter(
+            "copilot_tool_call_errors_total",
+            "Tool calls answered with an error",
+            static_cast<double>(stats.errors),
+            labels
+        );
+    }
+}
+
+// =============================================================================
+// Auto-restart
+// =============================================================================
+
+void Client::start_supervisor()
+{
+    std::lock_guard<std::mutex> supervisor_lock(supervisor_mutex_);
+    if (supervisor_thread_.joinable())
+        return;
+    supervisor_stop_ = false;
+    restart_requested_ = false;
+    supervisor_thread_ = std::thread([this] { supervise(); });
+}
+
+void Client::stop_supervisor()
+{
+    {
+        std::lock_guard<std::mutex> supervisor_lock(supervisor_mutex_);
+        supervisor_stop_ = true;
+    }
+    supervisor_cv_.notify_all();
+    if (supervisor_thread_.joinable() && supervisor_thread_.get_id() != std::this_thread::get_id())
+        supervisor_thread_.join();
+}
+
+void Client::supervise()
+{
+    configure_current_thread(options_.threads, ThreadRole::Supervisor);
+    const RestartPolicy& policy = options_.restart_policy;
+
+    std::unique_lock<std::mutex> lock(supervisor_mutex_);
+    while (true)
+    {
+        supervisor_cv_.wait(lock, [this] { return supervisor_stop_ || restart_requested_; });
+        if (supervisor_stop_)
+            return;
+        restart_requested_ = false;
+        const auto exit_time = exit_time_;
+
+        // Retry until a respawn sticks, the policy gives up, or the client stops
+        while (true)
+        {
+            auto now = std::chrono::steady_clock::now();
+            while (!restart_times_.empty() &&
+                   now - restart_times_.front() > policy.crash_loop_window)
+                restart_times_.pop_front();
+
+            if (static_cast<int>(restart_times_.size()) >= policy.max_restarts)
+            {
+                {
+                    std::lock_guard<std::mutex> stats_lock(restart_stats_mutex_);
+                    restart_stats_.crash_loop = true;
+                }
+                lock.unlock();
+                {
+                    std::lock_guard<std::mutex> client_lock(mutex_);
+                    retire_connection();
+                    state_ = ConnectionState::Error;
+                }
+                lock.lock();
+                break;
+            }
+            restart_times_.push_back(now);
+
+            auto delay = policy.backoff_for(static_cast<int>(restart_times_.size()));
+            if (supervisor_cv_.wait_for(lock, delay, [this] { return supervisor_stop_; }))
+                return;
+
+            lock.unlock();
+            bool restarted = restart_cli_server(exit_time);
+            lock.lock();
+            if (restarted || supervisor_stop_)
+                break;
+        }
+    }
+}
+
+bool Client::restart_cli_server(std::chrono::steady_clock::time_point exit_time)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    // Someone else (e.g. an auto_start call) already brought the client back
+    if (state_ == ConnectionState::Connected && process_ && process_->is_running())
+        return true;
+
+    state_ = ConnectionState::Connecting;
+    retire_connection();
+
+    try
+    {
+        start_cli_server();
+        connect_to_server();
+        verify_protocol_version();
+        record_cli_ready();
+    }
+    catch (...)
+    {
+        retire_connection();
+        state_ = ConnectionState::Error;
+        std::lock_guard<std::mutex> stats_lock(restart_stats_mutex_);
+        restart_stats_.failed_attempts++;
+        return false;
+    }
+
+    reattach_sessions();
+    state_ = ConnectionState::Connected;
+
+    auto downtime = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - exit_time
+    );
+    std::lock_guard<std::mutex> stats_lock(restart_stats_mutex_);
+    restart_stats_.restarts++;
+    restart_stats_.last_downtime = downtime;
+    restart_stats_.max_downtime = std::max(restart_stats_.max_downtime, downtime);
+    restart_stats_.total_downtime += downtime;
+    return true;
+}
+
+JsonRpcClient& Client::connected_rpc()
+{
+    auto* rpc = rpc_client();
+    if (!rpc)
+        throw JsonRpcError(JsonRpcErrorCode::ConnectionClosed, "Not connected to the CLI server");
+    return *rpc;
+}
+
+void Client::retire_connection()
+{
+    std::shared_ptr<JsonRpcClient> rpc;
+    {
+        std::lock_guard<std::mutex> exit_lock(cli_exit_mutex_);
+        rpc_view_.store(nullptr, std::memory_order_release);
+        rpc = std::move(rpc_);
+    }
+    if (rpc)
+        rpc->stop();
+
+    // Reap the old process (kill() is harmless if it already exited)
+    if (process_)
+    {
+        process_->kill();
+        process_->wait();
+    }
+    stderr_drain_.reset();
+
+    // Free the previous generation; the RPC client first, it references the pipes
+    retired_.rpc.reset();
+    retired_.process.reset();
+    publish_cli_process(nullptr);
+    retired_.process = std::move(process_);
+    retired_.rpc = std::move(rpc);
+}
+
+void Client::reattach_sessions()
+{
+    // Pipeline every session.resume, then collect: the server handles them concurrently
+    std::vector<std::future<json>> pending;
+    pending.reserve(sessions_.size());
+    for (const auto& [id, session] : sessions_)
+    {
+        auto it = session_attach_requests_.find(id);
+        json request = it != session_attach_requests_.end() ? it->second : json{{"sessionId", id}};
+        pending.push_back(rpc_->invoke("session.resume", request));
+    }
+
+    uint64_t reattached = 0;
+    uint64_t failed = 0;
+    for (auto& future : pending)
+    {
+        try
+        {
+            future.get();
+            reattached++;
+        }
+        catch (...)
+        {
+            failed++;
+        }
+    }
+
+    std::lock_guard<std::mutex> stats_lock(restart_stats_mutex_);
+    restart_stats_.sessions_reattached += reattached;
+    restart_stats_.reattach_failures += failed;
+}
+
+// =============================================================================
+// Rolling replace
+// =============================================================================
+
+std::future<RollingReplaceResult> Client::rolling_replace(
+    ClientOptions options, std::chrono::milliseconds drain_timeout
+)
+{
+    return std::async(
+        std::launch::async,
+        [this, options = std::move(options), drain_timeout]() mutable
+        {
+            normalize_options(options);
+            if (options.cli_url.has_value())
+                throw std::invalid_argument("rolling_replace() spawns the new server; "
+                                            "cli_url is not supported");
+
+            // Session creation and removal wait until the sessions have moved
+            std::unique_lock<std::shared_mutex> registry_lock(session_registry_mutex_);
+
+            // Before taking mutex_: a restart in progress holds it
+            stop_supervisor();
+            std::lock_guard<std::mutex> lock(mutex_);
+
+            try
+            {
+                auto result = replace_cli_server(options, drain_timeout);
+                if (options_.auto_restart)
+                    start_supervisor();
+                return result;
+            }
+            catch (...)
+            {
+                if (state_ == ConnectionState::Connected && process_ && options_.auto_restart)
+                    start_supervisor();
+                throw;
+            }
+        }
+    );
+}
+
+RollingReplaceResult Client::replace_cli_server(
+    const ClientOptions& launch, std::chrono::milliseconds drain_timeout
+)
+{
+    using std::chrono::duration_cast;
+    using std::chrono::microseconds;
+    using std::chrono::steady_clock;
+
+    if (state_ != ConnectionState::Connected || !process_ || !rpc_)
+        throw std::runtime_error("rolling_replace() needs a client connected to a CLI server "
+                                 "it spawned");
+
+    RollingReplaceResult result;
+    auto begin = steady_clock::now();
+
+    // Park the serving connection; sessions keep using it through rpc_view_
+    ClientOptions previous = options_;
+    auto previous_host = parsed_host_;
+    auto previous_port = parsed_port_;
+    publish_cli_process(nullptr);
+    std::unique_ptr<Process> old_process = std::move(process_);
+    std::unique_ptr<PipeDrain> old_drain = std::move(stderr_drain_);
+    std::shared_ptr<JsonRpcClient> old_rpc;
+    uint64_t old_generation = 0;
+    {
+        std::lock_guard<std::mutex> exit_lock(cli_exit_mutex_);
+        old_rpc = std::move(rpc_);
+        old_generation = cli_generation_;
+    }
+
+    // Only launch settings change; callbacks and policies stay as they are
+    options_.cli_path = launch.cli_path;
+    options_.cli_args = launch.cli_args;
+    options_.cwd = launch.cwd;
+    options_.port = launch.port;
+    options_.use_stdio = launch.use_stdio;
+    options_.log_level = launch.log_level;
+    options_.environment = launch.environment;
+    options_.github_token = launch.github_token;
+    options_.use_logged_in_user = launch.use_logged_in_user;
+    options_.node_startup = launch.node_startup;
+    options_.threads.cli_process = launch.threads.cli_process;
+    auto previous_launch = std::exchange(cli_launch_, std::nullopt);
+
+    // On failure: drop the new server and carry on with the old one
+    auto roll_back = [&]
+    {
+        std::shared_ptr<JsonRpcClient> new_rpc;
+        {
+            std::lock_guard<std::mutex> exit_lock(cli_exit_mutex_);
+            new_rpc = std::move(rpc_);
+            rpc_ = std::move(old_rpc);
+            cli_generation_ = old_generation;
+            cli_exit_code_.reset();
+        }
+        // Reap first: the stdio reader only unblocks once the child is gone
+        if (process_)
+        {
+            process_->kill();
+            process_->wait();
+        }
+        if (new_rpc)
+            new_rpc->stop();
+        stderr_drain_.reset();
+        new_rpc.reset();
+        publish_cli_process(nullptr);
+        process_ = std::move(old_process);
+        publish_cli_process(process_.get());
+        stderr_drain_ = std::move(old_drain);
+
+        options_.cli_path = previous.cli_path;
+        options_.cli_args = previous.cli_args;
+        options_.cwd = previous.cwd;
+        options_.port = previous.port;
+        options_.use_stdio = previous.use_stdio;
+        options_.log_level = previous.log_level;
+        options_.environment = previous.environment;
+        options_.github_token = previous.github_token;
+        options_.use_logged_in_user = previous.use_logged_in_user;
+        options_.node_startup = previous.node_startup;
+        options_.threads.cli_process = previous.threads.cli_process;
+        cli_launch_ = std::move(previous_launch);
+        parsed_host_ = previous_host;
+        parsed_port_ = previous_port;
+    };
+
+    try
+    {
+        start_cli_server();
+        connect_to_server(/*publish=*/false);
+        verify_protocol_version();
+        record_cli_ready();
+    }
+    catch (...)
+    {
+        roll_back();
+        throw;
+    }
+    result.startup_time = duration_cast<microseconds>(steady_clock::now() - begin);
+
+    // Pause new turns and let running ones finish on the old server
+    std::unique_lock<std::shared_mutex> gate(send_gate_);
+    auto pause_start = steady_clock::now();
+    auto deadline = pause_start + drain_timeout;
+
+    std::vector<std::shared_ptr<Session>> sessions;
+    for (const auto& [id, session] : sessions_)
+        sessions.push_back(session);
+    result.sessions.resize(sessions.size());
+
+    for (size_t i = 0; i < sessions.size(); ++i)
+    {
+        result.sessions[i].session_id = sessions[i]->session_id();
+        if (!sessions[i]->wait_turn_ended(deadline))
+        {
+            roll_back();
+            throw std::runtime_error(
+                "rolling_replace(): turn on session " + sessions[i]->session_id() +
+                " did not finish within the drain timeout"
+            );
+        }
+        result.sessions[i].drain_time =
+            duration_cast<microseconds>(steady_clock::now() - pause_start);
+    }
+
+    // Resume every session on the new server, pipelined
+    std::vector<std::promise<void>> attached(sessions.size());
+    std::vector<std::future<void>> attached_futures;
+    auto resume_start = steady_clock::now();
+    for (size_t i = 0; i < sessions.size(); ++i)
+    {
+        attached_futures.push_back(attached[i].get_future());
+        const std::string& id = result.sessions[i].session_id;
+        auto it = session_attach_requests_.find(id);
+        json request = it != session_attach_requests_.end() ? it->second : json{{"sessionId", id}};
+        try
+        {
+            rpc_->invoke_async(
+                "session.resume",
+                request,
+                [&handoff = result.sessions[i], &promise = attached[i], resume_start, pause_start](
+                    const json&, std::exception_ptr error
+                )
+                {
+                    auto now = steady_clock::now();
+                    handoff.resume_time = duration_cast<microseconds>(now - resume_start);
+                    handoff.handoff_latency = duration_cast<microseconds>(now - pause_start);
+                    if (error)
+                        promise.set_exception(error);
+                    else
+                        promise.set_value();
+                }
+            );
+        }
+        catch (...)
+        {
+            attached[i].set_exception(std::current_exception());
+        }
+    }
+
+    std::string failed;
+    for (size_t i = 0; i < attached_futures.size(); ++i)
+    {
+        try
+        {
+            attached_futures[i].get();
+        }
+        catch (const std::exception& e)
+        {
+            failed += (failed.empty() ? "" : "; ") + result.sessions[i].session_id + ": " +
+                      e.what();
+        }
+    }
+    if (!failed.empty())
+    {
+        roll_back();
+        throw std::runtime_error("rolling_replace(): session.resume failed (" + failed + ")");
+    }
+
+    // Switch over and let new turns through
+    rpc_view_.store(rpc_.get(), std::memory_order_release);
+    result.pause_time = duration_cast<microseconds>(steady_clock::now() - pause_start);
+    gate.unlock();
+
+    // Let requests already sent to the old server complete, then shut it down
+    old_rpc->wait_for_drain(deadline);
+    old_process->terminate();
+    result.old_exit_code = old_process->wait();
+    old_drain.reset();
+    old_rpc->stop();
+
+    // Kept for one generation: a caller may still hold the old rpc_client() pointer
+    retired_.rpc.reset();
+    retired_.process.reset();
+    retired_.process = std::move(old_process);
+    retired_.rpc = std::move(old_rpc);
+    return result;
+}
+
+namespace
+{
+
+/// Metrics detail of a server request: tool name, permission kind or hook type
+std::string callback_detail(const std::string& method, const json& params)
+{
+    auto string_at = [](const json& object, const char* key) -> std::string
+    {
+        if (!object.is_object())
+            return {};
+        auto it = object.find(key);
+        return it != object.end() && it->is_string() ? it->get<std::string>() : std::string();
+    };
+
+    if (method == "tool.call")
+        return string_at(params, "toolName");
+    if (method == "hooks.invoke")
+        return string_at(params, "hookType");
+    if (method == "permission.request" && params.is_object())
+        return string_at(params.value("permissionRequest", params), "kind");
+    return {};
+}
+
+/// Whether a server-chosen session id can name a directory under the journal root
+bool is_plain_path_component(const std::string& name)
+{
+    return !name.empty() && name != "." && name != ".." &&
+           name.find_first_of(std::string("/\\:\0", 4)) == std::string::npos;
+}
+
+} // namespace
+
+void Client::connect_to_server(bool publish)
 {
     if (options_.use_stdio && process_)
     {
@@ -564,7 +1360,12 @@ void Client::connect_to_server()
     }
 
     // Create JSON-RPC client
-    rpc_ = std::make_unique<JsonRpcClient>(std::move(transport_));
+    {
+        std::lock_guard<std::mutex> exit_lock(cli_exit_mutex_);
+        rpc_ = std::make_shared<JsonRpcClient>(std::move(transport_));
+    }
+    if (publish)
+        rpc_view_.store(rpc_.get(), std::memory_order_release);
 
     // Set up handlers for server-to-client calls
     rpc_->set_notification_handler(
@@ -603,9 +1404,18 @@ void Client::connect_to_server()
         }
     );
 
+    rpc_->set_thread_start_hook(thread_start_hook());
+    rpc_->set_metrics(rpc_metrics_);
+    rpc_->set_request_detail(callback_detail);
+    rpc_->set_transport_counters(transport_counters_);
     rpc_->start();
 }
 
+ThreadStartHook Client::thread_start_hook()
+{
+    return [this](ThreadRole role) { configure_current_thread(options_.threads, role); };
+}
+
 void Client::verify_protocol_version()
 {
     auto response = rpc_->invoke("ping", json{{"message", nullptr}}).get();
@@ -633,6 +1443,25 @@ void Client::verify_protocol_version()
 // Session Management
 // =============================================================================
 
+void Client::attach_event_journal(Session& session)
+{
+    if (!options_.event_journal_dir.has_value())
+        return;
+    // Never let an id like "../x" or "/x" place the journal outside the root
+    if (!is_plain_path_component(session.session_id()))
+        return;
+    try
+    {
+        auto dir = std::filesystem::path(*options_.event_journal_dir) / session.session_id();
+        session.attach_journal(EventJournal::open(dir.string()));
+    }
+    catch (const std::exception&)
+    {
+        // The session already exists on the server; like write failures, a
+        // journal that cannot be opened must not fail it
+    }
+}
+
 std::future<std::shared_ptr<Session>> Client::create_session(SessionConfig config)
 {
     return std::async(
@@ -648,9 +1477,12 @@ std::future<std::shared_ptr<Session>> Client::create_session(SessionConfig confi
                     throw std::runtime_error("Client not connected. Call start() first.");
             }
 
+            // A rolling_replace() in progress must see the session once it exists
+            std::shared_lock<std::shared_mutex> registry_lock(session_registry_mutex_);
+
             // Build and send request
             json request = build_session_create_request(config);
-            auto response = rpc_->invoke("session.create", request).get();
+            auto response = connected_rpc().invoke("session.create", request).get();
             std::string session_id = response["sessionId"].get<std::string>();
 
             // Capture workspace path for infinite sessions
@@ -659,6 +1491,7 @@ std::future<std::shared_ptr<Session>> Client::create_session(SessionConfig confi
                 workspace_path = response["workspacePath"].get<std::string>();
 
             auto session = std::make_shared<Session>(session_id, this, workspace_path);
+            attach_event_journal(*session);
 
             // Register tools locally for handling callbacks from the server
             for (const auto& tool : config.tools)
@@ -676,8 +1509,16 @@ std::future<std::shared_ptr<Session>> Client::create_session(SessionConfig confi
             if (config.hooks.has_value())
                 session->register_hooks(*config.hooks);
 
+            // Re-attaching after a CLI restart resumes with the same tools and flags
+            json attach_request = std::move(request);
+            attach_request["sessionId"] = session_id;
+
             std::lock_guard<std::mutex> lock(mutex_);
-            sessions_[session_id] = session;
+            {
+                std::lock_guard<std::mutex> sessions_lock(sessions_mutex_);
+                sessions_[session_id] = session;
+            }
+            session_attach_requests_[session_id] = std::move(attach_request);
 
             return session;
         }
@@ -700,9 +1541,11 @@ Client::resume_session(const std::string& session_id, ResumeSessionConfig config
                     throw std::runtime_error("Client not connected. Call start() first.");
             }
 
+            std::shared_lock<std::shared_mutex> registry_lock(session_registry_mutex_);
+
             // Build and send request
             json request = build_session_resume_request(session_id, config);
-            auto response = rpc_->invoke("session.resume", request).get();
+            auto response = connected_rpc().invoke("session.resume", request).get();
             std::string returned_session_id = response["sessionId"].get<std::string>();
 
             // Capture workspace_path if present (for infinite sessions)
@@ -711,6 +1554,7 @@ Client::resume_session(const std::string& session_id, ResumeSessionConfig config
                 workspace_path = response["workspacePath"].get<std::string>();
 
             auto session = std::make_shared<Session>(returned_session_id, this, workspace_path);
+            attach_event_journal(*session);
 
             // Register tools locally for handling callbacks from the server
             for (const auto& tool : config.tools)
@@ -728,8 +1572,14 @@ Client::resume_session(const std::string& session_id, ResumeSessionConfig config
             if (config.hooks.has_value())
                 session->register_hooks(*config.hooks);
 
+            request["sessionId"] = returned_session_id;
+
             std::lock_guard<std::mutex> lock(mutex_);
-            sessions_[returned_session_id] = session;
+            {
+                std::lock_guard<std::mutex> sessions_lock(sessions_mutex_);
+                sessions_[returned_session_id] = session;
+            }
+            session_attach_requests_[returned_session_id] = std::move(request);
 
             return session;
         }
@@ -750,7 +1600,7 @@ std::future<std::vector<SessionMetadata>> Client::list_sessions()
                     throw std::runtime_error("Client not connected. Call start() first.");
             }
 
-            auto response = rpc_->invoke("session.list", json::object()).get();
+            auto response = connected_rpc().invoke("session.list", json::object()).get();
             std::vector<SessionMetadata> sessions;
 
             for (const auto& item : response["sessions"])
@@ -776,8 +1626,9 @@ std::future<void> Client::delete_session(const std::string& session_id)
             if (state_ != ConnectionState::Connected)
                 throw std::runtime_error("Client not connected");
 
+            std::shared_lock<std::shared_mutex> registry_lock(session_registry_mutex_);
             auto response =
-                rpc_->invoke("session.delete", json{{"sessionId", session_id}}).get();
+                connected_rpc().invoke("session.delete", json{{"sessionId", session_id}}).get();
 
             if (response.contains("success") && !response["success"].get<bool>())
             {
@@ -788,7 +1639,11 @@ std::future<void> Client::delete_session(const std::string& session_id)
             }
 
             std::lock_guard<std::mutex> lock(mutex_);
-            sessions_.erase(session_id);
+            {
+                std::lock_guard<std::mutex> sessions_lock(sessions_mutex_);
+                sessions_.erase(session_id);
+            }
+            session_attach_requests_.erase(session_id);
         }
     );
 }
@@ -807,7 +1662,7 @@ std::future<std::optional<std::string>> Client::get_last_session_id()
                     throw std::runtime_error("Client not connected. Call start() first.");
             }
 
-            auto response = rpc_->invoke("session.getLastId", json::object()).get();
+            auto response = connected_rpc().invoke("session.getLastId", json::object()).get();
 
             if (response.contains("sessionId") && !response["sessionId"].is_null())
                 return response["sessionId"].get<std::string>();
@@ -836,7 +1691,7 @@ std::future<PingResponse> Client::ping(std::optional<std::string> message)
             else
                 params["message"] = nullptr;
 
-            auto response = rpc_->invoke("ping", params).get();
+            auto response = connected_rpc().invoke("ping", params).get();
 
             PingResponse result;
             if (response.contains("message") && !response["message"].is_null())
@@ -864,7 +1719,7 @@ std::future<GetStatusResponse> Client::get_status()
                     throw std::runtime_error("Client not connected. Call start() first.");
             }
 
-            auto response = rpc_->invoke("status.get", json::object()).get();
+            auto response = connected_rpc().invoke("status.get", json::object()).get();
             return response.get<GetStatusResponse>();
         }
     );
@@ -884,7 +1739,7 @@ std::future<GetAuthStatusResponse> Client::get_auth_status()
                     throw std::runtime_error("Client not connected. Call start() first.");
             }
 
-            auto response = rpc_->invoke("auth.getStatus", json::object()).get();
+            auto response = connected_rpc().invoke("auth.getStatus", json::object()).get();
             return response.get<GetAuthStatusResponse>();
         }
     );
@@ -911,7 +1766,7 @@ std::future<std::vector<ModelInfo>> Client::list_models()
                     return std::vector<ModelInfo>(*models_cache_);
             }
 
-            auto response = rpc_->invoke("models.list", json::object()).get();
+            auto response = connected_rpc().invoke("models.list", json::object()).get();
             auto models_response = response.get<GetModelsResponse>();
 
             // Store in cache
@@ -927,7 +1782,7 @@ std::future<std::vector<ModelInfo>> Client::list_models()
 
 std::shared_ptr<Session> Client::get_session(const std::string& session_id)
 {
-    std::lock_guard<std::mutex> lock(mutex_);
+    std::lock_guard<std::mutex> sessions_lock(sessions_mutex_);
     auto it = sessions_.find(session_id);
     return (it != sessions_.end()) ? it->second : nullptr;
 }
@@ -938,6 +1793,7 @@ std::shared_ptr<Session> Client::get_session(const std::string& session_id)
 
 void Client::handle_session_event(const std::string& method, const json& params)
 {
+    COPILOT_TRACE_SCOPE("client", "handle_session_event");
     if (!params.contains("sessionId") || !params.contains("event"))
         return;
 
@@ -947,12 +1803,59 @@ void Client::handle_session_event(const std::string& method, const json& params)
         return;
 
     // Parse and dispatch the event
-    auto event = parse_session_event(params["event"]);
-    session->dispatch_event(event);
+    const auto& event_json = params["event"];
+
+    // Read only the type first: events nobody wants are not decoded at all
+    auto type_it = event_json.find("type");
+    if (type_it != event_json.end() && type_it->is_string())
+    {
+        auto type = parse_session_event_type(type_it->get_ref<const std::string&>());
+        event_counts_[static_cast<size_t>(type)].fetch_add(1, std::memory_order_relaxed);
+        session->track_turn_state(type);
+        if (!session->wants_event_type(type))
+        {
+            session->skip_event(event_json, type);
+            return;
+        }
+    }
+
+    auto event = parse_session_event(event_json);
+    session->dispatch_event(event, event_json);
 }
 
+namespace
+{
+
+/// Reports the time spent in a session's callback handler, also when it throws
+class CallbackTimer
+{
+  public:
+    CallbackTimer(Session& session, SessionCallbackKind kind, std::string name)
+        : session_(session), kind_(kind), name_(std::move(name)),
+          started_(std::chrono::steady_clock::now())
+    {
+    }
+
+    ~CallbackTimer()
+    {
+        session_.record_callback_time(kind_, name_, started_);
+    }
+
+    CallbackTimer(const CallbackTimer&) = delete;
+    CallbackTimer& operator=(const CallbackTimer&) = delete;
+
+  private:
+    Session& session_;
+    SessionCallbackKind kind_;
+    std::string name_;
+    std::chrono::steady_clock::time_point started_;
+};
+
+} // namespace
+
 json Client::handle_tool_call(const json& params)
 {
+    COPILOT_TRACE_SCOPE_ARG("client", "handle_tool_call", params.value("toolName", ""));
     std::string session_id = params["sessionId"].get<std::string>();
     std::string tool_call_id = params["toolCallId"].get<std::string>();
     std::string tool_name = params["toolName"].get<std::string>();
@@ -988,6 +1891,7 @@ json Client::handle_tool_call(const json& params)
         invocation.tool_name = tool_name;
         invocation.arguments = arguments;
 
+        CallbackTimer timer(*session, SessionCallbackKind::Tool, tool_name);
         json result = tool->handler(invocation);
 
         // Wrap result in response format
@@ -1007,6 +1911,7 @@ json Client::handle_tool_call(const json& params)
 
 json Client::handle_permission_request(const json& params)
 {
+    COPILOT_TRACE_SCOPE("client", "handle_permission_request");
     std::string session_id = params["sessionId"].get<std::string>();
 
     // The permission request data is nested in "permissionRequest" field
@@ -1033,6 +1938,7 @@ json Client::handle_permission_request(const json& params)
             if (key != "kind" && key != "toolCallId")
                 request.extension_data[key] = value;
 
+        CallbackTimer timer(*session, SessionCallbackKind::Permission, request.kind);
         auto result = session->handle_permission_request(request);
 
         // Return response with nested result object
@@ -1053,6 +1959,7 @@ json Client::handle_permission_request(const json& params)
 
 json Client::handle_user_input_request(const json& params)
 {
+    COPILOT_TRACE_SCOPE("client", "handle_user_input_request");
     std::string session_id = params["sessionId"].get<std::string>();
     std::string question = params["question"].get<std::string>();
 
@@ -1069,6 +1976,7 @@ json Client::handle_user_input_request(const json& params)
         if (params.contains("allowFreeform") && !params["allowFreeform"].is_null())
             request.allow_freeform = params["allowFreeform"].get<bool>();
 
+        CallbackTimer timer(*session, SessionCallbackKind::UserInput, "userInput");
         auto result = session->handle_user_input_request(request);
 
         json response;
@@ -1084,6 +1992,7 @@ json Client::handle_user_input_request(const json& params)
 
 json Client::handle_hooks_invoke(const json& params)
 {
+    COPILOT_TRACE_SCOPE_ARG("client", "handle_hooks_invoke", params.value("hookType", ""));
     std::string session_id = params["sessionId"].get<std::string>();
     std::string hook_type = params["hookType"].get<std::string>();
     json input = params.value("input", json::object());
@@ -1094,6 +2003,7 @@ json Client::handle_hooks_invoke(const json& params)
 
     try
     {
+        CallbackTimer timer(*session, SessionCallbackKind::Hook, hook_type);
         auto output = session->handle_hooks_invoke(hook_type, input);
         json response;
         response["output"] = output;
@@ -1133,7 +2043,7 @@ std::future<std::optional<std::string>> Client::get_foreground_session_id()
         std::launch::async,
         [this]() -> std::optional<std::string>
         {
-            auto response = rpc_client()->invoke("session.getForeground", json::object()).get();
+            auto response = connected_rpc().invoke("session.getForeground", json::object()).get();
             auto parsed = response.get<GetForegroundSessionResponse>();
             return parsed.session_id;
         }
@@ -1146,7 +2056,7 @@ std::future<void> Client::set_foreground_session_id(const std::string& session_i
         std::launch::async,
         [this, session_id]()
         {
-            rpc_client()->invoke("session.setForeground", json{{"sessionId", session_id}}).get();
+            connected_rpc().invoke("session.setForeground", json{{"sessionId", session_id}}).get();
         }
     );
 }
@@ -0,0 +1,624 @@
+// Copyright (c) 2025 Elias Bachaalany
+// SPDX-License-Identifier: MIT
+
+#include <algorithm>
+#include <copilot/event_journal.hpp>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+
+#ifdef _WIN32
+#include <io.h>
+#include <stdio.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace copilot
+{
+
+namespace
+{
+
+// Segment layout: kSegmentMagic, then records of
+//   [RecordHeader][id bytes][MessagePack payload]
+// Integers are stored in host byte order; journals are local, not portable.
+constexpr char kSegmentMagic[8] = {'C', 'P', 'E', 'V', 'J', 'R', 'N', '1'};
+constexpr std::size_t kMagicSize = sizeof(kSegmentMagic);
+
+struct RecordHeader
+{
+    uint32_t payload_size;
+    uint32_t checksum; // FNV-1a over id and payload
+    uint16_t type;
+    uint16_t id_size;
+};
+static_assert(sizeof(RecordHeader) == 12, "RecordHeader must be packed");
+
+uint32_t fnv1a(const char* data, std::size_t size, uint32_t hash = 2166136261u)
+{
+    for (std::size_t i = 0; i < size; ++i)
+    {
+        hash ^= static_cast<uint8_t>(data[i]);
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+std::string segment_name(std::size_t number)
+{
+    char name[32];
+    std::snprintf(name, sizeof(name), "segment-%08zu.evj", number);
+    return name;
+}
+
+/// Descriptor for `file` that stays valid after it is closed (-1 on failure)
+int duplicate_fd(std::FILE* file)
+{
+#ifdef _WIN32
+    return _dup(_fileno(file));
+#else
+    return ::dup(fileno(file));
+#endif
+}
+
+void sync_and_close_fd(int fd)
+{
+    if (fd < 0)
+        return;
+#ifdef _WIN32
+    _commit(fd);
+    _close(fd);
+#else
+    ::fsync(fd);
+    ::close(fd);
+#endif
+}
+
+} // namespace
+
+// =============================================================================
+// Segment
+// =============================================================================
+
+/// One segment file, mapped read-only on demand
+struct EventJournal::Segment
+{
+    explicit Segment(std::string segment_path) : path(std::move(segment_path)) {}
+
+    ~Segment()
+    {
+        unmap();
+    }
+
+    /// Bytes [offset, offset + length) of the file, or nullptr if out of range.
+    /// `scratch` backs the result where memory maps are not used.
+    const char* view(uint64_t offset, std::size_t length, std::vector<char>& scratch)
+    {
+#ifdef _WIN32
+        std::ifstream file(path, std::ios::binary);
+        file.seekg(static_cast<std::streamoff>(offset));
+        scratch.resize(length);
+        file.read(scratch.data(), static_cast<std::streamsize>(length));
+        return file.gcount() == static_cast<std::streamsize>(length) ? scratch.data() : nullptr;
+#else
+        (void)scratch;
+        if (offset + length > map_size_)
+        {
+            // The file grew since it was mapped (active segment): remap it whole
+            unmap();
+            int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+            if (fd < 0)
+                return nullptr;
+            struct stat st;
+            if (::fstat(fd, &st) == 0 && static_cast<uint64_t>(st.st_size) >= offset + length &&
+                st.st_size > 0)
+            {
+                void* map = ::mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+                if (map != MAP_FAILED)
+                {
+                    map_ = static_cast<const char*>(map);
+                    map_size_ = static_cast<std::size_t>(st.st_size);
+                }
+            }
+            ::close(fd);
+            if (offset + length > map_size_)
+                return nullptr;
+        }
+        return map_ + offset;
+#endif
+    }
+
+    void unmap()
+    {
+#ifndef _WIN32
+        if (map_)
+            ::munmap(const_cast<char*>(map_), map_size_);
+        map_ = nullptr;
+        map_size_ = 0;
+#endif
+    }
+
+    std::string path;
+    uint64_t size = 0; // bytes holding valid records
+
+  private:
+#ifndef _WIN32
+    const char* map_ = nullptr;
+    std::size_t map_size_ = 0;
+#endif
+};
+
+// =============================================================================
+// Flusher
+// =============================================================================
+
+/// The one thread syncing journals in the background
+///
+/// Journals queue themselves with a due time when they first become dirty (or on
+/// request_sync()); clean journals cost nothing, however many are open.
+class EventJournal::Flusher
+{
+  public:
+    static Flusher& instance()
+    {
+        static Flusher flusher;
+        return flusher;
+    }
+
+    ~Flusher()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_ = true;
+        }
+        cv_.notify_all();
+        thread_.join();
+    }
+
+    void schedule(std::weak_ptr<EventJournal> journal, std::chrono::steady_clock::time_point due)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            queue_.emplace(due, std::move(journal));
+        }
+        cv_.notify_one();
+    }
+
+  private:
+    Flusher() : thread_([this] { run(); }) {}
+
+    void run()
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (!stop_)
+        {
+            if (queue_.empty())
+            {
+                cv_.wait(lock);
+                continue;
+            }
+            auto next = queue_.begin();
+            if (next->first > std::chrono::steady_clock::now())
+            {
+                cv_.wait_until(lock, next->first);
+                continue;
+            }
+            auto journal = next->second.lock();
+            queue_.erase(next);
+            lock.unlock();
+
+            // Dropping the last reference here closes the journal, which syncs it
+            if (journal)
+                journal->flush_scheduled();
+            journal.reset();
+            lock.lock();
+        }
+    }
+
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::multimap<std::chrono::steady_clock::time_point, std::weak_ptr<EventJournal>> queue_;
+    bool stop_ = false;
+    std::thread thread_; // last: started once the queue exists
+};
+
+// =============================================================================
+// Open / Close
+// =============================================================================
+
+std::shared_ptr<EventJournal> EventJournal::open(
+    const std::string& directory, EventJournalOptions options
+)
+{
+    std::shared_ptr<EventJournal> journal(new EventJournal(directory, options));
+    journal->load_segments();
+    return journal;
+}
+
+EventJournal::EventJournal(std::string directory, EventJournalOptions options)
+    : directory_(std::move(directory)), options_(options)
+{
+}
+
+EventJournal::~EventJournal()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    sync_locked(lock);
+    if (active_)
+    {
+        std::fclose(active_);
+        active_ = nullptr;
+    }
+}
+
+void EventJournal::load_segments()
+{
+    namespace fs = std::filesystem;
+
+    std::error_code ec;
+    fs::create_directories(directory_, ec);
+    if (ec)
+        throw std::runtime_error("Cannot create event journal directory: " + directory_);
+
+    std::vector<std::string> names;
+    for (const auto& entry : fs::directory_iterator(directory_))
+    {
+        auto name = entry.path().filename().string();
+        if (entry.is_regular_file() && name.rfind("segment-", 0) == 0 &&
+            entry.path().extension() == ".evj")
+            names.push_back(name);
+    }
+    std::sort(names.begin(), names.end());
+
+    for (std::size_t i = 0; i < names.size(); ++i)
+    {
+        segments_.push_back(std::make_unique<Segment>((fs::path(directory_) / names[i]).string()));
+        index_segment(static_cast<uint32_t>(i), i + 1 == names.size());
+    }
+    stats_.segments = segments_.size();
+
+    if (segments_.empty())
+    {
+        open_new_segment();
+        return;
+    }
+
+    active_ = std::fopen(segments_.back()->path.c_str(), "ab");
+    if (!active_)
+        throw std::runtime_error("Cannot open event journal segment: " + segments_.back()->path);
+    active_size_ = segments_.back()->size;
+}
+
+void EventJournal::index_segment(uint32_t segment_index, bool is_last)
+{
+    auto& segment = *segments_[segment_index];
+
+    std::error_code ec;
+    auto file_size = static_cast<uint64_t>(std::filesystem::file_size(segment.path, ec));
+    if (ec)
+        throw std::runtime_error("Cannot read event journal segment: " + segment.path);
+
+    std::vector<char> scratch;
+    const char* data = file_size > 0 ? segment.view(0, file_size, scratch) : nullptr;
+    if (file_size >= kMagicSize && (!data || std::memcmp(data, kSegmentMagic, kMagicSize) != 0))
+        throw std::runtime_error("Not an event journal segment: " + segment.path);
+
+    uint64_t pos = kMagicSize;
+    while (data && pos + sizeof(RecordHeader) <= file_size)
+    {
+        RecordHeader header;
+        std::memcpy(&header, data + pos, sizeof(header));
+
+        uint64_t body = pos + sizeof(RecordHeader);
+        uint64_t end = body + header.id_size + header.payload_size;
+        if (end > file_size)
+            break; // torn write
+
+        const char* id = data + body;
+        if (fnv1a(id, header.id_size + header.payload_size) != header.checksum)
+            break;
+
+        auto type = header.type < kSessionEventTypeCount
+                        ? static_cast<SessionEventType>(header.type)
+                        : SessionEventType::Unknown;
+        auto index = records_.size();
+        records_.push_back(
+            RecordRef{segment_index, body + header.id_size, header.payload_size, type}
+        );
+        if (header.id_size > 0)
+            by_id_[std::string(id, header.id_size)] = index;
+        by_type_[static_cast<std::size_t>(type)].push_back(index);
+        pos = end;
+    }
+
+    uint64_t valid = file_size < kMagicSize ? 0 : pos;
+    segment.size = valid;
+
+    if (valid < file_size)
+    {
+        stats_.recovered_bytes += file_size - valid;
+        if (is_last)
+        {
+            // Drop the torn tail so new records follow the last valid one
+            segment.unmap();
+            std::filesystem::resize_file(segment.path, valid, ec);
+        }
+    }
+
+    if (is_last && valid == 0)
+    {
+        // Crashed right after creating the file: restore the magic
+        std::FILE* file = std::fopen(segment.path.c_str(), "wb");
+        if (!file || std::fwrite(kSegmentMagic, 1, kMagicSize, file) != kMagicSize)
+        {
+            if (file)
+                std::fclose(file);
+            throw std::runtime_error("Cannot repair event journal segment: " + segment.path);
+        }
+        std::fclose(file);
+        segment.size = kMagicSize;
+    }
+}
+
+void EventJournal::open_new_segment()
+{
+    auto path = (std::filesystem::path(directory_) / segment_name(segments_.size() + 1)).string();
+
+    active_ = std::fopen(path.c_str(), "ab");
+    if (!active_ || std::fwrite(kSegmentMagic, 1, kMagicSize, active_) != kMagicSize)
+        throw std::runtime_error("Cannot create event journal segment: " + path);
+
+    segments_.push_back(std::make_unique<Segment>(path));
+    segments_.back()->size = kMagicSize;
+    active_size_ = kMagicSize;
+    stats_.segments = segments_.size();
+    dirty_ = true;
+}
+
+// =============================================================================
+// Writing
+// =============================================================================
+
+bool EventJournal::append(const json& event_json)
+{
+    if (!options_.include_ephemeral)
+    {
+        auto ephemeral = event_json.find("ephemeral");
+        if (ephemeral != event_json.end() && ephemeral->is_boolean() && ephemeral->get<bool>())
+            return false;
+    }
+
+    auto id_it = event_json.find("id");
+    auto type_it = event_json.find("type");
+    std::string id =
+        id_it != event_json.end() && id_it->is_string() ? id_it->get<std::string>() : "";
+    auto type = type_it != event_json.end() && type_it->is_string()
+                    ? parse_session_event_type(type_it->get_ref<const std::string&>())
+                    : SessionEventType::Unknown;
+    if (id.size() > UINT16_MAX)
+        throw std::invalid_argument("Event id too long for the event journal");
+
+    // Encode outside the lock
+    auto payload = json::to_msgpack(event_json);
+    RecordHeader header{
+        static_cast<uint32_t>(payload.size()),
+        0,
+        static_cast<uint16_t>(type),
+        static_cast<uint16_t>(id.size())
+    };
+    std::vector<char> record(sizeof(RecordHeader) + id.size() + payload.size());
+    char* body = record.data() + sizeof(RecordHeader);
+    std::memcpy(body, id.data(), id.size());
+    std::memcpy(body + id.size(), payload.data(), payload.size());
+    header.checksum = fnv1a(body, id.size() + payload.size());
+    std::memcpy(record.data(), &header, sizeof(header));
+
+    std::unique_lock<std::mutex> lock(mutex_);
+
+    if (active_size_ > kMagicSize && active_size_ + record.size() > options_.segment_bytes)
+    {
+        // The flusher syncs the finished segment through a duplicate descriptor
+        std::fflush(active_);
+        unsynced_fds_.push_back(duplicate_fd(active_));
+        std::fclose(active_);
+        active_ = nullptr;
+        open_new_segment();
+    }
+
+    if (std::fwrite(record.data(), 1, record.size(), active_) != record.size())
+    {
+        ++stats_.write_errors;
+        throw std::runtime_error("Event journal write failed: " + segments_.back()->path);
+    }
+
+    auto index = records_.size();
+    auto segment_index = static_cast<uint32_t>(segments_.size() - 1);
+    uint64_t offset = active_size_ + sizeof(RecordHeader) + id.size();
+    records_.push_back(RecordRef{segment_index, offset, header.payload_size, type});
+    if (!id.empty())
+        by_id_[id] = index;
+    by_type_[static_cast<std::size_t>(type)].push_back(index);
+
+    active_size_ += record.size();
+    segments_.back()->size = active_size_;
+    stats_.bytes_written += record.size();
+    dirty_ = true;
+    bool schedule = !std::exchange(scheduled_, true);
+    lock.unlock();
+
+    if (schedule)
+        schedule_sync(options_.sync_interval);
+    return true;
+}
+
+void EventJournal::sync()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    // Records flushed by a running fsync are only durable once it returns
+    flush_cv_.wait(lock, [this] { return !syncing_; });
+    sync_locked(lock);
+}
+
+void EventJournal::request_sync()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        scheduled_ = true;
+    }
+    schedule_sync(std::chrono::milliseconds(0));
+}
+
+void EventJournal::schedule_sync(std::chrono::milliseconds delay)
+{
+    Flusher::instance().schedule(weak_from_this(), std::chrono::steady_clock::now() + delay);
+}
+
+void EventJournal::flush_scheduled()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    // Appends from here on queue the next sync
+    scheduled_ = false;
+    flush_cv_.wait(lock, [this] { return !syncing_; });
+    sync_locked(lock);
+}
+
+void EventJournal::sync_locked(std::unique_lock<std::mutex>& lock)
+{
+    if (!dirty_ && unsynced_fds_.empty())
+        return;
+
+    // Flushing only copies into the kernel; fsync runs without the lock so
+    // appends keep going while the disk catches up
+    std::vector<int> fds;
+    fds.swap(unsynced_fds_);
+    if (active_ && dirty_)
+    {
+        std::fflush(active_);
+        fds.push_back(duplicate_fd(active_));
+    }
+    dirty_ = false;
+
+    syncing_ = true;
+    lock.unlock();
+    for (int fd : fds)
+        sync_and_close_fd(fd);
+    lock.lock();
+    syncing_ = false;
+    ++stats_.syncs;
+    flush_cv_.notify_all();
+}
+
+// =============================================================================
+// Reading
+// =============================================================================
+
+std::optional<SessionEvent> EventJournal::decode_locked(const RecordRef& ref) const
+{
+    // Records of the active segment may still sit in the stdio buffer
+    if (active_ && ref.segment + 1 == segments_.size())
+        std::fflush(active_);
+
+    std::vector<char> scratch;
+    const char* data = segments_[ref.segment]->view(ref.offset, ref.size, scratch);
+    if (!data)
+        return std::nullopt;
+
+    try
+    {
+        auto bytes = reinterpret_cast<const uint8_t*>(data);
+        return parse_session_event(json::from_msgpack(bytes, bytes + ref.size));
+    }
+    catch (...)
+    {
+        return std::nullopt;
+    }
+}
+
+std::size_t EventJournal::size() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return records_.size();
+}
+
+bool EventJournal::contains(const std::string& event_id) const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return by_id_.count(event_id) != 0;
+}
+
+std::optional<SessionEvent> EventJournal::read(std::size_t index) const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (index >= records_.size())
+        return std::nullopt;
+    return decode_locked(records_[index]);
+}
+
+std::optional<SessionEvent> EventJournal::find(const std::string& event_id) const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = by_id_.find(event_id);
+    if (it == by_id_.end())
+        return std::nullopt;
+    return decode_locked(records_[it->second]);
+}
+
+std::vector<SessionEvent> EventJournal::read_all() const
+{
+    return read_since("");
+}
+
+std::vector<SessionEvent> EventJournal::read_since(const std::string& event_id) const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::size_t begin = 0;
+    if (!event_id.empty())
+    {
+        auto it = by_id_.find(event_id);
+        if (it != by_id_.end())
+            begin = it->second + 1;
+    }
+
+    std::vector<SessionEvent> events;
+    events.reserve(records_.size() - begin);
+    for (std::size_t i = begin; i < records_.size(); ++i)
+        if (auto event = decode_locked(records_[i]))
+            events.push_back(std::move(*event));
+    return events;
+}
+
+std::vector<SessionEvent> EventJournal::read_types(SessionEventTypeMask types) const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::vector<SessionEvent> events;
+    for (const auto& ref : records_)
+        if (types & session_event_type_bit(ref.type))
+            if (auto event = decode_locked(ref))
+                events.push_back(std::move(*event));
+    return events;
+}
+
+std::vector<std::size_t> EventJournal::indices_of_type(SessionEventType type) const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto index = static_cast<std::size_t>(type);
+    return index < by_type_.size() ? by_type_[index] : std::vector<std::size_t>{};
+}
+
+EventJournalStats EventJournal::stats() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto stats = stats_;
+    stats.events = records_.size();
+    return stats;
+}
+
+} // namespace copilot
@@ -0,0 +1,216 @@
+// Copyright (c) 2025 Elias Bachaalany
+// SPDX-License-Identifier: MIT
+
+#include <algorithm>
+#include <copilot/event_stream.hpp>
+
+namespace copilot
+{
+
+// =============================================================================
+// Constructor / Destructor
+// =============================================================================
+
+EventStream::EventStream(std::size_t capacity, StreamOverflowPolicy policy)
+    : EventStream(EventStreamOptions{capacity, policy, 0})
+{
+}
+
+EventStream::EventStream(const EventStreamOptions& options)
+    : capacity_(options.capacity > 0 ? options.capacity : 1), policy_(options.overflow),
+      coalesce_threshold_(
+          options.coalesce_threshold > 0
+              ? std::min(options.coalesce_threshold, capacity_)
+              : (options.overflow == StreamOverflowPolicy::CoalesceDeltas ? capacity_ : 0)
+      )
+{
+    ring_.resize(capacity_);
+}
+
+EventStream::~EventStream()
+{
+    run_on_close();
+}
+
+// =============================================================================
+// Consumer API
+// =============================================================================
+
+SessionEvent EventStream::pop_front_locked()
+{
+    SessionEvent event = std::move(ring_[head_]);
+    head_ = (head_ + 1) % capacity_;
+    --count_;
+    return event;
+}
+
+std::optional<SessionEvent> EventStream::try_pop()
+{
+    std::optional<SessionEvent> event;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (count_ == 0)
+            return std::nullopt;
+        event = pop_front_locked();
+        ++stats_.popped_events;
+    }
+    not_full_.notify_one();
+    return event;
+}
+
+std::optional<SessionEvent> EventStream::pop(std::chrono::milliseconds timeout)
+{
+    std::optional<SessionEvent> event;
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        if (!not_empty_.wait_for(lock, timeout, [this] { return count_ > 0 || closed_; }))
+            return std::nullopt;
+        if (count_ == 0)
+            return std::nullopt; // Closed and drained
+        event = pop_front_locked();
+        ++stats_.popped_events;
+    }
+    not_full_.notify_one();
+    return event;
+}
+
+std::size_t EventStream::pop_n(
+    std::vector<SessionEvent>& out, std::size_t max_events, std::chrono::milliseconds timeout
+)
+{
+    if (max_events == 0)
+        return 0;
+
+    std::size_t popped = 0;
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        if (timeout.count() > 0)
+            not_empty_.wait_for(lock, timeout, [this] { return count_ > 0 || closed_; });
+
+        popped = std::min(max_events, count_);
+        out.reserve(out.size() + popped);
+        for (std::size_t i = 0; i < popped; ++i)
+            out.push_back(pop_front_locked());
+        stats_.popped_events += popped;
+    }
+    if (popped > 0)
+        not_full_.notify_all();
+    return popped;
+}
+
+void EventStream::close()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        closed_ = true;
+    }
+    not_empty_.notify_all();
+    not_full_.notify_all();
+    run_on_close();
+}
+
+bool EventStream::is_closed() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return closed_;
+}
+
+std::size_t EventStream::size() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return count_;
+}
+
+uint64_t EventStream::dropped_events() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stats_.dropped_events;
+}
+
+uint64_t EventStream::coalesced_deltas() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stats_.coalesced_deltas;
+}
+
+EventStreamStats EventStream::stats() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stats_;
+}
+
+// =============================================================================
+// Producer API
+// =============================================================================
+
+bool EventStream::push(const SessionEvent& event)
+{
+    // Copy outside the lock; only the move into the slot happens under it
+    SessionEvent queued = event;
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        if (closed_)
+        {
+            ++stats_.dropped_events;
+            return false;
+        }
+
+        // Coalescing stage: once the consumer is behind, merge a delta into the
+        // newest queued delta of the same message instead of taking a slot
+        if (coalesce_threshold_ > 0 && count_ >= coalesce_threshold_)
+        {
+            auto& newest = ring_[(head_ + count_ - 1) % capacity_];
+            if (coalesce_delta_event(newest, event))
+            {
+                ++stats_.pushed_events;
+                ++stats_.coalesced_deltas;
+                return true;
+            }
+        }
+
+        if (count_ == capacity_)
+        {
+            if (policy_ == StreamOverflowPolicy::DropOldest)
+            {
+                pop_front_locked();
+                ++stats_.dropped_events;
+            }
+            else
+            {
+                not_full_.wait(lock, [this] { return count_ < capacity_ || closed_; });
+                if (closed_)
+                {
+                    ++stats_.dropped_events;
+                    return false;
+                }
+            }
+        }
+
+        ring_[(head_ + count_) % capacity_] = std::move(queued);
+        ++count_;
+        ++stats_.pushed_events;
+        stats_.max_depth = std::max(stats_.max_depth, count_);
+    }
+    not_empty_.notify_one();
+    return true;
+}
+
+void EventStream::set_on_close(std::function<void()> on_close)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    on_close_ = std::move(on_close);
+}
+
+void EventStream::run_on_close()
+{
+    std::function<void()> on_close;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        on_close = std::move(on_close_);
+        on_close_ = nullptr;
+    }
+    if (on_close)
+        on_close();
+}
+
+} // namespace copilot
@@ -0,0 +1,582 @@
+// Copyright (c) 2025 Elias Bachaalany
+// SPDX-License-Identifier: MIT
+
+#include <cmath>
+#include <copilot/metrics_registry.hpp>
+#include <iomanip>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+
+#ifndef _WIN32
+#include <poll.h>
+#endif
+
+namespace copilot
+{
+
+namespace
+{
+
+bool valid_metric_name(const std::string& name)
+{
+    if (name.empty())
+        return false;
+    for (size_t i = 0; i < name.size(); ++i)
+    {
+        char c = name[i];
+        bool letter = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_' || c == ':';
+        if (!letter && !(i > 0 && c >= '0' && c <= '9'))
+            return false;
+    }
+    return true;
+}
+
+void check_metric_name(const std::string& name)
+{
+    if (!valid_metric_name(name))
+        throw std::invalid_argument("Invalid metric name: " + name);
+}
+
+const char* type_name(MetricType type)
+{
+    switch (type)
+    {
+    case MetricType::Counter:
+        return "counter";
+    case MetricType::Gauge:
+        return "gauge";
+    case MetricType::Histogram:
+        return "histogram";
+    }
+    return "untyped";
+}
+
+/// Backslash-escape `\`, newline and (in label values) `"`
+void append_escaped(std::string& out, const std::string& text, bool quote)
+{
+    for (char c : text)
+    {
+        if (c == '\\')
+            out += "\\\\";
+        else if (c == '\n')
+            out += "\\n";
+        else if (c == '"' && quote)
+            out += "\\\"";
+        else
+            out += c;
+    }
+}
+
+void append_number(std::string& out, double value)
+{
+    if (std::isnan(value))
+    {
+        out += "NaN";
+    }
+    else if (std::isinf(value))
+    {
+        out += value > 0 ? "+Inf" : "-Inf";
+    }
+    else if (value == std::floor(value) && std::fabs(value) < 9007199254740992.0) // 2^53
+    {
+        out += std::to_string(static_cast<int64_t>(value));
+    }
+    else
+    {
+        std::ostringstream stream;
+        stream << std::setprecision(15) << value;
+        out += stream.str();
+    }
+}
+
+/// `name{labels,extra="value"} ` (the braces are left out without labels)
+void append_series(
+    std::string& out,
+    const std::string& name,
+    const MetricLabels& labels,
+    const char* extra_name = nullptr,
+    const std::string& extra_value = {}
+)
+{
+    out += name;
+    if (labels.empty() && !extra_name)
+    {
+        out += ' ';
+        return;
+    }
+    out += '{';
+    bool first = true;
+    auto append_label = [&](const std::string& label, const std::string& value)
+    {
+        if (!first)
+            out += ',';
+        first = false;
+        out += label;
+        out += "=\"";
+        append_escaped(out, value, true);
+        out += '"';
+    };
+    for (const auto& [label, value] : labels)
+        append_label(label, value);
+    if (extra_name)
+        append_label(extra_name, extra_value);
+    out += "} ";
+}
+
+void add_into(HistogramData& target, const HistogramData& sample)
+{
+    if (target.counts.empty())
+    {
+        target = sample;
+        return;
+    }
+    if (target.bounds != sample.bounds)
+        throw std::invalid_argument("Histogram samples with different buckets");
+    for (size_t i = 0; i < target.counts.size(); ++i)
+        target.counts[i] += sample.counts[i];
+    target.count += sample.count;
+    target.sum += sample.sum;
+}
+
+} // namespace
+
+// =============================================================================
+// MetricHistogram
+// =============================================================================
+
+MetricHistogram::MetricHistogram(std::vector<double> bounds)
+    : bounds_(std::move(bounds)),
+      counts_(std::make_unique<std::atomic<uint64_t>[]>(bounds_.size() + 1))
+{
+    for (size_t i = 1; i < bounds_.size(); ++i)
+        if (!(bounds_[i - 1] < bounds_[i]))
+            throw std::invalid_argument("Histogram bounds must be strictly ascending");
+}
+
+HistogramData MetricHistogram::data() const
+{
+    HistogramData data;
+    data.bounds = bounds_;
+    data.counts.resize(bounds_.size() + 1);
+    for (size_t i = 0; i < data.counts.size(); ++i)
+    {
+        data.counts[i] = counts_[i].load(std::memory_order_relaxed);
+        data.count += data.counts[i];
+    }
+    data.sum = sum_.load(std::memory_order_relaxed);
+    return data;
+}
+
+// =============================================================================
+// MetricsWriter
+// =============================================================================
+
+const std::vector<double>& MetricsWriter::default_latency_bounds()
+{
+    static const std::vector<double> bounds = {
+        0.0005, 0.001, 0.0025, 0.005, 0.01, 0.025, 0.05, 0.1, 0.25, 0.5, 1, 2.5, 5, 10, 30, 60
+    };
+    return bounds;
+}
+
+MetricsWriter::Family& MetricsWriter::family(
+    const std::string& name, const std::string& help, MetricType type
+)
+{
+    check_metric_name(name);
+    auto [it, inserted] = families_.try_emplace(name, Family{type, help, {}});
+    if (!inserted && it->second.type != type)
+        throw std::invalid_argument("Metric " + name + " already has another type");
+    return it->second;
+}
+
+void MetricsWriter::counter(
+    const std::string& name, const std::string& help, double value, const MetricLabels& labels
+)
+{
+    family(name, help, MetricType::Counter).samples[labels].sum += value;
+}
+
+void MetricsWriter::gauge(
+    const std::string& name, const std::string& help, double value, const MetricLabels& labels
+)
+{
+    family(name, help, MetricType::Gauge).samples[labels].sum += value;
+}
+
+void MetricsWriter::histogram(
+    const std::string& name,
+    const std::string& help,
+    const HistogramData& data,
+    const MetricLabels& labels
+)
+{
+    if (data.counts.size() != data.bounds.size() + 1)
+        throw std::invalid_argument("Histogram " + name + " needs one count per bucket");
+    add_into(family(name, help, MetricType::Histogram).samples[labels], data);
+}
+
+void MetricsWriter::histogram(
+    const std::string& name,
+    const std::string& help,
+    const LatencyHistogram& latencies,
+    const MetricLabels& labels,
+    const std::vector<double>& bounds
+)
+{
+    // A LatencyHistogram bucket goes to the first bound its upper end fits under,
+    // which is exact for the bounds above 32us up to 1/16 of the bound
+    HistogramData data;
+    data.bounds = bounds;
+    data.counts.assign(bounds.size() + 1, 0);
+    const auto& buckets = latencies.buckets();
+    for (size_t i = 0; i < buckets.size(); ++i)
+    {
+        if (buckets[i] == 0)
+            continue;
+        double upper = static_cast<double>(LatencyHistogram::bucket_upper_bound(i)) / 1e6;
+        size_t index = std::lower_bound(bounds.begin(), bounds.end(), upper) - bounds.begin();
+        data.counts[index] += buckets[i];
+    }
+    data.count = latencies.count();
+    data.sum = static_cast<double>(latencies.total().count()) / 1e6;
+    histogram(name, help, data, labels);
+}
+
+std::string MetricsWriter::prometheus_text() const
+{
+    std::string out;
+    for (const auto& [name, family] : families_)
+    {
+        out += "# HELP ";
+        out += name;
+        out += ' ';
+        append_escaped(out, family.help, false);
+        out += "\n# TYPE ";
+        out += name;
+        out += ' ';
+        out += type_name(family.type);
+        out += '\n';
+
+        for (const auto& [labels, sample] : family.samples)
+        {
+            if (family.type != MetricType::Histogram)
+            {
+                append_series(out, name, labels);
+                append_number(out, sample.sum);
+                out += '\n';
+                continue;
+            }
+
+            uint64_t cumulative = 0;
+            for (size_t i = 0; i < sample.counts.size(); ++i)
+            {
+                cumulative += sample.counts[i];
+                std::string le;
+                if (i < sample.bounds.size())
+                    append_number(le, sample.bounds[i]);
+                else
+                    le = "+Inf";
+                append_series(out, name + "_bucket", labels, "le", le);
+                out += std::to_string(cumulative);
+                out += '\n';
+            }
+            append_series(out, name + "_sum", labels);
+            append_number(out, sample.sum);
+            out += '\n';
+            append_series(out, name + "_count", labels);
+            out += std::to_string(sample.count);
+            out += '\n';
+        }
+    }
+    return out;
+}
+
+// =============================================================================
+// MetricsRegistry
+// =============================================================================
+
+MetricsRegistry::Family& MetricsRegistry::family(
+    const std::string& name, const std::string& help, MetricType type
+)
+{
+    check_metric_name(name);
+    auto [it, inserted] = families_.try_emplace(name);
+    if (inserted)
+    {
+        it->second.type = type;
+        it->second.help = help;
+    }
+    else if (it->second.type != type)
+    {
+        throw std::invalid_argument("Metric " + name + " already has another type");
+    }
+    return it->second;
+}
+
+MetricCounter& MetricsRegistry::counter(
+    const std::string& name, const std::string& help, const MetricLabels& labels
+)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto& slot = family(name, help, MetricType::Counter).counters[labels];
+    if (!slot)
+        slot = std::make_unique<MetricCounter>();
+    return *slot;
+}
+
+MetricGauge& MetricsRegistry::gauge(
+    const std::string& name, const std::string& help, const MetricLabels& labels
+)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto& slot = family(name, help, MetricType::Gauge).gauges[labels];
+    if (!slot)
+        slot = std::make_unique<MetricGauge>();
+    return *slot;
+}
+
+MetricHistogram& MetricsRegistry::histogram(
+    const std::string& name,
+    const std::string& help,
+    const MetricLabels& labels,
+    const std::vector<double>& bounds
+)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto& slot = family(name, help, MetricType::Histogram).histograms[labels];
+    if (!slot)
+        slot = std::make_unique<MetricHistogram>(bounds);
+    return *slot;
+}
+
+int MetricsRegistry::add_collector(Collector collector)
+{
+    std::lock_guard<std::mutex> lock(collectors_mutex_);
+    int id = next_collector_id_++;
+    collectors_.emplace_back(id, std::move(collector));
+    return id;
+}
+
+void MetricsRegistry::remove_collector(int id)
+{
+    std::lock_guard<std::mutex> lock(collectors_mutex_);
+    collectors_.erase(
+        std::remove_if(
+            collectors_.begin(),
+            collectors_.end(),
+            [id](const auto& entry) { return entry.first == id; }
+        ),
+        collectors_.end()
+    );
+}
+
+void MetricsRegistry::collect(MetricsWriter& writer) const
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (const auto& [name, family] : families_)
+        {
+            for (const auto& [labels, counter] : family.counters)
+                writer.counter(name, family.help, static_cast<double>(counter->value()), labels);
+            for (const auto& [labels, gauge] : family.gauges)
+                writer.gauge(name, family.help, gauge->value(), labels);
+            for (const auto& [labels, histogram] : family.histograms)
+                writer.histogram(name, family.help, histogram->data(), labels);
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(collectors_mutex_);
+    for (const auto& [id, collector] : collectors_)
+        collector(writer);
+}
+
+std::string MetricsRegistry::render_prometheus() const
+{
+    MetricsWriter writer;
+    collect(writer);
+    return writer.prometheus_text();
+}
+
+// =============================================================================
+// MetricsServer
+// =============================================================================
+
+namespace
+{
+
+void close_socket(TcpTransport::Socket socket)
+{
+#ifdef _WIN32
+    closesocket(socket);
+#else
+    ::close(socket);
+#endif
+}
+
+std::string http_response(
+    const std::string& status, const std::string& type, const std::string& body
+)
+{
+    return "HTTP/1.1 " + status + "\r\nContent-Type: " + type +
+           "\r\nContent-Length: " + std::to_string(body.size()) + "\r\nConnection: close\r\n\r\n" +
+           body;
+}
+
+} // namespace
+
+MetricsServer::MetricsServer(std::shared_ptr<const MetricsRegistry> registry)
+    : MetricsServer(std::move(registry), Options{})
+{
+}
+
+MetricsServer::MetricsServer(std::shared_ptr<const MetricsRegistry> registry, Options options)
+    : registry_(std::move(registry)), options_(std::move(options))
+{
+#ifdef _WIN32
+    WinsockInitializer::instance();
+#endif
+    struct addrinfo hints{};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = AI_PASSIVE;
+    struct addrinfo* result = nullptr;
+    std::string port = std::to_string(options_.port);
+    if (getaddrinfo(options_.host.c_str(), port.c_str(), &hints, &result) != 0 || !result)
+        throw TransportError("Cannot resolve metrics address " + options_.host);
+
+    listen_socket_ = ::socket(result->ai_family, result->ai_socktype, result->ai_protocol);
+    if (listen_socket_ == TcpTransport::kInvalidSocket)
+    {
+        freeaddrinfo(result);
+        throw TransportError("Cannot create metrics socket");
+    }
+    int reuse = 1;
+    setsockopt(
+        listen_socket_, SOL_SOCKET, SO_REUSEADDR, reinterpret_cast<char*>(&reuse), sizeof(reuse)
+    );
+    auto address_length = static_cast<int>(result->ai_addrlen);
+    bool bound = ::bind(listen_socket_, result->ai_addr, address_length) == 0 &&
+                 ::listen(listen_socket_, 16) == 0;
+    freeaddrinfo(result);
+
+    struct sockaddr_storage address{};
+    socklen_t length = sizeof(address);
+    if (!bound ||
+        getsockname(listen_socket_, reinterpret_cast<struct sockaddr*>(&address), &length) != 0)
+    {
+        close_socket(listen_socket_);
+        throw TransportError(
+            "Cannot listen on " + options_.host + ":" + std::to_string(options_.port)
+        );
+    }
+    port_ = address.ss_family == AF_INET6
+                ? ntohs(reinterpret_cast<struct sockaddr_in6*>(&address)->sin6_port)
+                : ntohs(reinterpret_cast<struct sockaddr_in*>(&address)->sin_port);
+
+    running_ = true;
+    thread_ = std::thread([this] { serve(); });
+}
+
+MetricsServer::~MetricsServer()
+{
+    stop();
+}
+
+std::string MetricsServer::url() const
+{
+    return "http://" + options_.host + ":" + std::to_string(port_) + options_.path;
+}
+
+void MetricsServer::stop()
+{
+    if (!running_.exchange(false))
+        return;
+    if (thread_.joinable())
+        thread_.join();
+    close_socket(listen_socket_);
+    listen_socket_ = TcpTransport::kInvalidSocket;
+}
+
+void MetricsServer::serve()
+{
+    while (running_)
+    {
+        // Poll so stop() is noticed without closing the socket under accept();
+        // unlike select(), poll() works for any descriptor number
+#ifdef _WIN32
+        WSAPOLLFD listener{};
+        listener.fd = listen_socket_;
+        listener.events = POLLRDNORM;
+        int ready = WSAPoll(&listener, 1, 100);
+#else
+        struct pollfd listener{};
+        listener.fd = listen_socket_;
+        listener.events = POLLIN;
+        int ready = ::poll(&listener, 1, 100);
+#endif
+        if (ready <= 0)
+            continue;
+
+        TcpTransport::Socket client = ::accept(listen_socket_, nullptr, nullptr);
+        if (client == TcpTransport::kInvalidSocket)
+            continue;
+        answer(client);
+    }
+}
+
+void MetricsServer::answer(TcpTransport::Socket socket)
+{
+    // A silent client must not stall the next scrape
+#ifdef _WIN32
+    DWORD timeout_ms = 2000;
+    setsockopt(
+        socket, SOL_SOCKET, SO_RCVTIMEO, reinterpret_cast<char*>(&timeout_ms), sizeof(timeout_ms)
+    );
+#else
+    struct timeval timeout{2, 0};
+    setsockopt(socket, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+#endif
+
+    TcpTransport connection(socket);
+    try
+    {
+        std::string request;
+        char buffer[1024];
+        while (request.find("\r\n\r\n") == std::string::npos && request.size() < 8192)
+        {
+            size_t n = connection.read(buffer, sizeof(buffer));
+            if (n == 0)
+                return;
+            request.append(buffer, n);
+        }
+
+        // Request line: METHOD SP TARGET SP VERSION
+        std::istringstream line(request.substr(0, request.find("\r\n")));
+        std::string method, target;
+        line >> method >> target;
+        std::string path = target.substr(0, target.find('?'));
+
+        std::string response;
+        if (path != options_.path)
+            response = http_response("404 Not Found", "text/plain", "Not found\n");
+        else if (method != "GET" && method != "HEAD")
+            response = http_response("405 Method Not Allowed", "text/plain", "GET only\n");
+        else
+        {
+            response = http_response(
+                "200 OK", "text/plain; version=0.0.4; charset=utf-8", registry_->render_prometheus()
+            );
+            if (method == "HEAD")
+                response.erase(response.find("\r\n\r\n") + 4);
+        }
+        connection.write(response.data(), response.size());
+    }
+    catch (const std::exception&)
+    {
+        // Drop the connection; the next scrape retries
+    }
+}
+
+} // namespace copilot
@@ -0,0 +1,179 @@
+// Copyright (c) 2025 Elias Bachaalany
+// SPDX-License-Identifier: MIT
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <copilot/node_startup.hpp>
+#include <copilot/process.hpp>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <system_error>
+#include <vector>
+
+#ifndef _WIN32
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace copilot
+{
+
+namespace fs = std::filesystem;
+
+namespace
+{
+
+// Another client may still be running a version it touched this recently
+constexpr auto kPruneIdleTime = std::chrono::hours(24);
+
+fs::path env_path(const char* name)
+{
+    const char* value = std::getenv(name);
+    fs::path path = value ? value : "";
+    return path.is_absolute() ? path : fs::path{};
+}
+
+/// Per-user cache location, so other users cannot pre-create or poison it
+fs::path default_cache_root()
+{
+#ifdef _WIN32
+    fs::path base = env_path("LOCALAPPDATA");
+    if (!base.empty())
+        return base / "copilot-sdk-cpp" / "node-compile-cache";
+#else
+    fs::path base = env_path("XDG_CACHE_HOME");
+    if (base.empty() && !env_path("HOME").empty())
+        base = env_path("HOME") / ".cache";
+    if (!base.empty())
+        return base / "copilot-sdk-cpp" / "node-compile-cache";
+#endif
+
+    std::error_code ec;
+    fs::path temp = fs::temp_directory_path(ec);
+    if (ec)
+        return {};
+#ifdef _WIN32
+    return temp / "copilot-sdk-cpp" / "node-compile-cache";
+#else
+    return temp / ("copilot-sdk-cpp-" + std::to_string(::geteuid())) / "node-compile-cache";
+#endif
+}
+
+/// Create `dir` readable by the current user only
+/// @return false if it exists but belongs to someone else (or is not a directory)
+bool create_private_directory(const fs::path& dir)
+{
+    std::error_code ec;
+    fs::create_directories(dir, ec);
+    if (ec)
+        return false;
+#ifndef _WIN32
+    struct stat st;
+    if (::lstat(dir.c_str(), &st) != 0 || !S_ISDIR(st.st_mode) || st.st_uid != ::geteuid())
+        return false;
+    if ((st.st_mode & 077) != 0 && ::chmod(dir.c_str(), 0700) != 0)
+        return false;
+#endif
+    return true;
+}
+
+} // namespace
+
+std::optional<std::string> find_node_cached()
+{
+    static std::mutex mutex;
+    static std::optional<std::string> cached;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    std::error_code ec;
+    if (cached && fs::exists(*cached, ec))
+        return cached;
+    cached = find_node();
+    return cached;
+}
+
+std::string node_cli_version(const std::string& script)
+{
+    std::error_code ec;
+    fs::path path = fs::absolute(script, ec);
+    if (ec)
+        path = script;
+
+    for (fs::path dir = path.parent_path(); !dir.empty(); dir = dir.parent_path())
+    {
+        fs::path manifest = dir / "package.json";
+        if (fs::is_regular_file(manifest, ec))
+        {
+            std::ifstream in(manifest);
+            json package = json::parse(in, nullptr, /*allow_exceptions=*/false);
+            if (package.is_object() && package.contains("version") &&
+                package["version"].is_string())
+                return package["version"].get<std::string>();
+            break; // the nearest package.json owns the script
+        }
+        if (dir == dir.root_path())
+            break;
+    }
+
+    // No usable manifest: any change to the script starts a fresh cache
+    auto size = fs::file_size(path, ec);
+    if (ec)
+        return "unknown";
+    auto mtime = fs::last_write_time(path, ec).time_since_epoch().count();
+    return "script-" + std::to_string(size) + "-" + std::to_string(mtime);
+}
+
+std::string prepare_node_compile_cache(
+    const NodeStartupOptions& options, const std::string& script
+)
+{
+    std::error_code ec;
+    fs::path root = options.cache_root;
+    if (root.empty())
+        root = default_cache_root();
+    if (root.empty() || !create_private_directory(root))
+        return {};
+
+    // Version strings come from a file on disk; keep them to one path component
+    std::string version = node_cli_version(script);
+    for (char& c : version)
+    {
+        if (!std::isalnum(static_cast<unsigned char>(c)) && c != '.' && c != '-' && c != '_')
+            c = '_';
+    }
+    if (version.empty() || version == "." || version == "..")
+        version = "unknown";
+
+    fs::path dir = root / version;
+    if (!create_private_directory(dir))
+        return {};
+    auto now = fs::file_time_type::clock::now();
+    fs::last_write_time(dir, now, ec);
+
+    // Least recently used versions go first; ones in recent use are kept
+    std::vector<std::pair<fs::file_time_type, fs::path>> versions;
+    for (const auto& entry : fs::directory_iterator(root, ec))
+    {
+        if (entry.is_directory(ec) && entry.path() != dir)
+            versions.emplace_back(entry.last_write_time(ec), entry.path());
+    }
+    size_t keep = options.max_cached_versions > 0 ? options.max_cached_versions - 1 : 0;
+    if (versions.size() > keep)
+    {
+        std::sort(
+            versions.begin(),
+            versions.end(),
+            [](const auto& a, const auto& b) { return a.first > b.first; }
+        );
+        for (size_t i = keep; i < versions.size(); ++i)
+            if (now - versions[i].first >= kPruneIdleTime)
+                fs::remove_all(versions[i].second, ec);
+    }
+
+    return dir.string();
+}
+
+} // namespace copilot
@@ -0,0 +1,103 @@
+// Copyright (c) 2025 Elias Bachaalany
+// SPDX-License-Identifier: MIT
+
+// Platform-independent part of ReadPipe: the internal read buffer behind
+// read(), read_line(), read_until() and read_available(). The raw pipe access
+// (read_raw, wait_readable) lives in process_posix.cpp / process_win32.cpp.
+
+#include <algorithm>
+#include <copilot/process.hpp>
+#include <cstring>
+
+namespace copilot
+{
+
+// =============================================================================
+// ReadPipe buffering
+// =============================================================================
+
+size_t ReadPipe::take_buffered(char* out, size_t size)
+{
+    size_t n = std::min(size, buffered());
+    std::memcpy(out, buffer_.get() + buffer_begin_, n);
+    buffer_begin_ += n;
+    return n;
+}
+
+bool ReadPipe::fill_buffer()
+{
+    if (!buffer_)
+        buffer_ = std::make_unique<char[]>(kBufferSize);
+    buffer_begin_ = 0;
+    buffer_end_ = read_raw(buffer_.get(), kBufferSize);
+    return buffer_end_ > 0;
+}
+
+size_t ReadPipe::read(char* buffer, size_t size)
+{
+    if (!is_open())
+        throw ProcessError("Pipe is not open");
+    if (size == 0)
+        return 0;
+
+    if (buffered() > 0)
+        return take_buffered(buffer, size);
+
+    // Large reads bypass the buffer; small ones (e.g. framing headers) refill it
+    if (size >= kBufferSize)
+        return read_raw(buffer, size);
+    if (!fill_buffer())
+        return 0; // EOF
+    return take_buffered(buffer, size);
+}
+
+std::string ReadPipe::read_line(size_t max_size)
+{
+    return read_until('\n', max_size);
+}
+
+std::string ReadPipe::read_until(char delim, size_t max_size)
+{
+    if (!is_open())
+        throw ProcessError("Pipe is not open");
+
+    std::string result;
+    while (result.size() < max_size)
+    {
+        if (buffered() == 0 && !fill_buffer())
+            break; // EOF
+
+        const char* begin = buffer_.get() + buffer_begin_;
+        size_t limit = std::min(buffered(), max_size - result.size());
+        const char* found = static_cast<const char*>(std::memchr(begin, delim, limit));
+        size_t n = found ? static_cast<size_t>(found - begin) + 1 : limit;
+
+        result.append(begin, n);
+        buffer_begin_ += n;
+        if (found)
+            break;
+    }
+    return result;
+}
+
+std::string ReadPipe::read_available(size_t max_size)
+{
+    if (!is_open())
+        throw ProcessError("Pipe is not open");
+
+    if (buffered() == 0 && (!wait_readable(0) || !fill_buffer()))
+        return {};
+
+    std::string result(std::min(max_size, buffered()), '\0');
+    take_buffered(result.data(), result.size());
+    return result;
+}
+
+bool ReadPipe::has_data(int timeout_ms)
+{
+    if (!is_open())
+        return false;
+    return buffered() > 0 || wait_readable(timeout_ms);
+}
+
+} // namespace copilot
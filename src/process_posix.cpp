@@ -11,19 +11,33 @@
 #ifndef _WIN32
 
 #include <algorithm>
+#include <atomic>
 #include <copilot/process.hpp>
 #include <cstdlib>
 #include <cstring>
 #include <errno.h>
 #include <fcntl.h>
 #include <filesystem>
+#include <fstream>
+#include <poll.h>
+#include <pthread.h>
+#include <sched.h>
 #include <signal.h>
+#include <spawn.h>
 #include <sstream>
+#include <string_view>
+#include <sys/resource.h>
 #include <sys/select.h>
+#include <sys/stat.h>
 #include <sys/wait.h>
+#include <thread>
 #include <unistd.h>
 
-// Global environ pointer for environment manipulation (needed for macOS)
+#ifdef __linux__
+#include <sys/syscall.h>
+#endif
+
+// Global environ pointer, used to build the child's envp (needed for macOS)
 extern "C" char** environ;
 
 namespace copilot
@@ -48,12 +62,29 @@ struct ProcessHandle
 {
     pid_t pid = 0;
     bool running = false;
-    int exit_code = -1;
+    std::atomic<int> exit_code{-1}; // also read by the exit watcher
 
     // Pipe file descriptors (stored for cleanup)
     int stdin_fd = -1;
     int stdout_fd = -1;
     int stderr_fd = -1;
+
+    // Exit notification
+    int pidfd = -1;
+    std::thread exit_watcher;
+    ThreadStartHook on_thread_start;
+
+    // Final accounting, recorded when the child is reaped
+    std::optional<ResourceUsage> final_usage;
+
+    ~ProcessHandle()
+    {
+        // The watcher returns once the child exits; ~Process ensures it does
+        if (exit_watcher.joinable())
+            exit_watcher.join();
+        if (pidfd >= 0)
+            ::close(pidfd);
+    }
 };
 
 // =============================================================================
@@ -65,6 +96,132 @@ static std::string get_errno_message()
     return std::strerror(errno);
 }
 
+/// Open a pidfd for `pid`, or -1 where pidfd_open is unavailable
+static int open_pidfd(pid_t pid)
+{
+#if defined(__linux__) && defined(SYS_pidfd_open)
+    // Created close-on-exec; safe from pid reuse since the child is not yet reaped
+    return static_cast<int>(::syscall(SYS_pidfd_open, pid, 0));
+#else
+    (void)pid;
+    return -1;
+#endif
+}
+
+/// Exit code of an exited, unreaped child (same encoding as wait()), or -1
+static int peek_exit_code(pid_t pid)
+{
+    siginfo_t info{};
+    int rc;
+    do
+    {
+        rc = waitid(P_PID, static_cast<id_t>(pid), &info, WEXITED | WNOWAIT);
+    } while (rc < 0 && errno == EINTR);
+
+    if (rc < 0)
+        return -1;
+    if (info.si_code == CLD_EXITED)
+        return info.si_status;
+    return 128 + info.si_status;
+}
+
+/// Exit code for a wait status (128 + signal if killed by a signal)
+static int decode_wait_status(int status)
+{
+    if (WIFEXITED(status))
+        return WEXITSTATUS(status);
+    if (WIFSIGNALED(status))
+        return 128 + WTERMSIG(status);
+    return -1;
+}
+
+static ResourceUsage usage_from_rusage(const struct rusage& ru)
+{
+    auto to_us = [](const timeval& tv)
+    { return std::chrono::microseconds(tv.tv_sec * 1000000LL + tv.tv_usec); };
+
+    ResourceUsage usage;
+    usage.user_cpu = to_us(ru.ru_utime);
+    usage.system_cpu = to_us(ru.ru_stime);
+#ifdef __APPLE__
+    usage.peak_rss_bytes = static_cast<uint64_t>(ru.ru_maxrss); // bytes
+#else
+    usage.peak_rss_bytes = static_cast<uint64_t>(ru.ru_maxrss) * 1024; // KiB
+#endif
+    usage.voluntary_context_switches = static_cast<uint64_t>(ru.ru_nvcsw);
+    usage.involuntary_context_switches = static_cast<uint64_t>(ru.ru_nivcsw);
+    usage.read_bytes = static_cast<uint64_t>(ru.ru_inblock) * 512;
+    usage.write_bytes = static_cast<uint64_t>(ru.ru_oublock) * 512;
+    usage.exited = true;
+    usage.sampled_at = std::chrono::steady_clock::now();
+    return usage;
+}
+
+#ifdef __linux__
+static std::string read_proc_file(pid_t pid, const char* name)
+{
+    std::ifstream in("/proc/" + std::to_string(pid) + "/" + name);
+    std::ostringstream text;
+    text << in.rdbuf();
+    return text.str();
+}
+
+/// Value of a "Key: value" line of /proc/<pid>/status or /proc/<pid>/io, or 0
+static uint64_t proc_field(const std::string& text, std::string_view key)
+{
+    for (size_t pos = text.find(key); pos != std::string::npos; pos = text.find(key, pos + 1))
+    {
+        size_t colon = pos + key.size();
+        if ((pos == 0 || text[pos - 1] == '\n') && colon < text.size() && text[colon] == ':')
+            return std::strtoull(text.c_str() + colon + 1, nullptr, 10);
+    }
+    return 0;
+}
+
+/// Live figures of a running (or exited but unreaped) child
+static ResourceUsage sample_proc(pid_t pid)
+{
+    ResourceUsage usage;
+    usage.sampled_at = std::chrono::steady_clock::now();
+
+    // Fields after "(comm)", which may itself contain spaces: state is field 3,
+    // utime 14, stime 15 (in clock ticks)
+    std::string stat = read_proc_file(pid, "stat");
+    size_t comm_end = stat.rfind(')');
+    if (comm_end != std::string::npos)
+    {
+        std::istringstream fields(stat.substr(comm_end + 1));
+        std::string field;
+        uint64_t utime = 0;
+        uint64_t stime = 0;
+        for (int index = 3; index <= 15 && fields >> field; ++index)
+        {
+            if (index == 14)
+                utime = std::strtoull(field.c_str(), nullptr, 10);
+            else if (index == 15)
+                stime = std::strtoull(field.c_str(), nullptr, 10);
+        }
+        static const long ticks = sysconf(_SC_CLK_TCK);
+        if (ticks > 0)
+        {
+            usage.user_cpu = std::chrono::microseconds(utime * 1000000 / ticks);
+            usage.system_cpu = std::chrono::microseconds(stime * 1000000 / ticks);
+        }
+    }
+
+    std::string status = read_proc_file(pid, "status");
+    usage.rss_bytes = proc_field(status, "VmRSS") * 1024;
+    usage.peak_rss_bytes = proc_field(status, "VmHWM") * 1024;
+    usage.voluntary_context_switches = proc_field(status, "voluntary_ctxt_switches");
+    usage.involuntary_context_switches = proc_field(status, "nonvoluntary_ctxt_switches");
+
+    std::string io = read_proc_file(pid, "io");
+    usage.read_bytes = proc_field(io, "read_bytes");
+    usage.write_bytes = proc_field(io, "write_bytes");
+    return usage;
+}
+#endif
+
 static void set_nonblocking(int fd)
 {
     int flags = fcntl(fd, F_GETFL, 0);
@@ -74,6 +231,33 @@ static void set_nonblocking(int fd)
         throw ProcessError("fcntl F_SETFL failed: " + get_errno_message());
 }
 
+/// write() that reports a reader that went away as EPIPE instead of raising
+/// SIGPIPE, which would kill the host application
+static ssize_t write_without_sigpipe(int fd, const char* data, size_t size)
+{
+    sigset_t sigpipe;
+    sigemptyset(&sigpipe);
+    sigaddset(&sigpipe, SIGPIPE);
+
+    sigset_t pending;
+    sigpending(&pending);
+    bool already_pending = sigismember(&pending, SIGPIPE) == 1;
+
+    sigset_t previous;
+    pthread_sigmask(SIG_BLOCK, &sigpipe, &previous);
+    ssize_t written = ::write(fd, data, size);
+    int saved_errno = errno;
+    if (written < 0 && saved_errno == EPIPE && !already_pending)
+    {
+        // Consume the SIGPIPE this write raised while it is still blocked
+        int signal_number = 0;
+        sigwait(&sigpipe, &signal_number);
+    }
+    pthread_sigmask(SIG_SETMASK, &previous, nullptr);
+    errno = saved_errno;
+    return written;
+}
+
 // =============================================================================
 // ReadPipe implementation
 // =============================================================================
@@ -88,11 +272,12 @@ ReadPipe::~ReadPipe()
 ReadPipe::ReadPipe(ReadPipe&&) noexcept = default;
 ReadPipe& ReadPipe::operator=(ReadPipe&&) noexcept = default;
 
-size_t ReadPipe::read(char* buffer, size_t size)
+size_t ReadPipe::read_raw(char* buffer, size_t size)
 {
     if (!is_open())
         throw ProcessError("Pipe is not open");
 
+    ++read_syscalls_;
     ssize_t bytes_read = ::read(handle_->fd, buffer, size);
     if (bytes_read < 0)
     {
@@ -104,26 +289,7 @@ size_t ReadPipe::read(char* buffer, size_t size)
     return static_cast<size_t>(bytes_read);
 }
 
-std::string ReadPipe::read_line(size_t max_size)
-{
-    std::string line;
-    line.reserve(256);
-
-    char ch;
-    while (line.size() < max_size)
-    {
-        size_t bytes_read = read(&ch, 1);
-        if (bytes_read == 0)
-            break; // EOF
-        line.push_back(ch);
-        if (ch == '\n')
-            break;
-    }
-
-    return line;
-}
-
-bool ReadPipe::has_data(int timeout_ms)
+bool ReadPipe::wait_readable(int timeout_ms)
 {
     if (!is_open())
         return false;
@@ -179,7 +345,8 @@ size_t WritePipe::write(const char* data, size_t size)
     size_t total_written = 0;
     while (total_written < size)
     {
-        ssize_t bytes_written = ::write(handle_->fd, data + total_written, size - total_written);
+        ssize_t bytes_written =
+            write_without_sigpipe(handle_->fd, data + total_written, size - total_written);
         if (bytes_written < 0)
         {
             if (errno == EPIPE)
@@ -247,244 +414,462 @@ Process::~Process()
 Process::Process(Process&&) noexcept = default;
 Process& Process::operator=(Process&&) noexcept = default;
 
-void Process::spawn(
-    const std::string& executable,
-    const std::vector<std::string>& args,
-    const ProcessOptions& options
-)
+// =============================================================================
+// Spawn helpers
+// =============================================================================
+
+/// Everything exec needs, built in the parent before the child exists so the
+/// child only has to redirect, chdir and exec
+struct SpawnBlock
 {
-    // Create pipes for stdin
-    int stdin_pipe[2] = {-1, -1};
-    if (options.redirect_stdin)
+    std::string executable; // as given
+    std::vector<std::string> args;
+    ProcessOptions options;
+
+    std::string path;                     // resolved executable
+    std::vector<std::string> arg_storage; // argv[0] = executable as given
+    std::vector<std::string> env_storage; // "KEY=value"
+    std::vector<char*> argv;
+    std::vector<char*> envp;
+};
+
+namespace
+{
+
+/// Resolve `name` against a PATH value the way execvp does
+///
+/// Names containing '/' are used as-is; if nothing matches, the name is
+/// returned unchanged so that exec reports ENOENT.
+std::string resolve_executable(const std::string& name, const std::string& path_value)
+{
+    if (name.empty() || name.find('/') != std::string::npos)
+        return name;
+
+    size_t start = 0;
+    while (start <= path_value.size())
     {
-        if (pipe(stdin_pipe) != 0)
-            throw ProcessError("Failed to create stdin pipe: " + get_errno_message());
+        size_t end = path_value.find(':', start);
+        if (end == std::string::npos)
+            end = path_value.size();
+
+        std::string dir = path_value.substr(start, end - start);
+        std::string candidate = (dir.empty() ? std::string(".") : dir) + "/" + name;
+        struct stat st;
+        if (::stat(candidate.c_str(), &st) == 0 && S_ISREG(st.st_mode) &&
+            ::access(candidate.c_str(), X_OK) == 0)
+            return candidate;
+
+        start = end + 1;
     }
+    return name;
+}
 
-    // Create pipes for stdout
-    int stdout_pipe[2] = {-1, -1};
-    if (options.redirect_stdout)
+/// Fill in the exec arrays of a block whose inputs are set
+void prepare_block(SpawnBlock& command)
+{
+    const std::string& executable = command.executable;
+    const ProcessOptions& options = command.options;
+
+    // Environment: inherited variables, overridden by options.environment
+    if (options.inherit_environment && environ)
     {
-        if (pipe(stdout_pipe) != 0)
+        for (char** var = environ; *var; ++var)
         {
-            if (stdin_pipe[0] >= 0)
-            {
-                ::close(stdin_pipe[0]);
-                ::close(stdin_pipe[1]);
-            }
-            throw ProcessError("Failed to create stdout pipe: " + get_errno_message());
+            std::string_view entry(*var);
+            std::string key(entry.substr(0, entry.find('=')));
+            if (options.environment.count(key) == 0)
+                command.env_storage.emplace_back(entry);
         }
     }
+    for (const auto& [key, value] : options.environment)
+        command.env_storage.push_back(key + "=" + value);
+
+    // Search the child's PATH, as execvp in the child would
+    std::string path_value = "/bin:/usr/bin";
+    if (auto it = options.environment.find("PATH"); it != options.environment.end())
+        path_value = it->second;
+    else if (const char* inherited = options.inherit_environment ? std::getenv("PATH") : nullptr)
+        path_value = inherited;
+    command.path = resolve_executable(executable, path_value);
+
+    command.arg_storage.reserve(command.args.size() + 1);
+    command.arg_storage.push_back(executable);
+    command.arg_storage.insert(command.arg_storage.end(), command.args.begin(), command.args.end());
+
+    for (auto& arg : command.arg_storage)
+        command.argv.push_back(arg.data());
+    command.argv.push_back(nullptr);
+    for (auto& var : command.env_storage)
+        command.envp.push_back(var.data());
+    command.envp.push_back(nullptr);
+}
 
-    // Create pipes for stderr
+/// Pipe ends owned by spawn() until they are handed to the pipe objects
+struct SpawnPipes
+{
+    int stdin_pipe[2] = {-1, -1};
+    int stdout_pipe[2] = {-1, -1};
     int stderr_pipe[2] = {-1, -1};
-    if (options.redirect_stderr)
+
+    ~SpawnPipes()
     {
-        if (pipe(stderr_pipe) != 0)
+        for (int* p : {stdin_pipe, stdout_pipe, stderr_pipe})
         {
-            if (stdin_pipe[0] >= 0)
-            {
-                ::close(stdin_pipe[0]);
-                ::close(stdin_pipe[1]);
-            }
-            if (stdout_pipe[0] >= 0)
+            for (int i = 0; i < 2; ++i)
             {
-                ::close(stdout_pipe[0]);
-                ::close(stdout_pipe[1]);
+                if (p[i] >= 0)
+                    ::close(p[i]);
             }
-            throw ProcessError("Failed to create stderr pipe: " + get_errno_message());
         }
     }
+};
 
-    // Create error pipe for detecting exec failures (O_CLOEXEC closes on successful exec)
-    int error_pipe[2] = {-1, -1};
-    if (pipe(error_pipe) != 0)
+/// Create a close-on-exec pipe whose ends are never 0, 1 or 2
+///
+/// The child's redirections dup2 these onto the standard descriptors; an end
+/// that already sat on its target would keep FD_CLOEXEC and vanish at exec.
+void make_pipe(int fds[2], const char* what)
+{
+    auto fail = [what]
     {
-        if (stdin_pipe[0] >= 0)
-        {
-            ::close(stdin_pipe[0]);
-            ::close(stdin_pipe[1]);
-        }
-        if (stdout_pipe[0] >= 0)
-        {
-            ::close(stdout_pipe[0]);
-            ::close(stdout_pipe[1]);
-        }
-        if (stderr_pipe[0] >= 0)
+        std::string message = std::string("Failed to create ") + what + " pipe: ";
+        throw ProcessError(message + get_errno_message());
+    };
+
+    if (::pipe(fds) != 0)
+        fail();
+
+    for (int i = 0; i < 2; ++i)
+    {
+        if (fds[i] > STDERR_FILENO)
         {
-            ::close(stderr_pipe[0]);
-            ::close(stderr_pipe[1]);
+            fcntl(fds[i], F_SETFD, FD_CLOEXEC);
+            continue;
         }
-        throw ProcessError("Failed to create error pipe: " + get_errno_message());
+        int moved = fcntl(fds[i], F_DUPFD_CLOEXEC, STDERR_FILENO + 1);
+        if (moved < 0)
+            fail();
+        ::close(fds[i]);
+        fds[i] = moved;
     }
-    // Set close-on-exec for write end - will be closed automatically on successful exec
-    fcntl(error_pipe[1], F_SETFD, FD_CLOEXEC);
+}
 
-    // Fork the process
-    pid_t pid = fork();
-    if (pid < 0)
+/// Scheduler policy constant for `policy`, or -1 to leave it inherited
+int native_sched_policy(SchedulingPolicy policy)
+{
+    switch (policy)
     {
-        // Fork failed - clean up pipes
-        if (stdin_pipe[0] >= 0)
-        {
-            ::close(stdin_pipe[0]);
-            ::close(stdin_pipe[1]);
-        }
-        if (stdout_pipe[0] >= 0)
-        {
-            ::close(stdout_pipe[0]);
-            ::close(stdout_pipe[1]);
-        }
-        if (stderr_pipe[0] >= 0)
+    case SchedulingPolicy::Other:
+        return SCHED_OTHER;
+#ifdef SCHED_BATCH
+    case SchedulingPolicy::Batch:
+        return SCHED_BATCH;
+#endif
+#ifdef SCHED_IDLE
+    case SchedulingPolicy::Idle:
+        return SCHED_IDLE;
+#endif
+    case SchedulingPolicy::Fifo:
+        return SCHED_FIFO;
+    case SchedulingPolicy::RoundRobin:
+        return SCHED_RR;
+    default:
+        return -1;
+    }
+}
+
+/// Narrows the calling thread's CPU affinity for its lifetime, so that a child
+/// spawned meanwhile inherits it (neither posix_spawn nor fork can set it)
+class ScopedThreadAffinity
+{
+  public:
+    explicit ScopedThreadAffinity(const std::vector<int>& cpus)
+    {
+        if (cpus.empty())
+            return;
+#ifdef __linux__
+        if (pthread_getaffinity_np(pthread_self(), sizeof(saved_), &saved_) != 0)
+            throw ProcessError("Failed to read CPU affinity: " + get_errno_message());
+
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        for (int cpu : cpus)
         {
-            ::close(stderr_pipe[0]);
-            ::close(stderr_pipe[1]);
+            if (cpu >= 0 && cpu < CPU_SETSIZE)
+                CPU_SET(cpu, &set);
         }
-        ::close(error_pipe[0]);
-        ::close(error_pipe[1]);
-        throw ProcessError("Failed to fork process: " + get_errno_message());
+        int rc = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+        if (rc != 0)
+            throw ProcessError("Failed to set CPU affinity: " + std::string(std::strerror(rc)));
+        active_ = true;
+#else
+        throw ProcessError("CPU affinity for child processes is not supported on this platform");
+#endif
     }
 
-    if (pid == 0)
+    ~ScopedThreadAffinity()
     {
-        // Child process
+#ifdef __linux__
+        if (active_)
+            pthread_setaffinity_np(pthread_self(), sizeof(saved_), &saved_);
+#endif
+    }
 
-        // Close error pipe read end - we only write to it
-        ::close(error_pipe[0]);
+    ScopedThreadAffinity(const ScopedThreadAffinity&) = delete;
+    ScopedThreadAffinity& operator=(const ScopedThreadAffinity&) = delete;
 
-        // Redirect stdin
-        if (options.redirect_stdin)
-        {
-            ::close(stdin_pipe[1]); // Close write end
-            if (dup2(stdin_pipe[0], STDIN_FILENO) < 0)
-            {
-                int err = errno;
-                (void)::write(error_pipe[1], &err, sizeof(err));
-                _exit(127);
-            }
-            ::close(stdin_pipe[0]);
-        }
+  private:
+#ifdef __linux__
+    cpu_set_t saved_;
+    bool active_ = false;
+#endif
+};
 
-        // Redirect stdout
-        if (options.redirect_stdout)
-        {
-            ::close(stdout_pipe[0]); // Close read end
-            if (dup2(stdout_pipe[1], STDOUT_FILENO) < 0)
-            {
-                int err = errno;
-                (void)::write(error_pipe[1], &err, sizeof(err));
-                _exit(127);
-            }
-            ::close(stdout_pipe[1]);
-        }
+/// posix_spawn can chdir in the child only through a (widely available) extension
+#if defined(__APPLE__) || \
+    (defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 29)))
+#define COPILOT_HAVE_SPAWN_CHDIR 1
+#endif
 
-        // Redirect stderr
-        if (options.redirect_stderr)
-        {
-            ::close(stderr_pipe[0]); // Close read end
-            if (dup2(stderr_pipe[1], STDERR_FILENO) < 0)
-            {
-                int err = errno;
-                (void)::write(error_pipe[1], &err, sizeof(err));
-                _exit(127);
-            }
-            ::close(stderr_pipe[1]);
-        }
+/// Launch through posix_spawn (vfork/CLONE_VM under the hood on Linux and macOS)
+/// @return 0 on success, otherwise the errno describing the failure
+int spawn_with_posix_spawn(const SpawnBlock& command, const SpawnPipes& pipes, pid_t& pid)
+{
+    const ProcessOptions& options = command.options;
+    posix_spawn_file_actions_t actions;
+    int rc = posix_spawn_file_actions_init(&actions);
+    if (rc != 0)
+        return rc;
+
+    if (options.redirect_stdin && rc == 0)
+        rc = posix_spawn_file_actions_adddup2(&actions, pipes.stdin_pipe[0], STDIN_FILENO);
+    if (options.redirect_stdout && rc == 0)
+        rc = posix_spawn_file_actions_adddup2(&actions, pipes.stdout_pipe[1], STDOUT_FILENO);
+    if (options.redirect_stderr && rc == 0)
+        rc = posix_spawn_file_actions_adddup2(&actions, pipes.stderr_pipe[1], STDERR_FILENO);
+#ifdef COPILOT_HAVE_SPAWN_CHDIR
+    if (!options.working_directory.empty() && rc == 0)
+        rc = posix_spawn_file_actions_addchdir_np(&actions, options.working_directory.c_str());
+#endif
 
-        // Change working directory
-        if (!options.working_directory.empty())
-        {
-            if (chdir(options.working_directory.c_str()) != 0)
-            {
-                int err = errno;
-                (void)::write(error_pipe[1], &err, sizeof(err));
-                _exit(127);
-            }
-        }
+    posix_spawnattr_t attr;
+    int attr_rc = posix_spawnattr_init(&attr);
+    if (rc == 0)
+        rc = attr_rc;
 
-        // Set environment variables
-        if (!options.inherit_environment)
-        {
-#if defined(__linux__) && defined(_GNU_SOURCE)
-            clearenv();
-#else
-            // Fallback: best-effort clearing by resetting environ
-            if (environ)
-                environ[0] = nullptr;
-#endif
-        }
+    int policy = native_sched_policy(options.scheduling.policy);
+    if (policy >= 0 && rc == 0)
+    {
+        sched_param param{};
+        if (policy == SCHED_FIFO || policy == SCHED_RR)
+            param.sched_priority = options.scheduling.priority;
+        rc = posix_spawnattr_setschedpolicy(&attr, policy);
+        if (rc == 0)
+            rc = posix_spawnattr_setschedparam(&attr, &param);
+        if (rc == 0)
+            rc = posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETSCHEDULER);
+    }
 
-        for (const auto& [key, value] : options.environment)
-            setenv(key.c_str(), value.c_str(), 1); // Overwrite if exists
+    if (rc == 0)
+        rc = posix_spawn(
+            &pid, command.path.c_str(), &actions, &attr, command.argv.data(), command.envp.data()
+        );
 
-        // Build argv array
-        std::vector<char*> argv;
-        argv.push_back(const_cast<char*>(executable.c_str()));
-        for (const auto& arg : args)
-            argv.push_back(const_cast<char*>(arg.c_str()));
-        argv.push_back(nullptr);
+    if (attr_rc == 0)
+        posix_spawnattr_destroy(&attr);
+    posix_spawn_file_actions_destroy(&actions);
+    return rc;
+}
 
-        // Execute the program
-        execvp(executable.c_str(), argv.data());
+/// Launch through fork + execve, reporting child-side failures over a pipe
+/// @return 0 on success, otherwise the errno describing the failure
+int spawn_with_fork(const SpawnBlock& command, const SpawnPipes& pipes, pid_t& pid)
+{
+    const ProcessOptions& options = command.options;
+    // Write end is close-on-exec: a successful exec closes it with nothing written
+    int error_pipe[2] = {-1, -1};
+    if (::pipe(error_pipe) != 0)
+        throw ProcessError("Failed to create error pipe: " + get_errno_message());
+    fcntl(error_pipe[0], F_SETFD, FD_CLOEXEC);
+    fcntl(error_pipe[1], F_SETFD, FD_CLOEXEC);
 
-        // If execvp returns, it failed - write error to pipe
+    pid = fork();
+    if (pid < 0)
+    {
         int err = errno;
-        (void)::write(error_pipe[1], &err, sizeof(err));
-        _exit(127);
+        ::close(error_pipe[0]);
+        ::close(error_pipe[1]);
+        throw ProcessError("Failed to fork process: " + std::string(std::strerror(err)));
     }
 
-    // Parent process
+    if (pid == 0)
+    {
+        // Child process: only async-signal-safe calls from here on
+        auto fail = [&]
+        {
+            int err = errno;
+            (void)::write(error_pipe[1], &err, sizeof(err));
+            _exit(127);
+        };
+
+        if (options.redirect_stdin && dup2(pipes.stdin_pipe[0], STDIN_FILENO) < 0)
+            fail();
+        if (options.redirect_stdout && dup2(pipes.stdout_pipe[1], STDOUT_FILENO) < 0)
+            fail();
+        if (options.redirect_stderr && dup2(pipes.stderr_pipe[1], STDERR_FILENO) < 0)
+            fail();
+        if (!options.working_directory.empty() && chdir(options.working_directory.c_str()) != 0)
+            fail();
+        if (int policy = native_sched_policy(options.scheduling.policy); policy >= 0)
+        {
+            sched_param param{};
+            if (policy == SCHED_FIFO || policy == SCHED_RR)
+                param.sched_priority = options.scheduling.priority;
+            if (sched_setscheduler(0, policy, &param) != 0)
+                fail();
+        }
+
+        execve(command.path.c_str(), command.argv.data(), command.envp.data());
+        fail();
+    }
 
-    // Close write end of error pipe and check for exec errors
+    // Parent process: read the child's errno, if exec failed
     ::close(error_pipe[1]);
     int child_errno = 0;
-    ssize_t error_bytes = ::read(error_pipe[0], &child_errno, sizeof(child_errno));
+    ssize_t error_bytes;
+    do
+    {
+        error_bytes = ::read(error_pipe[0], &child_errno, sizeof(child_errno));
+    } while (error_bytes < 0 && errno == EINTR);
     ::close(error_pipe[0]);
 
     if (error_bytes > 0)
     {
-        // Exec failed in child - clean up and throw
         waitpid(pid, nullptr, 0); // Reap zombie child
-        if (options.redirect_stdin)
-        {
-            ::close(stdin_pipe[0]);
-            ::close(stdin_pipe[1]);
-        }
-        if (options.redirect_stdout)
-        {
-            ::close(stdout_pipe[0]);
-            ::close(stdout_pipe[1]);
-        }
-        if (options.redirect_stderr)
-        {
-            ::close(stderr_pipe[0]);
-            ::close(stderr_pipe[1]);
-        }
-        throw ProcessError("Failed to execute '" + executable + "': " + std::strerror(child_errno));
+        return child_errno;
     }
+    return 0;
+}
 
-    // Close unused pipe ends and store handles
+} // namespace
+
+// =============================================================================
+// SpawnSpec Implementation
+// =============================================================================
+
+SpawnSpec::SpawnSpec(
+    const std::string& executable,
+    const std::vector<std::string>& args,
+    const ProcessOptions& options
+)
+{
+    auto block = std::make_shared<SpawnBlock>();
+    block->executable = executable;
+    block->args = args;
+    block->options = options;
+    prepare_block(*block);
+    block_ = std::move(block);
+}
+
+SpawnSpec::~SpawnSpec() = default;
+
+const std::string& SpawnSpec::executable() const
+{
+    return block_->executable;
+}
+
+const std::string& SpawnSpec::resolved_path() const
+{
+    return block_->path;
+}
+
+const std::vector<std::string>& SpawnSpec::args() const
+{
+    return block_->args;
+}
+
+const std::vector<std::string>& SpawnSpec::environment() const
+{
+    return block_->env_storage;
+}
+
+const ProcessOptions& SpawnSpec::options() const
+{
+    return block_->options;
+}
+
+// =============================================================================
+// Process Spawn
+// =============================================================================
+
+void Process::spawn(
+    const std::string& executable,
+    const std::vector<std::string>& args,
+    const ProcessOptions& options
+)
+{
+    spawn(SpawnSpec(executable, args, options));
+}
+
+void Process::spawn(const SpawnSpec& spec)
+{
+    // argv/envp were built up front; the child never touches the parent's heap or environ
+    const SpawnBlock& command = *spec.block_;
+    const ProcessOptions& options = command.options;
+    const std::string& executable = command.executable;
+
+    SpawnPipes pipes;
     if (options.redirect_stdin)
+        make_pipe(pipes.stdin_pipe, "stdin");
+    if (options.redirect_stdout)
+        make_pipe(pipes.stdout_pipe, "stdout");
+    if (options.redirect_stderr)
+        make_pipe(pipes.stderr_pipe, "stderr");
+
+    bool use_posix_spawn = options.spawn_method == SpawnMethod::PosixSpawn;
+#ifndef COPILOT_HAVE_SPAWN_CHDIR
+    if (!options.working_directory.empty())
+        use_posix_spawn = false;
+#endif
+    // posix_spawnattr_setschedpolicy only accepts the POSIX policies
+    if (options.scheduling.policy == SchedulingPolicy::Batch ||
+        options.scheduling.policy == SchedulingPolicy::Idle)
+        use_posix_spawn = false;
+
+    pid_t pid = 0;
+    int err = 0;
     {
-        ::close(stdin_pipe[0]); // Close read end
-        stdin_->handle_->fd = stdin_pipe[1];
+        ScopedThreadAffinity affinity(options.scheduling.cpus);
+        err = use_posix_spawn ? spawn_with_posix_spawn(command, pipes, pid)
+                              : spawn_with_fork(command, pipes, pid);
+    }
+    if (err != 0)
+        throw ProcessError("Failed to execute '" + executable + "': " + std::strerror(err));
+
+    // Hand the parent's ends to the pipe objects; the child's ends close with `pipes`
+    if (options.redirect_stdin)
+    {
+        stdin_->handle_->fd = pipes.stdin_pipe[1];
+        pipes.stdin_pipe[1] = -1;
     }
 
     if (options.redirect_stdout)
     {
-        ::close(stdout_pipe[1]); // Close write end
-        stdout_->handle_->fd = stdout_pipe[0];
+        stdout_->handle_->fd = pipes.stdout_pipe[0];
+        pipes.stdout_pipe[0] = -1;
     }
 
     if (options.redirect_stderr)
     {
-        ::close(stderr_pipe[1]); // Close write end
-        stderr_->handle_->fd = stderr_pipe[0];
+        stderr_->handle_->fd = pipes.stderr_pipe[0];
+        pipes.stderr_pipe[0] = -1;
     }
 
     // Store process information
     handle_->pid = pid;
     handle_->running = true;
+    handle_->pidfd = open_pidfd(pid);
+    handle_->on_thread_start = options.on_thread_start;
 }
 
 WritePipe& Process::stdin_pipe()
@@ -516,6 +901,15 @@ bool Process::is_running() const
     if (!handle_->running)
         return false;
 
+    // A readable pidfd means the child has exited (even if not yet reaped)
+    if (handle_->pidfd >= 0)
+    {
+        pollfd pfd{handle_->pidfd, POLLIN, 0};
+        int ready = ::poll(&pfd, 1, 0);
+        if (ready >= 0)
+            return ready == 0;
+    }
+
     // Check process status using kill with signal 0
     int result = ::kill(handle_->pid, 0);
     if (result == 0)
@@ -531,23 +925,20 @@ bool Process::is_running() const
 std::optional<int> Process::try_wait()
 {
     if (!handle_ || handle_->pid == 0)
-        return handle_ ? handle_->exit_code : -1;
+        return handle_ ? handle_->exit_code.load() : -1;
 
     if (!handle_->running)
         return handle_->exit_code;
 
     int status;
-    pid_t result = waitpid(handle_->pid, &status, WNOHANG);
+    struct rusage ru{};
+    pid_t result = wait4(handle_->pid, &status, WNOHANG, &ru);
 
     if (result == handle_->pid)
     {
         // Process has exited
-        if (WIFEXITED(status))
-            handle_->exit_code = WEXITSTATUS(status);
-        else if (WIFSIGNALED(status))
-            handle_->exit_code = 128 + WTERMSIG(status);
-        else
-            handle_->exit_code = -1;
+        handle_->exit_code = decode_wait_status(status);
+        handle_->final_usage = usage_from_rusage(ru);
         handle_->running = false;
         return handle_->exit_code;
     }
@@ -559,34 +950,31 @@ std::optional<int> Process::try_wait()
     else
     {
         // Error occurred
-        throw ProcessError("waitpid failed: " + get_errno_message());
+        throw ProcessError("wait4 failed: " + get_errno_message());
     }
 }
 
 int Process::wait()
 {
     if (!handle_ || handle_->pid == 0)
-        return handle_ ? handle_->exit_code : -1;
+        return handle_ ? handle_->exit_code.load() : -1;
 
     if (!handle_->running)
         return handle_->exit_code;
 
     int status;
-    pid_t result = waitpid(handle_->pid, &status, 0);
+    struct rusage ru{};
+    pid_t result = wait4(handle_->pid, &status, 0, &ru);
 
     if (result == handle_->pid)
     {
-        if (WIFEXITED(status))
-            handle_->exit_code = WEXITSTATUS(status);
-        else if (WIFSIGNALED(status))
-            handle_->exit_code = 128 + WTERMSIG(status);
-        else
-            handle_->exit_code = -1;
+        handle_->exit_code = decode_wait_status(status);
+        handle_->final_usage = usage_from_rusage(ru);
         handle_->running = false;
         return handle_->exit_code;
     }
 
-    throw ProcessError("waitpid failed: " + get_errno_message());
+    throw ProcessError("wait4 failed: " + get_errno_message());
 }
 
 void Process::terminate()
@@ -601,6 +989,66 @@ void Process::kill()
         ::kill(handle_->pid, SIGKILL);
 }
 
+int Process::pidfd() const
+{
+    return handle_ ? handle_->pidfd : -1;
+}
+
+ResourceUsage Process::resource_usage() const
+{
+    if (!handle_ || handle_->pid == 0)
+        throw ProcessError("Process not spawned");
+    if (handle_->final_usage)
+        return *handle_->final_usage;
+
+#ifdef __linux__
+    return sample_proc(handle_->pid);
+#else
+    ResourceUsage usage;
+    usage.sampled_at = std::chrono::steady_clock::now();
+    return usage;
+#endif
+}
+
+void Process::on_exit(ExitCallback callback)
+{
+    if (!handle_ || handle_->pid == 0)
+        throw ProcessError("Process not spawned");
+    if (handle_->exit_watcher.joinable())
+        throw ProcessError("Exit callback already set");
+
+    ProcessHandle* handle = handle_.get();
+    handle->exit_watcher = std::thread(
+        [handle, callback = std::move(callback)]
+        {
+            if (handle->on_thread_start)
+                handle->on_thread_start(ThreadRole::ExitWatcher);
+
+            if (handle->pidfd >= 0)
+            {
+                pollfd pfd{handle->pidfd, POLLIN, 0};
+                while (::poll(&pfd, 1, -1) < 0 && errno == EINTR)
+                {
+                }
+            }
+
+            // Blocks until exit when there is no pidfd; -1 once wait() has reaped it
+            int exit_code = peek_exit_code(handle->pid);
+            if (exit_code < 0)
+                exit_code = handle->exit_code;
+
+            try
+            {
+                callback(exit_code);
+            }
+            catch (...)
+            {
+                // Exceptions must not escape the watcher thread
+            }
+        }
+    );
+}
+
 int Process::pid() const
 {
     return handle_ ? static_cast<int>(handle_->pid) : 0;
@@ -19,7 +19,10 @@
 #include <cstdlib>
 #include <filesystem>
 #include <sstream>
+#include <thread>
 #include <windows.h>
+// After windows.h
+#include <psapi.h>
 
 namespace copilot
 {
@@ -47,8 +50,15 @@ struct ProcessHandle
     bool running = false;
     int exit_code = -1;
 
+    // Exit notification
+    std::thread exit_watcher;
+    ThreadStartHook on_thread_start;
+
     ~ProcessHandle()
     {
+        // The watcher returns once the child exits; ~Process ensures it does
+        if (exit_watcher.joinable())
+            exit_watcher.join();
         if (thread_handle != INVALID_HANDLE_VALUE)
             CloseHandle(thread_handle);
         if (process_handle != INVALID_HANDLE_VALUE)
@@ -196,6 +206,100 @@ resolve_executable_for_spawn(const std::string& executable, const ProcessOptions
     return executable;
 }
 
+// =============================================================================
+// SpawnSpec Implementation
+// =============================================================================
+
+/// Command line and environment block, built before CreateProcess
+struct SpawnBlock
+{
+    std::string executable; // as given
+    std::vector<std::string> args;
+    ProcessOptions options;
+
+    std::string path;                     // resolved executable
+    std::string cmdline;                  // quoted command line
+    std::vector<std::string> env_storage; // "KEY=value", sorted
+    std::string env_block;                // NUL-separated, double-NUL terminated
+};
+
+SpawnSpec::SpawnSpec(
+    const std::string& executable,
+    const std::vector<std::string>& args,
+    const ProcessOptions& options
+)
+{
+    auto block = std::make_shared<SpawnBlock>();
+    block->executable = executable;
+    block->args = args;
+    block->options = options;
+
+    // Resolve executable for spawning. Passing lpApplicationName avoids Windows searching the
+    // current directory when the executable is not fully-qualified.
+    block->path = resolve_executable_for_spawn(executable, options);
+    block->cmdline = build_command_line(block->path, args);
+
+    std::map<std::string, std::string> env;
+    if (options.inherit_environment)
+    {
+        // Snapshot the current environment
+        LPCH env_strings = GetEnvironmentStrings();
+        if (env_strings)
+        {
+            for (LPCH p = env_strings; *p; p += strlen(p) + 1)
+            {
+                std::string entry(p);
+                size_t eq = entry.find('=');
+                if (eq != std::string::npos && eq > 0)
+                    env[entry.substr(0, eq)] = entry.substr(eq + 1);
+            }
+            FreeEnvironmentStrings(env_strings);
+        }
+    }
+
+    // Merge/override with provided environment
+    for (const auto& [key, value] : options.environment)
+        env[key] = value;
+
+    // Build null-terminated block
+    for (const auto& [key, value] : env)
+    {
+        block->env_storage.push_back(key + "=" + value);
+        block->env_block += block->env_storage.back();
+        block->env_block.push_back('\0');
+    }
+    block->env_block.push_back('\0');
+
+    block_ = std::move(block);
+}
+
+SpawnSpec::~SpawnSpec() = default;
+
+const std::string& SpawnSpec::executable() const
+{
+    return block_->executable;
+}
+
+const std::string& SpawnSpec::resolved_path() const
+{
+    return block_->path;
+}
+
+const std::vector<std::string>& SpawnSpec::args() const
+{
+    return block_->args;
+}
+
+const std::vector<std::string>& SpawnSpec::environment() const
+{
+    return block_->env_storage;
+}
+
+const ProcessOptions& SpawnSpec::options() const
+{
+    return block_->options;
+}
+
 // =============================================================================
 // ReadPipe implementation
 // =============================================================================
@@ -210,11 +314,12 @@ ReadPipe::~ReadPipe()
 ReadPipe::ReadPipe(ReadPipe&&) noexcept = default;
 ReadPipe& ReadPipe::operator=(ReadPipe&&) noexcept = default;
 
-size_t ReadPipe::read(char* buffer, size_t size)
+size_t ReadPipe::read_raw(char* buffer, size_t size)
 {
     if (!is_open())
         throw ProcessError("Pipe is not open");
 
+    ++read_syscalls_;
     DWORD bytes_read = 0;
     BOOL success =
         ReadFile(handle_->handle, buffer, static_cast<DWORD>(size), &bytes_read, nullptr);
@@ -230,26 +335,7 @@ size_t ReadPipe::read(char* buffer, size_t size)
     return bytes_read;
 }
 
-std::string ReadPipe::read_line(size_t max_size)
-{
-    std::string line;
-    line.reserve(256);
-
-    char ch;
-    while (line.size() < max_size)
-    {
-        size_t bytes_read = read(&ch, 1);
-        if (bytes_read == 0)
-            break; // EOF
-        line.push_back(ch);
-        if (ch == '\n')
-            break;
-    }
-
-    return line;
-}
-
-bool ReadPipe::has_data(int timeout_ms)
+bool ReadPipe::wait_readable(int timeout_ms)
 {
     if (!is_open())
         return false;
@@ -391,6 +477,14 @@ void Process::spawn(
     const ProcessOptions& options
 )
 {
+    spawn(SpawnSpec(executable, args, options));
+}
+
+void Process::spawn(const SpawnSpec& spec)
+{
+    const SpawnBlock& command = *spec.block_;
+    const ProcessOptions& options = command.options;
+
     // Create pipes
     HANDLE stdin_read = INVALID_HANDLE_VALUE;
     HANDLE stdin_write = INVALID_HANDLE_VALUE;
@@ -442,48 +536,8 @@ void Process::spawn(
         SetHandleInformation(stderr_read, HANDLE_FLAG_INHERIT, 0);
     }
 
-    // Resolve executable for spawning. Passing lpApplicationName avoids Windows searching the
-    // current directory when the executable is not fully-qualified.
-    std::string resolved_executable = resolve_executable_for_spawn(executable, options);
-
-    // Build command line
-    std::string cmdline = build_command_line(resolved_executable, args);
-
-    // Build environment block
-    std::string env_block;
-    if (!options.environment.empty() || !options.inherit_environment)
-    {
-        std::map<std::string, std::string> env;
-
-        if (options.inherit_environment)
-        {
-            // Get current environment
-            LPCH env_strings = GetEnvironmentStrings();
-            if (env_strings)
-            {
-                for (LPCH p = env_strings; *p; p += strlen(p) + 1)
-                {
-                    std::string entry(p);
-                    size_t eq = entry.find('=');
-                    if (eq != std::string::npos && eq > 0)
-                        env[entry.substr(0, eq)] = entry.substr(eq + 1);
-                }
-                FreeEnvironmentStrings(env_strings);
-            }
-        }
-
-        // Merge/override with provided environment
-        for (const auto& [key, value] : options.environment)
-            env[key] = value;
-
-        // Build null-terminated block
-        for (const auto& [key, value] : env)
-        {
-            env_block += key + "=" + value;
-            env_block.push_back('\0');
-        }
-        env_block.push_back('\0');
-    }
+    // CreateProcessA may modify the command line buffer, so it gets a copy
+    std::string cmdline = command.cmdline;
 
     // Setup startup info
     STARTUPINFOA si;
@@ -503,14 +557,24 @@ void Process::spawn(
     if (options.create_no_window)
         creation_flags |= CREATE_NO_WINDOW;
 
+    // Affinity is applied before the child runs its first instruction
+    DWORD_PTR affinity_mask = 0;
+    for (int cpu : options.scheduling.cpus)
+    {
+        if (cpu >= 0 && cpu < static_cast<int>(sizeof(DWORD_PTR) * 8))
+            affinity_mask |= DWORD_PTR(1) << cpu;
+    }
+    if (affinity_mask != 0)
+        creation_flags |= CREATE_SUSPENDED;
+
     BOOL success = CreateProcessA(
-        resolved_executable.c_str(),
+        command.path.c_str(),
         cmdline.data(),
         nullptr,
         nullptr,
         TRUE, // Inherit handles
         creation_flags,
-        env_block.empty() ? nullptr : env_block.data(),
+        const_cast<char*>(command.env_block.data()),
         options.working_directory.empty() ? nullptr : options.working_directory.c_str(),
         &si,
         &pi
@@ -540,6 +604,15 @@ void Process::spawn(
     handle_->thread_handle = pi.hThread;
     handle_->process_id = pi.dwProcessId;
     handle_->running = true;
+    handle_->on_thread_start = options.on_thread_start;
+
+    if (affinity_mask != 0)
+    {
+        BOOL pinned = SetProcessAffinityMask(pi.hProcess, affinity_mask);
+        ResumeThread(pi.hThread);
+        if (!pinned)
+            throw ProcessError("Failed to set CPU affinity: " + get_last_error_message());
+    }
 
     // Assign to job object so child dies when parent dies
     HANDLE job = get_child_process_job();
@@ -643,6 +716,84 @@ int Process::pid() const
     return handle_ ? static_cast<int>(handle_->process_id) : 0;
 }
 
+int Process::pidfd() const
+{
+    return -1; // Linux only; the process handle is waitable instead
+}
+
+ResourceUsage Process::resource_usage() const
+{
+    if (!handle_ || handle_->process_handle == INVALID_HANDLE_VALUE)
+        throw ProcessError("Process not spawned");
+
+    // The handle stays valid after exit, so the final figures come from the same calls
+    ResourceUsage usage;
+    usage.sampled_at = std::chrono::steady_clock::now();
+    usage.exited = !is_running();
+
+    auto to_us = [](const FILETIME& ft)
+    {
+        ULARGE_INTEGER ticks; // 100 ns units
+        ticks.LowPart = ft.dwLowDateTime;
+        ticks.HighPart = ft.dwHighDateTime;
+        return std::chrono::microseconds(ticks.QuadPart / 10);
+    };
+    FILETIME created, exited, kernel, user;
+    if (GetProcessTimes(handle_->process_handle, &created, &exited, &kernel, &user))
+    {
+        usage.user_cpu = to_us(user);
+        usage.system_cpu = to_us(kernel);
+    }
+
+    // K32 variant lives in kernel32, so psapi.lib is not needed
+    PROCESS_MEMORY_COUNTERS memory{};
+    if (K32GetProcessMemoryInfo(handle_->process_handle, &memory, sizeof(memory)))
+    {
+        if (!usage.exited)
+            usage.rss_bytes = memory.WorkingSetSize;
+        usage.peak_rss_bytes = memory.PeakWorkingSetSize;
+    }
+
+    IO_COUNTERS io{};
+    if (GetProcessIoCounters(handle_->process_handle, &io))
+    {
+        usage.read_bytes = io.ReadTransferCount;
+        usage.write_bytes = io.WriteTransferCount;
+    }
+    return usage;
+}
+
+void Process::on_exit(ExitCallback callback)
+{
+    if (!handle_ || handle_->process_handle == INVALID_HANDLE_VALUE)
+        throw ProcessError("Process not spawned");
+    if (handle_->exit_watcher.joinable())
+        throw ProcessError("Exit callback already set");
+
+    HANDLE process_handle = handle_->process_handle;
+    handle_->exit_watcher = std::thread(
+        [process_handle, hook = handle_->on_thread_start, callback = std::move(callback)]
+        {
+            if (hook)
+                hook(ThreadRole::ExitWatcher);
+
+            WaitForSingleObject(process_handle, INFINITE);
+
+            DWORD exit_code = static_cast<DWORD>(-1);
+            GetExitCodeProcess(process_handle, &exit_code);
+
+            try
+            {
+                callback(static_cast<int>(exit_code));
+            }
+            catch (...)
+            {
+                // Exceptions must not escape the watcher thread
+            }
+        }
+    );
+}
+
 // =============================================================================
 // Utility functions
 // =============================================================================
@@ -1,13 +1,91 @@
 // Copyright (c) 2025 Elias Bachaalany
 // SPDX-License-Identifier: MIT
 
+#include <algorithm>
 #include <copilot/client.hpp>
 #include <copilot/session.hpp>
-#include <condition_variable>
 
 namespace copilot
 {
 
+namespace
+{
+
+json make_send_params(const std::string& session_id, const MessageOptions& options)
+{
+    json params;
+    params["sessionId"] = session_id;
+    params["prompt"] = options.prompt;
+
+    if (options.attachments.has_value())
+        params["attachments"] = *options.attachments;
+    if (options.mode.has_value())
+        params["mode"] = *options.mode;
+    return params;
+}
+
+/// Heap bytes owned by a string beyond its inline (SSO) storage
+std::size_t heap_bytes(const std::string& value)
+{
+    static const std::size_t inline_capacity = std::string().capacity();
+    return value.capacity() > inline_capacity ? value.capacity() + 1 : 0;
+}
+
+std::size_t heap_bytes(const std::optional<std::string>& value)
+{
+    return value ? heap_bytes(*value) : 0;
+}
+
+// Payload estimates cover the text-carrying event types, which dominate history
+// memory; other payloads are counted by sizeof(SessionEvent) alone.
+template <typename T>
+std::size_t payload_bytes(const T&)
+{
+    return 0;
+}
+
+std::size_t payload_bytes(const UserMessageData& d)
+{
+    return heap_bytes(d.content) + heap_bytes(d.transformed_content);
+}
+
+std::size_t payload_bytes(const AssistantMessageData& d)
+{
+    return heap_bytes(d.message_id) + heap_bytes(d.content) + heap_bytes(d.chunk_content) +
+           heap_bytes(d.reasoning_text) + heap_bytes(d.reasoning_opaque) +
+           heap_bytes(d.encrypted_content);
+}
+
+std::size_t payload_bytes(const AssistantMessageDeltaData& d)
+{
+    return heap_bytes(d.message_id) + heap_bytes(d.delta_content);
+}
+
+std::size_t payload_bytes(const AssistantReasoningData& d)
+{
+    return heap_bytes(d.reasoning_id) + heap_bytes(d.content) + heap_bytes(d.chunk_content);
+}
+
+std::size_t payload_bytes(const AssistantReasoningDeltaData& d)
+{
+    return heap_bytes(d.reasoning_id) + heap_bytes(d.delta_content);
+}
+
+std::size_t payload_bytes(const ToolExecutionPartialResultData& d)
+{
+    return heap_bytes(d.tool_call_id) + heap_bytes(d.partial_output);
+}
+
+/// Estimated memory held by a copy of an event
+std::size_t estimate_event_bytes(const SessionEvent& event)
+{
+    return sizeof(SessionEvent) + heap_bytes(event.id) + heap_bytes(event.timestamp) +
+           heap_bytes(event.parent_id) + heap_bytes(event.type_string) +
+           std::visit([](const auto& data) { return payload_bytes(data); }, event.data);
+}
+
+} // namespace
+
 // =============================================================================
 // Constructor / Destructor
 // =============================================================================
@@ -23,6 +101,7 @@ Session::~Session()
     // Note: We don't automatically destroy the session on destruction
     // because the user might want to resume it later.
     // Call destroy() explicitly if you want to remove it from the server.
+    fail_turns(std::make_exception_ptr(std::runtime_error("Session was released")));
 }
 
 // =============================================================================
@@ -35,16 +114,36 @@ std::future<std::string> Session::send(MessageOptions options)
         std::launch::async,
         [this, options = std::move(options)]()
         {
-            json params;
-            params["sessionId"] = session_id_;
-            params["prompt"] = options.prompt;
-
-            if (options.attachments.has_value())
-                params["attachments"] = *options.attachments;
-            if (options.mode.has_value())
-                params["mode"] = *options.mode;
+            auto params = make_send_params(session_id_, options);
+            std::future<json> pending;
+            {
+                // Client::rolling_replace() holds the gate while moving sessions
+                auto gate = client_->send_gate();
+                set_turn_running(true);
+                notify_turn_sent();
+                try
+                {
+                    pending = client_->connected_rpc().invoke("session.send", params);
+                }
+                catch (...)
+                {
+                    set_turn_running(false);
+                    notify_turn_failed(std::current_exception());
+                    throw;
+                }
+            }
 
-            auto response = client_->rpc_client()->invoke("session.send", params).get();
+            json response;
+            try
+            {
+                response = pending.get();
+            }
+            catch (...)
+            {
+                set_turn_running(false);
+                notify_turn_failed(std::current_exception());
+                throw;
+            }
             return response["messageId"].get<std::string>();
         }
     );
@@ -59,7 +158,7 @@ std::future<void> Session::abort()
             json params;
             params["sessionId"] = session_id_;
 
-            client_->rpc_client()->invoke("session.abort", params).get();
+            client_->connected_rpc().invoke("session.abort", params).get();
         }
     );
 }
@@ -73,7 +172,7 @@ std::future<std::vector<SessionEvent>> Session::get_messages()
             json params;
             params["sessionId"] = session_id_;
 
-            auto response = client_->rpc_client()->invoke("session.getMessages", params).get();
+            auto response = client_->connected_rpc().invoke("session.getMessages", params).get();
 
             std::vector<SessionEvent> events;
             if (response.contains("events") && response["events"].is_array())
@@ -84,78 +183,586 @@ std::future<std::vector<SessionEvent>> Session::get_messages()
     );
 }
 
+std::future<std::vector<SessionEvent>> Session::get_messages_since(const std::string& event_id)
+{
+    if (auto retained = history_since(event_id))
+    {
+        retained->erase(
+            std::remove_if(
+                retained->begin(),
+                retained->end(),
+                [](const SessionEvent& event) { return event.ephemeral.value_or(false); }
+            ),
+            retained->end()
+        );
+        std::promise<std::vector<SessionEvent>> ready;
+        ready.set_value(std::move(*retained));
+        return ready.get_future();
+    }
+
+    return std::async(
+        std::launch::async,
+        [this, event_id]()
+        {
+            json params;
+            params["sessionId"] = session_id_;
+
+            auto response = client_->connected_rpc().invoke("session.getMessages", params).get();
+
+            auto events = response.find("events");
+            if (events == response.end())
+                return std::vector<SessionEvent>{};
+            return parse_session_events_after(*events, event_id);
+        }
+    );
+}
+
 std::future<std::optional<SessionEvent>> Session::send_and_wait(
     MessageOptions options,
     std::chrono::seconds timeout)
 {
-    return std::async(
-        std::launch::async,
-        [this, options = std::move(options), timeout]() -> std::optional<SessionEvent>
+    auto promise = std::make_shared<std::promise<std::optional<SessionEvent>>>();
+    auto future = promise->get_future();
+    send_and_wait(
+        std::move(options),
+        [promise](std::optional<SessionEvent> message, std::exception_ptr error)
         {
-            std::mutex mtx;
-            std::condition_variable cv;
-            bool done = false;
-            std::optional<SessionEvent> last_assistant_message;
-            std::optional<std::string> error_message;
-
-            // Subscribe to events
-            auto subscription = on(
-                [&](const SessionEvent& evt)
+            if (error)
+                promise->set_exception(error);
+            else
+                promise->set_value(std::move(message));
+        },
+        timeout
+    );
+    return future;
+}
+
+void Session::send_and_wait(
+    MessageOptions options, TurnCallback callback, std::chrono::milliseconds timeout
+)
+{
+    // Register before sending so a fast session.idle cannot be missed
+    auto turn = start_turn(std::move(callback), timeout);
+
+    std::weak_ptr<Session> weak_self = weak_from_this();
+    try
+    {
+        auto gate = client_->send_gate();
+        set_turn_running(true);
+        notify_turn_sent();
+        client_->connected_rpc().invoke_async(
+            "session.send",
+            make_send_params(session_id_, options),
+            [weak_self, turn](const json&, std::exception_ptr error)
+            {
+                if (!error)
+                    return;
+                if (auto self = weak_self.lock())
                 {
-                    std::lock_guard<std::mutex> lock(mtx);
-                    if (evt.type == SessionEventType::AssistantMessage)
-                    {
-                        last_assistant_message = evt;
-                    }
-                    else if (evt.type == SessionEventType::SessionIdle)
-                    {
-                        done = true;
-                        cv.notify_one();
-                    }
-                    else if (evt.type == SessionEventType::SessionError)
-                    {
-                        if (auto* data = evt.try_as<SessionErrorData>())
-                            error_message = data->message;
-                        else
-                            error_message = "Session error";
-                        done = true;
-                        cv.notify_one();
-                    }
+                    self->set_turn_running(false);
+                    self->notify_turn_failed(error);
+                    self->finish_turn(turn, std::nullopt, error);
                 }
-            );
+            }
+        );
+    }
+    catch (...)
+    {
+        set_turn_running(false);
+        notify_turn_failed(std::current_exception());
+        finish_turn(turn, std::nullopt, std::current_exception());
+    }
+}
 
-            // Send the message
-            send(options).get();
+#if COPILOT_HAS_COROUTINES
+TurnAwaitable Session::async_send_and_wait(
+    MessageOptions options, std::chrono::milliseconds timeout
+)
+{
+    return TurnAwaitable(
+        [&](TurnCallback callback)
+        { send_and_wait(std::move(options), std::move(callback), timeout); }
+    );
+}
+#endif
+
+void Session::wait_for_idle(TurnCallback callback, std::chrono::milliseconds timeout)
+{
+    start_turn(std::move(callback), timeout);
+}
 
-            // Wait for completion or timeout
+// =============================================================================
+// Turn Tracking
+// =============================================================================
+
+void Session::set_turn_running(bool running)
+{
+    {
+        std::lock_guard<std::mutex> lock(turn_state_mutex_);
+        turn_running_ = running;
+    }
+    if (!running)
+        turn_state_cv_.notify_all();
+}
+
+void Session::track_turn_state(SessionEventType type)
+{
+    if (type == SessionEventType::SessionIdle || type == SessionEventType::SessionError)
+        set_turn_running(false);
+}
+
+bool Session::turn_running() const
+{
+    std::lock_guard<std::mutex> lock(turn_state_mutex_);
+    return turn_running_;
+}
+
+bool Session::wait_turn_ended(std::chrono::steady_clock::time_point deadline)
+{
+    std::unique_lock<std::mutex> lock(turn_state_mutex_);
+    return turn_state_cv_.wait_until(lock, deadline, [this] { return !turn_running_; });
+}
+
+// =============================================================================
+// Timing
+// =============================================================================
+
+Subscription Session::observe_timing(SessionTimingObserver observer)
+{
+    int id;
+    {
+        std::lock_guard<std::mutex> lock(timing_mutex_);
+        id = next_timing_id_++;
+        auto current = timing_observers_.load();
+        auto observers = current ? std::make_shared<TimingObservers>(*current)
+                                 : std::make_shared<TimingObservers>();
+        observers->emplace_back(
+            id, std::make_shared<const SessionTimingObserver>(std::move(observer))
+        );
+        timing_observers_.store(std::move(observers));
+    }
+
+    std::weak_ptr<Session> weak_self = shared_from_this();
+    return Subscription(
+        [weak_self, id]()
+        {
+            if (auto self = weak_self.lock())
             {
-                std::unique_lock<std::mutex> lock(mtx);
-                if (!cv.wait_for(lock, timeout, [&] { return done; }))
+                std::lock_guard<std::mutex> lock(self->timing_mutex_);
+                auto current = self->timing_observers_.load();
+                if (!current)
+                    return;
+                auto observers = std::make_shared<TimingObservers>();
+                for (const auto& entry : *current)
+                    if (entry.first != id)
+                        observers->push_back(entry);
+                self->timing_observers_.store(std::move(observers));
+            }
+        }
+    );
+}
+
+void Session::notify_turn_sent()
+{
+    auto observers = timing_observers_.load();
+    if (!observers || observers->empty())
+        return;
+
+    auto now = std::chrono::steady_clock::now();
+    for (const auto& [id, observer] : *observers)
+    {
+        if (!observer->on_turn_sent)
+            continue;
+        try
+        {
+            observer->on_turn_sent(now);
+        }
+        catch (...)
+        {
+            // Observers must not break sending
+        }
+    }
+}
+
+void Session::notify_turn_failed(std::exception_ptr error)
+{
+    auto observers = timing_observers_.load();
+    if (!observers || observers->empty())
+        return;
+
+    std::string message = "Turn failed";
+    try
+    {
+        if (error)
+            std::rethrow_exception(error);
+    }
+    catch (const std::exception& e)
+    {
+        message = e.what();
+    }
+    catch (...)
+    {
+    }
+    for (const auto& [id, observer] : *observers)
+    {
+        if (!observer->on_turn_failed)
+            continue;
+        try
+        {
+            observer->on_turn_failed(message);
+        }
+        catch (...)
+        {
+            // Observers must not break sending
+        }
+    }
+}
+
+void Session::record_callback_time(
+    SessionCallbackKind kind,
+    const std::string& name,
+    std::chrono::steady_clock::time_point started
+)
+{
+    auto observers = timing_observers_.load();
+    if (!observers || observers->empty())
+        return;
+
+    auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - started
+    );
+    for (const auto& [id, observer] : *observers)
+    {
+        if (!observer->on_callback)
+            continue;
+        try
+        {
+            observer->on_callback(kind, name, elapsed);
+        }
+        catch (...)
+        {
+            // Observers must not break callback replies
+        }
+    }
+}
+
+std::shared_ptr<Session::PendingTurn> Session::start_turn(
+    TurnCallback callback, std::chrono::milliseconds timeout
+)
+{
+    auto turn = std::make_shared<PendingTurn>();
+    turn->callback = std::move(callback);
+    {
+        std::lock_guard<std::mutex> lock(turns_mutex_);
+        turns_.push_back(turn);
+        active_turns_.store(turns_.size(), std::memory_order_release);
+    }
+    refresh_event_mask();
+
+    // The timeout rides on the RPC client's existing timeout thread
+    auto* rpc = client_ ? client_->rpc_client() : nullptr;
+    if (timeout.count() > 0 && rpc)
+    {
+        std::weak_ptr<Session> weak_self = weak_from_this();
+        turn->deadline_rpc = rpc->weak_from_this();
+        auto id = rpc->watch_deadline(
+            timeout,
+            [weak_self, turn](const json&, std::exception_ptr error)
+            {
+                try
+                {
+                    if (error)
+                        std::rethrow_exception(error);
+                }
+                catch (const JsonRpcError& e)
                 {
-                    throw std::runtime_error("Timeout waiting for session to become idle");
+                    if (e.code() == JsonRpcErrorCode::Timeout)
+                        error = std::make_exception_ptr(
+                            std::runtime_error("Timeout waiting for session to become idle")
+                        );
                 }
+                catch (...)
+                {
+                }
+                if (auto self = weak_self.lock())
+                    self->finish_turn(turn, std::nullopt, error);
             }
+        );
+        turn->deadline_id.store(id);
+
+        // Completed before the deadline was recorded: drop it now
+        if (turn->settled.load())
+            rpc->cancel(id);
+    }
+    return turn;
+}
+
+void Session::finish_turn(
+    const std::shared_ptr<PendingTurn>& turn,
+    std::optional<SessionEvent> message,
+    std::exception_ptr error
+)
+{
+    {
+        std::lock_guard<std::mutex> lock(turns_mutex_);
+        turns_.erase(std::remove(turns_.begin(), turns_.end(), turn), turns_.end());
+        active_turns_.store(turns_.size(), std::memory_order_release);
+    }
+    refresh_event_mask();
+
+    if (turn->settled.exchange(true))
+        return;
+
+    // On the connection that registered it; after a restart the same id may
+    // name an unrelated request on the new one
+    if (auto id = turn->deadline_id.load(); id != 0)
+        if (auto rpc = turn->deadline_rpc.lock())
+            rpc->cancel(id);
+
+    try
+    {
+        turn->callback(std::move(message), error);
+    }
+    catch (...)
+    {
+        // Callback exceptions must not escape into dispatch
+    }
+}
 
-            if (error_message.has_value())
+void Session::fail_turns(std::exception_ptr error)
+{
+    std::vector<std::shared_ptr<PendingTurn>> failed;
+    {
+        std::lock_guard<std::mutex> lock(turns_mutex_);
+        failed = turns_;
+    }
+    set_turn_running(false);
+    notify_turn_failed(error);
+    for (auto& turn : failed)
+        finish_turn(turn, std::nullopt, error);
+}
+
+void Session::track_turns(const SessionEvent& event)
+{
+    if (event.type == SessionEventType::AssistantMessage)
+    {
+        std::lock_guard<std::mutex> lock(turns_mutex_);
+        for (auto& turn : turns_)
+            turn->last_message = event;
+        return;
+    }
+
+    std::exception_ptr error;
+    if (event.type == SessionEventType::SessionError)
+    {
+        auto* data = event.try_as<SessionErrorData>();
+        error = std::make_exception_ptr(
+            std::runtime_error("Session error: " + (data ? data->message : "Session error"))
+        );
+    }
+    else if (event.type != SessionEventType::SessionIdle)
+    {
+        return;
+    }
+
+    std::vector<std::shared_ptr<PendingTurn>> finished;
+    {
+        std::lock_guard<std::mutex> lock(turns_mutex_);
+        finished = turns_;
+    }
+    for (auto& turn : finished)
+    {
+        std::optional<SessionEvent> message;
+        if (!error)
+        {
+            std::lock_guard<std::mutex> lock(turns_mutex_);
+            message = std::move(turn->last_message);
+        }
+        finish_turn(turn, std::move(message), error);
+    }
+}
+
+#if COPILOT_HAS_COROUTINES
+// =============================================================================
+// TurnAwaitable
+// =============================================================================
+
+TurnAwaitable::TurnAwaitable(const std::function<void(TurnCallback)>& start)
+    : state_(std::make_shared<State>())
+{
+    start(
+        [state = state_](std::optional<SessionEvent> message, std::exception_ptr error)
+        {
+            std::coroutine_handle<> waiter;
             {
-                throw std::runtime_error("Session error: " + *error_message);
+                std::lock_guard<std::mutex> lock(state->mutex);
+                state->message = std::move(message);
+                state->error = error;
+                state->done = true;
+                waiter = state->waiter;
             }
-
-            return last_assistant_message;
+            if (waiter)
+                waiter.resume();
         }
     );
 }
 
+bool TurnAwaitable::await_ready() const noexcept
+{
+    std::lock_guard<std::mutex> lock(state_->mutex);
+    return state_->done;
+}
+
+bool TurnAwaitable::await_suspend(std::coroutine_handle<> waiter)
+{
+    std::lock_guard<std::mutex> lock(state_->mutex);
+    if (state_->done)
+        return false; // Completed in the meantime; continue without suspending
+    state_->waiter = waiter;
+    return true;
+}
+
+std::optional<SessionEvent> TurnAwaitable::await_resume()
+{
+    std::lock_guard<std::mutex> lock(state_->mutex);
+    if (state_->error)
+        std::rethrow_exception(state_->error);
+    return std::move(state_->message);
+}
+#endif
+
 // =============================================================================
 // Event Handling
 // =============================================================================
 
+std::shared_ptr<const Session::HandlerTable> Session::HandlerTable::build(HandlerList entries)
+{
+    auto table = std::make_shared<HandlerTable>();
+    for (const auto& entry : entries)
+    {
+        table->types |= entry.types;
+        for (std::size_t t = 0; t < kSessionEventTypeCount; ++t)
+            if (entry.types & session_event_type_bit(static_cast<SessionEventType>(t)))
+                table->by_type[t].push_back(entry);
+    }
+    table->entries = std::move(entries);
+    return table;
+}
+
 Subscription Session::on(EventHandler handler)
 {
-    std::lock_guard<std::mutex> lock(handlers_mutex_);
+    return subscribe(kAllSessionEventTypes, std::move(handler));
+}
 
-    int id = next_handler_id_++;
-    event_handlers_.emplace_back(id, std::move(handler));
+Subscription Session::on(EventHandler handler, const std::string& replay_from_event_id)
+{
+    // Live events are held back here until the replay has been delivered
+    struct ReplayGate
+    {
+        EventHandler handler;
+        std::atomic<bool> live{false};
+        std::mutex mutex;
+        std::vector<SessionEvent> held;
+    };
+    auto gate = std::make_shared<ReplayGate>();
+    gate->handler = std::move(handler);
+
+    auto deliver = [&gate](const SessionEvent& event)
+    {
+        try
+        {
+            gate->handler(event);
+        }
+        catch (...)
+        {
+            // Same policy as live dispatch
+        }
+    };
+
+    // Copy the tail and subscribe under the history lock: dispatch records an
+    // event and snapshots subscribers under the same lock, so every event is
+    // either in the copy or reaches the gate, never both
+    std::vector<SessionEvent> replay;
+    Subscription subscription;
+    {
+        std::lock_guard<std::mutex> lock(history_mutex_);
+        auto it = history_.begin();
+        if (!replay_from_event_id.empty())
+        {
+            auto found = std::find_if(
+                history_.rbegin(),
+                history_.rend(),
+                [&](const HistoryEntry& entry) { return entry.event.id == replay_from_event_id; }
+            );
+            it = found != history_.rend() ? found.base() : history_.end();
+        }
+        replay.reserve(static_cast<std::size_t>(history_.end() - it));
+        for (; it != history_.end(); ++it)
+            replay.push_back(it->event);
+
+        subscription = subscribe(
+            kAllSessionEventTypes,
+            [gate](const SessionEvent& event)
+            {
+                if (!gate->live.load(std::memory_order_acquire))
+                {
+                    std::lock_guard<std::mutex> gate_lock(gate->mutex);
+                    if (!gate->live.load(std::memory_order_relaxed))
+                    {
+                        gate->held.push_back(event);
+                        return;
+                    }
+                }
+                gate->handler(event);
+            }
+        );
+    }
+
+    for (const auto& event : replay)
+        deliver(event);
+
+    // Drain what arrived during the replay, then let dispatch call through
+    while (true)
+    {
+        std::vector<SessionEvent> held;
+        {
+            std::lock_guard<std::mutex> gate_lock(gate->mutex);
+            if (gate->held.empty())
+            {
+                gate->live.store(true, std::memory_order_release);
+                break;
+            }
+            held.swap(gate->held);
+        }
+        for (const auto& event : held)
+            deliver(event);
+    }
+    return subscription;
+}
+
+Subscription Session::on(const std::vector<SessionEventType>& types, EventHandler handler)
+{
+    SessionEventTypeMask mask = 0;
+    for (auto type : types)
+        mask |= session_event_type_bit(type);
+    return subscribe(mask, std::move(handler));
+}
+
+Subscription Session::subscribe(SessionEventTypeMask types, EventHandler handler)
+{
+    int id;
+    {
+        std::lock_guard<std::mutex> lock(handlers_mutex_);
+
+        id = next_handler_id_++;
+        auto current = event_handlers_.load();
+        HandlerList entries = current ? current->entries : HandlerList{};
+        entries.push_back(
+            HandlerEntry{id, types, std::make_shared<const EventHandler>(std::move(handler))}
+        );
+        event_handlers_.store(HandlerTable::build(std::move(entries)));
+    }
+    refresh_event_mask();
 
     // Return subscription that removes this handler when destroyed
     // Use weak_ptr to avoid UAF if Subscription outlives Session
@@ -165,43 +772,306 @@ Subscription Session::on(EventHandler handler)
         {
             if (auto self = weak_self.lock())
             {
-                std::lock_guard<std::mutex> lock(self->handlers_mutex_);
-                self->event_handlers_.erase(
-                    std::remove_if(
-                        self->event_handlers_.begin(),
-                        self->event_handlers_.end(),
-                        [id](const auto& pair) { return pair.first == id; }
-                    ),
-                    self->event_handlers_.end()
-                );
+                {
+                    std::lock_guard<std::mutex> lock(self->handlers_mutex_);
+                    auto current = self->event_handlers_.load();
+                    if (!current)
+                        return;
+
+                    HandlerList entries;
+                    entries.reserve(current->entries.size());
+                    for (const auto& entry : current->entries)
+                        if (entry.id != id)
+                            entries.push_back(entry);
+                    self->event_handlers_.store(HandlerTable::build(std::move(entries)));
+                }
+                self->refresh_event_mask();
             }
         }
     );
 }
 
+bool Session::has_subscribers(SessionEventType type) const
+{
+    return (subscribed_event_types() & session_event_type_bit(type)) != 0;
+}
+
+SessionEventTypeMask Session::subscribed_event_types() const
+{
+    auto handlers = event_handlers_.load();
+    return handlers ? handlers->types : 0;
+}
+
+bool Session::wants_event_type(SessionEventType type) const
+{
+    return (event_mask_.load(std::memory_order_acquire) & session_event_type_bit(type)) != 0;
+}
+
+SessionEventTypeMask Session::wanted_event_types() const
+{
+    return event_mask_.load(std::memory_order_acquire);
+}
+
+uint64_t Session::skipped_events() const
+{
+    return skipped_events_.load(std::memory_order_relaxed);
+}
+
+void Session::refresh_event_mask()
+{
+    // Serialized so a slower refresh cannot overwrite a newer mask with a stale one
+    std::lock_guard<std::mutex> lock(event_mask_mutex_);
+
+    SessionEventTypeMask mask = subscribed_event_types();
+    if (active_turns_.load(std::memory_order_acquire) != 0)
+        mask |= session_event_type_bit(SessionEventType::AssistantMessage) |
+                session_event_type_bit(SessionEventType::SessionIdle) |
+                session_event_type_bit(SessionEventType::SessionError);
+    if (history_enabled_.load(std::memory_order_acquire))
+        mask = kAllSessionEventTypes;
+    event_mask_.store(mask, std::memory_order_release);
+}
+
+std::shared_ptr<EventStream> Session::open_stream(
+    std::size_t capacity, StreamOverflowPolicy overflow_policy
+)
+{
+    return open_stream(EventStreamOptions{capacity, overflow_policy, 0});
+}
+
+std::shared_ptr<EventStream> Session::open_stream(const EventStreamOptions& options)
+{
+    auto stream = std::make_shared<EventStream>(options);
+
+    // The handler only holds the stream weakly; the stream owns the subscription
+    // and drops it when closed or destroyed.
+    std::weak_ptr<EventStream> weak_stream = stream;
+    auto subscription = std::make_shared<Subscription>(on(
+        [weak_stream](const SessionEvent& event)
+        {
+            if (auto target = weak_stream.lock())
+                target->push(event);
+        }
+    ));
+    stream->set_on_close([subscription]() { subscription->unsubscribe(); });
+
+    std::lock_guard<std::mutex> lock(streams_mutex_);
+    streams_.erase(
+        std::remove_if(
+            streams_.begin(), streams_.end(), [](const auto& weak) { return weak.expired(); }
+        ),
+        streams_.end()
+    );
+    streams_.push_back(stream);
+    return stream;
+}
+
+void Session::close_streams()
+{
+    std::vector<std::weak_ptr<EventStream>> streams;
+    {
+        std::lock_guard<std::mutex> lock(streams_mutex_);
+        streams.swap(streams_);
+    }
+    for (auto& weak : streams)
+        if (auto stream = weak.lock())
+            stream->close();
+}
+
+std::shared_ptr<StreamAssembler> Session::stream_assembler()
+{
+    std::lock_guard<std::mutex> lock(assembler_mutex_);
+    if (!assembler_)
+    {
+        auto assembler = std::make_shared<StreamAssembler>();
+        assembler_subscription_ = on(
+            {SessionEventType::AssistantMessageDelta,
+             SessionEventType::AssistantMessage,
+             SessionEventType::SessionIdle,
+             SessionEventType::SessionError,
+             SessionEventType::Abort},
+            [assembler](const SessionEvent& event) { assembler->on_event(event); }
+        );
+        assembler_ = std::move(assembler);
+    }
+    return assembler_;
+}
+
+// =============================================================================
+// Event History
+// =============================================================================
+
+void Session::enable_history(const EventHistoryOptions& options)
+{
+    {
+        std::lock_guard<std::mutex> lock(history_mutex_);
+        history_options_ = options;
+        trim_history_locked();
+        history_enabled_.store(true, std::memory_order_release);
+    }
+    refresh_event_mask();
+}
+
+void Session::disable_history()
+{
+    {
+        std::lock_guard<std::mutex> lock(history_mutex_);
+        history_enabled_.store(false, std::memory_order_release);
+        std::deque<HistoryEntry>().swap(history_);
+        history_bytes_ = 0;
+    }
+    refresh_event_mask();
+}
+
+std::vector<SessionEvent> Session::history() const
+{
+    std::lock_guard<std::mutex> lock(history_mutex_);
+    std::vector<SessionEvent> events;
+    events.reserve(history_.size());
+    for (const auto& entry : history_)
+        events.push_back(entry.event);
+    return events;
+}
+
+std::optional<std::vector<SessionEvent>> Session::history_since(const std::string& event_id) const
+{
+    std::lock_guard<std::mutex> lock(history_mutex_);
+    auto found = std::find_if(
+        history_.rbegin(),
+        history_.rend(),
+        [&](const HistoryEntry& entry) { return entry.event.id == event_id; }
+    );
+    if (found == history_.rend())
+        return std::nullopt;
+
+    std::vector<SessionEvent> events;
+    events.reserve(static_cast<std::size_t>(found - history_.rbegin()));
+    for (auto it = found.base(); it != history_.end(); ++it)
+        events.push_back(it->event);
+    return events;
+}
+
+EventHistoryStats Session::history_stats() const
+{
+    std::lock_guard<std::mutex> lock(history_mutex_);
+    EventHistoryStats stats;
+    stats.events = history_.size();
+    stats.bytes = history_bytes_;
+    stats.appended_events = history_appended_;
+    stats.evicted_events = history_evicted_;
+    return stats;
+}
+
+void Session::append_history_locked(const SessionEvent& event)
+{
+    if (!history_options_.include_ephemeral && event.ephemeral.value_or(false))
+        return;
+
+    auto bytes = estimate_event_bytes(event);
+    history_.push_back(HistoryEntry{event, bytes});
+    history_bytes_ += bytes;
+    ++history_appended_;
+    trim_history_locked();
+}
+
+void Session::trim_history_locked()
+{
+    const auto& options = history_options_;
+    while (!history_.empty() &&
+           ((options.max_events != 0 && history_.size() > options.max_events) ||
+            (options.max_bytes != 0 && history_bytes_ > options.max_bytes)))
+    {
+        history_bytes_ -= history_.front().bytes;
+        history_.pop_front();
+        ++history_evicted_;
+    }
+}
+
+// =============================================================================
+// Event Journal
+// =============================================================================
+
+void Session::attach_journal(std::shared_ptr<EventJournal> journal)
+{
+    journal_.store(std::move(journal));
+}
+
+std::shared_ptr<EventJournal> Session::journal() const
+{
+    return journal_.load();
+}
+
+void Session::journal_event(const json& raw_event, SessionEventType type)
+{
+    auto journal = journal_.load();
+    if (!journal)
+        return;
+
+    try
+    {
+        journal->append(raw_event);
+        if (type == SessionEventType::SessionIdle)
+            journal->request_sync();
+    }
+    catch (...)
+    {
+        // A failing disk must not stop live delivery; the journal counts
+        // write errors in its stats
+    }
+}
+
+void Session::dispatch_event(const SessionEvent& event, const json& raw_event)
+{
+    journal_event(raw_event, event.type);
+    dispatch_event(event);
+}
+
+void Session::skip_event(const json& raw_event, SessionEventType type)
+{
+    skipped_events_.fetch_add(1, std::memory_order_relaxed);
+    journal_event(raw_event, type);
+}
+
 void Session::dispatch_event(const SessionEvent& event)
 {
-    std::vector<EventHandler> handlers_copy;
+    auto index = static_cast<std::size_t>(event.type);
+    if (index >= kSessionEventTypeCount)
+        return;
 
+    std::shared_ptr<const HandlerTable> handlers;
+    if (history_enabled_.load(std::memory_order_acquire))
     {
-        std::lock_guard<std::mutex> lock(handlers_mutex_);
-        handlers_copy.reserve(event_handlers_.size());
-        for (const auto& [id, handler] : event_handlers_)
-            handlers_copy.push_back(handler);
+        // Record and take the subscriber snapshot under one lock, so a replaying
+        // on(handler, replay_from_event_id) sees this event exactly once
+        std::lock_guard<std::mutex> lock(history_mutex_);
+        if (history_enabled_.load(std::memory_order_relaxed))
+            append_history_locked(event);
+        handlers = event_handlers_.load();
+    }
+    else
+    {
+        handlers = event_handlers_.load();
     }
 
-    for (const auto& handler : handlers_copy)
+    if (handlers)
     {
-        try
-        {
-            handler(event);
-        }
-        catch (...)
+        for (const auto& entry : handlers->by_type[index])
         {
-            // Ignore handler exceptions to prevent one handler from
-            // breaking others
+            try
+            {
+                (*entry.handler)(event);
+            }
+            catch (...)
+            {
+                // Ignore handler exceptions to prevent one handler from
+                // breaking others
+            }
         }
     }
+
+    // Turns resolve after subscribers have seen the event
+    if (active_turns_.load(std::memory_order_acquire) != 0)
+        track_turns(event);
 }
 
 // =============================================================================
@@ -381,7 +1251,8 @@ std::future<void> Session::destroy()
             json params;
             params["sessionId"] = session_id_;
 
-            client_->rpc_client()->invoke("session.destroy", params).get();
+            client_->connected_rpc().invoke("session.destroy", params).get();
+            fail_turns(std::make_exception_ptr(std::runtime_error("Session was destroyed")));
         }
     );
 }
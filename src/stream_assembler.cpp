@@ -0,0 +1,203 @@
+// Copyright (c) 2025 Elias Bachaalany
+// SPDX-License-Identifier: MIT
+
+#include <algorithm>
+#include <copilot/stream_assembler.hpp>
+#include <cstring>
+#include <stdexcept>
+
+namespace copilot
+{
+
+// =============================================================================
+// Text
+// =============================================================================
+
+std::string StreamAssembler::Text::str() const
+{
+    std::string result;
+    result.reserve(size_);
+    for (auto chunk : chunks_)
+        result.append(chunk.data(), chunk.size());
+    return result;
+}
+
+// =============================================================================
+// Constructor
+// =============================================================================
+
+StreamAssembler::StreamAssembler() : StreamAssembler(Options{}) {}
+
+StreamAssembler::StreamAssembler(Options options) : options_(options)
+{
+    if (options_.block_size == 0)
+        throw std::invalid_argument("StreamAssembler block_size must be positive");
+}
+
+// =============================================================================
+// Feeding
+// =============================================================================
+
+void StreamAssembler::on_event(const SessionEvent& event)
+{
+    if (const auto* delta = event.try_as<AssistantMessageDeltaData>())
+        append(delta->message_id, delta->delta_content);
+    else if (const auto* message = event.try_as<AssistantMessageData>())
+        complete(message->message_id);
+    else if (event.type == SessionEventType::SessionIdle ||
+             event.type == SessionEventType::SessionError || event.type == SessionEventType::Abort)
+        complete_all();
+}
+
+std::shared_ptr<StreamAssembler::Block> StreamAssembler::acquire_block()
+{
+    if (!pool_.empty())
+    {
+        auto block = std::move(pool_.back());
+        pool_.pop_back();
+        return block;
+    }
+    return std::make_shared<Block>(options_.block_size, live_blocks_);
+}
+
+void StreamAssembler::release_blocks(Message& message)
+{
+    // Recycle blocks nobody else references; blocks still held by a Text are
+    // freed when that Text goes away
+    for (auto& block : message.blocks)
+        if (block.use_count() == 1 && pool_.size() < options_.max_pooled_blocks)
+            pool_.push_back(std::move(block));
+    message.blocks.clear();
+}
+
+void StreamAssembler::append(const std::string& message_id, std::string_view delta)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!last_message_ || last_id_ != message_id)
+    {
+        last_message_ = &messages_[message_id];
+        last_id_ = message_id;
+    }
+    auto& message = *last_message_;
+
+    ++deltas_appended_;
+    bytes_appended_ += delta.size();
+
+    // Readers may be viewing bytes below message.size; we only write above it
+    const std::size_t block_size = options_.block_size;
+    while (!delta.empty())
+    {
+        std::size_t offset = message.size % block_size;
+        if (offset == 0 && message.size / block_size == message.blocks.size())
+            message.blocks.push_back(acquire_block());
+
+        std::size_t n = std::min(delta.size(), block_size - offset);
+        std::memcpy(message.blocks.back()->data.get() + offset, delta.data(), n);
+        message.size += n;
+        delta.remove_prefix(n);
+    }
+}
+
+void StreamAssembler::complete(const std::string& message_id)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = messages_.find(message_id);
+    if (it == messages_.end())
+        return;
+
+    release_blocks(it->second);
+    if (last_message_ == &it->second)
+        last_message_ = nullptr;
+    messages_.erase(it);
+    ++messages_completed_;
+}
+
+void StreamAssembler::complete_all()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto& [id, message] : messages_)
+        release_blocks(message);
+    messages_abandoned_ += messages_.size();
+    messages_.clear();
+    last_message_ = nullptr;
+}
+
+// =============================================================================
+// Reading
+// =============================================================================
+
+StreamAssembler::Text
+StreamAssembler::make_text(const Message& message, std::size_t from, std::size_t to) const
+{
+    Text text;
+    const std::size_t block_size = options_.block_size;
+    for (std::size_t pos = from; pos < to;)
+    {
+        std::size_t index = pos / block_size;
+        std::size_t offset = pos % block_size;
+        std::size_t n = std::min(to - pos, block_size - offset);
+
+        const auto& block = message.blocks[index];
+        text.chunks_.emplace_back(block->data.get() + offset, n);
+        text.blocks_.push_back(block);
+        pos += n;
+    }
+    text.size_ = to - from;
+    return text;
+}
+
+StreamAssembler::Text StreamAssembler::snapshot(const std::string& message_id) const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = messages_.find(message_id);
+    if (it == messages_.end())
+        return Text{};
+    return make_text(it->second, 0, it->second.size);
+}
+
+StreamAssembler::Text StreamAssembler::read_new(const std::string& message_id)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = messages_.find(message_id);
+    if (it == messages_.end())
+        return Text{};
+
+    auto& message = it->second;
+    auto text = make_text(message, message.read_offset, message.size);
+    message.read_offset = message.size;
+    return text;
+}
+
+std::size_t StreamAssembler::size(const std::string& message_id) const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = messages_.find(message_id);
+    return it != messages_.end() ? it->second.size : 0;
+}
+
+std::vector<std::string> StreamAssembler::in_flight_messages() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::vector<std::string> ids;
+    ids.reserve(messages_.size());
+    for (const auto& [id, message] : messages_)
+        ids.push_back(id);
+    return ids;
+}
+
+StreamAssemblerStats StreamAssembler::stats() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    StreamAssemblerStats stats;
+    stats.deltas_appended = deltas_appended_;
+    stats.bytes_appended = bytes_appended_;
+    stats.messages_completed = messages_completed_;
+    stats.messages_abandoned = messages_abandoned_;
+    stats.in_flight_messages = messages_.size();
+    stats.allocated_blocks = live_blocks_->load(std::memory_order_relaxed);
+    stats.pooled_blocks = pool_.size();
+    stats.allocated_bytes = stats.allocated_blocks * options_.block_size;
+    return stats;
+}
+
+} // namespace copilot
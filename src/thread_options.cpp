@@ -0,0 +1,133 @@
+// Copyright (c) 2025 Elias Bachaalany
+// SPDX-License-Identifier: MIT
+
+#include <copilot/thread_options.hpp>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace copilot
+{
+
+const char* thread_role_name(ThreadRole role)
+{
+    switch (role)
+    {
+    case ThreadRole::RpcReader:
+        return "copilot-rpc-rd";
+    case ThreadRole::RpcTimer:
+        return "copilot-rpc-tm";
+    case ThreadRole::LogDrain:
+        return "copilot-stderr";
+    case ThreadRole::ExitWatcher:
+        return "copilot-exit";
+    case ThreadRole::Supervisor:
+        return "copilot-superv";
+    }
+    return "copilot";
+}
+
+bool set_current_thread_name(const std::string& name)
+{
+#if defined(__linux__)
+    // Linux limits names to 15 characters plus the terminator
+    return pthread_setname_np(pthread_self(), name.substr(0, 15).c_str()) == 0;
+#elif defined(__APPLE__)
+    return pthread_setname_np(name.c_str()) == 0;
+#elif defined(_WIN32)
+    std::wstring wide(name.begin(), name.end());
+    return SUCCEEDED(SetThreadDescription(GetCurrentThread(), wide.c_str()));
+#else
+    (void)name;
+    return false;
+#endif
+}
+
+bool apply_thread_config(const ThreadConfig& config)
+{
+    bool ok = true;
+
+    if (!config.cpus.empty())
+    {
+#if defined(__linux__)
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        for (int cpu : config.cpus)
+        {
+            if (cpu >= 0 && cpu < CPU_SETSIZE)
+                CPU_SET(cpu, &set);
+        }
+        ok &= pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#elif defined(_WIN32)
+        DWORD_PTR mask = 0;
+        for (int cpu : config.cpus)
+        {
+            if (cpu >= 0 && cpu < static_cast<int>(sizeof(DWORD_PTR) * 8))
+                mask |= DWORD_PTR(1) << cpu;
+        }
+        ok &= mask != 0 && SetThreadAffinityMask(GetCurrentThread(), mask) != 0;
+#else
+        ok = false; // No thread affinity API (e.g. macOS)
+#endif
+    }
+
+#ifndef _WIN32
+    if (config.policy != SchedulingPolicy::Inherit)
+    {
+        int policy = SCHED_OTHER;
+        switch (config.policy)
+        {
+#ifdef SCHED_BATCH
+        case SchedulingPolicy::Batch:
+            policy = SCHED_BATCH;
+            break;
+#endif
+#ifdef SCHED_IDLE
+        case SchedulingPolicy::Idle:
+            policy = SCHED_IDLE;
+            break;
+#endif
+        case SchedulingPolicy::Fifo:
+            policy = SCHED_FIFO;
+            break;
+        case SchedulingPolicy::RoundRobin:
+            policy = SCHED_RR;
+            break;
+        default:
+            break;
+        }
+        sched_param param{};
+        if (policy == SCHED_FIFO || policy == SCHED_RR)
+            param.sched_priority = config.priority;
+        ok &= pthread_setschedparam(pthread_self(), policy, &param) == 0;
+    }
+#else
+    ok &= config.policy == SchedulingPolicy::Inherit;
+#endif
+
+    return ok;
+}
+
+bool configure_current_thread(const ThreadOptions& options, ThreadRole role)
+{
+    bool ok = true;
+    if (options.name_threads)
+        ok &= set_current_thread_name(thread_role_name(role));
+
+    auto it = options.roles.find(role);
+    if (it != options.roles.end())
+        ok &= apply_thread_config(it->second);
+    return ok;
+}
+
+} // namespace copilot
@@ -0,0 +1,372 @@
+// Copyright (c) 2025 Elias Bachaalany
+// SPDX-License-Identifier: MIT
+
+#include <copilot/turn_profiler.hpp>
+#include <mutex>
+#include <unordered_map>
+
+namespace copilot
+{
+
+namespace
+{
+
+std::chrono::microseconds elapsed_between(
+    std::chrono::steady_clock::time_point from, std::chrono::steady_clock::time_point to
+)
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(to - from);
+}
+
+double per_second(double amount, std::chrono::microseconds over)
+{
+    if (over.count() <= 0)
+        return 0;
+    return amount * 1e6 / static_cast<double>(over.count());
+}
+
+} // namespace
+
+// =============================================================================
+// TurnRecord
+// =============================================================================
+
+std::chrono::microseconds TurnRecord::callback_time(SessionCallbackKind kind) const
+{
+    std::chrono::microseconds total{0};
+    for (const auto& callback : callbacks)
+        if (callback.kind == kind)
+            total += callback.elapsed;
+    return total;
+}
+
+size_t TurnRecord::callback_count(SessionCallbackKind kind) const
+{
+    size_t count = 0;
+    for (const auto& callback : callbacks)
+        if (callback.kind == kind)
+            ++count;
+    return count;
+}
+
+double TurnRecord::delta_bytes_per_second() const
+{
+    return per_second(static_cast<double>(delta_bytes), streaming_time);
+}
+
+double TurnRecord::output_tokens_per_second() const
+{
+    return per_second(output_tokens, api_time.count() > 0 ? api_time : streaming_time);
+}
+
+// =============================================================================
+// State shared with the session subscriptions
+// =============================================================================
+
+struct TurnProfiler::State
+{
+    struct Attached
+    {
+        Subscription events;
+        Subscription timing;
+        std::optional<TurnRecord> open;
+        std::chrono::steady_clock::time_point first_delta;
+    };
+
+    explicit State(Options opts) : options(std::move(opts)) {}
+
+    void on_turn_sent(const std::string& session_id, std::chrono::steady_clock::time_point at);
+    void on_turn_failed(const std::string& session_id, const std::string& error);
+    void on_callback(
+        const std::string& session_id,
+        SessionCallbackKind kind,
+        const std::string& name,
+        std::chrono::microseconds elapsed
+    );
+    void on_event(const std::string& session_id, const SessionEvent& event);
+    void close_turn(Attached& attached, std::chrono::steady_clock::time_point at);
+    void report(const std::optional<TurnRecord>& closed) const;
+
+    const Options options;
+
+    mutable std::mutex mutex;
+    std::unordered_map<std::string, Attached> sessions;
+    std::deque<TurnRecord> records;
+    TurnProfileSummary summary;
+};
+
+void TurnProfiler::State::on_turn_sent(
+    const std::string& session_id, std::chrono::steady_clock::time_point at
+)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = sessions.find(session_id);
+    if (it == sessions.end() || it->second.open)
+        return;
+
+    TurnRecord record;
+    record.session_id = session_id;
+    record.sent_at = at;
+    it->second.open = std::move(record);
+}
+
+void TurnProfiler::State::on_turn_failed(const std::string& session_id, const std::string& error)
+{
+    auto now = std::chrono::steady_clock::now();
+    std::optional<TurnRecord> closed;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = sessions.find(session_id);
+        if (it == sessions.end() || !it->second.open)
+            return;
+
+        // Closed now, so the next turn does not inherit this one's sent_at
+        it->second.open->failed = true;
+        it->second.open->error_message = error;
+        close_turn(it->second, now);
+        if (options.on_turn)
+            closed = records.back();
+    }
+    report(closed);
+}
+
+void TurnProfiler::State::on_callback(
+    const std::string& session_id,
+    SessionCallbackKind kind,
+    const std::string& name,
+    std::chrono::microseconds elapsed
+)
+{
+    auto now = std::chrono::steady_clock::now();
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = sessions.find(session_id);
+    if (it == sessions.end() || !it->second.open)
+        return;
+
+    auto& record = *it->second.open;
+    record.callbacks.push_back(
+        TurnCallbackTiming{kind, name, elapsed_between(record.sent_at, now), elapsed}
+    );
+}
+
+void TurnProfiler::State::on_event(const std::string& session_id, const SessionEvent& event)
+{
+    auto now = std::chrono::steady_clock::now();
+    std::optional<TurnRecord> closed;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = sessions.find(session_id);
+        if (it == sessions.end() || !it->second.open)
+            return;
+
+        auto& attached = it->second;
+        auto& record = *attached.open;
+        if (const auto* start = event.try_as<AssistantTurnStartData>())
+        {
+            if (!record.time_to_turn_start)
+            {
+                record.turn_id = start->turn_id;
+                record.time_to_turn_start = elapsed_between(record.sent_at, now);
+            }
+        }
+        else if (const auto* delta = event.try_as<AssistantMessageDeltaData>())
+        {
+            if (record.delta_count == 0)
+            {
+                attached.first_delta = now;
+                record.time_to_first_delta = elapsed_between(record.sent_at, now);
+            }
+            record.delta_count++;
+            record.delta_bytes += delta->delta_content.size();
+            record.streaming_time = elapsed_between(attached.first_delta, now);
+        }
+        else if (const auto* usage = event.try_as<AssistantUsageData>())
+        {
+            record.model_calls++;
+            record.input_tokens += usage->input_tokens.value_or(0);
+            record.output_tokens += usage->output_tokens.value_or(0);
+            record.cache_read_tokens += usage->cache_read_tokens.value_or(0);
+            if (usage->duration) // milliseconds
+                record.api_time += std::chrono::microseconds(
+                    static_cast<int64_t>(*usage->duration * 1000.0)
+                );
+        }
+        else if (event.type == SessionEventType::SessionIdle ||
+                 event.type == SessionEventType::SessionError)
+        {
+            if (const auto* error = event.try_as<SessionErrorData>())
+            {
+                record.failed = true;
+                record.error_message = error->message;
+            }
+            close_turn(attached, now);
+            if (options.on_turn)
+                closed = records.back();
+        }
+    }
+    report(closed);
+}
+
+void TurnProfiler::State::report(const std::optional<TurnRecord>& closed) const
+{
+    if (!closed)
+        return;
+    try
+    {
+        options.on_turn(*closed);
+    }
+    catch (...)
+    {
+        // Same policy as event handlers
+    }
+}
+
+void TurnProfiler::State::close_turn(Attached& attached, std::chrono::steady_clock::time_point at)
+{
+    auto record = std::move(*attached.open);
+    attached.open.reset();
+    record.duration = elapsed_between(record.sent_at, at);
+
+    summary.turns++;
+    if (record.failed)
+        summary.failed_turns++;
+    if (record.time_to_turn_start)
+        summary.time_to_turn_start.record(*record.time_to_turn_start);
+    if (record.time_to_first_delta)
+        summary.time_to_first_delta.record(*record.time_to_first_delta);
+    summary.turn_duration.record(record.duration);
+    if (record.delta_count > 0)
+        summary.streaming_time.record(record.streaming_time);
+
+    for (const auto& callback : record.callbacks)
+    {
+        switch (callback.kind)
+        {
+        case SessionCallbackKind::Tool:
+            summary.tool_time.record(callback.elapsed);
+            summary.tools[callback.name].record(callback.elapsed);
+            break;
+        case SessionCallbackKind::Permission:
+            summary.permission_time.record(callback.elapsed);
+            break;
+        case SessionCallbackKind::UserInput:
+            summary.user_input_time.record(callback.elapsed);
+            break;
+        case SessionCallbackKind::Hook:
+            summary.hook_time.record(callback.elapsed);
+            break;
+        }
+    }
+
+    summary.input_tokens += record.input_tokens;
+    summary.output_tokens += record.output_tokens;
+    summary.cache_read_tokens += record.cache_read_tokens;
+
+    records.push_back(std::move(record));
+    while (records.size() > options.max_records)
+        records.pop_front();
+}
+
+// =============================================================================
+// TurnProfiler
+// =============================================================================
+
+TurnProfiler::TurnProfiler() : TurnProfiler(Options{}) {}
+
+TurnProfiler::TurnProfiler(Options options)
+    : state_(std::make_shared<State>(std::move(options)))
+{
+}
+
+TurnProfiler::~TurnProfiler()
+{
+    // Unsubscribe outside the lock; the session may be delivering an event
+    std::unordered_map<std::string, State::Attached> sessions;
+    {
+        std::lock_guard<std::mutex> lock(state_->mutex);
+        sessions.swap(state_->sessions);
+    }
+}
+
+void TurnProfiler::attach(const std::shared_ptr<Session>& session)
+{
+    const std::string session_id = session->session_id();
+    {
+        std::lock_guard<std::mutex> lock(state_->mutex);
+        if (!state_->sessions.try_emplace(session_id).second)
+            return;
+    }
+
+    std::weak_ptr<State> weak_state = state_;
+    auto events = session->on(
+        {SessionEventType::AssistantTurnStart,
+         SessionEventType::AssistantMessageDelta,
+         SessionEventType::AssistantUsage,
+         SessionEventType::SessionIdle,
+         SessionEventType::SessionError},
+        [weak_state, session_id](const SessionEvent& event)
+        {
+            if (auto state = weak_state.lock())
+                state->on_event(session_id, event);
+        }
+    );
+
+    SessionTimingObserver observer;
+    observer.on_turn_sent = [weak_state, session_id](std::chrono::steady_clock::time_point at)
+    {
+        if (auto state = weak_state.lock())
+            state->on_turn_sent(session_id, at);
+    };
+    observer.on_turn_failed = [weak_state, session_id](const std::string& error)
+    {
+        if (auto state = weak_state.lock())
+            state->on_turn_failed(session_id, error);
+    };
+    observer.on_callback = [weak_state, session_id](
+                               SessionCallbackKind kind,
+                               const std::string& name,
+                               std::chrono::microseconds elapsed
+                           )
+    {
+        if (auto state = weak_state.lock())
+            state->on_callback(session_id, kind, name, elapsed);
+    };
+    auto timing = session->observe_timing(std::move(observer));
+
+    std::lock_guard<std::mutex> lock(state_->mutex);
+    auto it = state_->sessions.find(session_id);
+    if (it == state_->sessions.end())
+        return; // Detached meanwhile; the subscriptions end on return
+    it->second.events = std::move(events);
+    it->second.timing = std::move(timing);
+}
+
+void TurnProfiler::detach(const std::string& session_id)
+{
+    std::unordered_map<std::string, State::Attached>::node_type node;
+    {
+        std::lock_guard<std::mutex> lock(state_->mutex);
+        node = state_->sessions.extract(session_id);
+    }
+}
+
+std::vector<TurnRecord> TurnProfiler::records() const
+{
+    std::lock_guard<std::mutex> lock(state_->mutex);
+    return {state_->records.begin(), state_->records.end()};
+}
+
+TurnProfileSummary TurnProfiler::summary() const
+{
+    std::lock_guard<std::mutex> lock(state_->mutex);
+    return state_->summary;
+}
+
+void TurnProfiler::reset()
+{
+    std::lock_guard<std::mutex> lock(state_->mutex);
+    state_->records.clear();
+    state_->summary = TurnProfileSummary{};
+}
+
+} // namespace copilot
@@ -2,8 +2,18 @@
 // SPDX-License-Identifier: MIT
 
 #include <copilot/client.hpp>
+#include <copilot/node_startup.hpp>
 #include <copilot/session.hpp>
+#include <copilot/turn_profiler.hpp>
+#include <filesystem>
+#include <fstream>
 #include <gtest/gtest.h>
+#include <sstream>
+#include <thread>
+
+#ifndef _WIN32
+#include <signal.h>
+#endif
 
 using namespace copilot;
 
@@ -826,3 +836,1981 @@ TEST(ClientOptions, AuthDefaultWithoutToken)
     // use_logged_in_user should default to true without token
     EXPECT_EQ(client.state(), ConnectionState::Disconnected);
 }
+
+// =============================================================================
+// Session Event Dispatch Tests
+// =============================================================================
+
+namespace
+{
+
+SessionEvent make_test_event(SessionEventType type, const std::string& id = "evt-1")
+{
+    SessionEvent event;
+    event.id = id;
+    event.timestamp = "2025-01-01T00:00:00Z";
+    event.type = type;
+    if (type == SessionEventType::SessionIdle)
+        event.data = SessionIdleData{};
+    else
+        event.data = json::object();
+    return event;
+}
+
+} // namespace
+
+TEST(SessionDispatchTest, DispatchReachesAllHandlers)
+{
+    auto session = std::make_shared<Session>("sess-1", nullptr);
+
+    int count_a = 0;
+    int count_b = 0;
+    auto sub_a = session->on([&](const SessionEvent&) { count_a++; });
+    auto sub_b = session->on([&](const SessionEvent&) { count_b++; });
+
+    session->dispatch_event(make_test_event(SessionEventType::SessionIdle));
+    session->dispatch_event(make_test_event(SessionEventType::SessionIdle));
+
+    EXPECT_EQ(count_a, 2);
+    EXPECT_EQ(count_b, 2);
+}
+
+TEST(SessionDispatchTest, UnsubscribeStopsDelivery)
+{
+    auto session = std::make_shared<Session>("sess-1", nullptr);
+
+    int count = 0;
+    auto sub = session->on([&](const SessionEvent&) { count++; });
+    session->dispatch_event(make_test_event(SessionEventType::SessionIdle));
+    sub.unsubscribe();
+    session->dispatch_event(make_test_event(SessionEventType::SessionIdle));
+
+    EXPECT_EQ(count, 1);
+}
+
+TEST(SessionDispatchTest, HandlerCanUnsubscribeDuringDispatch)
+{
+    auto session = std::make_shared<Session>("sess-1", nullptr);
+
+    int count = 0;
+    Subscription sub;
+    sub = session->on(
+        [&](const SessionEvent&)
+        {
+            count++;
+            sub.unsubscribe();
+        }
+    );
+
+    session->dispatch_event(make_test_event(SessionEventType::SessionIdle));
+    session->dispatch_event(make_test_event(SessionEventType::SessionIdle));
+
+    EXPECT_EQ(count, 1);
+}
+
+TEST(SessionDispatchTest, SubscribeDuringDispatchAppliesToNextEvent)
+{
+    auto session = std::make_shared<Session>("sess-1", nullptr);
+
+    int late_count = 0;
+    std::vector<Subscription> late_subs;
+    auto sub = session->on(
+        [&](const SessionEvent&)
+        {
+            if (late_subs.empty())
+                late_subs.push_back(session->on([&](const SessionEvent&) { late_count++; }));
+        }
+    );
+
+    session->dispatch_event(make_test_event(SessionEventType::SessionIdle));
+    EXPECT_EQ(late_count, 0);
+
+    session->dispatch_event(make_test_event(SessionEventType::SessionIdle));
+    EXPECT_EQ(late_count, 1);
+}
+
+TEST(SessionDispatchTest, ThrowingHandlerDoesNotBreakOthers)
+{
+    auto session = std::make_shared<Session>("sess-1", nullptr);
+
+    int count = 0;
+    auto sub_a = session->on([](const SessionEvent&) { throw std::runtime_error("boom"); });
+    auto sub_b = session->on([&](const SessionEvent&) { count++; });
+
+    session->dispatch_event(make_test_event(SessionEventType::SessionIdle));
+    EXPECT_EQ(count, 1);
+}
+
+TEST(SessionDispatchTest, SubscriptionOutlivesSession)
+{
+    int count = 0;
+    Subscription sub;
+    {
+        auto session = std::make_shared<Session>("sess-1", nullptr);
+        sub = session->on([&](const SessionEvent&) { count++; });
+        session->dispatch_event(make_test_event(SessionEventType::SessionIdle));
+    }
+    // Unsubscribing after the session is gone must be a no-op
+    sub.unsubscribe();
+    EXPECT_EQ(count, 1);
+}
+
+TEST(SessionDispatchTest, TypedSubscriptionOnlySeesItsType)
+{
+    auto session = std::make_shared<Session>("sess-1", nullptr);
+
+    std::string text;
+    auto sub = session->on<AssistantMessageDeltaData>(
+        [&](const AssistantMessageDeltaData& delta) { text += delta.delta_content; }
+    );
+
+    SessionEvent delta;
+    delta.id = "evt-1";
+    delta.type = SessionEventType::AssistantMessageDelta;
+    delta.data = AssistantMessageDeltaData{"msg-1", "Hel", std::nullopt, std::nullopt};
+    session->dispatch_event(delta);
+    delta.data = AssistantMessageDeltaData{"msg-1", "lo", std::nullopt, std::nullopt};
+    session->dispatch_event(delta);
+    session->dispatch_event(make_test_event(SessionEventType::SessionIdle));
+
+    EXPECT_EQ(text, "Hello");
+}
+
+TEST(SessionDispatchTest, TypedSubscriptionWithEventArgument)
+{
+    auto session = std::make_shared<Session>("sess-1", nullptr);
+
+    std::string seen_id;
+    auto sub = session->on<SessionIdleData>(
+        [&](const SessionEvent& evt, const SessionIdleData&) { seen_id = evt.id; }
+    );
+
+    session->dispatch_event(make_test_event(SessionEventType::SessionIdle, "evt-42"));
+    EXPECT_EQ(seen_id, "evt-42");
+}
+
+TEST(SessionDispatchTest, TypeListSubscription)
+{
+    auto session = std::make_shared<Session>("sess-1", nullptr);
+
+    std::vector<SessionEventType> seen;
+    auto sub = session->on(
+        {SessionEventType::SessionIdle, SessionEventType::SessionError},
+        [&](const SessionEvent& evt) { seen.push_back(evt.type); }
+    );
+
+    session->dispatch_event(make_test_event(SessionEventType::AssistantTurnStart));
+    session->dispatch_event(make_test_event(SessionEventType::SessionError));
+    session->dispatch_event(make_test_event(SessionEventType::SessionIdle));
+
+    ASSERT_EQ(seen.size(), 2u);
+    EXPECT_EQ(seen[0], SessionEventType::SessionError);
+    EXPECT_EQ(seen[1], SessionEventType::SessionIdle);
+}
+
+TEST(SessionDispatchTest, RegistrationOrderPreservedAcrossFilters)
+{
+    auto session = std::make_shared<Session>("sess-1", nullptr);
+
+    std::vector<int> order;
+    auto sub_a = session->on([&](const SessionEvent&) { order.push_back(1); });
+    auto sub_b = session->on<SessionIdleData>([&](const SessionIdleData&) { order.push_back(2); });
+    auto sub_c = session->on([&](const SessionEvent&) { order.push_back(3); });
+
+    session->dispatch_event(make_test_event(SessionEventType::SessionIdle));
+    EXPECT_EQ(order, (std::vector<int>{1, 2, 3}));
+}
+
+TEST(SessionDispatchTest, SubscribedEventTypesTracksSubscriptions)
+{
+    auto session = std::make_shared<Session>("sess-1", nullptr);
+    EXPECT_EQ(session->subscribed_event_types(), 0u);
+    EXPECT_FALSE(session->has_subscribers(SessionEventType::AssistantMessageDelta));
+
+    auto typed = session->on<AssistantMessageData>([](const AssistantMessageData&) {});
+    EXPECT_TRUE(session->has_subscribers(SessionEventType::AssistantMessage));
+    EXPECT_FALSE(session->has_subscribers(SessionEventType::AssistantMessageDelta));
+
+    {
+        auto wildcard = session->on([](const SessionEvent&) {});
+        EXPECT_EQ(session->subscribed_event_types(), kAllSessionEventTypes);
+    }
+    EXPECT_EQ(
+        session->subscribed_event_types(),
+        session_event_type_bit(SessionEventType::AssistantMessage)
+    );
+
+    typed.unsubscribe();
+    EXPECT_EQ(session->subscribed_event_types(), 0u);
+}
+
+// =============================================================================
+// EventStream Tests
+// =============================================================================
+
+namespace
+{
+
+SessionEvent make_delta_event(
+    const std::string& id, const std::string& message_id, const std::string& text
+)
+{
+    SessionEvent event;
+    event.id = id;
+    event.type = SessionEventType::AssistantMessageDelta;
+    event.data = AssistantMessageDeltaData{message_id, text, std::nullopt, std::nullopt};
+    return event;
+}
+
+} // namespace
+
+TEST(EventStreamTest, SessionEventsArriveInOrder)
+{
+    auto session = std::make_shared<Session>("sess-1", nullptr);
+    auto stream = session->open_stream(8);
+
+    session->dispatch_event(make_test_event(SessionEventType::AssistantTurnStart, "e1"));
+    session->dispatch_event(make_test_event(SessionEventType::SessionIdle, "e2"));
+
+    EXPECT_EQ(stream->size(), 2u);
+    auto first = stream->try_pop();
+    auto second = stream->try_pop();
+    ASSERT_TRUE(first.has_value());
+    ASSERT_TRUE(second.has_value());
+    EXPECT_EQ(first->id, "e1");
+    EXPECT_EQ(second->id, "e2");
+    EXPECT_FALSE(stream->try_pop().has_value());
+}
+
+TEST(EventStreamTest, PopTimesOutWhenEmpty)
+{
+    EventStream stream(4);
+    auto start = std::chrono::steady_clock::now();
+    EXPECT_FALSE(stream.pop(std::chrono::milliseconds(20)).has_value());
+    EXPECT_GE(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(15));
+}
+
+TEST(EventStreamTest, PopWakesOnPush)
+{
+    EventStream stream(4);
+    std::thread producer(
+        [&]
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            stream.push(make_test_event(SessionEventType::SessionIdle, "late"));
+        }
+    );
+
+    auto event = stream.pop(std::chrono::seconds(5));
+    producer.join();
+    ASSERT_TRUE(event.has_value());
+    EXPECT_EQ(event->id, "late");
+}
+
+TEST(EventStreamTest, PopNDrainsBatch)
+{
+    EventStream stream(16);
+    for (int i = 0; i < 10; ++i)
+        stream.push(make_test_event(SessionEventType::SessionIdle, "e" + std::to_string(i)));
+
+    std::vector<SessionEvent> batch;
+    EXPECT_EQ(stream.pop_n(batch, 4), 4u);
+    EXPECT_EQ(stream.pop_n(batch, 100), 6u);
+    ASSERT_EQ(batch.size(), 10u);
+    EXPECT_EQ(batch.front().id, "e0");
+    EXPECT_EQ(batch.back().id, "e9");
+}
+
+TEST(EventStreamTest, DropOldestKeepsNewest)
+{
+    EventStream stream(3, StreamOverflowPolicy::DropOldest);
+    for (int i = 0; i < 5; ++i)
+        stream.push(make_test_event(SessionEventType::SessionIdle, "e" + std::to_string(i)));
+
+    EXPECT_EQ(stream.size(), 3u);
+    EXPECT_EQ(stream.dropped_events(), 2u);
+    EXPECT_EQ(stream.try_pop()->id, "e2");
+}
+
+TEST(EventStreamTest, CoalesceDeltasWhenFull)
+{
+    EventStream stream(2, StreamOverflowPolicy::CoalesceDeltas);
+    stream.push(make_test_event(SessionEventType::AssistantTurnStart, "e0"));
+    stream.push(make_delta_event("e1", "msg-1", "Hel"));
+    stream.push(make_delta_event("e2", "msg-1", "lo"));
+    stream.push(make_delta_event("e3", "msg-1", "!"));
+
+    EXPECT_EQ(stream.size(), 2u);
+    EXPECT_EQ(stream.dropped_events(), 0u);
+    stream.try_pop();
+    auto merged = stream.try_pop();
+    ASSERT_TRUE(merged.has_value());
+    EXPECT_EQ(merged->id, "e3");
+    EXPECT_EQ(merged->as<AssistantMessageDeltaData>().delta_content, "Hello!");
+}
+
+TEST(EventStreamTest, BlockPolicyWaitsForConsumer)
+{
+    EventStream stream(1, StreamOverflowPolicy::Block);
+    stream.push(make_test_event(SessionEventType::SessionIdle, "e0"));
+
+    std::atomic<bool> pushed{false};
+    std::thread producer(
+        [&]
+        {
+            stream.push(make_test_event(SessionEventType::SessionIdle, "e1"));
+            pushed = true;
+        }
+    );
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    EXPECT_FALSE(pushed.load());
+    EXPECT_EQ(stream.try_pop()->id, "e0");
+    producer.join();
+    EXPECT_TRUE(pushed.load());
+    EXPECT_EQ(stream.try_pop()->id, "e1");
+}
+
+TEST(EventStreamTest, CloseReleasesBlockedProducerAndUnsubscribes)
+{
+    auto session = std::make_shared<Session>("sess-1", nullptr);
+    auto stream = session->open_stream(1, StreamOverflowPolicy::Block);
+    EXPECT_TRUE(session->has_subscribers(SessionEventType::SessionIdle));
+
+    session->dispatch_event(make_test_event(SessionEventType::SessionIdle, "e0"));
+    std::thread producer(
+        [&] { session->dispatch_event(make_test_event(SessionEventType::SessionIdle, "e1")); }
+    );
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    session->close_streams();
+    producer.join();
+
+    EXPECT_TRUE(stream->is_closed());
+    EXPECT_FALSE(session->has_subscribers(SessionEventType::SessionIdle));
+    // Events queued before close can still be drained
+    EXPECT_EQ(stream->try_pop()->id, "e0");
+    EXPECT_FALSE(stream->pop(std::chrono::milliseconds(10)).has_value());
+}
+
+TEST(EventStreamTest, ReleasingStreamUnsubscribes)
+{
+    auto session = std::make_shared<Session>("sess-1", nullptr);
+    {
+        auto stream = session->open_stream(4);
+        EXPECT_NE(session->subscribed_event_types(), 0u);
+    }
+    EXPECT_EQ(session->subscribed_event_types(), 0u);
+}
+
+TEST(EventStreamTest, CoalesceThresholdMergesOnlyWhenBehind)
+{
+    EventStreamOptions options;
+    options.capacity = 16;
+    options.coalesce_threshold = 2;
+    EventStream stream(options);
+
+    // Below the threshold every delta gets its own slot
+    stream.push(make_delta_event("e1", "msg-1", "a"));
+    stream.push(make_delta_event("e2", "msg-1", "b"));
+    EXPECT_EQ(stream.size(), 2u);
+
+    // At the threshold consecutive deltas of the same message are merged
+    stream.push(make_delta_event("e3", "msg-1", "c"));
+    stream.push(make_delta_event("e4", "msg-1", "d"));
+    EXPECT_EQ(stream.size(), 2u);
+
+    // A different message (or a non-delta event) is never merged
+    stream.push(make_delta_event("e5", "msg-2", "x"));
+    stream.push(make_test_event(SessionEventType::SessionIdle, "e6"));
+    EXPECT_EQ(stream.size(), 4u);
+
+    auto stats = stream.stats();
+    EXPECT_EQ(stats.pushed_events, 6u);
+    EXPECT_EQ(stats.coalesced_deltas, 2u);
+    EXPECT_EQ(stats.max_depth, 4u);
+
+    std::vector<SessionEvent> batch;
+    stream.pop_n(batch, 10);
+    ASSERT_EQ(batch.size(), 4u);
+    EXPECT_EQ(batch[1].id, "e4");
+    EXPECT_EQ(batch[1].as<AssistantMessageDeltaData>().delta_content, "bcd");
+    EXPECT_EQ(stream.stats().popped_events, 4u);
+}
+
+TEST(EventStreamTest, CoalescesReasoningDeltas)
+{
+    EventStreamOptions options;
+    options.capacity = 4;
+    options.coalesce_threshold = 1;
+    EventStream stream(options);
+
+    for (const char* part : {"think", "ing"})
+    {
+        SessionEvent event;
+        event.id = part;
+        event.type = SessionEventType::AssistantReasoningDelta;
+        event.data = AssistantReasoningDeltaData{"r-1", part};
+        stream.push(event);
+    }
+
+    EXPECT_EQ(stream.coalesced_deltas(), 1u);
+    EXPECT_EQ(stream.try_pop()->as<AssistantReasoningDeltaData>().delta_content, "thinking");
+}
+
+TEST(EventStreamTest, SessionStreamWithOptions)
+{
+    auto session = std::make_shared<Session>("sess-1", nullptr);
+    EventStreamOptions options;
+    options.capacity = 8;
+    options.coalesce_threshold = 1;
+    auto stream = session->open_stream(options);
+
+    session->dispatch_event(make_delta_event("e1", "msg-1", "Hello"));
+    session->dispatch_event(make_delta_event("e2", "msg-1", ", world"));
+
+    EXPECT_EQ(stream->size(), 1u);
+    EXPECT_EQ(stream->coalesced_deltas(), 1u);
+    EXPECT_EQ(stream->try_pop()->as<AssistantMessageDeltaData>().delta_content, "Hello, world");
+}
+
+// =============================================================================
+// StreamAssembler Tests
+// =============================================================================
+
+TEST(StreamAssemblerTest, AppendsAcrossBlockBoundaries)
+{
+    StreamAssembler::Options options;
+    options.block_size = 4;
+    StreamAssembler assembler(options);
+
+    assembler.append("msg-1", "Hello");
+    assembler.append("msg-1", ", world");
+
+    auto text = assembler.snapshot("msg-1");
+    EXPECT_EQ(text.size(), 12u);
+    EXPECT_EQ(text.str(), "Hello, world");
+    ASSERT_EQ(text.chunks().size(), 3u);
+    EXPECT_EQ(text.chunks()[0], "Hell");
+    EXPECT_EQ(text.chunks()[2], "orld");
+    EXPECT_EQ(assembler.stats().allocated_blocks, 3u);
+}
+
+TEST(StreamAssemblerTest, ReadNewReturnsOnlyUnreadText)
+{
+    StreamAssembler assembler;
+    assembler.append("msg-1", "Hel");
+    EXPECT_EQ(assembler.read_new("msg-1").str(), "Hel");
+    EXPECT_TRUE(assembler.read_new("msg-1").empty());
+
+    assembler.append("msg-1", "lo");
+    assembler.append("msg-1", "!");
+    EXPECT_EQ(assembler.read_new("msg-1").str(), "lo!");
+    EXPECT_EQ(assembler.snapshot("msg-1").str(), "Hello!");
+}
+
+TEST(StreamAssemblerTest, CompletionRecyclesBlocks)
+{
+    StreamAssembler::Options options;
+    options.block_size = 8;
+    StreamAssembler assembler(options);
+
+    for (int i = 0; i < 100; ++i)
+    {
+        auto id = "msg-" + std::to_string(i);
+        for (int j = 0; j < 10; ++j)
+            assembler.append(id, "token");
+        assembler.complete(id);
+    }
+
+    auto stats = assembler.stats();
+    EXPECT_EQ(stats.messages_completed, 100u);
+    EXPECT_EQ(stats.in_flight_messages, 0u);
+    EXPECT_EQ(stats.allocated_blocks, 7u); // one message's worth, reused
+    EXPECT_EQ(stats.pooled_blocks, 7u);
+}
+
+TEST(StreamAssemblerTest, ViewsOutliveCompletion)
+{
+    StreamAssembler::Options options;
+    options.block_size = 4;
+    StreamAssembler assembler(options);
+
+    assembler.append("msg-1", "abcdef");
+    auto text = assembler.snapshot("msg-1");
+    assembler.complete("msg-1");
+    assembler.append("msg-2", "zzzzzzzz"); // must not reuse blocks held by text
+
+    EXPECT_EQ(text.str(), "abcdef");
+    EXPECT_TRUE(assembler.snapshot("msg-1").empty());
+    EXPECT_EQ(assembler.stats().allocated_blocks, 4u); // text still holds two
+}
+
+TEST(StreamAssemblerTest, TurnEndReleasesUnfinishedMessages)
+{
+    StreamAssembler::Options options;
+    options.block_size = 4;
+    options.max_pooled_blocks = 0;
+    StreamAssembler assembler(options);
+
+    assembler.append("msg-1", "partial");
+    assembler.append("msg-2", "text");
+    assembler.on_event(make_test_event(SessionEventType::Abort, "e1"));
+
+    auto stats = assembler.stats();
+    EXPECT_EQ(stats.in_flight_messages, 0u);
+    EXPECT_EQ(stats.messages_abandoned, 2u);
+    EXPECT_EQ(stats.allocated_blocks, 0u);
+    EXPECT_TRUE(assembler.snapshot("msg-1").empty());
+}
+
+TEST(StreamAssemblerTest, SessionAssemblerFollowsEvents)
+{
+    auto session = std::make_shared<Session>("sess-1", nullptr);
+    auto assembler = session->stream_assembler();
+    EXPECT_EQ(session->stream_assembler(), assembler);
+
+    session->dispatch_event(make_delta_event("e1", "msg-1", "Hello"));
+    session->dispatch_event(make_delta_event("e2", "msg-2", "Other"));
+    session->dispatch_event(make_delta_event("e3", "msg-1", ", world"));
+    EXPECT_EQ(assembler->snapshot("msg-1").str(), "Hello, world");
+    EXPECT_EQ(assembler->in_flight_messages().size(), 2u);
+
+    SessionEvent done;
+    done.id = "e4";
+    done.type = SessionEventType::AssistantMessage;
+    AssistantMessageData data;
+    data.message_id = "msg-1";
+    data.content = "Hello, world";
+    done.data = data;
+    session->dispatch_event(done);
+
+    EXPECT_EQ(assembler->size("msg-1"), 0u);
+    EXPECT_EQ(assembler->snapshot("msg-2").str(), "Other");
+    EXPECT_EQ(assembler->stats().messages_completed, 1u);
+}
+
+// =============================================================================
+// Turn Tracking Tests
+// =============================================================================
+
+namespace
+{
+
+SessionEvent make_assistant_message(const std::string& id, const std::string& content)
+{
+    SessionEvent event;
+    event.id = id;
+    event.type = SessionEventType::AssistantMessage;
+    AssistantMessageData data;
+    data.message_id = "msg-" + id;
+    data.content = content;
+    event.data = data;
+    return event;
+}
+
+} // namespace
+
+TEST(TurnTrackerTest, IdleResolvesWithLastAssistantMessage)
+{
+    auto session = std::make_shared<Session>("sess-1", nullptr);
+
+    int calls = 0;
+    std::optional<SessionEvent> result;
+    session->wait_for_idle(
+        [&](std::optional<SessionEvent> message, std::exception_ptr error)
+        {
+            EXPECT_FALSE(error);
+            result = std::move(message);
+            calls++;
+        }
+    );
+
+    session->dispatch_event(make_assistant_message("e1", "first"));
+    session->dispatch_event(make_assistant_message("e2", "second"));
+    EXPECT_EQ(calls, 0);
+
+    session->dispatch_event(make_test_event(SessionEventType::SessionIdle, "e3"));
+    session->dispatch_event(make_test_event(SessionEventType::SessionIdle, "e4"));
+    EXPECT_EQ(calls, 1);
+    ASSERT_TRUE(result.has_value());
+    EXPECT_EQ(result->as<AssistantMessageData>().content, "second");
+}
+
+TEST(TurnTrackerTest, SessionErrorFailsTurn)
+{
+    auto session = std::make_shared<Session>("sess-1", nullptr);
+
+    std::exception_ptr failure;
+    session->wait_for_idle([&](std::optional<SessionEvent>, std::exception_ptr error)
+                           { failure = error; });
+
+    SessionEvent event;
+    event.id = "e1";
+    event.type = SessionEventType::SessionError;
+    SessionErrorData data;
+    data.error_type = "model";
+    data.message = "boom";
+    event.data = data;
+    session->dispatch_event(event);
+
+    ASSERT_TRUE(failure);
+    try
+    {
+        std::rethrow_exception(failure);
+    }
+    catch (const std::runtime_error& e)
+    {
+        EXPECT_STREQ(e.what(), "Session error: boom");
+    }
+}
+
+TEST(TurnTrackerTest, FailTurnsResolvesPendingTurnsOnce)
+{
+    auto session = std::make_shared<Session>("sess-1", nullptr);
+
+    int calls = 0;
+    std::exception_ptr failure;
+    session->wait_for_idle(
+        [&](std::optional<SessionEvent>, std::exception_ptr error)
+        {
+            ++calls;
+            failure = error;
+        }
+    );
+
+    session->fail_turns(std::make_exception_ptr(std::runtime_error("Client stopped")));
+    ASSERT_EQ(calls, 1);
+    ASSERT_TRUE(failure);
+    EXPECT_THROW(std::rethrow_exception(failure), std::runtime_error);
+
+    // A late idle finds nothing left to resolve
+    session->dispatch_event(make_test_event(SessionEventType::SessionIdle));
+    EXPECT_EQ(calls, 1);
+}
+
+TEST(TurnTrackerTest, ReleasingSessionFailsTurns)
+{
+    auto session = std::make_shared<Session>("sess-1", nullptr);
+
+    std::exception_ptr failure;
+    session->wait_for_idle([&](std::optional<SessionEvent>, std::exception_ptr error)
+                           { failure = error; });
+    session.reset();
+
+    ASSERT_TRUE(failure);
+    EXPECT_THROW(std::rethrow_exception(failure), std::runtime_error);
+}
+
+TEST(TurnTrackerTest, SubscribersSeeIdleBeforeTurnResolves)
+{
+    auto session = std::make_shared<Session>("sess-1", nullptr);
+
+    std::vector<std::string> order;
+    auto sub = session->on<SessionIdleData>([&](const SessionIdleData&)
+                                            { order.push_back("handler"); });
+    session->wait_for_idle([&](std::optional<SessionEvent>, std::exception_ptr)
+                           { order.push_back("turn"); });
+
+    session->dispatch_event(make_test_event(SessionEventType::SessionIdle));
+    EXPECT_EQ(order, (std::vector<std::string>{"handler", "turn"}));
+}
+
+#if COPILOT_HAS_COROUTINES
+namespace
+{
+
+/// Minimal eagerly started coroutine for driving TurnAwaitable in tests
+struct FireAndForget
+{
+    struct promise_type
+    {
+        FireAndForget get_return_object()
+        {
+            return {};
+        }
+        std::suspend_never initial_suspend() noexcept
+        {
+            return {};
+        }
+        std::suspend_never final_suspend() noexcept
+        {
+            return {};
+        }
+        void return_void() {}
+        void unhandled_exception()
+        {
+            std::terminate();
+        }
+    };
+};
+
+FireAndForget await_idle(std::shared_ptr<Session> session, std::string& out)
+{
+    auto message = co_await TurnAwaitable([&](TurnCallback callback)
+                                          { session->wait_for_idle(std::move(callback)); });
+    out = message ? message->as<AssistantMessageData>().content : "<none>";
+}
+
+} // namespace
+
+TEST(TurnTrackerTest, CoroutineResumesOnIdle)
+{
+    auto session = std::make_shared<Session>("sess-1", nullptr);
+
+    std::string out;
+    await_idle(session, out);
+    EXPECT_TRUE(out.empty());
+
+    session->dispatch_event(make_assistant_message("e1", "done"));
+    session->dispatch_event(make_test_event(SessionEventType::SessionIdle, "e2"));
+    EXPECT_EQ(out, "done");
+}
+#endif
+
+// =============================================================================
+// Event History Tests
+// =============================================================================
+
+TEST(EventHistoryTest, DisabledByDefault)
+{
+    auto session = std::make_shared<Session>("sess-1", nullptr);
+    session->dispatch_event(make_test_event(SessionEventType::SessionIdle, "e1"));
+
+    EXPECT_TRUE(session->history().empty());
+    EXPECT_EQ(session->history_stats().appended_events, 0u);
+}
+
+TEST(EventHistoryTest, EvictsOldestByCount)
+{
+    auto session = std::make_shared<Session>("sess-1", nullptr);
+    EventHistoryOptions options;
+    options.max_events = 3;
+    session->enable_history(options);
+
+    for (int i = 1; i <= 5; ++i)
+        session->dispatch_event(make_delta_event("e" + std::to_string(i), "msg-1", "x"));
+
+    auto events = session->history();
+    ASSERT_EQ(events.size(), 3u);
+    EXPECT_EQ(events.front().id, "e3");
+    EXPECT_EQ(events.back().id, "e5");
+
+    auto stats = session->history_stats();
+    EXPECT_EQ(stats.appended_events, 5u);
+    EXPECT_EQ(stats.evicted_events, 2u);
+    EXPECT_GE(stats.bytes, 3 * sizeof(SessionEvent));
+}
+
+TEST(EventHistoryTest, EvictsOldestByBytes)
+{
+    auto session = std::make_shared<Session>("sess-1", nullptr);
+    EventHistoryOptions options;
+    options.max_events = 0;
+    options.max_bytes = 4096;
+    session->enable_history(options);
+
+    for (int i = 0; i < 10; ++i)
+        session->dispatch_event(
+            make_delta_event("e" + std::to_string(i), "msg-1", std::string(1000, 'x'))
+        );
+
+    auto stats = session->history_stats();
+    EXPECT_LE(stats.bytes, 4096u);
+    EXPECT_GT(stats.events, 0u);
+    EXPECT_LT(stats.events, 4u);
+    EXPECT_EQ(session->history().back().id, "e9");
+}
+
+TEST(EventHistoryTest, HistorySinceReportsGaps)
+{
+    auto session = std::make_shared<Session>("sess-1", nullptr);
+    EventHistoryOptions options;
+    options.max_events = 3;
+    session->enable_history(options);
+    for (int i = 1; i <= 5; ++i)
+        session->dispatch_event(make_delta_event("e" + std::to_string(i), "msg-1", "x"));
+
+    auto tail = session->history_since("e3");
+    ASSERT_TRUE(tail.has_value());
+    ASSERT_EQ(tail->size(), 2u);
+    EXPECT_EQ((*tail)[0].id, "e4");
+    EXPECT_FALSE(session->history_since("e1").has_value()); // evicted
+}
+
+TEST(EventHistoryTest, ReplayThenLive)
+{
+    auto session = std::make_shared<Session>("sess-1", nullptr);
+    session->enable_history();
+    for (int i = 1; i <= 4; ++i)
+        session->dispatch_event(make_delta_event("e" + std::to_string(i), "msg-1", "x"));
+
+    std::vector<std::string> seen;
+    auto sub = session->on([&](const SessionEvent& evt) { seen.push_back(evt.id); }, "e2");
+    session->dispatch_event(make_delta_event("e5", "msg-1", "x"));
+    EXPECT_EQ(seen, (std::vector<std::string>{"e3", "e4", "e5"}));
+
+    std::vector<std::string> all;
+    auto sub_all = session->on([&](const SessionEvent& evt) { all.push_back(evt.id); }, "");
+    EXPECT_EQ(all.size(), 5u);
+
+    // An unknown ID is a gap: live events only
+    std::vector<std::string> after_gap;
+    auto sub_gap = session->on(
+        [&](const SessionEvent& evt) { after_gap.push_back(evt.id); }, "evicted"
+    );
+    session->dispatch_event(make_delta_event("e6", "msg-1", "x"));
+    EXPECT_EQ(after_gap, (std::vector<std::string>{"e6"}));
+}
+
+TEST(EventHistoryTest, ReplayHandlerMayReadHistory)
+{
+    auto session = std::make_shared<Session>("sess-1", nullptr);
+    session->enable_history();
+    session->dispatch_event(make_delta_event("e1", "msg-1", "x"));
+    session->dispatch_event(make_delta_event("e2", "msg-1", "x"));
+
+    std::vector<std::size_t> tails;
+    auto sub = session->on(
+        [&](const SessionEvent& evt) { tails.push_back(session->history_since(evt.id)->size()); },
+        ""
+    );
+    EXPECT_EQ(tails, (std::vector<std::size_t>{1, 0}));
+}
+
+TEST(EventHistoryTest, ReplayWhileDispatchingConcurrently)
+{
+    auto session = std::make_shared<Session>("sess-1", nullptr);
+    session->enable_history();
+
+    std::thread producer(
+        [&]
+        {
+            for (int i = 0; i < 500; ++i)
+                session->dispatch_event(make_delta_event("e" + std::to_string(i), "msg-1", "x"));
+        }
+    );
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    std::vector<std::string> seen;
+    auto sub = session->on([&](const SessionEvent& evt) { seen.push_back(evt.id); }, "");
+    producer.join();
+
+    // Every event after the first replayed one, each exactly once and in order
+    ASSERT_FALSE(seen.empty());
+    auto first = std::stoi(seen.front().substr(1));
+    ASSERT_EQ(seen.size(), static_cast<std::size_t>(500 - first));
+    for (std::size_t i = 0; i < seen.size(); ++i)
+        EXPECT_EQ(seen[i], "e" + std::to_string(first + static_cast<int>(i)));
+}
+
+TEST(EventHistoryTest, GetMessagesSinceServedFromHistory)
+{
+    auto session = std::make_shared<Session>("sess-1", nullptr);
+    session->enable_history();
+
+    session->dispatch_event(make_test_event(SessionEventType::AssistantTurnStart, "e1"));
+    auto delta = make_delta_event("e2", "msg-1", "x");
+    delta.ephemeral = true;
+    session->dispatch_event(delta);
+    session->dispatch_event(make_test_event(SessionEventType::SessionIdle, "e3"));
+
+    // No client: this must not issue an RPC
+    auto future = session->get_messages_since("e1");
+    ASSERT_EQ(future.wait_for(std::chrono::seconds(0)), std::future_status::ready);
+    auto events = future.get();
+    ASSERT_EQ(events.size(), 1u);
+    EXPECT_EQ(events[0].id, "e3");
+}
+
+// =============================================================================
+// Event Journal Tests
+// =============================================================================
+
+namespace
+{
+
+template <typename Pred>
+bool wait_until(Pred pred, std::chrono::milliseconds timeout = std::chrono::seconds(10))
+{
+    auto deadline = std::chrono::steady_clock::now() + timeout;
+    while (!pred())
+    {
+        if (std::chrono::steady_clock::now() > deadline)
+            return false;
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    return true;
+}
+
+/// Fresh, self-deleting directory for a journal
+class TempJournalDir
+{
+  public:
+    explicit TempJournalDir(const std::string& name)
+        : path_(std::filesystem::temp_directory_path() / ("copilot-journal-" + name))
+    {
+        std::filesystem::remove_all(path_);
+    }
+
+    ~TempJournalDir()
+    {
+        std::error_code ec;
+        std::filesystem::remove_all(path_, ec);
+    }
+
+    std::string str() const
+    {
+        return path_.string();
+    }
+
+  private:
+    std::filesystem::path path_;
+};
+
+json make_wire_event(const std::string& id, const std::string& type, json data = json::object())
+{
+    return {{"id", id}, {"timestamp", "2025-06-01T00:00:00Z"}, {"type", type}, {"data", data}};
+}
+
+} // namespace
+
+TEST(EventJournalTest, ReopenReadsBackWithIndexes)
+{
+    TempJournalDir dir("reopen");
+    {
+        auto journal = EventJournal::open(dir.str());
+        journal->append(make_wire_event("e1", "assistant.turn_start", {{"turnId", "t1"}}));
+        journal->append(make_wire_event(
+            "e2", "assistant.message", {{"messageId", "m1"}, {"content", "Hello"}}
+        ));
+        journal->append(make_wire_event("e3", "session.idle"));
+    }
+
+    auto journal = EventJournal::open(dir.str());
+    ASSERT_EQ(journal->size(), 3u);
+    EXPECT_TRUE(journal->contains("e2"));
+
+    auto message = journal->find("e2");
+    ASSERT_TRUE(message.has_value());
+    EXPECT_EQ(message->as<AssistantMessageData>().content, "Hello");
+
+    auto idle = journal->indices_of_type(SessionEventType::SessionIdle);
+    EXPECT_EQ(idle, (std::vector<std::size_t>{2}));
+
+    auto messages = journal->read_types(session_event_type_bit(SessionEventType::AssistantMessage));
+    ASSERT_EQ(messages.size(), 1u);
+    EXPECT_EQ(messages[0].id, "e2");
+
+    auto tail = journal->read_since("e1");
+    ASSERT_EQ(tail.size(), 2u);
+    EXPECT_EQ(tail[1].id, "e3");
+}
+
+TEST(EventJournalTest, SkipsEphemeralEventsByDefault)
+{
+    TempJournalDir dir("ephemeral");
+    auto journal = EventJournal::open(dir.str());
+
+    auto delta = make_wire_event(
+        "e1", "assistant.message_delta", {{"messageId", "m1"}, {"deltaContent", "x"}}
+    );
+    delta["ephemeral"] = true;
+    EXPECT_FALSE(journal->append(delta));
+    EXPECT_TRUE(journal->append(make_wire_event("e2", "session.idle")));
+    EXPECT_EQ(journal->size(), 1u);
+}
+
+TEST(EventJournalTest, RollsOverSegments)
+{
+    TempJournalDir dir("segments");
+    EventJournalOptions options;
+    options.segment_bytes = 256;
+    {
+        auto journal = EventJournal::open(dir.str(), options);
+        for (int i = 0; i < 20; ++i)
+            journal->append(make_wire_event(
+                "e" + std::to_string(i),
+                "assistant.message",
+                {{"messageId", "m"}, {"content", std::string(64, 'a')}}
+            ));
+        EXPECT_GT(journal->stats().segments, 1u);
+    }
+
+    auto journal = EventJournal::open(dir.str(), options);
+    auto events = journal->read_all();
+    ASSERT_EQ(events.size(), 20u);
+    EXPECT_EQ(events.back().id, "e19");
+}
+
+TEST(EventJournalTest, RecoversFromTornTail)
+{
+    TempJournalDir dir("torn");
+    {
+        auto journal = EventJournal::open(dir.str());
+        journal->append(make_wire_event("e1", "session.idle"));
+        journal->append(make_wire_event("e2", "session.idle"));
+    }
+
+    // Simulate a crash in the middle of writing a record
+    std::string segment;
+    for (const auto& entry : std::filesystem::directory_iterator(dir.str()))
+        segment = entry.path().string();
+    {
+        std::ofstream out(segment, std::ios::binary | std::ios::app);
+        out.write("\x20\x00\x00\x00garbage", 11);
+    }
+
+    {
+        auto journal = EventJournal::open(dir.str());
+        EXPECT_EQ(journal->size(), 2u);
+        EXPECT_EQ(journal->stats().recovered_bytes, 11u);
+        journal->append(make_wire_event("e3", "session.idle"));
+    }
+
+    auto journal = EventJournal::open(dir.str());
+    EXPECT_EQ(journal->size(), 3u);
+    EXPECT_EQ(journal->stats().recovered_bytes, 0u);
+    EXPECT_TRUE(journal->find("e3").has_value());
+}
+
+TEST(EventJournalTest, SessionJournalsDispatchedEvents)
+{
+    TempJournalDir dir("session");
+    auto session = std::make_shared<Session>("sess-1", nullptr);
+    session->attach_journal(EventJournal::open(dir.str()));
+
+    auto start = make_wire_event("e1", "assistant.turn_start", {{"turnId", "t1"}});
+    auto idle = make_wire_event("e2", "session.idle");
+    session->dispatch_event(parse_session_event(start), start);
+    session->dispatch_event(parse_session_event(idle), idle);
+
+    EXPECT_EQ(session->journal()->stats().events, 2u);
+    EXPECT_TRUE(wait_until([&] { return session->journal()->stats().syncs >= 1; })); // on idle
+}
+
+TEST(EventJournalTest, FlusherSyncsQuietJournal)
+{
+    TempJournalDir dir("flusher");
+    EventJournalOptions options;
+    options.sync_interval = std::chrono::milliseconds(20);
+    auto journal = EventJournal::open(dir.str(), options);
+
+    // No later append arrives to trigger it: the flusher syncs on its own
+    journal->append(make_wire_event("e1", "session.idle"));
+    EXPECT_TRUE(wait_until([&] { return journal->stats().syncs >= 1; }));
+
+    // Events without an id are kept but not indexed under ""
+    auto anonymous = make_wire_event("", "session.idle");
+    anonymous.erase("id");
+    journal->append(anonymous);
+    journal->append(anonymous);
+    EXPECT_EQ(journal->size(), 3u);
+    EXPECT_FALSE(journal->contains(""));
+    EXPECT_EQ(journal->indices_of_type(SessionEventType::SessionIdle).size(), 3u);
+}
+
+#ifdef __linux__
+TEST(EventJournalTest, JournalsShareOneFlusherThread)
+{
+    auto thread_count = []
+    {
+        std::size_t count = 0;
+        for ([[maybe_unused]] const auto& entry :
+             std::filesystem::directory_iterator("/proc/self/task"))
+            ++count;
+        return count;
+    };
+
+    TempJournalDir dir("shared-flusher");
+    EventJournalOptions options;
+    options.sync_interval = std::chrono::milliseconds(0);
+    auto warm = EventJournal::open((std::filesystem::path(dir.str()) / "warm").string(), options);
+    warm->append(make_wire_event("e0", "session.idle"));
+    ASSERT_TRUE(wait_until([&] { return warm->stats().syncs >= 1; }));
+
+    auto before = thread_count();
+    std::vector<std::shared_ptr<EventJournal>> journals;
+    for (int i = 0; i < 64; ++i)
+    {
+        auto path = std::filesystem::path(dir.str()) / ("j" + std::to_string(i));
+        journals.push_back(EventJournal::open(path.string(), options));
+        journals.back()->append(make_wire_event("e1", "session.idle"));
+    }
+    EXPECT_EQ(thread_count(), before);
+    for (auto& journal : journals)
+        EXPECT_TRUE(wait_until([&] { return journal->stats().syncs >= 1; }));
+}
+#endif
+
+// =============================================================================
+// Event Type Mask Tests
+// =============================================================================
+
+TEST(EventMaskTest, FollowsSubscriptions)
+{
+    auto session = std::make_shared<Session>("sess-1", nullptr);
+    EXPECT_EQ(session->wanted_event_types(), 0u);
+
+    auto sub = session->on<AssistantMessageData>([](const AssistantMessageData&) {});
+    EXPECT_TRUE(session->wants_event_type(SessionEventType::AssistantMessage));
+    EXPECT_FALSE(session->wants_event_type(SessionEventType::AssistantMessageDelta));
+
+    auto all = session->on([](const SessionEvent&) {});
+    EXPECT_EQ(session->wanted_event_types(), kAllSessionEventTypes);
+
+    all.unsubscribe();
+    sub.unsubscribe();
+    EXPECT_EQ(session->wanted_event_types(), 0u);
+}
+
+TEST(EventMaskTest, IncludesInternalConsumers)
+{
+    auto session = std::make_shared<Session>("sess-1", nullptr);
+
+    session->wait_for_idle([](std::optional<SessionEvent>, std::exception_ptr) {});
+    EXPECT_TRUE(session->wants_event_type(SessionEventType::SessionIdle));
+    EXPECT_TRUE(session->wants_event_type(SessionEventType::AssistantMessage));
+    EXPECT_FALSE(session->wants_event_type(SessionEventType::AssistantUsage));
+
+    session->dispatch_event(make_test_event(SessionEventType::SessionIdle));
+    EXPECT_EQ(session->wanted_event_types(), 0u);
+
+    session->enable_history();
+    EXPECT_EQ(session->wanted_event_types(), kAllSessionEventTypes);
+    session->disable_history();
+    EXPECT_EQ(session->wanted_event_types(), 0u);
+}
+
+TEST(EventMaskTest, SkippedEventsAreStillJournaled)
+{
+    TempJournalDir dir("skip");
+    auto session = std::make_shared<Session>("sess-1", nullptr);
+    session->attach_journal(EventJournal::open(dir.str()));
+
+    auto usage = make_wire_event("e1", "assistant.usage", {{"model", "gpt"}});
+    session->skip_event(usage, SessionEventType::AssistantUsage);
+
+    EXPECT_EQ(session->skipped_events(), 1u);
+    EXPECT_TRUE(session->journal()->contains("e1"));
+}
+
+// =============================================================================
+// CLI Supervisor Tests
+// =============================================================================
+
+TEST(RestartPolicyTest, BackoffGrowsExponentiallyAndCaps)
+{
+    RestartPolicy policy;
+    policy.initial_backoff = std::chrono::milliseconds(100);
+    policy.max_backoff = std::chrono::milliseconds(1000);
+    policy.multiplier = 2.0;
+
+    EXPECT_EQ(policy.backoff_for(1), std::chrono::milliseconds(100));
+    EXPECT_EQ(policy.backoff_for(2), std::chrono::milliseconds(200));
+    EXPECT_EQ(policy.backoff_for(4), std::chrono::milliseconds(800));
+    EXPECT_EQ(policy.backoff_for(5), std::chrono::milliseconds(1000));
+    EXPECT_EQ(policy.backoff_for(50), std::chrono::milliseconds(1000));
+}
+
+#ifndef _WIN32
+namespace
+{
+
+/// Writes a /bin/sh stand-in for `copilot --server --stdio` that answers ping,
+/// session.create and session.resume (and session.send, rejecting the prompt
+/// "fail"), records its pid and resumed session ids, and logs one line to stderr
+std::string write_fake_cli(const std::filesystem::path& dir)
+{
+    std::filesystem::create_directories(dir);
+    auto script = dir / "fake-cli.sh";
+    std::ofstream out(script);
+    out << "#!/bin/sh\n"
+        << "DIR='" << dir.string() << "'\n"
+        << R"SH(echo $$ > "$DIR/pid.tmp" && mv "$DIR/pid.tmp" "$DIR/pid"
+echo "[INFO] fake cli $$ listening on stdio" >&2
+len=0
+while IFS= read -r line; do
+  line=$(printf '%s' "$line" | tr -d '\r')
+  case "$line" in
+    Content-Length:*) len=${line#Content-Length: } ;;
+    "")
+      body=$(dd bs=1 count="$len" 2>/dev/null)
+      id=$(printf '%s' "$body" | sed -n 's/.*"id":\([0-9]*\).*/\1/p')
+      method=$(printf '%s' "$body" | sed -n 's/.*"method":"\([^"]*\)".*/\1/p')
+      sid=$(printf '%s' "$body" | sed -n 's/.*"sessionId":"\([^"]*\)".*/\1/p')
+      error=''
+      case "$method" in
+        ping) result='{"message":"pong","protocolVersion":)SH"
+        << kSdkProtocolVersion << R"SH(}' ;;
+        session.create) result='{"sessionId":"fake-session"}' ;;
+        session.resume) echo "$sid" >> "$DIR/resumed"; result="{\"sessionId\":\"$sid\"}" ;;
+        session.send)
+          case "$body" in
+            *'"prompt":"fail"'*) error='{"code":-32603,"message":"send rejected"}' ;;
+            *) result='{"messageId":"fake-message"}' ;;
+          esac ;;
+        *) result='{}' ;;
+      esac
+      if [ -n "$error" ]; then
+        resp="{\"jsonrpc\":\"2.0\",\"id\":$id,\"error\":$error}"
+      else
+        resp="{\"jsonrpc\":\"2.0\",\"id\":$id,\"result\":$result}"
+      fi
+      printf 'Content-Length: %d\r\n\r\n%s' "${#resp}" "$resp" ;;
+  esac
+done
+)SH";
+    out.close();
+    std::filesystem::permissions(
+        script, std::filesystem::perms::owner_all, std::filesystem::perm_options::add
+    );
+    return script.string();
+}
+
+int read_pid(const std::filesystem::path& dir)
+{
+    int pid = 0;
+    std::ifstream(dir / "pid") >> pid;
+    return pid;
+}
+
+} // namespace
+
+TEST(ClientSupervisorTest, RestartsCliAndReattachesSessions)
+{
+    TempJournalDir dir("supervisor-restart");
+    ClientOptions opts;
+    opts.cli_path = write_fake_cli(dir.str());
+    opts.use_logged_in_user = false;
+    opts.restart_policy.initial_backoff = std::chrono::milliseconds(10);
+
+    Client client(opts);
+    client.start().get();
+    auto session = client.create_session().get();
+    ASSERT_EQ(session->session_id(), "fake-session");
+
+    int first_pid = read_pid(dir.str());
+    ASSERT_GT(first_pid, 0);
+    std::filesystem::remove(std::filesystem::path(dir.str()) / "pid");
+    ::kill(first_pid, SIGKILL);
+
+    ASSERT_TRUE(wait_until([&] { return client.restart_stats().restarts == 1; }));
+    EXPECT_EQ(client.state(), ConnectionState::Connected);
+    EXPECT_EQ(client.cli_exit_code(), std::nullopt);
+
+    auto stats = client.restart_stats();
+    EXPECT_EQ(stats.last_exit_code, 128 + SIGKILL);
+    EXPECT_EQ(stats.sessions_reattached, 1u);
+    EXPECT_EQ(stats.reattach_failures, 0u);
+    EXPECT_GT(stats.last_downtime.count(), 0);
+    EXPECT_EQ(stats.total_downtime, stats.last_downtime);
+    EXPECT_TRUE(client.startup_stats().launch_reused);
+
+    std::string resumed;
+    std::ifstream(std::filesystem::path(dir.str()) / "resumed") >> resumed;
+    EXPECT_EQ(resumed, "fake-session");
+    EXPECT_NE(read_pid(dir.str()), first_pid);
+
+    // The new connection serves requests
+    EXPECT_EQ(client.ping("hi").get().protocol_version, kSdkProtocolVersion);
+
+    // stderr of both processes was captured
+    ASSERT_TRUE(wait_until([&] { return client.cli_log().stats().infos == 2; }));
+    EXPECT_NE(client.cli_log().lines().back().text.find("listening on stdio"), std::string::npos);
+
+#if COPILOT_ENABLE_RPC_METRICS
+    // Totals span the restart: two protocol checks plus the explicit ping
+    auto metrics = client.get_rpc_metrics();
+    EXPECT_EQ(metrics.methods.at("ping").responses, 3u);
+    EXPECT_EQ(metrics.methods.at("session.create").requests, 1u);
+    EXPECT_EQ(metrics.methods.at("session.resume").responses, 1u);
+#endif
+    client.force_stop();
+}
+
+TEST(ClientSupervisorTest, SessionCallsFailCleanlyWhileRestarting)
+{
+    TempJournalDir dir("supervisor-mid-restart");
+    ClientOptions opts;
+    opts.cli_path = write_fake_cli(dir.str());
+    opts.use_logged_in_user = false;
+    opts.restart_policy.initial_backoff = std::chrono::milliseconds(20);
+    opts.restart_policy.max_backoff = std::chrono::milliseconds(50);
+    opts.restart_policy.max_restarts = 1000;
+
+    Client client(opts);
+    client.start().get();
+    auto session = client.create_session().get();
+
+    // Respawns die at once, so the supervisor keeps retrying with no connection
+    auto script = std::filesystem::path(dir.str()) / "fake-cli.sh";
+    auto working = std::filesystem::path(dir.str()) / "fake-cli.sh.ok";
+    std::filesystem::copy_file(script, working);
+    std::ofstream(script) << "#!/bin/sh\nexit 3\n";
+    ::kill(read_pid(dir.str()), SIGKILL);
+    ASSERT_TRUE(wait_until([&] { return client.rpc_client() == nullptr; }));
+
+    auto expect_closed = [](auto&& call)
+    {
+        try
+        {
+            call();
+            ADD_FAILURE() << "expected ConnectionClosed";
+        }
+        catch (const JsonRpcError& e)
+        {
+            EXPECT_EQ(e.code(), JsonRpcErrorCode::ConnectionClosed);
+        }
+    };
+    expect_closed([&] { session->send(MessageOptions{"hi"}).get(); });
+    expect_closed([&] { session->abort().get(); });
+    expect_closed([&] { session->get_messages().get(); });
+
+    std::promise<std::exception_ptr> turn;
+    session->send_and_wait(
+        MessageOptions{"hi"},
+        [&](std::optional<SessionEvent>, std::exception_ptr error) { turn.set_value(error); }
+    );
+    auto turn_error = turn.get_future().get();
+    ASSERT_TRUE(turn_error);
+    expect_closed([&] { std::rethrow_exception(turn_error); });
+
+    // Once a respawn sticks, the same session works again
+    std::filesystem::rename(working, script);
+    ASSERT_TRUE(wait_until([&] { return client.state() == ConnectionState::Connected; }));
+    EXPECT_EQ(session->send(MessageOptions{"hi"}).get(), "fake-message");
+    client.force_stop();
+}
+
+TEST(ClientSupervisorTest, GivesUpOnCrashLoop)
+{
+    TempJournalDir dir("supervisor-crash-loop");
+    ClientOptions opts;
+    opts.cli_path = write_fake_cli(dir.str());
+    opts.use_logged_in_user = false;
+    opts.restart_policy.initial_backoff = std::chrono::milliseconds(1);
+    opts.restart_policy.max_restarts = 2;
+
+    Client client(opts);
+    client.start().get();
+
+    for (uint64_t restarts = 1; restarts <= 2; ++restarts)
+    {
+        ASSERT_TRUE(wait_until([&] { return read_pid(dir.str()) > 0; }));
+        int pid = read_pid(dir.str());
+        std::filesystem::remove(std::filesystem::path(dir.str()) / "pid");
+        ::kill(pid, SIGKILL);
+        ASSERT_TRUE(wait_until([&] { return client.restart_stats().restarts == restarts; }));
+    }
+
+    ASSERT_TRUE(wait_until([&] { return read_pid(dir.str()) > 0; }));
+    ::kill(read_pid(dir.str()), SIGKILL);
+    ASSERT_TRUE(wait_until([&] { return client.restart_stats().crash_loop; }));
+    // The state follows the flag once the supervisor has retired the connection
+    EXPECT_TRUE(wait_until([&] { return client.state() == ConnectionState::Error; }));
+    EXPECT_EQ(client.rpc_client(), nullptr);
+    EXPECT_EQ(client.restart_stats().restarts, 2u);
+}
+
+TEST(ClientSupervisorTest, NoRestartWhenDisabledOrStopped)
+{
+    TempJournalDir dir("supervisor-disabled");
+    ClientOptions opts;
+    opts.cli_path = write_fake_cli(dir.str());
+    opts.use_logged_in_user = false;
+    opts.auto_restart = false;
+
+    Client client(opts);
+    client.start().get();
+    ::kill(read_pid(dir.str()), SIGKILL);
+
+    ASSERT_TRUE(wait_until([&] { return client.cli_exit_code().has_value(); }));
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    EXPECT_EQ(client.restart_stats().restarts, 0u);
+    client.stop().get();
+    EXPECT_EQ(client.state(), ConnectionState::Disconnected);
+}
+
+TEST(ClientSupervisorTest, StopAndCliExitFailWaitingTurns)
+{
+    TempJournalDir dir("supervisor-fail-turns");
+    ClientOptions opts;
+    opts.cli_path = write_fake_cli(dir.str());
+    opts.use_logged_in_user = false;
+    opts.auto_restart = false;
+
+    Client client(opts);
+    client.start().get();
+    auto session = client.create_session().get();
+
+    // No timeout: only the CLI exit can end this turn
+    std::atomic<bool> exit_failed{false};
+    session->wait_for_idle([&](std::optional<SessionEvent>, std::exception_ptr error)
+                           { exit_failed = error != nullptr; });
+    ::kill(read_pid(dir.str()), SIGKILL);
+    ASSERT_TRUE(wait_until([&] { return exit_failed.load(); }));
+
+    std::atomic<bool> stop_failed{false};
+    session->wait_for_idle([&](std::optional<SessionEvent>, std::exception_ptr error)
+                           { stop_failed = error != nullptr; });
+    client.force_stop();
+    EXPECT_TRUE(stop_failed);
+}
+
+TEST(ClientSupervisorTest, ExitCallbacksMayQueryTheClient)
+{
+    TempJournalDir dir("supervisor-exit-callback");
+    ClientOptions opts;
+    opts.cli_path = write_fake_cli(dir.str());
+    opts.use_logged_in_user = false;
+    opts.auto_restart = false;
+
+    Client client(opts);
+    client.start().get();
+    auto session = client.create_session().get();
+
+    // The deadline entry is failed either by the read thread or by abort_pending()
+    // on the exit watcher; neither may hold a lock the callback needs
+    std::atomic<bool> called{false};
+    session->wait_for_idle(
+        [&](std::optional<SessionEvent>, std::exception_ptr)
+        {
+            (void)client.cli_exit_code();
+            called = true;
+        },
+        std::chrono::seconds(30)
+    );
+    ::kill(read_pid(dir.str()), SIGKILL);
+
+    ASSERT_TRUE(wait_until([&] { return called.load(); }));
+    ASSERT_TRUE(wait_until([&] { return client.cli_exit_code().has_value(); }));
+    EXPECT_EQ(client.cli_exit_code(), 128 + SIGKILL);
+    client.force_stop();
+}
+
+TEST(ClientSupervisorTest, ReportsCliResourceUsage)
+{
+    TempJournalDir dir("supervisor-usage");
+    ClientOptions opts;
+    opts.cli_path = write_fake_cli(dir.str());
+    opts.use_logged_in_user = false;
+
+    Client client(opts);
+    EXPECT_FALSE(client.get_resource_usage().cli.has_value());
+
+    client.start().get();
+    auto session = client.create_session(SessionConfig{}).get();
+    ASSERT_TRUE(wait_until([&] { return client.cli_log().stats().bytes > 0; }));
+
+    auto usage = client.get_resource_usage();
+    ASSERT_TRUE(usage.cli.has_value());
+    EXPECT_EQ(usage.cli_pid, read_pid(dir.str()));
+    EXPECT_FALSE(usage.cli->exited);
+#ifdef __linux__
+    EXPECT_GT(usage.cli->rss_bytes, 0u);
+    EXPECT_GE(usage.cli->peak_rss_bytes, usage.cli->rss_bytes);
+#endif
+    EXPECT_EQ(usage.sessions, 1u);
+    EXPECT_EQ(usage.pending_requests, 0u);
+    EXPECT_GT(usage.cli_log_bytes, 0u);
+
+    client.stop().get();
+    EXPECT_FALSE(client.get_resource_usage().cli.has_value());
+}
+
+TEST(EventJournalTest, UnopenableJournalDoesNotFailSession)
+{
+    TempJournalDir dir("unopenable");
+    std::filesystem::create_directories(dir.str());
+    auto blocker = std::filesystem::path(dir.str()) / "not-a-dir";
+    std::ofstream(blocker) << "x";
+
+    ClientOptions opts;
+    opts.cli_path = write_fake_cli(dir.str());
+    opts.use_logged_in_user = false;
+    opts.event_journal_dir = blocker.string();
+
+    Client client(opts);
+    client.start().get();
+    auto session = client.create_session().get();
+    EXPECT_EQ(session->journal(), nullptr);
+    EXPECT_EQ(client.get_resource_usage().sessions, 1u);
+    client.stop().get();
+}
+
+TEST(EventJournalTest, UnsafeSessionIdGetsNoJournal)
+{
+    TempJournalDir dir("unsafe-id");
+    auto root = std::filesystem::path(dir.str()) / "journals";
+
+    ClientOptions opts;
+    opts.cli_path = write_fake_cli(dir.str());
+    opts.use_logged_in_user = false;
+    opts.event_journal_dir = root.string();
+
+    Client client(opts);
+    client.start().get();
+    auto escaping = client.resume_session("../escaped").get();
+    EXPECT_EQ(escaping->journal(), nullptr);
+    EXPECT_FALSE(std::filesystem::exists(std::filesystem::path(dir.str()) / "escaped"));
+
+    auto plain = client.resume_session("plain-id").get();
+    ASSERT_NE(plain->journal(), nullptr);
+    EXPECT_TRUE(std::filesystem::exists(root / "plain-id"));
+    client.stop().get();
+}
+
+TEST(ClientSupervisorTest, ReportsIntoMetricsRegistry)
+{
+    TempJournalDir dir("supervisor-metrics");
+    ClientOptions opts;
+    opts.cli_path = write_fake_cli(dir.str());
+    opts.use_logged_in_user = false;
+    opts.metrics = std::make_shared<MetricsRegistry>();
+
+    {
+        Client client(opts);
+        client.start().get();
+        auto session = client.create_session().get();
+
+        std::string text = opts.metrics->render_prometheus();
+        const std::string sent = "copilot_transport_sent_bytes_total{transport=\"stdio\"} ";
+        EXPECT_NE(text.find("copilot_sessions_active 1\n"), std::string::npos);
+        EXPECT_NE(text.find(sent), std::string::npos);
+        EXPECT_EQ(text.find(sent + "0\n"), std::string::npos);
+#if COPILOT_ENABLE_RPC_METRICS
+        const std::string creates = "copilot_rpc_requests_total{method=\"session.create\"} 1\n";
+        EXPECT_NE(text.find(creates), std::string::npos);
+#endif
+        client.stop().get();
+    }
+
+    // The collector goes away with the Client
+    EXPECT_EQ(opts.metrics->render_prometheus(), "");
+}
+
+TEST(ClientSupervisorTest, RecordsStartupTiming)
+{
+    TempJournalDir dir("supervisor-startup");
+    ClientOptions opts;
+    opts.cli_path = write_fake_cli(dir.str());
+    opts.use_logged_in_user = false;
+    opts.node_startup.enabled = true; // not a .js CLI: no effect
+
+    Client client(opts);
+    client.start().get();
+
+    auto stats = client.startup_stats();
+    EXPECT_EQ(stats.starts, 1u);
+    EXPECT_GT(stats.spawn_time.count(), 0);
+    EXPECT_GE(stats.spawn_to_ready, stats.spawn_time);
+    EXPECT_FALSE(stats.launch_reused);
+    EXPECT_FALSE(stats.node_accelerated);
+    EXPECT_FALSE(stats.compile_cache_dir.has_value());
+    client.stop().get();
+}
+
+TEST(RollingReplaceTest, MovesSessionsToNewCli)
+{
+    TempJournalDir old_dir("replace-old");
+    TempJournalDir new_dir("replace-new");
+    ClientOptions opts;
+    opts.cli_path = write_fake_cli(old_dir.str());
+    opts.use_logged_in_user = false;
+
+    Client client(opts);
+    client.start().get();
+    auto session = client.create_session().get();
+    int old_pid = read_pid(old_dir.str());
+    ASSERT_GT(old_pid, 0);
+
+    ClientOptions next = opts;
+    next.cli_path = write_fake_cli(new_dir.str());
+    auto result = client.rolling_replace(next).get();
+    EXPECT_FALSE(client.startup_stats().launch_reused);
+
+    ASSERT_EQ(result.sessions.size(), 1u);
+    EXPECT_EQ(result.sessions[0].session_id, "fake-session");
+    EXPECT_GE(result.sessions[0].handoff_latency, result.sessions[0].resume_time);
+    EXPECT_GE(result.pause_time, result.sessions[0].handoff_latency);
+    EXPECT_GT(result.startup_time.count(), 0);
+    EXPECT_EQ(result.old_exit_code, 128 + SIGTERM);
+
+    std::string resumed;
+    std::ifstream(std::filesystem::path(new_dir.str()) / "resumed") >> resumed;
+    EXPECT_EQ(resumed, "fake-session");
+    int new_pid = read_pid(new_dir.str());
+    EXPECT_NE(new_pid, old_pid);
+    EXPECT_EQ(client.get_resource_usage().cli_pid, new_pid);
+
+    // The same Session object now talks to the new server
+    EXPECT_EQ(client.get_session("fake-session"), session);
+    EXPECT_NO_THROW(session->abort().get());
+    EXPECT_EQ(client.ping("hi").get().protocol_version, kSdkProtocolVersion);
+    EXPECT_EQ(client.state(), ConnectionState::Connected);
+    client.stop().get();
+}
+
+TEST(RollingReplaceTest, WaitsForRunningTurnsOrRollsBack)
+{
+    TempJournalDir old_dir("replace-drain-old");
+    TempJournalDir new_dir("replace-drain-new");
+    ClientOptions opts;
+    opts.cli_path = write_fake_cli(old_dir.str());
+    opts.use_logged_in_user = false;
+
+    Client client(opts);
+    client.start().get();
+    auto session = client.create_session().get();
+    int old_pid = read_pid(old_dir.str());
+
+    // The fake never reports session.idle, so the turn stays open
+    session->send(MessageOptions{.prompt = "hi"}).get();
+    ASSERT_TRUE(session->turn_running());
+
+    ClientOptions next = opts;
+    next.cli_path = write_fake_cli(new_dir.str());
+    EXPECT_THROW(
+        client.rolling_replace(next, std::chrono::milliseconds(100)).get(), std::runtime_error
+    );
+    EXPECT_EQ(client.get_resource_usage().cli_pid, old_pid);
+    EXPECT_EQ(client.ping("hi").get().protocol_version, kSdkProtocolVersion);
+
+    session->track_turn_state(SessionEventType::SessionIdle);
+    auto result = client.rolling_replace(next, std::chrono::milliseconds(100)).get();
+    ASSERT_EQ(result.sessions.size(), 1u);
+    EXPECT_EQ(client.get_resource_usage().cli_pid, read_pid(new_dir.str()));
+    client.stop().get();
+}
+
+TEST(RollingReplaceTest, KeepsOldCliWhenNewOneFails)
+{
+    TempJournalDir dir("replace-fail");
+    ClientOptions opts;
+    opts.cli_path = write_fake_cli(dir.str());
+    opts.use_logged_in_user = false;
+
+    Client client(opts);
+    client.start().get();
+    auto session = client.create_session().get();
+    int pid = read_pid(dir.str());
+
+    ClientOptions next = opts;
+    next.cli_path = dir.str() + "/missing-cli";
+    EXPECT_ANY_THROW(client.rolling_replace(next).get());
+    EXPECT_EQ(client.get_resource_usage().cli_pid, pid);
+    EXPECT_EQ(client.ping("hi").get().protocol_version, kSdkProtocolVersion);
+    EXPECT_NO_THROW(session->abort().get());
+
+    next.cli_url = "localhost:1234";
+    EXPECT_THROW(client.rolling_replace(next).get(), std::invalid_argument);
+    client.stop().get();
+}
+
+// =============================================================================
+// Turn Profiler Tests
+// =============================================================================
+
+TEST(TurnProfilerTest, RecordsTurnTimeline)
+{
+    TempJournalDir dir("turn-profiler");
+    ClientOptions opts;
+    opts.cli_path = write_fake_cli(dir.str());
+    opts.use_logged_in_user = false;
+
+    Client client(opts);
+    client.start().get();
+    auto session = client.create_session().get();
+
+    std::vector<TurnRecord> delivered;
+    TurnProfiler::Options options;
+    options.on_turn = [&](const TurnRecord& record) { delivered.push_back(record); };
+    TurnProfiler profiler(options);
+    profiler.attach(session);
+    profiler.attach(session); // no-op
+
+    auto event = [](SessionEventType type, SessionEventData data)
+    {
+        SessionEvent e;
+        e.type = type;
+        e.data = std::move(data);
+        return e;
+    };
+
+    // Events before any send are not part of a turn
+    session->dispatch_event(make_test_event(SessionEventType::SessionIdle));
+    EXPECT_TRUE(profiler.records().empty());
+
+    session->send(MessageOptions{"hello"}).get();
+    session->send(MessageOptions{"and more"}).get(); // joins the open turn
+    std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    session->dispatch_event(
+        event(SessionEventType::AssistantTurnStart, AssistantTurnStartData{"turn-1"})
+    );
+    session->dispatch_event(make_delta_event("d1", "m1", "Hello"));
+    session->record_callback_time(
+        SessionCallbackKind::Tool, "lookup", std::chrono::steady_clock::now()
+    );
+    session->record_callback_time(
+        SessionCallbackKind::Hook, "preToolUse", std::chrono::steady_clock::now()
+    );
+    std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    session->dispatch_event(make_delta_event("d2", "m1", ", world"));
+    AssistantUsageData usage;
+    usage.input_tokens = 100;
+    usage.output_tokens = 40;
+    usage.duration = 500; // ms
+    session->dispatch_event(event(SessionEventType::AssistantUsage, usage));
+    session->dispatch_event(make_test_event(SessionEventType::SessionIdle));
+
+    auto records = profiler.records();
+    ASSERT_EQ(records.size(), 1u);
+    ASSERT_EQ(delivered.size(), 1u);
+    const auto& turn = records[0];
+    EXPECT_EQ(turn.session_id, "fake-session");
+    EXPECT_EQ(turn.turn_id, "turn-1");
+    ASSERT_TRUE(turn.time_to_turn_start && turn.time_to_first_delta);
+    EXPECT_GE(turn.time_to_turn_start->count(), 2000);
+    EXPECT_GE(*turn.time_to_first_delta, *turn.time_to_turn_start);
+    EXPECT_GE(turn.duration, *turn.time_to_first_delta + turn.streaming_time);
+    EXPECT_EQ(turn.delta_count, 2u);
+    EXPECT_EQ(turn.delta_bytes, 12u);
+    EXPECT_GE(turn.streaming_time.count(), 2000);
+    EXPECT_GT(turn.delta_bytes_per_second(), 0);
+    EXPECT_EQ(turn.model_calls, 1u);
+    EXPECT_EQ(turn.output_tokens, 40);
+    EXPECT_DOUBLE_EQ(turn.output_tokens_per_second(), 80.0);
+    ASSERT_EQ(turn.callbacks.size(), 2u);
+    EXPECT_EQ(turn.callbacks[0].name, "lookup");
+    EXPECT_EQ(turn.callback_count(SessionCallbackKind::Tool), 1u);
+    EXPECT_EQ(turn.callback_count(SessionCallbackKind::Hook), 1u);
+    EXPECT_EQ(turn.callback_count(SessionCallbackKind::Permission), 0u);
+    EXPECT_FALSE(turn.failed);
+
+    // A failed turn, then one after detach() that is not seen
+    session->send(MessageOptions{"again"}).get();
+    SessionErrorData error;
+    error.error_type = "model";
+    error.message = "overloaded";
+    session->dispatch_event(event(SessionEventType::SessionError, error));
+    profiler.detach(session->session_id());
+    session->send(MessageOptions{"unseen"}).get();
+    session->dispatch_event(make_test_event(SessionEventType::SessionIdle));
+
+    records = profiler.records();
+    ASSERT_EQ(records.size(), 2u);
+    EXPECT_TRUE(records[1].failed);
+    EXPECT_EQ(records[1].error_message, "overloaded");
+    EXPECT_FALSE(records[1].time_to_first_delta.has_value());
+
+    auto summary = profiler.summary();
+    EXPECT_EQ(summary.turns, 2u);
+    EXPECT_EQ(summary.failed_turns, 1u);
+    EXPECT_EQ(summary.turn_duration.count(), 2u);
+    EXPECT_EQ(summary.time_to_first_delta.count(), 1u);
+    EXPECT_EQ(summary.tool_time.count(), 1u);
+    EXPECT_EQ(summary.tools.at("lookup").count(), 1u);
+    EXPECT_EQ(summary.hook_time.count(), 1u);
+    EXPECT_EQ(summary.input_tokens, 100);
+    EXPECT_GE(summary.turn_duration.percentile(100), turn.duration);
+
+    profiler.reset();
+    EXPECT_TRUE(profiler.records().empty());
+    EXPECT_EQ(profiler.summary().turns, 0u);
+    client.stop().get();
+}
+
+TEST(TurnProfilerTest, FailedSendDoesNotLeakIntoNextTurn)
+{
+    TempJournalDir dir("turn-profiler-failed-send");
+    ClientOptions opts;
+    opts.cli_path = write_fake_cli(dir.str());
+    opts.use_logged_in_user = false;
+
+    Client client(opts);
+    client.start().get();
+    auto session = client.create_session().get();
+
+    TurnProfiler profiler;
+    profiler.attach(session);
+
+    EXPECT_THROW(session->send(MessageOptions{"fail"}).get(), JsonRpcError);
+    auto records = profiler.records();
+    ASSERT_EQ(records.size(), 1u);
+    EXPECT_TRUE(records[0].failed);
+    EXPECT_EQ(records[0].error_message, "send rejected");
+
+    // The next turn opens its own record instead of inheriting the stale sent_at
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    auto sent = std::chrono::steady_clock::now();
+    session->send(MessageOptions{"hello"}).get();
+    session->dispatch_event(make_test_event(SessionEventType::SessionIdle));
+
+    auto since_sent = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - sent
+    );
+    records = profiler.records();
+    ASSERT_EQ(records.size(), 2u);
+    EXPECT_FALSE(records[1].failed);
+    EXPECT_LE(records[1].duration, since_sent);
+    auto summary = profiler.summary();
+    EXPECT_EQ(summary.turns, 2u);
+    EXPECT_EQ(summary.failed_turns, 1u);
+    client.force_stop();
+}
+#endif
+
+// =============================================================================
+// Node Startup Tests
+// =============================================================================
+
+namespace
+{
+
+void write_file(const std::filesystem::path& path, const std::string& content)
+{
+    std::filesystem::create_directories(path.parent_path());
+    std::ofstream(path) << content;
+}
+
+} // namespace
+
+TEST(NodeStartupTest, CliVersionFromNearestPackageJson)
+{
+    TempJournalDir dir("node-version");
+    auto root = std::filesystem::path(dir.str());
+    write_file(root / "cli" / "package.json", R"({"name":"cli","version":"1.2.3"})");
+    write_file(root / "cli" / "dist" / "index.js", "// cli\n");
+    write_file(root / "loose" / "index.js", "// no manifest\n");
+
+    EXPECT_EQ(node_cli_version((root / "cli" / "dist" / "index.js").string()), "1.2.3");
+    EXPECT_EQ(node_cli_version((root / "loose" / "index.js").string()).rfind("script-", 0), 0u);
+}
+
+TEST(NodeStartupTest, CompileCachePerVersionEvictsLeastRecentlyUsed)
+{
+    TempJournalDir dir("node-cache");
+    auto root = std::filesystem::path(dir.str());
+    NodeStartupOptions options;
+    options.cache_root = (root / "cache").string();
+    options.max_cached_versions = 2;
+
+    int cli_count = 0;
+    auto cache_for = [&](const std::string& version)
+    {
+        auto cli = root / ("cli" + std::to_string(++cli_count));
+        write_file(cli / "package.json", json{{"version", version}}.dump());
+        write_file(cli / "index.js", "");
+        return prepare_node_compile_cache(options, (cli / "index.js").string());
+    };
+
+    auto first = cache_for("1.0.0");
+    EXPECT_EQ(first, (root / "cache" / "1.0.0").string());
+    EXPECT_TRUE(std::filesystem::is_directory(first));
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    auto second = cache_for("2.0.0");
+
+    // Recently used versions survive; only long-idle ones are pruned
+    auto third = cache_for("3.0.0");
+    EXPECT_TRUE(std::filesystem::exists(first));
+    auto idle = std::filesystem::file_time_type::clock::now() - std::chrono::hours(48);
+    std::filesystem::last_write_time(first, idle);
+    std::filesystem::last_write_time(second, idle + std::chrono::minutes(1));
+    third = cache_for("3.0.0");
+
+    EXPECT_FALSE(std::filesystem::exists(first));
+    EXPECT_TRUE(std::filesystem::is_directory(second));
+    EXPECT_TRUE(std::filesystem::is_directory(third));
+
+    // Unsafe version strings stay inside the cache root
+    auto unsafe = cache_for("../../escape");
+    EXPECT_EQ(std::filesystem::path(unsafe).parent_path(), root / "cache");
+}
+
+#ifndef _WIN32
+TEST(NodeStartupTest, DefaultCacheRootIsPrivatePerUser)
+{
+    TempJournalDir dir("node-cache-home");
+    auto root = std::filesystem::path(dir.str());
+    write_file(root / "cli" / "package.json", R"({"version":"1.0.0"})");
+    write_file(root / "cli" / "index.js", "");
+
+    const char* saved = std::getenv("XDG_CACHE_HOME");
+    std::string previous = saved ? saved : "";
+    ::setenv("XDG_CACHE_HOME", (root / "xdg").c_str(), 1);
+    auto cache = prepare_node_compile_cache({}, (root / "cli" / "index.js").string());
+    if (saved)
+        ::setenv("XDG_CACHE_HOME", previous.c_str(), 1);
+    else
+        ::unsetenv("XDG_CACHE_HOME");
+
+    auto expected_root = root / "xdg" / "copilot-sdk-cpp" / "node-compile-cache";
+    EXPECT_EQ(cache, (expected_root / "1.0.0").string());
+    auto perms = std::filesystem::status(expected_root).permissions();
+    EXPECT_EQ(perms & std::filesystem::perms::all, std::filesystem::perms::owner_all);
+}
+#endif
+
+TEST(NodeStartupTest, FindNodeCachedMatchesFindNode)
+{
+    EXPECT_EQ(find_node_cached(), find_node());
+    EXPECT_EQ(find_node_cached(), find_node());
+}
+
+#ifndef _WIN32
+TEST(NodeStartupTest, ClientPassesCompileCacheAndV8Flags)
+{
+    if (!find_node())
+        GTEST_SKIP() << "node not on PATH";
+
+    TempJournalDir dir("node-client");
+    auto root = std::filesystem::path(dir.str());
+    write_file(root / "cli" / "package.json", R"({"version":"9.9.9"})");
+    // Minimal Content-Length JSON-RPC server that records how it was started
+    std::ostringstream script;
+    script << "const fs = require('fs');\n"
+           << "fs.writeFileSync(" << json((root / "started.json").string()).dump()
+           << ", JSON.stringify({cache: process.env.NODE_COMPILE_CACHE,"
+           << " argv: process.execArgv}));\n"
+           << R"JS(let buf = Buffer.alloc(0);
+process.stdin.on('data', (chunk) => {
+  buf = Buffer.concat([buf, chunk]);
+  for (;;) {
+    const sep = buf.indexOf('\r\n\r\n');
+    if (sep < 0) return;
+    const len = Number(/Content-Length: (\d+)/.exec(buf.subarray(0, sep).toString())[1]);
+    if (buf.length < sep + 4 + len) return;
+    const req = JSON.parse(buf.subarray(sep + 4, sep + 4 + len).toString());
+    buf = buf.subarray(sep + 4 + len);
+    const result = req.method === 'ping' ? {message: 'pong', protocolVersion: )JS"
+           << kSdkProtocolVersion << R"JS(} : {};
+    const body = JSON.stringify({jsonrpc: '2.0', id: req.id, result});
+    process.stdout.write(`Content-Length: ${Buffer.byteLength(body)}\r\n\r\n${body}`);
+  }
+});
+)JS";
+    write_file(root / "cli" / "index.js", script.str());
+
+    ClientOptions opts;
+    opts.cli_path = (root / "cli" / "index.js").string();
+    opts.use_logged_in_user = false;
+    opts.node_startup.enabled = true;
+    opts.node_startup.cache_root = (root / "cache").string();
+
+    Client client(opts);
+    client.start().get();
+    auto stats = client.startup_stats();
+    client.stop().get();
+
+    EXPECT_TRUE(stats.node_accelerated);
+    ASSERT_TRUE(stats.compile_cache_dir.has_value());
+    EXPECT_EQ(*stats.compile_cache_dir, (root / "cache" / "9.9.9").string());
+    EXPECT_GT(stats.spawn_to_ready.count(), 0);
+
+    std::ifstream in(root / "started.json");
+    json started = json::parse(in);
+    EXPECT_EQ(started["cache"], *stats.compile_cache_dir);
+    EXPECT_EQ(started["argv"], json::array({"--max-semi-space-size=32"}));
+}
+#endif
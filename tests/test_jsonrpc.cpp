@@ -1,14 +1,25 @@
 // Copyright (c) 2025 Elias Bachaalany
 // SPDX-License-Identifier: MIT
 
+#include <atomic>
 #include <chrono>
 #include <condition_variable>
 #include <copilot/jsonrpc.hpp>
+#include <copilot/metrics_registry.hpp>
+#include <copilot/trace.hpp>
+#include <future>
 #include <gtest/gtest.h>
 #include <mutex>
 #include <queue>
+#include <set>
 #include <thread>
 
+#ifndef _WIN32
+#include <sys/resource.h>
+#include <sys/select.h>
+#include <unistd.h>
+#endif
+
 using namespace copilot;
 
 // =============================================================================
@@ -240,6 +251,485 @@ TEST(JsonRpcClientTest, BasicRequestResponse)
     client.stop();
 }
 
+TEST(JsonRpcClientTest, ThreadStartHookRunsOnBackgroundThreads)
+{
+    auto [client_transport, server_transport] = PipeTransport::create_pair();
+    JsonRpcClient client(std::move(client_transport));
+
+    std::mutex mutex;
+    std::set<ThreadRole> roles;
+    std::set<std::thread::id> threads;
+    client.set_thread_start_hook(
+        [&](ThreadRole role)
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            roles.insert(role);
+            threads.insert(std::this_thread::get_id());
+        }
+    );
+    client.start();
+    client.stop(); // joins both threads, so both have run the hook
+
+    std::lock_guard<std::mutex> lock(mutex);
+    EXPECT_EQ(roles, (std::set<ThreadRole>{ThreadRole::RpcReader, ThreadRole::RpcTimer}));
+    EXPECT_EQ(threads.size(), 2u);
+    EXPECT_EQ(threads.count(std::this_thread::get_id()), 0u);
+}
+
+TEST(LatencyHistogramTest, BucketsArePreciseToOneSixteenth)
+{
+    using H = LatencyHistogram;
+    for (uint64_t v : {0ull, 1ull, 31ull, 32ull, 33ull, 1000ull, 123456789ull, 1ull << 36})
+    {
+        size_t i = H::bucket_index(v);
+        EXPECT_LE(H::bucket_lower_bound(i), v) << v;
+        EXPECT_GE(H::bucket_upper_bound(i), v) << v;
+        if (v >= 32)
+        {
+            EXPECT_LE(H::bucket_upper_bound(i) - H::bucket_lower_bound(i) + 1, v / 16 + 1) << v;
+        }
+    }
+    EXPECT_EQ(H::bucket_index(~0ull), H::kBucketCount - 1);
+    for (size_t i = 1; i < H::kBucketCount; ++i)
+        EXPECT_EQ(H::bucket_lower_bound(i), H::bucket_upper_bound(i - 1) + 1) << i;
+
+    H histogram;
+    EXPECT_EQ(histogram.percentile(50).count(), 0);
+    for (int us = 1; us <= 1000; ++us)
+        histogram.record(std::chrono::microseconds(us));
+    EXPECT_EQ(histogram.count(), 1000u);
+    EXPECT_EQ(histogram.min().count(), 1);
+    EXPECT_EQ(histogram.max().count(), 1000);
+    EXPECT_EQ(histogram.mean().count(), 500);
+    EXPECT_NEAR(histogram.percentile(50).count(), 500, 500 / 16);
+    EXPECT_NEAR(histogram.percentile(99).count(), 990, 990 / 16);
+    EXPECT_EQ(histogram.percentile(100).count(), 1000);
+}
+
+TEST(LatencyHistogramTest, AtomicHistogramRecordsFromManyThreads)
+{
+    AtomicLatencyHistogram histogram;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t)
+        threads.emplace_back(
+            [&]
+            {
+                for (int us = 1; us <= 1000; ++us)
+                    histogram.record(std::chrono::microseconds(us));
+            }
+        );
+    for (auto& thread : threads)
+        thread.join();
+
+    auto copy = histogram.load();
+    EXPECT_EQ(copy.count(), 4000u);
+    EXPECT_EQ(copy.min().count(), 1);
+    EXPECT_EQ(copy.max().count(), 1000);
+    EXPECT_EQ(copy.mean().count(), 500);
+
+    histogram.clear();
+    EXPECT_EQ(histogram.load().count(), 0u);
+}
+
+TEST(RpcMetricsTest, CountsConcurrentlyAndBeyondTheSlotTable)
+{
+    RpcMetrics metrics;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t)
+        threads.emplace_back(
+            [&]
+            {
+                for (int i = 0; i < 1000; ++i)
+                    metrics.record_incoming("session.event", 10);
+            }
+        );
+    for (auto& thread : threads)
+        thread.join();
+
+    // More methods than the lock-free table holds spill into the overflow map
+    for (int i = 0; i < 300; ++i)
+        metrics.record_sent("method." + std::to_string(i), 1, std::chrono::microseconds(i));
+    metrics.record_failure("method.7", JsonRpcErrorCode::Timeout);
+    metrics.record_callback("tool.call", "lookup", CallbackTiming{}, false);
+
+    auto snapshot = metrics.snapshot();
+    EXPECT_EQ(snapshot.methods.at("session.event").incoming, 4000u);
+    EXPECT_EQ(snapshot.methods.at("session.event").bytes_in, 40000u);
+    EXPECT_EQ(snapshot.methods.size(), 301u);
+    EXPECT_EQ(snapshot.methods.at("method.299").requests, 1u);
+    EXPECT_EQ(snapshot.methods.at("method.7").errors.at(JsonRpcErrorCode::Timeout), 1u);
+    EXPECT_EQ(snapshot.callbacks.at("tool.call").count, 1u);
+    EXPECT_EQ(snapshot.callback_details.at({"tool.call", "lookup"}).count, 1u);
+
+    metrics.reset();
+    snapshot = metrics.snapshot();
+    EXPECT_TRUE(snapshot.methods.empty());
+    EXPECT_TRUE(snapshot.callback_details.empty());
+    metrics.record_sent("method.299", 1, std::chrono::microseconds(1));
+    EXPECT_EQ(metrics.snapshot().methods.at("method.299").requests, 1u);
+}
+
+#if COPILOT_ENABLE_RPC_METRICS
+TEST(JsonRpcClientTest, RecordsPerMethodMetrics)
+{
+    auto [client_transport, server_transport] = PipeTransport::create_pair();
+    JsonRpcClient client(std::move(client_transport));
+    MessageFramer server_framer(*server_transport);
+    client.start();
+
+    // Answers "ok" and fails "bad"; "slow" is left to time out
+    std::thread server_thread(
+        [&]
+        {
+            for (int i = 0; i < 3; ++i)
+            {
+                auto req = json::parse(server_framer.read_message());
+                json response = {{"jsonrpc", "2.0"}, {"id", req["id"]}};
+                if (req["method"] == "ok")
+                    response["result"] = {{"value", 1}};
+                else if (req["method"] == "bad")
+                    response["error"] = {{"code", -32602}, {"message", "Invalid params"}};
+                else
+                    continue;
+                server_framer.write_message(response.dump());
+            }
+            json note = {{"jsonrpc", "2.0"}, {"method", "event"}, {"params", {{"x", 1}}}};
+            server_framer.write_message(note.dump());
+        }
+    );
+
+    auto slow = client.invoke("slow", nullptr, std::chrono::milliseconds(50));
+    EXPECT_EQ(client.invoke("ok").get()["value"], 1);
+    EXPECT_THROW(client.invoke("bad").get(), JsonRpcError);
+    EXPECT_THROW(slow.get(), JsonRpcError);
+    server_thread.join();
+
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (client.metrics()->snapshot().methods.count("event") == 0 &&
+           std::chrono::steady_clock::now() < deadline)
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    auto snapshot = client.metrics()->snapshot();
+    client.stop();
+
+    EXPECT_TRUE(snapshot.enabled);
+    const auto& ok = snapshot.methods.at("ok");
+    EXPECT_EQ(ok.requests, 1u);
+    EXPECT_EQ(ok.responses, 1u);
+    EXPECT_EQ(ok.error_count(), 0u);
+    EXPECT_GT(ok.bytes_out, 0u);
+    EXPECT_GT(ok.bytes_in, 0u);
+    EXPECT_EQ(ok.send_time.count(), 1u);
+    EXPECT_EQ(ok.wait_time.count(), 1u);
+
+    const auto& bad = snapshot.methods.at("bad");
+    EXPECT_EQ(bad.responses, 0u);
+    EXPECT_EQ(bad.errors.at(JsonRpcErrorCode::InvalidParams), 1u);
+    EXPECT_EQ(bad.wait_time.count(), 1u);
+
+    const auto& timed_out = snapshot.methods.at("slow");
+    EXPECT_EQ(timed_out.errors.at(JsonRpcErrorCode::Timeout), 1u);
+    EXPECT_EQ(timed_out.wait_time.count(), 0u);
+
+    EXPECT_EQ(snapshot.methods.at("event").incoming, 1u);
+    EXPECT_EQ(snapshot.total().requests, 3u);
+}
+
+TEST(JsonRpcClientTest, TimesIncomingRequestStages)
+{
+    auto [client_transport, server_transport] = PipeTransport::create_pair();
+    JsonRpcClient client(std::move(client_transport));
+    MessageFramer server_framer(*server_transport);
+    client.set_request_handler(
+        [](const std::string&, const json& params) -> json
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+            if (params["toolName"] == "broken")
+                throw std::runtime_error("tool failed");
+            return json{{"ok", true}};
+        }
+    );
+    client.set_request_detail(
+        [](const std::string&, const json& params) { return params["toolName"].get<std::string>(); }
+    );
+    client.start();
+
+    int id = 0;
+    for (const char* tool : {"lookup", "lookup", "broken"})
+    {
+        json request = {
+            {"jsonrpc", "2.0"},
+            {"method", "tool.call"},
+            {"params", {{"toolName", tool}}},
+            {"id", ++id}
+        };
+        server_framer.write_message(request.dump());
+        EXPECT_EQ(json::parse(server_framer.read_message())["id"], id);
+    }
+    client.stop(); // The read thread records after writing each response
+
+    auto snapshot = client.metrics()->snapshot();
+    const auto& calls = snapshot.callbacks.at("tool.call");
+    EXPECT_EQ(calls.count, 3u);
+    EXPECT_EQ(calls.errors, 1u);
+    EXPECT_GE(calls.handler.min().count(), 5000);
+    EXPECT_EQ(calls.write.count(), 3u);
+    EXPECT_GE(calls.total.min(), calls.handler.min());
+
+    const auto& lookup = snapshot.callback_details.at({"tool.call", "lookup"});
+    EXPECT_EQ(lookup.count, 2u);
+    EXPECT_EQ(lookup.errors, 0u);
+    EXPECT_EQ(snapshot.callback_details.at({"tool.call", "broken"}).errors, 1u);
+    // Answered requests are not counted as outgoing ones
+    EXPECT_EQ(snapshot.methods.at("tool.call").incoming, 3u);
+    EXPECT_EQ(snapshot.methods.at("tool.call").requests, 0u);
+}
+#endif
+
+// =============================================================================
+// Tracer Tests
+// =============================================================================
+
+namespace
+{
+
+/// Complete ("X") events of an exported trace
+std::vector<json> trace_spans(const json& trace)
+{
+    std::vector<json> spans;
+    for (const auto& event : trace["traceEvents"])
+        if (event["ph"] == "X")
+            spans.push_back(event);
+    return spans;
+}
+
+} // namespace
+
+TEST(TracerTest, RecordsSpansPerThreadAndExportsChromeJson)
+{
+    auto& tracer = Tracer::instance();
+    {
+        TraceScope before("test", "before_start"); // Not traced: starts before start()
+    }
+    tracer.start();
+    {
+        TraceScope outer("test", "outer");
+        outer.set_arg("say \"hi\"");
+        TraceScope inner("test", "inner");
+    }
+    std::thread worker(
+        []
+        {
+            Tracer::instance().set_thread_name("worker");
+            TraceScope span("test", "on_worker");
+        }
+    );
+    worker.join();
+    tracer.stop();
+    {
+        TraceScope after("test", "after_stop");
+    }
+
+    auto stats = tracer.stats();
+    EXPECT_EQ(stats.events, 3u);
+    EXPECT_EQ(stats.threads, 2u);
+    EXPECT_EQ(stats.dropped, 0u);
+
+    json trace = json::parse(tracer.chrome_json());
+    auto spans = trace_spans(trace);
+    ASSERT_EQ(spans.size(), 3u);
+    // Spans are recorded when they end
+    EXPECT_EQ(spans[0]["name"], "inner");
+    EXPECT_EQ(spans[1]["name"], "outer");
+    EXPECT_EQ(spans[1]["cat"], "test");
+    EXPECT_EQ(spans[1]["args"]["detail"], "say \"hi\"");
+    EXPECT_LE(spans[1]["ts"].get<double>(), spans[0]["ts"].get<double>());
+    EXPECT_GE(spans[1]["dur"].get<double>(), spans[0]["dur"].get<double>());
+    EXPECT_EQ(spans[2]["name"], "on_worker");
+    EXPECT_NE(spans[2]["tid"], spans[0]["tid"]);
+
+    bool named = false;
+    for (const auto& event : trace["traceEvents"])
+        if (event["name"] == "thread_name" && event["tid"] == spans[2]["tid"])
+            named = event["args"]["name"] == "worker";
+    EXPECT_TRUE(named);
+}
+
+TEST(TracerTest, DropsBeyondCapacityAndRestartDiscards)
+{
+    auto& tracer = Tracer::instance();
+    TraceOptions options;
+    options.max_events_per_thread = 600; // More than one chunk
+    tracer.start(options);
+    for (int i = 0; i < 700; ++i)
+        TraceScope span("test", "loop");
+    tracer.stop();
+
+    auto stats = tracer.stats();
+    EXPECT_EQ(stats.events, 600u);
+    EXPECT_EQ(stats.dropped, 100u);
+    EXPECT_EQ(json::parse(tracer.chrome_json())["otherData"]["dropped_events"], 100);
+
+    tracer.start();
+    tracer.stop();
+    EXPECT_EQ(tracer.stats().events, 0u);
+    EXPECT_TRUE(trace_spans(json::parse(tracer.chrome_json())).empty());
+}
+
+#if COPILOT_ENABLE_TRACING
+TEST(JsonRpcClientTest, TracesSendAndDispatch)
+{
+    auto [client_transport, server_transport] = PipeTransport::create_pair();
+    JsonRpcClient client(std::move(client_transport));
+    MessageFramer server_framer(*server_transport);
+    client.start();
+
+    Tracer::instance().start();
+    std::thread server_thread(
+        [&]
+        {
+            auto req = json::parse(server_framer.read_message());
+            json response = {{"jsonrpc", "2.0"}, {"id", req["id"]}, {"result", 1}};
+            server_framer.write_message(response.dump());
+        }
+    );
+    EXPECT_EQ(client.invoke("traced.method").get(), 1);
+    server_thread.join();
+    client.stop();
+    Tracer::instance().stop();
+
+    std::set<std::string> seen;
+    for (const auto& span : trace_spans(json::parse(Tracer::instance().chrome_json())))
+    {
+        std::string detail = span.contains("args") ? span["args"]["detail"].get<std::string>() : "";
+        seen.insert(span["name"].get<std::string>() + ":" + detail);
+    }
+    EXPECT_TRUE(seen.count("send_message:traced.method"));
+    EXPECT_TRUE(seen.count("read_loop:"));
+    EXPECT_TRUE(seen.count("json_parse:"));
+    EXPECT_TRUE(seen.count("dispatch_message:response"));
+}
+#endif
+
+// =============================================================================
+// MetricsRegistry Tests
+// =============================================================================
+
+TEST(MetricsRegistryTest, RendersPrometheusText)
+{
+    MetricsRegistry registry;
+    registry.counter("app_requests_total", "Requests", {{"path", "/a\"b"}}).inc(3);
+    registry.gauge("app_queue_depth", "Queue depth").set(2.5);
+    auto& histogram = registry.histogram("app_latency_seconds", "Latency", {}, {0.1, 1});
+    histogram.observe(0.05);
+    histogram.observe(std::chrono::milliseconds(500));
+    histogram.observe(5.0);
+
+    // Collector samples add up with instruments of the same series
+    int id = registry.add_collector(
+        [](MetricsWriter& writer)
+        { writer.counter("app_requests_total", "Requests", 2, {{"path", "/a\"b"}}); }
+    );
+
+    std::string text = registry.render_prometheus();
+    EXPECT_NE(text.find("# TYPE app_requests_total counter\n"), std::string::npos);
+    EXPECT_NE(text.find("app_requests_total{path=\"/a\\\"b\"} 5\n"), std::string::npos);
+    EXPECT_NE(text.find("app_queue_depth 2.5\n"), std::string::npos);
+    EXPECT_NE(text.find("app_latency_seconds_bucket{le=\"0.1\"} 1\n"), std::string::npos);
+    EXPECT_NE(text.find("app_latency_seconds_bucket{le=\"1\"} 2\n"), std::string::npos);
+    EXPECT_NE(text.find("app_latency_seconds_bucket{le=\"+Inf\"} 3\n"), std::string::npos);
+    EXPECT_NE(text.find("app_latency_seconds_sum 5.55\n"), std::string::npos);
+    EXPECT_NE(text.find("app_latency_seconds_count 3\n"), std::string::npos);
+
+    registry.remove_collector(id);
+    EXPECT_NE(registry.render_prometheus().find("} 3\n"), std::string::npos);
+
+    EXPECT_THROW(registry.gauge("app_requests_total", "Requests"), std::invalid_argument);
+    EXPECT_THROW(registry.counter("bad name", "Bad"), std::invalid_argument);
+    EXPECT_THROW(MetricHistogram({1, 0.5}), std::invalid_argument);
+}
+
+TEST(MetricsRegistryTest, ConvertsLatencyHistogramToSeconds)
+{
+    LatencyHistogram latencies;
+    latencies.record(std::chrono::microseconds(800));
+    latencies.record(std::chrono::milliseconds(30));
+
+    MetricsWriter writer;
+    writer.histogram("rpc_seconds", "RPC", latencies, {{"method", "ping"}}, {0.001, 0.01, 0.1});
+    std::string text = writer.prometheus_text();
+    constexpr auto npos = std::string::npos;
+    EXPECT_NE(text.find("rpc_seconds_bucket{method=\"ping\",le=\"0.001\"} 1\n"), npos);
+    EXPECT_NE(text.find("rpc_seconds_bucket{method=\"ping\",le=\"0.01\"} 1\n"), npos);
+    EXPECT_NE(text.find("rpc_seconds_bucket{method=\"ping\",le=\"0.1\"} 2\n"), npos);
+    EXPECT_NE(text.find("rpc_seconds_count{method=\"ping\"} 2\n"), std::string::npos);
+}
+
+TEST(MetricsServerTest, ServesRegistryOverHttp)
+{
+    auto registry = std::make_shared<MetricsRegistry>();
+    registry->counter("served_total", "Served").inc();
+    MetricsServer server(registry);
+    ASSERT_GT(server.port(), 0);
+
+    auto fetch = [&](const std::string& path)
+    {
+        TcpTransport transport;
+        transport.connect("127.0.0.1", server.port(), 5000);
+        std::string request = "GET " + path + " HTTP/1.1\r\nHost: localhost\r\n\r\n";
+        transport.write(request.data(), request.size());
+        std::string response;
+        char buffer[1024];
+        while (size_t n = transport.read(buffer, sizeof(buffer)))
+            response.append(buffer, n);
+        return response;
+    };
+
+    std::string ok = fetch("/metrics");
+    EXPECT_EQ(ok.rfind("HTTP/1.1 200", 0), 0u);
+    EXPECT_NE(ok.find("text/plain; version=0.0.4"), std::string::npos);
+    EXPECT_NE(ok.find("served_total 1\n"), std::string::npos);
+    EXPECT_EQ(fetch("/other").rfind("HTTP/1.1 404", 0), 0u);
+
+    server.stop();
+}
+
+#ifndef _WIN32
+TEST(MetricsServerTest, ListensOnDescriptorAboveFdSetsize)
+{
+    struct rlimit limit;
+    ASSERT_EQ(getrlimit(RLIMIT_NOFILE, &limit), 0);
+    if (limit.rlim_cur < FD_SETSIZE + 64)
+        GTEST_SKIP() << "descriptor limit below FD_SETSIZE";
+
+    // Push the listening socket past what an fd_set can hold
+    std::vector<int> fillers;
+    while (fillers.empty() || fillers.back() < FD_SETSIZE)
+    {
+        int fd = ::dup(STDIN_FILENO);
+        ASSERT_GE(fd, 0);
+        fillers.push_back(fd);
+    }
+
+    auto registry = std::make_shared<MetricsRegistry>();
+    registry->counter("served_total", "Served").inc();
+    MetricsServer server(registry);
+
+    TcpTransport transport;
+    transport.connect("127.0.0.1", server.port(), 5000);
+    std::string request = "GET /metrics HTTP/1.1\r\nHost: localhost\r\n\r\n";
+    transport.write(request.data(), request.size());
+    std::string response;
+    char buffer[1024];
+    while (size_t n = transport.read(buffer, sizeof(buffer)))
+        response.append(buffer, n);
+    EXPECT_EQ(response.rfind("HTTP/1.1 200", 0), 0u);
+
+    server.stop();
+    for (int fd : fillers)
+        ::close(fd);
+}
+#endif
+
 TEST(JsonRpcClientTest, ErrorResponse)
 {
     auto [client_transport, server_transport] = PipeTransport::create_pair();
@@ -500,6 +990,32 @@ TEST(JsonRpcClientTest, ConnectionClosed)
     EXPECT_TRUE(threw_error);
 }
 
+TEST(JsonRpcClientTest, InvokeAfterPeerClosedFailsImmediately)
+{
+    auto [client_transport, server_transport] = PipeTransport::create_pair();
+
+    JsonRpcClient client(std::move(client_transport));
+    client.start();
+    server_transport->close();
+
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (client.is_running() && std::chrono::steady_clock::now() < deadline)
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    ASSERT_FALSE(client.is_running());
+
+    // The write would succeed, but no read loop is left to answer or time it out
+    try
+    {
+        client.invoke("late.method", nullptr, std::chrono::milliseconds{0});
+        FAIL() << "invoke() on a closed connection must throw";
+    }
+    catch (const JsonRpcError& e)
+    {
+        EXPECT_EQ(e.code(), JsonRpcErrorCode::ConnectionClosed);
+    }
+    client.stop();
+}
+
 TEST(JsonRpcClientTest, StopWithPendingRequests)
 {
     auto [client_transport, server_transport] = PipeTransport::create_pair();
@@ -515,6 +1031,152 @@ TEST(JsonRpcClientTest, StopWithPendingRequests)
     EXPECT_THROW(future.get(), JsonRpcError);
 }
 
+TEST(JsonRpcClientTest, InvokeAsyncDeliversResultToCallback)
+{
+    auto [client_transport, server_transport] = PipeTransport::create_pair();
+
+    JsonRpcClient client(std::move(client_transport));
+    MessageFramer server_framer(*server_transport);
+    client.start();
+
+    std::promise<json> delivered;
+    client.invoke_async(
+        "ping",
+        json{{"message", "hello"}},
+        [&](const json& result, std::exception_ptr error)
+        {
+            EXPECT_FALSE(error);
+            delivered.set_value(result);
+        }
+    );
+
+    auto req = json::parse(server_framer.read_message());
+    json response = {{"jsonrpc", "2.0"}, {"result", {{"message", "pong"}}}, {"id", req["id"]}};
+    server_framer.write_message(response.dump());
+
+    auto future = delivered.get_future();
+    ASSERT_EQ(future.wait_for(std::chrono::seconds(5)), std::future_status::ready);
+    EXPECT_EQ(future.get()["message"], "pong");
+    client.stop();
+}
+
+TEST(JsonRpcClientTest, WatchDeadlineFiresTimeout)
+{
+    auto [client_transport, server_transport] = PipeTransport::create_pair();
+
+    JsonRpcClient client(std::move(client_transport));
+    client.start();
+
+    std::promise<JsonRpcErrorCode> fired;
+    client.watch_deadline(
+        std::chrono::milliseconds(20),
+        [&](const json&, std::exception_ptr error)
+        {
+            try
+            {
+                std::rethrow_exception(error);
+            }
+            catch (const JsonRpcError& e)
+            {
+                fired.set_value(e.code());
+            }
+        }
+    );
+
+    auto future = fired.get_future();
+    ASSERT_EQ(future.wait_for(std::chrono::seconds(5)), std::future_status::ready);
+    EXPECT_EQ(future.get(), JsonRpcErrorCode::Timeout);
+    client.stop();
+}
+
+TEST(JsonRpcClientTest, CancelledDeadlineNeverFires)
+{
+    auto [client_transport, server_transport] = PipeTransport::create_pair();
+
+    JsonRpcClient client(std::move(client_transport));
+    client.start();
+
+    std::atomic<int> calls{0};
+    auto id = client.watch_deadline(
+        std::chrono::milliseconds(20), [&](const json&, std::exception_ptr) { calls++; }
+    );
+    EXPECT_EQ(client.pending_request_count(), 0u); // a local deadline, not a request
+    EXPECT_TRUE(client.cancel(id));
+    EXPECT_FALSE(client.cancel(id));
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    client.stop();
+    EXPECT_EQ(calls.load(), 0);
+}
+
+TEST(JsonRpcClientTest, WatchDeadlineFailsOnStop)
+{
+    auto [client_transport, server_transport] = PipeTransport::create_pair();
+
+    JsonRpcClient client(std::move(client_transport));
+    client.start();
+
+    std::atomic<int> calls{0};
+    client.watch_deadline(std::chrono::hours(1), [&](const json&, std::exception_ptr) { calls++; });
+    client.stop();
+    EXPECT_EQ(calls.load(), 1);
+
+    // Registering after stop fails immediately
+    client.watch_deadline(std::chrono::hours(1), [&](const json&, std::exception_ptr) { calls++; });
+    EXPECT_EQ(calls.load(), 2);
+}
+
+TEST(JsonRpcClientTest, AbortPendingFailsInFlightRequestsWithoutStopping)
+{
+    auto [client_transport, server_transport] = PipeTransport::create_pair();
+
+    JsonRpcClient client(std::move(client_transport));
+    client.start();
+
+    auto future = client.invoke("slow.method");
+    client.abort_pending("server exited");
+
+    ASSERT_EQ(future.wait_for(std::chrono::seconds(5)), std::future_status::ready);
+    try
+    {
+        future.get();
+        FAIL() << "request should have failed";
+    }
+    catch (const JsonRpcError& e)
+    {
+        EXPECT_EQ(e.code(), JsonRpcErrorCode::ConnectionClosed);
+        EXPECT_STREQ(e.what(), "server exited");
+    }
+    EXPECT_TRUE(client.is_running());
+    client.stop();
+}
+
+TEST(JsonRpcClientTest, WaitForDrainWakesWhenRequestsComplete)
+{
+    auto [client_transport, server_transport] = PipeTransport::create_pair();
+
+    JsonRpcClient client(std::move(client_transport));
+    client.start();
+
+    auto future = client.invoke("slow.method");
+    auto now = std::chrono::steady_clock::now;
+    EXPECT_FALSE(client.wait_for_drain(now() + std::chrono::milliseconds(20)));
+
+    std::thread aborter(
+        [&]
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+            client.abort_pending("server exited");
+        }
+    );
+    auto start = now();
+    EXPECT_TRUE(client.wait_for_drain(start + std::chrono::seconds(10)));
+    EXPECT_LT(now() - start, std::chrono::seconds(5));
+    aborter.join();
+    EXPECT_THROW(future.get(), JsonRpcError);
+    client.stop();
+}
+
 // =============================================================================
 // Error Type Tests
 // =============================================================================
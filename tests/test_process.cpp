@@ -1,11 +1,22 @@
 // Copyright (c) 2025 Elias Bachaalany
 // SPDX-License-Identifier: MIT
 
+#include <algorithm>
 #include <chrono>
+#include <copilot/cli_log.hpp>
 #include <copilot/process.hpp>
+#include <copilot/thread_options.hpp>
+#include <cstdlib>
+#include <future>
 #include <gtest/gtest.h>
 #include <thread>
 
+#ifdef __linux__
+#include <poll.h>
+#include <pthread.h>
+#include <sched.h>
+#endif
+
 using namespace copilot;
 
 // =============================================================================
@@ -261,6 +272,435 @@ TEST(ProcessTest, ReadLine)
     EXPECT_TRUE(line1.find("line") != std::string::npos || line2.find("line") != std::string::npos);
 }
 
+#ifndef _WIN32
+TEST(ProcessTest, ReadLineIsBuffered)
+{
+    Process proc;
+    // 50 lines of 200 bytes, written before we start reading
+    std::string script = "i=0; while [ $i -lt 50 ]; do printf '%0199d\\n' $i; i=$((i+1)); done";
+    proc.spawn("sh", {"-c", script});
+    EXPECT_EQ(proc.wait(), 0);
+
+    auto& out = proc.stdout_pipe();
+    for (int i = 0; i < 50; ++i)
+    {
+        std::string line = out.read_line();
+        ASSERT_EQ(line.size(), 200u);
+        EXPECT_EQ(std::stoi(line), i);
+    }
+    EXPECT_EQ(out.read_line(), "");
+
+    // One syscall per buffer fill plus EOF, instead of one per byte (10,001)
+    EXPECT_LE(out.read_syscalls(), 3u);
+}
+
+TEST(ProcessTest, BufferedAndRawReadsInterleave)
+{
+    Process proc;
+    proc.spawn("sh", {"-c", "printf 'key=value;rest\\nsecond line\\ntail'"});
+    EXPECT_EQ(proc.wait(), 0);
+
+    auto& out = proc.stdout_pipe();
+    EXPECT_EQ(out.read_until('='), "key=");
+    EXPECT_EQ(out.read_until(';', 3), "val");
+
+    char raw[4];
+    ASSERT_EQ(out.read(raw, sizeof(raw)), 4u);
+    EXPECT_EQ(std::string(raw, 4), "ue;r");
+
+    EXPECT_EQ(out.read_line(), "est\n");
+    EXPECT_TRUE(out.has_data());
+    EXPECT_EQ(out.read_available(6), "second");
+    EXPECT_EQ(out.read_available(), " line\ntail");
+    EXPECT_EQ(out.read_line(), "");
+}
+#endif
+
+TEST(ProcessTest, OnExitReportsExitCode)
+{
+    Process proc;
+    ProcessOptions opts;
+    opts.redirect_stdout = false;
+
+#ifdef _WIN32
+    proc.spawn("cmd", {"/c", "exit 3"}, opts);
+#else
+    proc.spawn("sh", {"-c", "sleep 0.05; exit 3"}, opts);
+#endif
+
+    std::promise<int> exited;
+    proc.on_exit([&](int exit_code) { exited.set_value(exit_code); });
+    EXPECT_THROW(proc.on_exit([](int) {}), ProcessError);
+
+    auto future = exited.get_future();
+    ASSERT_EQ(future.wait_for(std::chrono::seconds(5)), std::future_status::ready);
+    EXPECT_EQ(future.get(), 3);
+
+    // The watcher does not reap; wait() still reports the exit code
+    EXPECT_FALSE(proc.is_running());
+    EXPECT_EQ(proc.wait(), 3);
+}
+
+TEST(ProcessTest, OnExitAfterWait)
+{
+    Process proc;
+    ProcessOptions opts;
+    opts.redirect_stdout = false;
+
+#ifdef _WIN32
+    proc.spawn("cmd", {"/c", "exit 0"}, opts);
+#else
+    proc.spawn("true", {}, opts);
+#endif
+    proc.wait();
+
+    std::promise<int> exited;
+    proc.on_exit([&](int exit_code) { exited.set_value(exit_code); });
+
+    auto future = exited.get_future();
+    ASSERT_EQ(future.wait_for(std::chrono::seconds(5)), std::future_status::ready);
+    EXPECT_EQ(future.get(), 0);
+}
+
+#ifndef _WIN32
+TEST(ProcessTest, ResourceUsageLiveAndFinal)
+{
+    Process proc;
+    EXPECT_THROW(proc.resource_usage(), ProcessError);
+
+    // Burn some CPU, then wait for stdin
+    std::string script = "i=0; while [ $i -lt 100000 ]; do i=$((i+1)); done; echo busy; read x";
+    proc.spawn("sh", {"-c", script});
+    EXPECT_EQ(proc.stdout_pipe().read_line(), "busy\n");
+
+    auto live = proc.resource_usage();
+    EXPECT_FALSE(live.exited);
+#ifdef __linux__
+    EXPECT_GT(live.cpu().count(), 0);
+    EXPECT_GT(live.rss_bytes, 0u);
+    EXPECT_GE(live.peak_rss_bytes, live.rss_bytes);
+    EXPECT_GT(live.voluntary_context_switches + live.involuntary_context_switches, 0u);
+#endif
+
+    proc.stdin_pipe().write("done\n");
+    EXPECT_EQ(proc.wait(), 0);
+
+    auto final_usage = proc.resource_usage();
+    EXPECT_TRUE(final_usage.exited);
+    EXPECT_EQ(final_usage.rss_bytes, 0u);
+    EXPECT_GT(final_usage.peak_rss_bytes, 0u);
+    EXPECT_GE(final_usage.cpu(), live.cpu());
+}
+#endif
+
+TEST(ProcessTest, OnExitRequiresSpawn)
+{
+    Process proc;
+    EXPECT_THROW(proc.on_exit([](int) {}), ProcessError);
+    EXPECT_EQ(proc.pidfd(), -1);
+}
+
+#ifdef __linux__
+TEST(ProcessTest, PidfdBecomesReadableOnExit)
+{
+    Process proc;
+    ProcessOptions opts;
+    opts.redirect_stdin = false;
+    opts.redirect_stdout = false;
+    proc.spawn("sleep", {"0.05"}, opts);
+
+    if (proc.pidfd() < 0)
+        GTEST_SKIP() << "pidfd_open not supported by this kernel";
+
+    pollfd pfd{proc.pidfd(), POLLIN, 0};
+    EXPECT_EQ(::poll(&pfd, 1, 0), 0);
+    EXPECT_EQ(::poll(&pfd, 1, 5000), 1);
+    EXPECT_FALSE(proc.is_running());
+    EXPECT_EQ(proc.wait(), 0);
+}
+#endif
+
+#ifndef _WIN32
+class ProcessSpawnMethodTest : public ::testing::TestWithParam<SpawnMethod>
+{
+};
+
+TEST_P(ProcessSpawnMethodTest, EnvironmentAndWorkingDirectory)
+{
+    Process proc;
+    ProcessOptions opts;
+    opts.spawn_method = GetParam();
+    opts.working_directory = "/";
+    opts.inherit_environment = false;
+    opts.environment["PATH"] = "/usr/bin:/bin";
+    opts.environment["TEST_VAR"] = "test_value";
+    proc.spawn("sh", {"-c", "echo \"$TEST_VAR|$(pwd)|${HOME:-unset}\""}, opts);
+
+    std::string line = proc.stdout_pipe().read_line();
+    EXPECT_EQ(proc.wait(), 0);
+    EXPECT_EQ(line, "test_value|/|unset\n");
+}
+
+TEST_P(ProcessSpawnMethodTest, RedirectsAllStreams)
+{
+    Process proc;
+    ProcessOptions opts;
+    opts.spawn_method = GetParam();
+    opts.redirect_stderr = true;
+    proc.spawn("sh", {"-c", "read x; echo \"out:$x\"; echo \"err:$x\" >&2"}, opts);
+
+    proc.stdin_pipe().write("ping\n");
+    proc.stdin_pipe().close();
+
+    EXPECT_EQ(proc.stdout_pipe().read_line(), "out:ping\n");
+    EXPECT_EQ(proc.stderr_pipe().read_line(), "err:ping\n");
+    EXPECT_EQ(proc.wait(), 0);
+}
+
+TEST_P(ProcessSpawnMethodTest, ReportsExecFailure)
+{
+    Process proc;
+    ProcessOptions opts;
+    opts.spawn_method = GetParam();
+
+    try
+    {
+        proc.spawn("this_executable_does_not_exist_12345", {}, opts);
+        FAIL() << "spawn should throw";
+    }
+    catch (const ProcessError& e)
+    {
+        std::string message = e.what();
+        EXPECT_NE(message.find("this_executable_does_not_exist_12345"), std::string::npos);
+    }
+
+    opts.working_directory = "/nonexistent_directory_12345";
+    EXPECT_THROW(proc.spawn("sh", {"-c", "true"}, opts), ProcessError);
+}
+
+TEST_P(ProcessSpawnMethodTest, SpawnSpecIsReusedAndFrozen)
+{
+    ProcessOptions opts;
+    opts.spawn_method = GetParam();
+    opts.environment["SPEC_VAR"] = "frozen";
+    ::unsetenv("SPEC_LATE");
+    SpawnSpec spec("sh", {"-c", "echo \"$SPEC_VAR|${SPEC_LATE:-unset}\""}, opts);
+
+    EXPECT_EQ(spec.executable(), "sh");
+    EXPECT_NE(spec.resolved_path().find('/'), std::string::npos);
+    EXPECT_EQ(spec.args().size(), 2u);
+    auto& env = spec.environment();
+    EXPECT_NE(std::find(env.begin(), env.end(), "SPEC_VAR=frozen"), env.end());
+
+    // Changes to the parent's environment after the build are not seen
+    ::setenv("SPEC_LATE", "late", 1);
+    SpawnSpec copy = spec;
+    for (const SpawnSpec* s : {&spec, &copy, &spec})
+    {
+        Process proc;
+        proc.spawn(*s);
+        EXPECT_EQ(proc.stdout_pipe().read_line(), "frozen|unset\n");
+        EXPECT_EQ(proc.wait(), 0);
+    }
+    ::unsetenv("SPEC_LATE");
+}
+
+#ifdef __linux__
+TEST_P(ProcessSpawnMethodTest, AppliesChildScheduling)
+{
+    cpu_set_t before;
+    ASSERT_EQ(pthread_getaffinity_np(pthread_self(), sizeof(before), &before), 0);
+
+    Process proc;
+    ProcessOptions opts;
+    opts.spawn_method = GetParam();
+    opts.scheduling.cpus = {0};
+    opts.scheduling.policy = SchedulingPolicy::Batch;
+    proc.spawn("sh", {"-c", "grep Cpus_allowed_list /proc/self/status; chrt -p $$"}, opts);
+
+    std::string cpus = proc.stdout_pipe().read_line();
+    std::string policy = proc.stdout_pipe().read_line();
+    EXPECT_EQ(proc.wait(), 0);
+    EXPECT_EQ(cpus, "Cpus_allowed_list:\t0\n");
+    if (!policy.empty()) // chrt (util-linux) may be missing
+    {
+        EXPECT_NE(policy.find("SCHED_BATCH"), std::string::npos) << policy;
+    }
+
+    // The spawning thread gets its own mask back
+    cpu_set_t after;
+    ASSERT_EQ(pthread_getaffinity_np(pthread_self(), sizeof(after), &after), 0);
+    EXPECT_TRUE(CPU_EQUAL(&before, &after));
+}
+#endif
+
+INSTANTIATE_TEST_SUITE_P(
+    Methods,
+    ProcessSpawnMethodTest,
+    ::testing::Values(SpawnMethod::PosixSpawn, SpawnMethod::Fork)
+);
+#endif
+
+// =============================================================================
+// CLI Log Tests
+// =============================================================================
+
+TEST(CliLogTest, SplitsChunksIntoLines)
+{
+    CliLog log;
+    auto feed = [&](std::string_view chunk) { log.feed(chunk.data(), chunk.size()); };
+    feed("[INFO] star");
+    feed("ting\r\n[WARN] slow\n2025-06-01T10:00:00Z error: boom\ntail");
+
+    auto lines = log.lines();
+    ASSERT_EQ(lines.size(), 3u);
+    EXPECT_EQ(lines[0].text, "[INFO] starting");
+    EXPECT_EQ(lines[0].level, LogLevel::Info);
+    EXPECT_EQ(lines[1].level, LogLevel::Warning);
+    EXPECT_EQ(lines[2].level, LogLevel::Error);
+
+    log.flush();
+    lines = log.lines();
+    ASSERT_EQ(lines.size(), 4u);
+    EXPECT_EQ(lines[3].text, "tail");
+    EXPECT_EQ(lines[3].level, LogLevel::None);
+
+    auto stats = log.stats();
+    EXPECT_EQ(stats.lines, 4u);
+    EXPECT_EQ(stats.bytes, 66u);
+    EXPECT_EQ(stats.infos, 1u);
+    EXPECT_EQ(stats.warnings, 1u);
+    EXPECT_EQ(stats.errors, 1u);
+    EXPECT_EQ(stats.unleveled, 1u);
+}
+
+TEST(CliLogTest, ParseLevel)
+{
+    EXPECT_EQ(CliLog::parse_level("DEBUG [rpc] sent 12 bytes"), LogLevel::Debug);
+    EXPECT_EQ(CliLog::parse_level("12:00:01.5 [Warning] retrying"), LogLevel::Warning);
+    EXPECT_EQ(CliLog::parse_level("fatal: cannot open"), LogLevel::Error);
+    EXPECT_EQ(CliLog::parse_level("connected to server with no error at all"), LogLevel::None);
+    EXPECT_EQ(CliLog::parse_level(""), LogLevel::None);
+}
+
+TEST(CliLogTest, RingIsBoundedAndLongLinesTruncated)
+{
+    std::vector<std::string> seen;
+    CliLog log(2, [&](const CliLogLine& line) { seen.push_back(line.text); });
+
+    std::string input = "a\nb\nc\n" + std::string(CliLog::kMaxLineLength + 100, 'x') + "\nd\n";
+    log.feed(input.data(), input.size());
+
+    auto lines = log.lines();
+    ASSERT_EQ(lines.size(), 2u);
+    EXPECT_EQ(lines[0].text.size(), CliLog::kMaxLineLength);
+    EXPECT_EQ(lines[1].text, "d");
+    EXPECT_EQ(seen.size(), 5u);
+
+    auto stats = log.stats();
+    EXPECT_EQ(stats.evicted, 3u);
+    EXPECT_EQ(stats.truncated, 1u);
+}
+
+TEST(CliLogTest, SinkMayReadTheLog)
+{
+    CliLog* self = nullptr;
+    std::vector<uint64_t> counts;
+    CliLog log(10, [&](const CliLogLine&) { counts.push_back(self->stats().lines); });
+    self = &log;
+
+    log.feed("a\nb\n", 4);
+    EXPECT_EQ(counts, (std::vector<uint64_t>{2, 2}));
+    EXPECT_EQ(log.lines().size(), 2u);
+}
+
+#ifndef _WIN32
+TEST(PipeDrainTest, VerboseStderrNeverBlocksTheChild)
+{
+    Process proc;
+    ProcessOptions opts;
+    opts.redirect_stdin = false;
+    opts.redirect_stdout = false;
+    opts.redirect_stderr = true;
+    // ~1 MB of stderr, far beyond the pipe buffer
+    std::string script = "i=0; while [ $i -lt 4000 ]; do "
+                         "echo \"DEBUG line $i $(printf '%0200d' 0)\" >&2; i=$((i+1)); done";
+    proc.spawn("sh", {"-c", script}, opts);
+
+    auto log = std::make_shared<CliLog>(100);
+    {
+        PipeDrain drain(proc.stderr_pipe(), log);
+        EXPECT_EQ(proc.wait(), 0);
+    }
+
+    auto stats = log->stats();
+    EXPECT_EQ(stats.lines, 4000u);
+    EXPECT_EQ(stats.debugs, 4000u);
+    EXPECT_EQ(stats.evicted, 3900u);
+    EXPECT_EQ(log->lines().back().text.substr(0, 15), "DEBUG line 3999");
+}
+#endif
+
+#ifdef __linux__
+// =============================================================================
+// Thread Options Tests
+// =============================================================================
+
+TEST(ThreadOptionsTest, NamesAndPinsThread)
+{
+    ThreadOptions options;
+    options.roles[ThreadRole::LogDrain].cpus = {0};
+
+    std::string name;
+    int cpu_count = 0;
+    bool cpu0 = false;
+    bool ok = false;
+    std::thread worker(
+        [&]
+        {
+            ok = configure_current_thread(options, ThreadRole::LogDrain);
+            char buffer[16] = {};
+            pthread_getname_np(pthread_self(), buffer, sizeof(buffer));
+            name = buffer;
+            cpu_set_t set;
+            pthread_getaffinity_np(pthread_self(), sizeof(set), &set);
+            cpu_count = CPU_COUNT(&set);
+            cpu0 = CPU_ISSET(0, &set);
+        }
+    );
+    worker.join();
+
+    EXPECT_TRUE(ok);
+    EXPECT_EQ(name, "copilot-stderr");
+    EXPECT_EQ(cpu_count, 1);
+    EXPECT_TRUE(cpu0);
+}
+
+TEST(ThreadOptionsTest, ExitWatcherAndDrainRunHook)
+{
+    std::promise<ThreadRole> exit_role;
+    std::promise<ThreadRole> drain_role;
+
+    Process proc;
+    ProcessOptions opts;
+    opts.redirect_stderr = true;
+    opts.on_thread_start = [&](ThreadRole role) { exit_role.set_value(role); };
+    proc.spawn("sh", {"-c", "echo done >&2"}, opts);
+    proc.on_exit([](int) {});
+
+    auto log = std::make_shared<CliLog>();
+    {
+        PipeDrain drain(
+            proc.stderr_pipe(), log, [&](ThreadRole role) { drain_role.set_value(role); }
+        );
+        proc.wait();
+    }
+
+    EXPECT_EQ(exit_role.get_future().get(), ThreadRole::ExitWatcher);
+    EXPECT_EQ(drain_role.get_future().get(), ThreadRole::LogDrain);
+}
+#endif
+
 // =============================================================================
 // Utility Function Tests
 // =============================================================================
@@ -192,6 +192,60 @@ TEST(TypesTest, SessionMetadataParsesIso8601Timestamps)
 // Events Tests
 // =============================================================================
 
+TEST(EventsTest, EventDataTypeMapsToEventType)
+{
+#define COPILOT_EXPECT_EVENT_TYPE(DataType, EventType)                                              \
+    static_assert(session_event_type_v<DataType> == SessionEventType::EventType)
+    COPILOT_EXPECT_EVENT_TYPE(SessionStartData, SessionStart);
+    COPILOT_EXPECT_EVENT_TYPE(SessionResumeData, SessionResume);
+    COPILOT_EXPECT_EVENT_TYPE(SessionErrorData, SessionError);
+    COPILOT_EXPECT_EVENT_TYPE(SessionIdleData, SessionIdle);
+    COPILOT_EXPECT_EVENT_TYPE(SessionInfoData, SessionInfo);
+    COPILOT_EXPECT_EVENT_TYPE(SessionModelChangeData, SessionModelChange);
+    COPILOT_EXPECT_EVENT_TYPE(SessionHandoffData, SessionHandoff);
+    COPILOT_EXPECT_EVENT_TYPE(SessionTruncationData, SessionTruncation);
+    COPILOT_EXPECT_EVENT_TYPE(UserMessageData, UserMessage);
+    COPILOT_EXPECT_EVENT_TYPE(PendingMessagesModifiedData, PendingMessagesModified);
+    COPILOT_EXPECT_EVENT_TYPE(AssistantTurnStartData, AssistantTurnStart);
+    COPILOT_EXPECT_EVENT_TYPE(AssistantIntentData, AssistantIntent);
+    COPILOT_EXPECT_EVENT_TYPE(AssistantReasoningData, AssistantReasoning);
+    COPILOT_EXPECT_EVENT_TYPE(AssistantReasoningDeltaData, AssistantReasoningDelta);
+    COPILOT_EXPECT_EVENT_TYPE(AssistantMessageData, AssistantMessage);
+    COPILOT_EXPECT_EVENT_TYPE(AssistantMessageDeltaData, AssistantMessageDelta);
+    COPILOT_EXPECT_EVENT_TYPE(AssistantTurnEndData, AssistantTurnEnd);
+    COPILOT_EXPECT_EVENT_TYPE(AssistantUsageData, AssistantUsage);
+    COPILOT_EXPECT_EVENT_TYPE(AbortData, Abort);
+    COPILOT_EXPECT_EVENT_TYPE(ToolUserRequestedData, ToolUserRequested);
+    COPILOT_EXPECT_EVENT_TYPE(ToolExecutionStartData, ToolExecutionStart);
+    COPILOT_EXPECT_EVENT_TYPE(ToolExecutionPartialResultData, ToolExecutionPartialResult);
+    COPILOT_EXPECT_EVENT_TYPE(ToolExecutionCompleteData, ToolExecutionComplete);
+    COPILOT_EXPECT_EVENT_TYPE(ToolExecutionProgressData, ToolExecutionProgress);
+    COPILOT_EXPECT_EVENT_TYPE(SessionCompactionStartData, SessionCompactionStart);
+    COPILOT_EXPECT_EVENT_TYPE(SessionCompactionCompleteData, SessionCompactionComplete);
+    COPILOT_EXPECT_EVENT_TYPE(SessionUsageInfoData, SessionUsageInfo);
+    COPILOT_EXPECT_EVENT_TYPE(CustomAgentStartedData, CustomAgentStarted);
+    COPILOT_EXPECT_EVENT_TYPE(CustomAgentCompletedData, CustomAgentCompleted);
+    COPILOT_EXPECT_EVENT_TYPE(CustomAgentFailedData, CustomAgentFailed);
+    COPILOT_EXPECT_EVENT_TYPE(CustomAgentSelectedData, CustomAgentSelected);
+    COPILOT_EXPECT_EVENT_TYPE(HookStartData, HookStart);
+    COPILOT_EXPECT_EVENT_TYPE(HookEndData, HookEnd);
+    COPILOT_EXPECT_EVENT_TYPE(SystemMessageData, SystemMessage);
+    COPILOT_EXPECT_EVENT_TYPE(SessionSnapshotRewindData, SessionSnapshotRewind);
+    COPILOT_EXPECT_EVENT_TYPE(SessionShutdownData, SessionShutdown);
+    COPILOT_EXPECT_EVENT_TYPE(SkillInvokedData, SkillInvoked);
+#undef COPILOT_EXPECT_EVENT_TYPE
+
+    // Parsed events carry the data alternative matching their type
+    json j = {
+        {"id", "evt-1"},
+        {"timestamp", "2025-01-01T00:00:00Z"},
+        {"type", "assistant.message_delta"},
+        {"data", {{"messageId", "m1"}, {"deltaContent", "x"}}}
+    };
+    auto event = parse_session_event(j);
+    EXPECT_EQ(event.data.index(), static_cast<std::size_t>(event.type));
+}
+
 TEST(EventsTest, SessionStartEvent)
 {
     json input = {
@@ -1789,3 +1843,24 @@ TEST(Events, SessionUsageInfoRecognized)
     EXPECT_EQ(data.token_limit, 128000);
     EXPECT_EQ(data.current_tokens, 5000);
 }
+
+TEST(Events, ParseEventsAfterKnownId)
+{
+    json events = json::array();
+    for (int i = 1; i <= 5; ++i)
+        events.push_back(
+            {{"type", "session.idle"},
+             {"id", "e" + std::to_string(i)},
+             {"timestamp", "2025-06-01T00:00:00Z"},
+             {"data", json::object()}}
+        );
+
+    auto tail = parse_session_events_after(events, "e3");
+    ASSERT_EQ(tail.size(), 2u);
+    EXPECT_EQ(tail[0].id, "e4");
+    EXPECT_EQ(tail[1].id, "e5");
+
+    EXPECT_TRUE(parse_session_events_after(events, "e5").empty());
+    EXPECT_EQ(parse_session_events_after(events, "missing").size(), 5u);
+    EXPECT_EQ(parse_session_events_after(events, "").size(), 5u);
+}